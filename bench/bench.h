@@ -0,0 +1,42 @@
+// SPDX-License-Identifier: GPL-3.0-only
+
+/**
+ * bench.h
+ * Small helpers shared by the benchmark programs. Each benchmark loads a Lua
+ * chunk defining a function and times repeated calls to it.
+ */
+
+#ifndef LUASTRUCT_BENCH_H
+#define LUASTRUCT_BENCH_H
+
+#include <stdio.h>
+#include <time.h>
+#include <lua.h>
+#include <lauxlib.h>
+
+/**
+ * Time calls to a global Lua function, passing it the value on top of the stack.
+ * @param state Lua state.
+ * @param label Label printed next to the result.
+ * @param function_name Name of the global function to call.
+ * @param iterations Number of calls.
+ * @return Average time per call in milliseconds.
+ */
+static inline double bench_lua_function(lua_State *state, const char *label, const char *function_name, int iterations) {
+    clock_t start = clock();
+    for(int i = 0; i < iterations; i++) {
+        lua_getglobal(state, function_name);
+        lua_pushvalue(state, -2);
+        if(lua_pcall(state, 1, 1, 0) != LUA_OK) {
+            fprintf(stderr, "Error: %s\n", lua_tostring(state, -1));
+            lua_pop(state, 1);
+            return -1;
+        }
+        lua_pop(state, 1);
+    }
+    double elapsed = (double)(clock() - start) * 1000.0 / CLOCKS_PER_SEC / iterations;
+    printf("  %-32s %10.3f ms\n", label, elapsed);
+    return elapsed;
+}
+
+#endif
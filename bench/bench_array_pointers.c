@@ -0,0 +1,125 @@
+// SPDX-License-Identifier: GPL-3.0-only
+
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <lua.h>
+#include <lualib.h>
+#include <lauxlib.h>
+#include "helpers.h"
+#include "array.h"
+#include "bench.h"
+
+#define ELEMENTS_COUNT (1 << 22)
+#define ITERATIONS 5
+
+/**
+ * One cache line per body, so that every element of the pointer arrays
+ * lands on a different line.
+ */
+typedef struct Body {
+    int32_t id;
+    float mass;
+    int32_t group;
+    uint8_t payload[52];
+} Body;
+
+typedef struct Scene {
+    Body **bodies;
+    float **masses;
+} Scene;
+
+static int get_elements_count(lua_State *state) {
+    lua_pushinteger(state, ELEMENTS_COUNT);
+    return 1;
+}
+
+static const char *lua_functions =
+    "function prepare(scene) masses = {} for i = 1, #scene.masses do masses[i] = scene.masses[i] end end\n"
+    "function bodies_aggregate(scene) return scene.bodies:aggregate{ by = 'group', sum = 'id' } end\n"
+    "function bodies_index(scene) return scene.bodies:index_by('id'):get(1) end\n"
+    "function masses_assign(scene) scene.masses:assign(masses) end\n"
+    "function bodies_pairs(scene) local n = 0 for _, body in pairs(scene.bodies) do n = n + 1 end return n end\n";
+
+static const struct {
+    const char *label;
+    const char *function_name;
+} benches[] = {
+    { "bodies:aggregate() by group", "bodies_aggregate" },
+    { "bodies:index_by()", "bodies_index" },
+    { "masses:assign()", "masses_assign" },
+    { "pairs(bodies)", "bodies_pairs" },
+};
+
+/**
+ * Shuffle the pointers so that consecutive elements are scattered over the
+ * whole pool, like objects allocated at different times.
+ */
+static void shuffle(Body **bodies, size_t count) {
+    for(size_t i = count - 1; i > 0; i--) {
+        size_t j = ((size_t)rand() * ((size_t)RAND_MAX + 1) + (size_t)rand()) % (i + 1);
+        Body *tmp = bodies[i];
+        bodies[i] = bodies[j];
+        bodies[j] = tmp;
+    }
+}
+
+int main(int argc, char *argv[]) {
+    size_t distance = argc > 1 ? strtoul(argv[1], NULL, 10) : LUAS_PREFETCH_DISTANCE;
+    lua_State *state = luaL_newstate();
+    luaL_openlibs(state);
+
+    Body *pool = malloc(sizeof(Body) * ELEMENTS_COUNT);
+    Scene scene;
+    scene.bodies = malloc(sizeof(Body *) * ELEMENTS_COUNT);
+    scene.masses = malloc(sizeof(float *) * ELEMENTS_COUNT);
+    for(int i = 0; i < ELEMENTS_COUNT; i++) {
+        pool[i].id = i + 1;
+        pool[i].mass = (float)(rand() % 10000) / 100.0f;
+        pool[i].group = rand() % 16;
+        scene.bodies[i] = &pool[i];
+    }
+    shuffle(scene.bodies, ELEMENTS_COUNT);
+    for(int i = 0; i < ELEMENTS_COUNT; i++) {
+        scene.masses[i] = &scene.bodies[i]->mass;
+    }
+
+    LUAS_STRUCT(state, Body);
+    LUAS_PRIMITIVE_FIELD(state, Body, id, LUAST_INT32, 0);
+    LUAS_PRIMITIVE_FIELD(state, Body, mass, LUAST_FLOAT, 0);
+    LUAS_PRIMITIVE_FIELD(state, Body, group, LUAST_INT32, 0);
+    lua_pop(state, 1);
+
+    LUAS_STRUCT(state, Scene);
+    LUAS_OBJREF_DYNAMIC_ARRAY_FIELD(state, Scene, bodies, get_elements_count, Body, LUAS_FIELD_POINTER);
+    LUAS_PRIMITIVE_DYNAMIC_ARRAY_FIELD(state, Scene, masses, get_elements_count, LUAST_FLOAT, LUAS_FIELD_POINTER);
+    lua_pop(state, 1);
+
+    if(luaL_dostring(state, lua_functions) != LUA_OK) {
+        fprintf(stderr, "Error: %s\n", lua_tostring(state, -1));
+        return EXIT_FAILURE;
+    }
+
+    LUAS_OBJECT(state, Scene, &scene, false);
+    lua_getglobal(state, "prepare");
+    lua_pushvalue(state, -2);
+    lua_call(state, 1, 0);
+    printf("Shuffled pointer arrays (%d elements), run with a distance argument to try other ones\n", ELEMENTS_COUNT);
+    for(size_t i = 0; i < sizeof(benches) / sizeof(benches[0]); i++) {
+        char label[64];
+        luastruct_set_prefetch_distance(state, 0);
+        snprintf(label, sizeof(label), "%s", benches[i].label);
+        double plain_time = bench_lua_function(state, label, benches[i].function_name, ITERATIONS);
+        luastruct_set_prefetch_distance(state, distance);
+        snprintf(label, sizeof(label), "%s prefetch %zu", benches[i].label, distance);
+        double prefetch_time = bench_lua_function(state, label, benches[i].function_name, ITERATIONS);
+        printf("  %-32s %10.2fx\n", "speedup", plain_time / prefetch_time);
+    }
+    lua_pop(state, 1);
+
+    lua_close(state);
+    free(scene.masses);
+    free(scene.bodies);
+    free(pool);
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,84 @@
+// SPDX-License-Identifier: GPL-3.0-only
+
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <lua.h>
+#include <lualib.h>
+#include <lauxlib.h>
+#include "helpers.h"
+#include "simd.h"
+#include "bench.h"
+
+#define ELEMENTS_COUNT (1 << 20)
+#define ITERATIONS 20
+
+typedef struct Telemetry {
+    float *samples;
+    int32_t *counters;
+} Telemetry;
+
+static int get_elements_count(lua_State *state) {
+    lua_pushinteger(state, ELEMENTS_COUNT);
+    return 1;
+}
+
+static const char *lua_loops = 
+    "function lua_sum(array) local sum = 0 for i = 1, #array do sum = sum + array[i] end return sum end\n"
+    "function lua_max(array) local max = array[1] for i = 2, #array do local v = array[i] if v > max then max = v end end return max end\n"
+    "function c_sum(array) return array:sum() end\n"
+    "function c_max(array) return array:max() end\n";
+
+static void bench_array(lua_State *state, const char *field) {
+    static const char *level_names[] = { "scalar", "sse2", "avx2" };
+    char label[64];
+
+    lua_getfield(state, -1, field);
+    printf("%s (%d elements)\n", field, ELEMENTS_COUNT);
+    double lua_time = bench_lua_function(state, "lua loop sum", "lua_sum", ITERATIONS);
+    bench_lua_function(state, "lua loop max", "lua_max", ITERATIONS);
+    for(LuastructSimdLevel level = LUAS_SIMD_SCALAR; level <= LUAS_SIMD_AVX2; level++) {
+        if(simd_set_level(level) != level) {
+            continue;
+        }
+        snprintf(label, sizeof(label), "arr:sum() %s", level_names[level]);
+        double c_time = bench_lua_function(state, label, "c_sum", ITERATIONS);
+        snprintf(label, sizeof(label), "arr:max() %s", level_names[level]);
+        bench_lua_function(state, label, "c_max", ITERATIONS);
+        printf("  %-32s %10.1fx\n", "sum speedup over lua loop", lua_time / c_time);
+    }
+    lua_pop(state, 1);
+}
+
+int main(int argc, char *argv[]) {
+    lua_State *state = luaL_newstate();
+    luaL_openlibs(state);
+
+    Telemetry telemetry;
+    telemetry.samples = malloc(sizeof(float) * ELEMENTS_COUNT);
+    telemetry.counters = malloc(sizeof(int32_t) * ELEMENTS_COUNT);
+    for(int i = 0; i < ELEMENTS_COUNT; i++) {
+        telemetry.samples[i] = (float)(rand() % 10000) / 100.0f;
+        telemetry.counters[i] = rand() % 100000 - 50000;
+    }
+
+    LUAS_STRUCT(state, Telemetry);
+    LUAS_PRIMITIVE_DYNAMIC_ARRAY_FIELD(state, Telemetry, samples, get_elements_count, LUAST_FLOAT, 0);
+    LUAS_PRIMITIVE_DYNAMIC_ARRAY_FIELD(state, Telemetry, counters, get_elements_count, LUAST_INT32, 0);
+    lua_pop(state, 1);
+
+    if(luaL_dostring(state, lua_loops) != LUA_OK) {
+        fprintf(stderr, "Error: %s\n", lua_tostring(state, -1));
+        return EXIT_FAILURE;
+    }
+
+    LUAS_OBJECT(state, Telemetry, &telemetry, false);
+    bench_array(state, "samples");
+    bench_array(state, "counters");
+    lua_pop(state, 1);
+
+    lua_close(state);
+    free(telemetry.samples);
+    free(telemetry.counters);
+    return EXIT_SUCCESS;
+}
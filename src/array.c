@@ -1,19 +1,47 @@
 // SPDX-License-Identifier: GPL-3.0-only
 
 #include <stdlib.h>
+#include <stdio.h>
 #include <string.h>
+#include <inttypes.h>
+#include <math.h>
 #include <lua.h>
 #include <lualib.h>
 #include <lauxlib.h>
 #include "luastruct.h"
+#include "array.h"
 #include "debug.h"
 
-static const char *ARRAY_METATABLE_NAME = "luastruct_array";
+/**
+ * Alignment of the elements of Lua-owned arrays: a cache line, which is
+ * also wider than any vector the SIMD kernels load.
+ */
+#define LUAS_OWNED_ARRAY_ALIGNMENT 64
+
+/**
+ * Key stored in every array metatable to recognize array objects.
+ */
+static const char array_metatable_marker = 0;
+
+static const char *ARRAY_METHODS_NAME = "luastruct_array_methods";
+
+/**
+ * Registry key of the prefetch distance of a state.
+ */
+static const char prefetch_distance_key = 0;
 
 LuastructTypeInfo *get_type_info(lua_State *state, LuastructType type, const char *type_name);
+int luastruct_get_type(lua_State *state, const char *name);
 size_t get_type_size(lua_State *state, LuastructType type, void *type_info);
 
-static int get_array_size(lua_State *state, LuastructArrayDesc *desc) {
+size_t checked_mul_size(lua_State *state, size_t count, size_t size) {
+    if(size != 0 && count > SIZE_MAX / size) {
+        luaL_error(state, "Array too large: %I elements of %I bytes", (lua_Integer)count, (lua_Integer)size);
+    }
+    return count * size;
+}
+
+lua_Integer get_array_size(lua_State *state, LuastructArrayDesc *desc) {
     if(desc->count_getter) {
         if(desc->count_getter(state) == 0) {
             return luaL_error(state, "Failed to get array size");
@@ -21,176 +49,342 @@ static int get_array_size(lua_State *state, LuastructArrayDesc *desc) {
         if(!lua_isinteger(state, -1)) {
             return luaL_error(state, "Array size is not an integer");
         }
-        int size = lua_tointeger(state, -1);
+        lua_Integer size = lua_tointeger(state, -1);
         lua_pop(state, 1);
         if(size <= 0) {
             return luaL_error(state, "Array size is negative");
         }
+        if(desc->elements_type != LUAST_BITFIELD) {
+            size_t slot_size = desc->elements_are_pointers ? sizeof(void *) : get_array_elements_size(state, desc);
+            checked_mul_size(state, (lua_Unsigned)size, slot_size);
+        }
         return size;
     }
     return desc->array_size;
 }
 
-int luastruct_array__index(lua_State *state) {
-    LuastructArray *array = luaL_checkudata(state, 1, ARRAY_METATABLE_NAME);
-    if(!array) {
-        return luaL_error(state, "Array is NULL in __index method");
+size_t get_array_elements_size(lua_State *state, LuastructArrayDesc *desc) {
+    if(desc->elements_size == 0) {
+        desc->elements_size = get_type_size(state, desc->elements_type, desc->elements_type_info);
     }
+    return desc->elements_size;
+}
 
-    int index = luaL_checkinteger(state, 2);
-    if(index < 1 || index > get_array_size(state, array->array_info)) {
-        lua_pushnil(state);
-        return 1;
+bool same_array_elements(lua_State *state, LuastructArrayDesc *a, LuastructArrayDesc *b) {
+    if(a->elements_type != b->elements_type || get_array_elements_size(state, a) != get_array_elements_size(state, b)) {
+        return false;
     }
+    switch(a->elements_type) {
+        case LUAST_STRUCT:
+        case LUAST_ENUM:
+            return strcmp(((LuastructTypeInfo *)a->elements_type_info)->name, ((LuastructTypeInfo *)b->elements_type_info)->name) == 0;
+        case LUAST_ARRAY:
+            return same_array_elements(state, a->elements_type_info, b->elements_type_info);
+        default:
+            return true;
+    }
+}
 
+size_t get_array_stride(lua_State *state, LuastructArray *array) {
+    if(array->stride) {
+        return array->stride;
+    }
+    if(array->array_info->elements_are_pointers) {
+        return sizeof(void *);
+    }
+    if(array->array_info->elements_type == LUAST_BITFIELD) {
+        // Packed bits are addressed by bit index, not by byte stride
+        return 0;
+    }
+    return get_array_elements_size(state, array->array_info);
+}
+
+bool is_array_contiguous(lua_State *state, LuastructArray *array) {
+    return !array->array_info->elements_are_pointers && get_array_stride(state, array) == get_array_elements_size(state, array->array_info);
+}
+
+/**
+ * Slot of a ring buffer holding the element at a zero-based logical index,
+ * which is at most the capacity of the ring.
+ */
+static size_t get_ring_position(LuastructArray *array, size_t index) {
+    size_t capacity = array->array_info->ring->capacity;
+    size_t position = ((LuastructRingArray *)array)->head + index;
+    return position >= capacity ? position - capacity : position;
+}
+
+void *get_array_element(lua_State *state, LuastructArray *array, size_t index) {
     LuastructArrayDesc *array_info = array->array_info;
-    LUAS_DEBUG_MSG("Accessing index #%d of array at 0x%.8X of type \"%s\"\n", index, array->data, luastruct_name_for_type(array_info->elements_type));
-    
-    void *data;
+    if(array_info->ring) {
+        index = get_ring_position(array, index);
+    }
+    void *data = array->data + index * get_array_stride(state, array);
     if(array_info->elements_are_pointers) {
-        data = *(void **)(array->data + (index - 1) * sizeof(void *));
+        return *(void **)data;
     } 
-    else {
-        if(array_info->elements_size == 0) {
-            array_info->elements_size = get_type_size(state, array_info->elements_type, array_info->elements_type_info);
+    return data;
+}
+
+void get_array_span(lua_State *state, LuastructArray *array, size_t first, size_t count, LuastructArraySpan *span) {
+    LuastructArrayDesc *array_info = array->array_info;
+    if(array_info->ring) {
+        first = get_ring_position(array, first);
+        if(count > 0 && first + count > array_info->ring->capacity) {
+            luaL_error(state, "Elements wrap around the end of the ring buffer");
+            return;
         }
-        data = array->data + (index - 1) * array_info->elements_size;
     }
+    span->elements_size = get_array_elements_size(state, array_info);
+    span->elements_type = array_info->elements_type;
+    span->elements_are_pointers = array_info->elements_are_pointers;
+    span->stride = get_array_stride(state, array);
+    span->data = (uint8_t *)array->data + first * span->stride;
+    span->count = count;
+}
 
-    switch(array_info->elements_type) {
-        case LUAST_INT8:
-            lua_pushinteger(state, *(int8_t *)(data));
-            break;
-        case LUAST_INT16:
-            lua_pushinteger(state, *(int16_t *)(data));
-            break;
-        case LUAST_INT32:
-            lua_pushinteger(state, *(int32_t *)(data));
-            break;
-        case LUAST_INT64:
-            lua_pushinteger(state, *(int64_t *)(data));
-            break;
-        case LUAST_UINT8:
-            lua_pushinteger(state, *(uint8_t *)(data));
-            break;
-        case LUAST_UINT16:
-            lua_pushinteger(state, *(uint16_t *)(data));
-            break;
-        case LUAST_UINT32:
-            lua_pushinteger(state, *(uint32_t *)(data));
-            break;
+size_t get_array_segments(lua_State *state, LuastructArray *array, size_t first, size_t count, LuastructArraySpan *spans) {
+    if(array->array_info->ring) {
+        size_t tail = array->array_info->ring->capacity - get_ring_position(array, first);
+        if(count > tail) {
+            get_array_span(state, array, first, tail, &spans[0]);
+            get_array_span(state, array, first + tail, count - tail, &spans[1]);
+            return 2;
+        }
+    }
+    get_array_span(state, array, first, count, &spans[0]);
+    return 1;
+}
+
+LuastructStructField *find_struct_field_path(lua_State *state, LuastructStruct *st, const char *path, uint32_t *offset, bool *readonly) {
+    *offset = 0;
+    *readonly = false;
+    const char *name = path;
+    for(;;) {
+        const char *end = strchr(name, '.');
+        size_t length = end ? (size_t)(end - name) : strlen(name);
+        LuastructStructField *field = st->fields_by_name;
+        while(field && (strncmp(field->field_name, name, length) != 0 || field->field_name[length] != '\0')) {
+            field = field->next_by_name;
+        }
+        if(!field) {
+            luaL_error(state, "Struct %s has no field \"%s\"", st->type_info.name, path);
+            return NULL;
+        }
+        *offset += field->offset;
+        *readonly = *readonly || field->readonly;
+        if(!end) {
+            return field;
+        }
+        if(field->type != LUAST_STRUCT || field->pointer) {
+            luaL_error(state, "Field \"%s\" is not an inline struct", field->field_name);
+            return NULL;
+        }
+        st = field->type_info;
+        name = end + 1;
+    }
+}
+
+static LuastructType get_key_type(lua_State *state, LuastructType type, void *type_info) {
+    switch(type) {
+        #define INTEGER_CASE(type, name) case type:
+        LUAS_FOREACH_INTEGER_TYPE(INTEGER_CASE)
+        #undef INTEGER_CASE
         case LUAST_FLOAT:
-            lua_pushnumber(state, *(float *)(data));
-            break;
+        case LUAST_BITFIELD:
+            return type;
         case LUAST_BOOL:
-            lua_pushboolean(state, *(bool *)(data));
-            break;
-        case LUAST_STRUCT:
+            return LUAST_UINT8;
         case LUAST_ENUM:
-            luastruct_new_object(state, ((LuastructTypeInfo *)array_info->elements_type_info)->name, data, array_info->elements_are_readonly);
-            break;
-        case LUAST_ARRAY:
-            return luaL_error(state, "Nested arrays are not supported");
-        case LUAST_BITFIELD:
-            return luaL_error(state, "Bitfields are not supported in arrays");
+            switch(((LuastructEnum *)type_info)->type) {
+                case LUAS_ENUM_INT8:
+                    return LUAST_INT8;
+                case LUAS_ENUM_INT16:
+                    return LUAST_INT16;
+                default:
+                    return LUAST_INT32;
+            }
         default:
-            return luaL_error(state, "Unknown field type: %d", array_info->elements_type);
+            return luaL_error(state, "Cannot use values of type %s as a key", luastruct_name_for_type(type));
     }
-
-    return 1;
 }
 
-int luastruct_array__newindex(lua_State *state) {
-    LuastructArray *array = luaL_checkudata(state, 1, ARRAY_METATABLE_NAME);
-    if(!array) {
-        return luaL_error(state, "Array is NULL in __newindex method");
+void check_array_key(lua_State *state, LuastructArrayDesc *desc, int index, LuastructArrayKey *key) {
+    key->offset = 0;
+    key->pointer = false;
+    key->bit_size = 0;
+    key->bit_offset = 0;
+    key->overflow = desc->overflow;
+    if(lua_isnoneornil(state, index)) {
+        key->type = get_key_type(state, desc->elements_type, desc->elements_type_info);
+        return;
     }
 
-    int index = luaL_checkinteger(state, 2);
-    if(index < 1 || index > get_array_size(state, array->array_info)) {
-        return luaL_error(state, "Tried to set an index out of bounds: %d", index);
+    const char *field_name = luaL_checkstring(state, index);
+    if(desc->elements_type != LUAST_STRUCT) {
+        luaL_error(state, "Array elements of type %s have no field \"%s\"", luastruct_name_for_type(desc->elements_type), field_name);
+        return;
+    }
+    bool readonly;
+    LuastructStructField *field = find_struct_field_path(state, desc->elements_type_info, field_name, &key->offset, &readonly);
+    key->type = get_key_type(state, field->type, field->type_info);
+    key->pointer = field->pointer;
+    key->overflow = field->overflow;
+    if(field->type == LUAST_BITFIELD) {
+        key->bit_size = field->bitfield.size;
+        key->bit_offset = field->bitfield.offset;
     }
+}
 
-    LuastructArrayDesc *array_info = array->array_info;
-    LUAS_DEBUG_MSG("Setting index #%d of array at 0x%.8X of type \"%s\"\n", index, array->data, luastruct_name_for_type(array_info->elements_type));
+lua_Integer read_array_key_integer(const LuastructArrayKey *key, const void *element) {
+    const void *data = (const uint8_t *)element + key->offset;
+    if(key->pointer) {
+        data = *(void **)data;
+    }
+    switch(key->type) {
+        #define INTEGER_CASE(type, name) case type: return *(const name##_t *)data;
+        LUAS_FOREACH_INTEGER_TYPE(INTEGER_CASE)
+        #undef INTEGER_CASE
+        case LUAST_FLOAT:
+            return *(const float *)data;
+        case LUAST_BITFIELD:
+            switch(key->bit_size) {
+                case 1:
+                    return (*(const uint8_t *)data >> key->bit_offset) & 1;
+                case 2:
+                    return (*(const uint16_t *)data >> key->bit_offset) & 1;
+                default:
+                    return (*(const uint32_t *)data >> key->bit_offset) & 1;
+            }
+        default:
+            return 0;
+    }
+}
 
-    if(array_info->elements_are_readonly) {
-        return luaL_error(state, "Array is read-only");
+lua_Number read_array_key_number(const LuastructArrayKey *key, const void *element) {
+    if(key->type == LUAST_FLOAT || key->type == LUAST_UINT64) {
+        const void *data = (const uint8_t *)element + key->offset;
+        if(key->pointer) {
+            data = *(void **)data;
+        }
+        if(key->type == LUAST_UINT64) {
+            // Keep values above LUA_MAXINTEGER positive
+            return (lua_Number)*(const uint64_t *)data;
+        }
+        return *(const float *)data;
     }
+    return read_array_key_integer(key, element);
+}
 
-    void *data;
-    if(array_info->elements_are_pointers) {
-        data = *(void **)(array->data + (index - 1) * sizeof(void *));
-    } 
-    else {
-        if(array_info->elements_size == 0) {
-            array_info->elements_size = get_type_size(state, array_info->elements_type, array_info->elements_type_info);
+void push_uint64(lua_State *state, uint64_t value, LuastructOverflow overflow) {
+    if(value <= (uint64_t)LUA_MAXINTEGER) {
+        lua_pushinteger(state, (lua_Integer)value);
+        return;
+    }
+    switch(overflow) {
+        case LUAS_OVERFLOW_ERROR: {
+            char digits[24];
+            snprintf(digits, sizeof(digits), "%" PRIu64, value);
+            luaL_error(state, "Value out of range for a Lua integer: %s", digits);
+            break;
+        }
+        case LUAS_OVERFLOW_FLOAT:
+            lua_pushnumber(state, (lua_Number)value);
+            break;
+        default:
+            lua_pushinteger(state, (lua_Integer)value);
+            break;
+    }
+}
+
+uint64_t check_uint64(lua_State *state, int index, LuastructOverflow overflow) {
+    int isnum;
+    lua_Integer integer = lua_tointegerx(state, index, &isnum);
+    if(isnum) {
+        if(integer < 0 && overflow != LUAS_OVERFLOW_WRAP) {
+            luaL_error(state, "Value out of range for uint64: %I", integer);
         }
-        data = array->data + (index - 1) * array_info->elements_size;
+        return (uint64_t)integer;
+    }
+    if(overflow != LUAS_OVERFLOW_FLOAT) {
+        return (uint64_t)luaL_checkinteger(state, index);
     }
+    // 2^64 is exactly representable, so the comparison does not round
+    lua_Number number = luaL_checknumber(state, index);
+    if(!(number >= 0 && number < 18446744073709551616.0) || number != floor(number)) {
+        luaL_error(state, "Value out of range for uint64: %f", number);
+    }
+    return (uint64_t)number;
+}
 
+void set_array_element(lua_State *state, LuastructArrayDesc *array_info, void *data, int value_index) {
     switch(array_info->elements_type) {
         case LUAST_INT8: {
-            lua_Integer value = luaL_checkinteger(state, 3);
+            lua_Integer value = luaL_checkinteger(state, value_index);
             if(value < INT8_MIN || value > INT8_MAX) {
-                return luaL_error(state, "Value out of range for int8: %d", value);
+                luaL_error(state, "Value out of range for int8: %I", value);
             }
             *(int8_t *)(data) = value;
             break;
         }
         case LUAST_INT16: {
-            lua_Integer value = luaL_checkinteger(state, 3);
+            lua_Integer value = luaL_checkinteger(state, value_index);
             if(value < INT16_MIN || value > INT16_MAX) {
-                return luaL_error(state, "Value out of range for int16: %d", value);
+                luaL_error(state, "Value out of range for int16: %I", value);
             }
             *(int16_t *)(data) = value;
             break;
         }
         case LUAST_INT32: {
-            lua_Integer value = luaL_checkinteger(state, 3);
+            lua_Integer value = luaL_checkinteger(state, value_index);
             if(value < INT32_MIN || value > INT32_MAX) {
-                return luaL_error(state, "Value out of range for int32: %d", value);
+                luaL_error(state, "Value out of range for int32: %I", value);
             }
             *(int32_t *)(data) = value;
             break;
         }
+        case LUAST_INT64:
+            *(int64_t *)(data) = luaL_checkinteger(state, value_index);
+            break;
+        case LUAST_UINT64:
+            *(uint64_t *)(data) = check_uint64(state, value_index, array_info->overflow);
+            break;
         case LUAST_UINT8: {
-            lua_Integer value = luaL_checkinteger(state, 3);
+            lua_Integer value = luaL_checkinteger(state, value_index);
             if(value < 0 || value > UINT8_MAX) {
-                return luaL_error(state, "Value out of range for uint8: %d", value);
+                luaL_error(state, "Value out of range for uint8: %I", value);
             }
             *(uint8_t *)(data) = value;
             break;
         }
         case LUAST_UINT16: {
-            lua_Integer value = luaL_checkinteger(state, 3);
+            lua_Integer value = luaL_checkinteger(state, value_index);
             if(value < 0 || value > UINT16_MAX) {
-                return luaL_error(state, "Value out of range for uint16: %d", value);
+                luaL_error(state, "Value out of range for uint16: %I", value);
             }
             *(uint16_t *)(data) = value;
             break;
         }
         case LUAST_UINT32: {
-            lua_Integer value = luaL_checkinteger(state, 3);
+            lua_Integer value = luaL_checkinteger(state, value_index);
             if(value < 0 || value > UINT32_MAX) {
-                return luaL_error(state, "Value out of range for uint32: %d", value);
+                luaL_error(state, "Value out of range for uint32: %I", value);
             }
             *(uint32_t *)(data) = value;
             break;
         }
         case LUAST_FLOAT:
-            *(float *)(data) = luaL_checknumber(state, 3);
+            *(float *)(data) = luaL_checknumber(state, value_index);
             break;
         case LUAST_BOOL:
-            *(bool *)(data) = lua_toboolean(state, 3);
+            *(bool *)(data) = lua_toboolean(state, value_index);
             break;
         case LUAST_STRUCT: {
-            LuastructStructObject *obj = luaL_checkudata(state, 3, STRUCT_METATABLE_NAME);
+            LuastructStructObject *obj = luaL_checkudata(state, value_index, OBJECT_METATABLE_NAME);
             if(!obj || obj->invalid) {
-                return luaL_error(state, "Object to copy is invalid");
+                luaL_error(state, "Object to copy is invalid");
             }
             if(obj->type != array_info->elements_type_info) {
-                return luaL_error(state, "Object type does not match array element type");
+                luaL_error(state, "Object type does not match array element type");
             }
             LuastructStruct *struct_info = obj->type;
             memcpy(data, obj->data, struct_info->size);
@@ -200,68 +394,237 @@ int luastruct_array__newindex(lua_State *state) {
             LuastructEnum *enum_type = array_info->elements_type_info;
             switch(enum_type->type) {
                 case LUAS_ENUM_INT8:
-                    *(int8_t *)(data) = luaL_checkinteger(state, 3);
+                    *(int8_t *)(data) = luaL_checkinteger(state, value_index);
                     break;
                 case LUAS_ENUM_INT16:
-                    *(int16_t *)(data) = luaL_checkinteger(state, 3);
+                    *(int16_t *)(data) = luaL_checkinteger(state, value_index);
                     break;
                 case LUAS_ENUM_INT32:
-                    *(int32_t *)(data) = luaL_checkinteger(state, 3);
+                    *(int32_t *)(data) = luaL_checkinteger(state, value_index);
                     break;
                 default:
-                    return luaL_error(state, "Invalid enum type");
+                    luaL_error(state, "Invalid enum type");
+                    break;
             }
             break;
         }
         case LUAST_ARRAY:
-            return luaL_error(state, "Nested arrays are not supported");
+            luaL_error(state, "Cannot assign to an array row, assign to its elements instead");
+            break;
+        case LUAST_BITFIELD:
+            luaL_error(state, "Bitfields are not supported in arrays");
+            break;
+        default:
+            luaL_error(state, "Unknown field type: %d", array_info->elements_type);
+            break;
+    }
+}
+
+int luastruct_array__index(lua_State *state) {
+    LuastructArray *array = check_array(state, 1);
+    if(!array) {
+        return luaL_error(state, "Array is NULL in __index method");
+    }
+
+    if(lua_type(state, 2) == LUA_TSTRING && !lua_isnumber(state, 2)) {
+        luaL_getmetafield(state, 1, "__methods");
+        lua_pushvalue(state, 2);
+        lua_rawget(state, -2);
+        return 1;
+    }
+
+    lua_Integer index = luaL_checkinteger(state, 2);
+    if(index < 1 || index > get_array_size(state, array->array_info)) {
+        lua_pushnil(state);
+        return 1;
+    }
+
+    LuastructArrayDesc *array_info = array->array_info;
+    LUAS_DEBUG_MSG("Accessing index #%lld of array at 0x%.8X of type \"%s\"\n", (long long)index, array->data, luastruct_name_for_type(array_info->elements_type));
+    
+    void *data = get_array_element(state, array, index - 1);
+    push_array_element(state, array_info, data);
+    inherit_buffer_owner(state, 1);
+    return 1;
+}
+
+int push_array_element(lua_State *state, LuastructArrayDesc *array_info, void *data) {
+    switch(array_info->elements_type) {
+        case LUAST_INT8:
+            lua_pushinteger(state, *(int8_t *)(data));
+            break;
+        case LUAST_INT16:
+            lua_pushinteger(state, *(int16_t *)(data));
+            break;
+        case LUAST_INT32:
+            lua_pushinteger(state, *(int32_t *)(data));
+            break;
+        case LUAST_INT64:
+            lua_pushinteger(state, *(int64_t *)(data));
+            break;
+        case LUAST_UINT64:
+            push_uint64(state, *(uint64_t *)(data), array_info->overflow);
+            break;
+        case LUAST_UINT8:
+            lua_pushinteger(state, *(uint8_t *)(data));
+            break;
+        case LUAST_UINT16:
+            lua_pushinteger(state, *(uint16_t *)(data));
+            break;
+        case LUAST_UINT32:
+            lua_pushinteger(state, *(uint32_t *)(data));
+            break;
+        case LUAST_FLOAT:
+            lua_pushnumber(state, *(float *)(data));
+            break;
+        case LUAST_BOOL:
+            lua_pushboolean(state, *(bool *)(data));
+            break;
+        case LUAST_STRUCT:
+        case LUAST_ENUM:
+            luastruct_new_object(state, ((LuastructTypeInfo *)array_info->elements_type_info)->name, data, array_info->elements_are_readonly);
+            break;
+        case LUAST_ARRAY:
+            luastruct_new_array(state, data, array_info->elements_type_info);
+            break;
         case LUAST_BITFIELD:
             return luaL_error(state, "Bitfields are not supported in arrays");
         default:
             return luaL_error(state, "Unknown field type: %d", array_info->elements_type);
     }
 
+    return 1;
+}
+
+int luastruct_array__newindex(lua_State *state) {
+    LuastructArray *array = check_array(state, 1);
+    if(!array) {
+        return luaL_error(state, "Array is NULL in __newindex method");
+    }
+
+    lua_Integer index = luaL_checkinteger(state, 2);
+    if(index < 1 || index > get_array_size(state, array->array_info)) {
+        return luaL_error(state, "Tried to set an index out of bounds: %I", index);
+    }
+
+    LuastructArrayDesc *array_info = array->array_info;
+    LUAS_DEBUG_MSG("Setting index #%lld of array at 0x%.8X of type \"%s\"\n", (long long)index, array->data, luastruct_name_for_type(array_info->elements_type));
+
+    if(array_info->elements_are_readonly) {
+        return luaL_error(state, "Array is read-only");
+    }
+
+    void *data = get_array_element(state, array, index - 1);
+    set_array_element(state, array_info, data, 3);
+
     return 0;
 }
 
+int luastruct_array_at(lua_State *state) {
+    LuastructArray *array = check_array(state, 1);
+    int dimensions = lua_gettop(state) - 1;
+    if(dimensions < 1) {
+        return luaL_error(state, "Expected at least one index");
+    }
+
+    LuastructArrayDesc *array_info = array->array_info;
+    void *data = array->data;
+    size_t stride = 0;
+    for(int i = 0; i < dimensions; i++) {
+        if(i > 0) {
+            if(array_info->elements_type != LUAST_ARRAY) {
+                return luaL_error(state, "Too many indices: the array has %d dimensions", i);
+            }
+            array_info = array_info->elements_type_info;
+            stride = array_info->elements_are_pointers ? sizeof(void *) : array_info->elements_type == LUAST_BITFIELD ? 0 : get_array_elements_size(state, array_info);
+        }
+        lua_Integer index = luaL_checkinteger(state, i + 2);
+        if(index < 1 || index > get_array_size(state, array_info)) {
+            lua_pushnil(state);
+            return 1;
+        }
+        if(array_info->elements_type == LUAST_BITFIELD) {
+            if(i + 1 < dimensions) {
+                return luaL_error(state, "Too many indices: the array has %d dimensions", i + 1);
+            }
+            lua_pushboolean(state, LUAS_BIT_GET(data, index - 1));
+            return 1;
+        }
+        if(i == 0) {
+            data = get_array_element(state, array, index - 1);
+            continue;
+        }
+        data = data + (index - 1) * stride;
+        if(array_info->elements_are_pointers) {
+            data = *(void **)data;
+        }
+    }
+    push_array_element(state, array_info, data);
+    inherit_buffer_owner(state, 1);
+    return 1;
+}
+
 int luastruct_array__len(lua_State *state) {
-    LuastructArray *array = luaL_checkudata(state, 1, ARRAY_METATABLE_NAME);
+    LuastructArray *array = check_array(state, 1);
     if(!array) {
         return luaL_error(state, "Array is NULL in __len method");
     }
 
-    int size = get_array_size(state, array->array_info);
+    lua_Integer size = get_array_size(state, array->array_info);
     lua_pushinteger(state, size);
     return 1;
 }
 
+void luastruct_set_prefetch_distance(lua_State *state, size_t distance) {
+    lua_pushinteger(state, (lua_Integer)distance);
+    lua_rawsetp(state, LUA_REGISTRYINDEX, &prefetch_distance_key);
+}
+
+size_t get_prefetch_distance(lua_State *state) {
+    size_t distance = LUAS_PREFETCH_DISTANCE;
+    if(lua_rawgetp(state, LUA_REGISTRYINDEX, &prefetch_distance_key) == LUA_TNUMBER) {
+        distance = (size_t)lua_tointeger(state, -1);
+    }
+    lua_pop(state, 1);
+    return distance;
+}
+
 int luastruct_array__next(lua_State *state) {
-    LuastructArray *array = luaL_checkudata(state, 1, ARRAY_METATABLE_NAME);
+    LuastructArray *array = check_array(state, 1);
     if(!array) {
         return luaL_error(state, "Array is NULL in __next method");
     }
     
-    int index = 0;
+    lua_Integer index = 0;
     if(!lua_isnil(state, 2)) {
         index = luaL_checkinteger(state, 2);
     }
     index++;
-    if(index < 1 || index > get_array_size(state, array->array_info)) {
+    lua_Integer size = get_array_size(state, array->array_info);
+    if(index < 1 || index > size) {
         lua_pushnil(state);
         return 1;
     }
 
     lua_pushinteger(state, index);
-	lua_pushcfunction(state, luastruct_array__index);
-	lua_pushvalue(state, 1);
-	lua_pushinteger(state, index);
-	lua_call(state, 2, 1);
+    if(array->array_info->elements_type == LUAST_BITFIELD) {
+        lua_pushboolean(state, LUAS_BIT_GET(array->data, index - 1));
+        return 2;
+    }
+    if(array->array_info->elements_are_pointers && !array->array_info->ring) {
+        // Iterating over pointers visits scattered elements, so fetch the next ones early
+        LuastructArraySpan span;
+        get_array_span(state, array, 0, size, &span);
+        prefetch_span_element(&span, index - 1, 0, get_prefetch_distance(state));
+    }
+    push_array_element(state, array->array_info, get_array_element(state, array, index - 1));
+    inherit_buffer_owner(state, 1);
 
     return 2;
 }
 
 int luastruct_array__pairs(lua_State *state) {
-    luaL_checkudata(state, 1, ARRAY_METATABLE_NAME);
+    check_array(state, 1);
 
     lua_pushvalue(state, lua_upvalueindex(1));
     lua_pushvalue(state, 1);
@@ -270,7 +633,14 @@ int luastruct_array__pairs(lua_State *state) {
     return 3;
 }
 
+static void check_bit_array_desc(lua_State *state, LuastructType type, bool elements_are_pointers) {
+    if(type == LUAST_BITFIELD && elements_are_pointers) {
+        luaL_error(state, "Packed bit arrays cannot have pointer elements");
+    }
+}
+
 void luastruct_new_dynamic_array_desc(lua_State *state, LuastructType type, const char *type_name, lua_CFunction count_getter, bool elements_are_pointers, bool readonly, LuastructArrayDesc *desc) {
+    check_bit_array_desc(state, type, elements_are_pointers);
     desc->count_getter = count_getter;
     desc->array_size = 0; 
     desc->elements_type = type;
@@ -278,9 +648,15 @@ void luastruct_new_dynamic_array_desc(lua_State *state, LuastructType type, cons
     desc->elements_size = 0;
     desc->elements_are_pointers = elements_are_pointers;
     desc->elements_are_readonly = readonly;
+    desc->vector = NULL;
+    desc->ring = NULL;
+    desc->list = NULL;
+    desc->map = NULL;
+    desc->overflow = LUAS_OVERFLOW_WRAP;
 }
 
 void luastruct_new_static_array_desc(lua_State *state, LuastructType type, const char *type_name, size_t size, bool elements_are_pointers, bool readonly, LuastructArrayDesc *desc) {
+    check_bit_array_desc(state, type, elements_are_pointers);
     desc->count_getter = NULL;
     desc->array_size = size;
     desc->elements_type = type;
@@ -288,25 +664,597 @@ void luastruct_new_static_array_desc(lua_State *state, LuastructType type, const
     desc->elements_size = 0;
     desc->elements_are_pointers = elements_are_pointers;
     desc->elements_are_readonly = readonly;
+    desc->vector = NULL;
+    desc->ring = NULL;
+    desc->list = NULL;
+    desc->map = NULL;
+    desc->overflow = LUAS_OVERFLOW_WRAP;
 }
 
-int luastruct_new_array(lua_State *state, void *data, LuastructArrayDesc *array_info) {
-    LuastructArray *array = lua_newuserdata(state, sizeof(LuastructArray));
-    array->data = data;
-    array->array_info = array_info;
+void copy_array_desc(const LuastructArrayDesc *source, LuastructArrayDesc *desc) {
+    *desc = *source;
+    if(source->elements_type == LUAST_ARRAY && source->elements_type_info) {
+        desc->elements_type_info = malloc(sizeof(LuastructArrayDesc));
+        copy_array_desc(source->elements_type_info, desc->elements_type_info);
+    }
+    if(source->vector) {
+        desc->vector = malloc(sizeof(LuastructVectorDesc));
+        memcpy(desc->vector, source->vector, sizeof(LuastructVectorDesc));
+    }
+    if(source->ring) {
+        desc->ring = malloc(sizeof(LuastructRingDesc));
+        memcpy(desc->ring, source->ring, sizeof(LuastructRingDesc));
+    }
+    if(source->list) {
+        desc->list = malloc(sizeof(LuastructListDesc));
+        memcpy(desc->list, source->list, sizeof(LuastructListDesc));
+    }
+    if(source->map) {
+        desc->map = malloc(sizeof(LuastructMapDesc));
+        memcpy(desc->map, source->map, sizeof(LuastructMapDesc));
+    }
+}
+
+void luastruct_free_array_desc(LuastructArrayDesc *desc) {
+    if(desc->elements_type == LUAST_ARRAY && desc->elements_type_info) {
+        luastruct_free_array_desc(desc->elements_type_info);
+        free(desc->elements_type_info);
+        desc->elements_type_info = NULL;
+    }
+    free(desc->vector);
+    free(desc->ring);
+    free(desc->list);
+    free(desc->map);
+    desc->vector = NULL;
+    desc->ring = NULL;
+    desc->list = NULL;
+    desc->map = NULL;
+}
+
+static void new_nested_array_desc(lua_State *state, const LuastructArrayDesc *inner, bool elements_are_pointers, bool readonly, LuastructArrayDesc *desc) {
+    if(inner == NULL) {
+        luaL_error(state, "Inner array info is NULL");
+    }
+    if(inner->count_getter && !elements_are_pointers) {
+        luaL_error(state, "Inline nested arrays must have a static size");
+    }
+    if(inner->vector || inner->ring || inner->list || inner->map) {
+        luaL_error(state, "Vectors, ring buffers, lists and maps cannot be nested in arrays");
+    }
+    desc->elements_type = LUAST_ARRAY;
+    desc->elements_size = inner->count_getter ? 0 : get_type_size(state, LUAST_ARRAY, (void *)inner);
+    desc->elements_are_pointers = elements_are_pointers;
+    desc->elements_are_readonly = readonly;
+    desc->vector = NULL;
+    desc->ring = NULL;
+    desc->list = NULL;
+    desc->map = NULL;
+    desc->overflow = LUAS_OVERFLOW_WRAP;
+    desc->elements_type_info = malloc(sizeof(LuastructArrayDesc));
+    copy_array_desc(inner, desc->elements_type_info);
+}
+
+void luastruct_new_static_nested_array_desc(lua_State *state, const LuastructArrayDesc *inner, size_t size, bool elements_are_pointers, bool readonly, LuastructArrayDesc *desc) {
+    desc->count_getter = NULL;
+    desc->array_size = size;
+    new_nested_array_desc(state, inner, elements_are_pointers, readonly, desc);
+}
+
+void luastruct_new_dynamic_nested_array_desc(lua_State *state, const LuastructArrayDesc *inner, lua_CFunction count_getter, bool elements_are_pointers, bool readonly, LuastructArrayDesc *desc) {
+    desc->count_getter = count_getter;
+    desc->array_size = 0;
+    new_nested_array_desc(state, inner, elements_are_pointers, readonly, desc);
+}
+
+void luastruct_new_vector_desc(lua_State *state, LuastructType type, const char *type_name, const LuastructVectorDesc *vector, bool readonly, LuastructArrayDesc *desc) {
+    switch(type) {
+        #define INTEGER_CASE(type, name) case type:
+        LUAS_FOREACH_INTEGER_TYPE(INTEGER_CASE)
+        #undef INTEGER_CASE
+        case LUAST_FLOAT:
+        case LUAST_BOOL:
+        case LUAST_STRUCT:
+        case LUAST_ENUM:
+            break;
+        default:
+            luaL_error(state, "Cannot create a vector of type %s", luastruct_name_for_type(type));
+            return;
+    }
+    switch(vector->size_type) {
+        case LUAST_INT32:
+        case LUAST_UINT32:
+        case LUAST_INT64:
+        case LUAST_UINT64:
+            break;
+        default:
+            luaL_error(state, "Vector sizes cannot be of type %s", luastruct_name_for_type(vector->size_type));
+            return;
+    }
+    if(vector->realloc == NULL) {
+        luaL_error(state, "Vector has no realloc function");
+        return;
+    }
+    luastruct_new_static_array_desc(state, type, type_name, 0, false, readonly, desc);
+    desc->vector = malloc(sizeof(LuastructVectorDesc));
+    memcpy(desc->vector, vector, sizeof(LuastructVectorDesc));
+}
+
+void luastruct_new_ring_desc(lua_State *state, LuastructType type, const char *type_name, const LuastructRingDesc *ring, bool readonly, LuastructArrayDesc *desc) {
+    switch(type) {
+        #define INTEGER_CASE(type, name) case type:
+        LUAS_FOREACH_INTEGER_TYPE(INTEGER_CASE)
+        #undef INTEGER_CASE
+        case LUAST_FLOAT:
+        case LUAST_BOOL:
+        case LUAST_STRUCT:
+        case LUAST_ENUM:
+            break;
+        default:
+            luaL_error(state, "Cannot create a ring buffer of type %s", luastruct_name_for_type(type));
+            return;
+    }
+    switch(ring->size_type) {
+        case LUAST_INT32:
+        case LUAST_UINT32:
+        case LUAST_INT64:
+        case LUAST_UINT64:
+            break;
+        default:
+            luaL_error(state, "Ring buffer positions cannot be of type %s", luastruct_name_for_type(ring->size_type));
+            return;
+    }
+    if(ring->capacity == 0) {
+        luaL_error(state, "Ring buffer has no capacity");
+        return;
+    }
+    luastruct_new_static_array_desc(state, type, type_name, 0, false, readonly, desc);
+    desc->ring = malloc(sizeof(LuastructRingDesc));
+    memcpy(desc->ring, ring, sizeof(LuastructRingDesc));
+}
+
+void luastruct_new_list_desc(lua_State *state, const char *type_name, const LuastructListDesc *list, bool readonly, LuastructArrayDesc *desc) {
+    luastruct_new_static_array_desc(state, LUAST_STRUCT, type_name, 0, false, readonly, desc);
+    size_t node_size = get_array_elements_size(state, desc);
+    if(list->next_offset + sizeof(void *) > node_size) {
+        luaL_error(state, "List next pointer is outside of the nodes: offset %I", (lua_Integer)list->next_offset);
+        return;
+    }
+    desc->list = malloc(sizeof(LuastructListDesc));
+    memcpy(desc->list, list, sizeof(LuastructListDesc));
+}
+
+void luastruct_new_map_desc(lua_State *state, LuastructType type, const char *type_name, const LuastructMapDesc *map, bool readonly, LuastructArrayDesc *desc) {
+    switch(type) {
+        #define INTEGER_CASE(type, name) case type:
+        LUAS_FOREACH_INTEGER_TYPE(INTEGER_CASE)
+        #undef INTEGER_CASE
+        case LUAST_FLOAT:
+        case LUAST_BOOL:
+        case LUAST_STRUCT:
+        case LUAST_ENUM:
+            break;
+        default:
+            luaL_error(state, "Cannot create a map of type %s", luastruct_name_for_type(type));
+            return;
+    }
+    switch(map->key_type) {
+        #define INTEGER_CASE(type, name) case type:
+        LUAS_FOREACH_INTEGER_TYPE(INTEGER_CASE)
+        #undef INTEGER_CASE
+            break;
+        default:
+            luaL_error(state, "Map keys cannot be of type %s", luastruct_name_for_type(map->key_type));
+            return;
+    }
+    switch(map->size_type) {
+        case LUAST_INT32:
+        case LUAST_UINT32:
+        case LUAST_INT64:
+        case LUAST_UINT64:
+            break;
+        default:
+            luaL_error(state, "Map capacity cannot be of type %s", luastruct_name_for_type(map->size_type));
+            return;
+    }
+    if(map->hash == LUAS_HASH_CUSTOM && map->hash_function == NULL) {
+        luaL_error(state, "Map has no hash function");
+        return;
+    }
+    if(map->hash > LUAS_HASH_CUSTOM) {
+        luaL_error(state, "Unknown map hash: %d", (int)map->hash);
+        return;
+    }
+    luastruct_new_static_array_desc(state, type, type_name, 0, false, readonly, desc);
+    desc->map = malloc(sizeof(LuastructMapDesc));
+    memcpy(desc->map, map, sizeof(LuastructMapDesc));
+}
+
+static const struct luaL_Reg luastruct_array_methods[] = {
+    {"assign", luastruct_array_assign},
+    {"fill", luastruct_array_fill},
+    {"setrange", luastruct_array_setrange},
+    {"tobytes", luastruct_array_tobytes},
+    {"frombytes", luastruct_array_frombytes},
+    {"copy", luastruct_array_copy},
+    {"swap", luastruct_array_swap},
+    {"reverse", luastruct_array_reverse},
+    {"rotate", luastruct_array_rotate},
+    {"equals", luastruct_array_equals},
+    {"diff", luastruct_array_diff},
+    {"sum", luastruct_array_sum},
+    {"min", luastruct_array_min},
+    {"max", luastruct_array_max},
+    {"minmax", luastruct_array_minmax},
+    {"mean", luastruct_array_mean},
+    {"dot", luastruct_array_dot},
+    {"find", luastruct_array_find},
+    {"count", luastruct_array_count},
+    {"indexof_all", luastruct_array_indexof_all},
+    {"sort", luastruct_array_sort},
+    {"bsearch", luastruct_array_bsearch},
+    {"lower_bound", luastruct_array_lower_bound},
+    {"upper_bound", luastruct_array_upper_bound},
+    {"column", luastruct_array_column},
+    {"view", luastruct_array_view},
+    {"at", luastruct_array_at},
+    {"index_by", luastruct_array_index_by},
+    {"where", luastruct_array_where},
+    {"aggregate", luastruct_array_aggregate},
+    {"add", luastruct_array_add},
+    {"mul", luastruct_array_mul},
+    {"axpy", luastruct_array_axpy},
+    {"clamp", luastruct_array_clamp},
+    {"lerp", luastruct_array_lerp},
+    {"popcount", luastruct_array_popcount},
+    {"first_set", luastruct_array_first_set},
+    {"band", luastruct_array_band},
+    {"bor", luastruct_array_bor},
+    {"bxor", luastruct_array_bxor},
+    {"bandnot", luastruct_array_bandnot},
+    {"frombools", luastruct_array_frombools},
+    {"tobools", luastruct_array_tobools},
+    {"push", luastruct_array_push},
+    {"pop", luastruct_array_pop},
+    {"reserve", luastruct_array_reserve},
+    {"resize", luastruct_array_resize},
+    {"capacity", luastruct_array_capacity},
+    {NULL, NULL}
+};
 
-    if(luaL_newmetatable(state, ARRAY_METATABLE_NAME) != 0) {
-        lua_pushcfunction(state, luastruct_array__index);
+/**
+ * Set the metatable of the array on top of the stack. Each kind of elements
+ * has its own metatable with specialized __index and __newindex; the other
+ * metamethods and the methods table are shared by all of them.
+ */
+static void set_array_metatable(lua_State *state, LuastructArray *array) {
+    const LuastructArrayKind *kind = get_array_kind(array->array_info);
+    if(luaL_newmetatable(state, kind ? kind->metatable_name : ARRAY_METATABLE_NAME) != 0) {
+        lua_pushcfunction(state, kind ? kind->index : luastruct_array__index);
         lua_setfield(state, -2, "__index");
-        lua_pushcfunction(state, luastruct_array__newindex);
+        lua_pushcfunction(state, kind ? kind->newindex : luastruct_array__newindex);
         lua_setfield(state, -2, "__newindex");
         lua_pushcfunction(state, luastruct_array__len);
         lua_setfield(state, -2, "__len");
         lua_pushcfunction(state, luastruct_array__next);
         lua_pushcclosure(state, luastruct_array__pairs, 1);
         lua_setfield(state, -2, "__pairs");
+        if(lua_getfield(state, LUA_REGISTRYINDEX, ARRAY_METHODS_NAME) == LUA_TNIL) {
+            lua_pop(state, 1);
+            luaL_newlib(state, luastruct_array_methods);
+            lua_pushvalue(state, -1);
+            lua_setfield(state, LUA_REGISTRYINDEX, ARRAY_METHODS_NAME);
+        }
+        lua_setfield(state, -2, "__methods");
+        lua_pushboolean(state, true);
+        lua_rawsetp(state, -2, &array_metatable_marker);
     }
     lua_setmetatable(state, -2);
+}
+
+LuastructArray *test_array(lua_State *state, int index) {
+    LuastructArray *array = lua_touserdata(state, index);
+    if(array && lua_getmetatable(state, index)) {
+        bool is_array = lua_rawgetp(state, -1, &array_metatable_marker) != LUA_TNIL;
+        lua_pop(state, 2);
+        if(is_array) {
+            return array;
+        }
+    }
+    return NULL;
+}
+
+LuastructArray *check_array(lua_State *state, int index) {
+    LuastructArray *array = test_array(state, index);
+    if(array) {
+        if(array->array_info->vector || array->array_info->ring) {
+            sync_array(state, array);
+        }
+        return array;
+    }
+    const char *message = lua_pushfstring(state, "%s expected, got %s", ARRAY_METATABLE_NAME, luaL_typename(state, index));
+    luaL_argerror(state, index, message);
+    return NULL;
+}
+
+/**
+ * Create a vector array over the header at data. The tracker of the header
+ * becomes the user value of the array, so that the proxies taken from it
+ * are rebased when its buffer moves.
+ */
+static int new_vector_array(lua_State *state, void *data, LuastructArrayDesc *array_info) {
+    LuastructVectorArray *vector = lua_newuserdata(state, sizeof(LuastructVectorArray));
+    vector->view.desc = *array_info;
+    vector->view.array.data = NULL;
+    vector->view.array.array_info = &vector->view.desc;
+    vector->view.array.stride = get_array_elements_size(state, array_info);
+    vector->header = data;
+    set_array_metatable(state, &vector->view.array);
+    sync_vector_array(state, &vector->view.array);
+    push_vector_tracker(state, data);
+    lua_setuservalue(state, -2);
+    return 1;
+}
+
+/**
+ * Reload the head and the count of a ring buffer array from its header.
+ */
+static void sync_ring_array(lua_State *state, LuastructArray *array) {
+    LuastructRingArray *ring = (LuastructRingArray *)array;
+    const LuastructRingDesc *layout = array->array_info->ring;
+    uint8_t *header = ring->header;
+    lua_Integer head = read_header_size(layout->size_type, header + layout->head_offset);
+    lua_Integer count = read_header_size(layout->size_type, header + layout->count_offset);
+    if(head < 0 || (size_t)head >= layout->capacity) {
+        luaL_error(state, "Ring buffer head out of bounds: %I", head);
+        return;
+    }
+    if(count < 0 || (size_t)count > layout->capacity) {
+        luaL_error(state, "Ring buffer count out of bounds: %I", count);
+        return;
+    }
+    ring->head = head;
+    ring->view.desc.array_size = count;
+}
+
+void sync_array(lua_State *state, LuastructArray *array) {
+    if(array->array_info->vector) {
+        sync_vector_array(state, array);
+    }
+    else if(array->array_info->ring) {
+        sync_ring_array(state, array);
+    }
+}
+
+/**
+ * Create a ring buffer array over the header at data. The slots start offset
+ * bytes after the header and are stride bytes apart.
+ */
+static int new_ring_array(lua_State *state, void *data, const LuastructArrayDesc *array_info, size_t offset, size_t stride) {
+    LuastructRingArray *ring = lua_newuserdata(state, sizeof(LuastructRingArray));
+    ring->view.desc = *array_info;
+    ring->view.array.data = (uint8_t *)data + offset;
+    ring->view.array.array_info = &ring->view.desc;
+    ring->view.array.stride = stride;
+    ring->header = data;
+    ring->offset = offset;
+    set_array_metatable(state, &ring->view.array);
+    sync_ring_array(state, &ring->view.array);
+    return 1;
+}
+
+int luastruct_new_array(lua_State *state, void *data, LuastructArrayDesc *array_info) {
+    if(array_info->list) {
+        return luastruct_new_list(state, data, array_info);
+    }
+    if(array_info->map) {
+        return luastruct_new_map(state, data, array_info);
+    }
+    if(array_info->vector) {
+        return new_vector_array(state, data, array_info);
+    }
+    if(array_info->ring) {
+        return new_ring_array(state, data, array_info, array_info->ring->data_offset, get_array_elements_size(state, array_info));
+    }
+    LuastructArray *array = lua_newuserdata(state, sizeof(LuastructArray));
+    array->data = data;
+    array->array_info = array_info;
+    array->stride = 0;
+    array->stride = get_array_stride(state, array);
+    set_array_metatable(state, array);
+
+    return 1;
+}
+
+int luastruct_new_array_view(lua_State *state, void *data, const LuastructArrayDesc *array_info, size_t stride) {
+    LuastructArrayView *view = lua_newuserdata(state, sizeof(LuastructArrayView));
+    view->desc = *array_info;
+    // A view has a fixed size, even when it is taken from a vector or a ring buffer
+    view->desc.vector = NULL;
+    view->desc.ring = NULL;
+    view->desc.list = NULL;
+    view->desc.map = NULL;
+    view->array.data = data;
+    view->array.array_info = &view->desc;
+    view->array.stride = stride;
+    set_array_metatable(state, &view->array);
+
+    return 1;
+}
+
+int luastruct_array_column(lua_State *state) {
+    LuastructArray *array = check_array(state, 1);
+    const char *path = luaL_checkstring(state, 2);
+
+    LuastructArrayDesc *array_info = array->array_info;
+    if(array_info->elements_type != LUAST_STRUCT) {
+        return luaL_error(state, "Array elements of type %s have no field \"%s\"", luastruct_name_for_type(array_info->elements_type), path);
+    }
+    if(array_info->elements_are_pointers) {
+        return luaL_error(state, "Cannot take a column of an array of pointers");
+    }
+
+    uint32_t offset;
+    bool readonly;
+    LuastructStructField *field = find_struct_field_path(state, array_info->elements_type_info, path, &offset, &readonly);
+    switch(field->type) {
+        #define INTEGER_CASE(type, name) case type:
+        LUAS_FOREACH_INTEGER_TYPE(INTEGER_CASE)
+        #undef INTEGER_CASE
+        case LUAST_FLOAT:
+        case LUAST_BOOL:
+        case LUAST_STRUCT:
+        case LUAST_ENUM:
+            break;
+        default:
+            return luaL_error(state, "Cannot take a column of type %s", luastruct_name_for_type(field->type));
+    }
+
+    LuastructArrayDesc column = *array_info;
+    column.elements_type = field->type;
+    column.elements_type_info = field->type_info;
+    column.elements_size = 0;
+    column.elements_are_pointers = field->pointer;
+    column.elements_are_readonly = array_info->elements_are_readonly || readonly;
+    column.overflow = field->overflow;
+    if(array_info->ring) {
+        // The column of a ring buffer wraps around with it
+        LuastructRingArray *ring = (LuastructRingArray *)array;
+        new_ring_array(state, ring->header, &column, ring->offset + offset, get_array_stride(state, array));
+        inherit_buffer_owner(state, 1);
+        return 1;
+    }
+    luastruct_new_array_view(state, array->data + offset, &column, get_array_stride(state, array));
+    inherit_buffer_owner(state, 1);
+    return 1;
+}
 
+int luastruct_array_view(lua_State *state) {
+    LuastructArray *array = check_array(state, 1);
+    LuastructArrayDesc *array_info = array->array_info;
+    lua_Integer size = get_array_size(state, array_info);
+    lua_Integer first = luaL_optinteger(state, 2, 1);
+    lua_Integer last = lua_isnoneornil(state, 3) ? size : luaL_checkinteger(state, 3);
+    if(array_info->elements_type == LUAST_BITFIELD) {
+        return luaL_error(state, "Cannot take a view of a packed bit array");
+    }
+    if(first < 1 || first > size + 1) {
+        return luaL_error(state, "Index out of bounds: %I", first);
+    }
+    if(last < first - 1 || last > size) {
+        return luaL_error(state, "Index out of bounds: %I", last);
+    }
+
+    size_t stride = get_array_stride(state, array);
+    checked_mul_size(state, last - first + 1, stride);
+    LuastructArraySpan span;
+    get_array_span(state, array, first - 1, last - first + 1, &span);
+    LuastructArrayDesc view = *array_info;
+    view.count_getter = NULL;
+    view.array_size = last - first + 1;
+    luastruct_new_array_view(state, span.data, &view, stride);
+    inherit_buffer_owner(state, 1);
     return 1;
 }
+
+void inherit_buffer_owner(lua_State *state, int parent_index) {
+    if(lua_type(state, -1) != LUA_TUSERDATA) {
+        return;
+    }
+    int owner_type = lua_getuservalue(state, parent_index);
+    if(owner_type != LUA_TUSERDATA && owner_type != LUA_TTABLE) {
+        lua_pop(state, 1);
+        return;
+    }
+    if(owner_type == LUA_TTABLE) {
+        // The parent lives in a vector buffer, which tracks the proxy to rebase it when the buffer moves
+        lua_pushvalue(state, -2);
+        lua_pushboolean(state, true);
+        lua_rawset(state, -3);
+    }
+    LuastructArray *array = test_array(state, -2);
+    if(array && array->array_info->vector) {
+        // A vector keeps its own tracker, which holds on to the buffer of its header instead
+        lua_getuservalue(state, -2);
+        lua_insert(state, -2);
+        lua_setfield(state, -2, "owner");
+        lua_pop(state, 1);
+        return;
+    }
+    lua_setuservalue(state, -2);
+}
+
+int luastruct_new_owned_array(lua_State *state, LuastructType type, const char *type_name, size_t count) {
+    switch(type) {
+        #define INTEGER_CASE(type, name) case type:
+        LUAS_FOREACH_INTEGER_TYPE(INTEGER_CASE)
+        #undef INTEGER_CASE
+        case LUAST_FLOAT:
+        case LUAST_BOOL:
+        case LUAST_STRUCT:
+        case LUAST_ENUM:
+            break;
+        default:
+            return luaL_error(state, "Cannot create an array of type %s", luastruct_name_for_type(type));
+    }
+
+    LuastructArrayDesc desc;
+    luastruct_new_static_array_desc(state, type, type_name, count, false, false, &desc);
+    if((type == LUAST_STRUCT || type == LUAST_ENUM) && desc.elements_type_info == NULL) {
+        return luaL_error(state, "Type not found: %s", type_name);
+    }
+    size_t size = checked_mul_size(state, count, get_array_elements_size(state, &desc));
+    if(size > SIZE_MAX - sizeof(LuastructArrayView) - LUAS_OWNED_ARRAY_ALIGNMENT) {
+        return luaL_error(state, "Array too large: %I elements of %I bytes", (lua_Integer)count, (lua_Integer)desc.elements_size);
+    }
+
+    // The elements follow the object in the same userdata, so they are freed with it
+    LuastructArrayView *view = lua_newuserdata(state, sizeof(LuastructArrayView) + size + LUAS_OWNED_ARRAY_ALIGNMENT - 1);
+    uintptr_t data = ((uintptr_t)(view + 1) + LUAS_OWNED_ARRAY_ALIGNMENT - 1) & ~(uintptr_t)(LUAS_OWNED_ARRAY_ALIGNMENT - 1);
+    memset((void *)data, 0, size);
+    view->desc = desc;
+    view->array.data = (void *)data;
+    view->array.array_info = &view->desc;
+    view->array.stride = desc.elements_size;
+    set_array_metatable(state, &view->array);
+
+    // An owned array is its own owner, which the proxies to its elements inherit
+    lua_pushvalue(state, -1);
+    lua_setuservalue(state, -2);
+    return 1;
+}
+
+/**
+ * Resolve the element type of newarray from a type object or a type name.
+ */
+static LuastructType check_element_type(lua_State *state, int index, const char **type_name) {
+    *type_name = NULL;
+    if(lua_type(state, index) == LUA_TUSERDATA) {
+        LuastructTypeInfo *type_info = luaL_checkudata(state, index, STRUCT_METATABLE_NAME);
+        *type_name = type_info->name;
+        return type_info->type;
+    }
+    const char *name = luaL_checkstring(state, index);
+    for(LuastructType type = LUAST_INT8; type <= LUAST_BOOL; type++) {
+        if(strcmp(name, luastruct_name_for_type(type)) == 0) {
+            return type;
+        }
+    }
+    if(luastruct_get_type(state, name) == 0) {
+        luaL_error(state, "Type not found: %s", name);
+        return LUAST_STRUCT;
+    }
+    LuastructTypeInfo *type_info = lua_touserdata(state, -1);
+    lua_pop(state, 1);
+    *type_name = type_info->name;
+    return type_info->type;
+}
+
+int luastruct_newarray(lua_State *state) {
+    const char *type_name;
+    LuastructType type = check_element_type(state, 1, &type_name);
+    lua_Integer count = luaL_checkinteger(state, 2);
+    if(count < 0) {
+        return luaL_error(state, "Array size is negative");
+    }
+    return luastruct_new_owned_array(state, type, type_name, count);
+}
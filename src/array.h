@@ -0,0 +1,562 @@
+// SPDX-License-Identifier: GPL-3.0-only
+
+/**
+ * array.h
+ * Internal helpers shared by the array implementation files. These are not
+ * part of the public API; embedders should only use luastruct.h and helpers.h.
+ */
+
+#ifndef LUASTRUCT_ARRAY_H
+#define LUASTRUCT_ARRAY_H
+
+#include <lua.h>
+#include "luastruct.h"
+
+static const char *ARRAY_METATABLE_NAME = "luastruct_array";
+
+/**
+ * Expands X(type, name) for every integer element type, where name##_t is
+ * the matching C type. Used to stamp out per-type kernels.
+ */
+#define LUAS_FOREACH_INTEGER_TYPE(X) \
+	X(LUAST_INT8, int8) \
+	X(LUAST_INT16, int16) \
+	X(LUAST_INT32, int32) \
+	X(LUAST_INT64, int64) \
+	X(LUAST_UINT8, uint8) \
+	X(LUAST_UINT16, uint16) \
+	X(LUAST_UINT32, uint32) \
+	X(LUAST_UINT64, uint64)
+
+/**
+ * Memory layout of a range of array elements. Bulk methods resolve the
+ * array once into a span and then walk it without touching the descriptor.
+ */
+typedef struct LuastructArraySpan {
+	uint8_t *data;
+	size_t count;
+	size_t stride;
+	size_t elements_size;
+	LuastructType elements_type;
+	bool elements_are_pointers;
+} LuastructArraySpan;
+
+/**
+ * Address of the element i of a span. For pointer element arrays the slots
+ * are dereferenced.
+ */
+#define LUAS_SPAN_ELEMENT(span, i) \
+	((span)->elements_are_pointers ? *(void **)((span)->data + (i) * (span)->stride) : (void *)((span)->data + (i) * (span)->stride))
+
+/**
+ * Whether the elements of a span are laid out back to back in memory,
+ * which is what the vectorized kernels require.
+ */
+#define LUAS_SPAN_IS_CONTIGUOUS(span) \
+	(!(span)->elements_are_pointers && (span)->stride == (span)->elements_size)
+
+#if defined(__GNUC__)
+#define LUAS_PREFETCH(address) __builtin_prefetch(address)
+#else
+#define LUAS_PREFETCH(address) ((void)(address))
+#endif
+
+/**
+ * Default number of elements the loops over arrays of pointers look ahead.
+ * Each element is a likely cache miss, so the distance must cover the
+ * latency of a memory load divided by the cost of one iteration.
+ */
+#define LUAS_PREFETCH_DISTANCE 16
+
+/**
+ * Number of elements the loops over arrays of pointers look ahead, as set
+ * by luastruct_set_prefetch_distance. Loops read it once before they start.
+ * @param state Lua state.
+ * @return The distance, LUAS_PREFETCH_DISTANCE unless it was set.
+ */
+size_t get_prefetch_distance(lua_State *state);
+
+/**
+ * Prefetch the element a loop over a span reaches a few iterations after
+ * the element i, and the pointer slot twice as far ahead so that loading
+ * that pointer does not miss either. Does nothing unless the elements of
+ * the span are pointers, since the hardware prefetcher already follows
+ * strided loops. Tight gather loops such as sum() or where() keep enough
+ * independent loads in flight on their own, so only the loops doing more
+ * work per element (hashing, converting Lua values, iterating) call this.
+ * @param span Span being walked in increasing order.
+ * @param i Index of the element about to be read.
+ * @param offset Offset of the bytes read from each element, such as a key field.
+ * @param distance Number of elements to look ahead, 0 to do nothing.
+ */
+static inline void prefetch_span_element(const LuastructArraySpan *span, size_t i, size_t offset, size_t distance) {
+	if(!span->elements_are_pointers || distance == 0) {
+		return;
+	}
+	size_t ahead = i + distance;
+	if(ahead + distance < span->count) {
+		LUAS_PREFETCH(span->data + (ahead + distance) * span->stride);
+	}
+	if(ahead < span->count) {
+		uint8_t *element = *(uint8_t **)(span->data + ahead * span->stride);
+		if(element) {
+			LUAS_PREFETCH(element + offset);
+		}
+	}
+}
+
+/**
+ * Read or write the bit i of a packed bit array. Bits are numbered from the
+ * least significant bit of the first byte, which on little-endian machines
+ * puts bit i in bit i % 64 of the 64-bit word i / 64.
+ */
+#define LUAS_BIT_GET(data, i) ((((const uint8_t *)(data))[(i) >> 3] >> ((i) & 7)) & 1)
+#define LUAS_BIT_SET(data, i, value) \
+	(((uint8_t *)(data))[(i) >> 3] = (value) \
+		? ((uint8_t *)(data))[(i) >> 3] | (uint8_t)(1u << ((i) & 7)) \
+		: ((uint8_t *)(data))[(i) >> 3] & (uint8_t)~(1u << ((i) & 7)))
+
+/**
+ * An array object that owns its descriptor, such as a view or a Lua-owned array.
+ */
+typedef struct LuastructArrayView {
+	LuastructArray array;
+	LuastructArrayDesc desc;
+} LuastructArrayView;
+
+/**
+ * An array object over a C vector. The data and the size of the array are
+ * reloaded from the header every time the array is checked.
+ */
+typedef struct LuastructVectorArray {
+	LuastructArrayView view;
+	void *header;
+} LuastructVectorArray;
+
+/**
+ * An array object over a C ring buffer. The head and the count are reloaded
+ * from the header every time the array is checked.
+ */
+typedef struct LuastructRingArray {
+	LuastructArrayView view;
+	void *header;
+	/**
+	 * Distance in bytes from the header to the first slot of the array,
+	 * which for columns includes the offset of the field.
+	 */
+	size_t offset;
+	size_t head;
+} LuastructRingArray;
+
+/**
+ * Maximum number of contiguous segments a range of array elements is made
+ * of: two for a ring buffer that wraps around, one for any other array.
+ */
+#define LUAS_MAX_SEGMENTS 2
+
+/**
+ * Location and type of the value an element is keyed by: either the element
+ * itself or one of its fields. Enums are resolved to the integer type of
+ * their storage. uint64 values are pushed with the overflow policy of the
+ * array or of the field.
+ */
+typedef struct LuastructArrayKey {
+	LuastructType type;
+	uint32_t offset;
+	bool pointer;
+	uint8_t bit_size;
+	uint8_t bit_offset;
+	LuastructOverflow overflow;
+} LuastructArrayKey;
+
+/**
+ * Metamethods specialized for one kind of elements: an element type, stored
+ * inline or behind pointers, writable or read-only.
+ */
+typedef struct LuastructArrayKind {
+	const char *metatable_name;
+	lua_CFunction index;
+	lua_CFunction newindex;
+} LuastructArrayKind;
+
+/**
+ * Get the specialized metamethods for the elements of an array.
+ * @param desc Array descriptor.
+ * @return The kind of the elements, or NULL if the generic metamethods must be used.
+ */
+const LuastructArrayKind *get_array_kind(LuastructArrayDesc *desc);
+
+/**
+ * Check that the value at the given stack index is an array object,
+ * whatever the kind of its elements.
+ * Raises an argument error otherwise.
+ * @param state Lua state.
+ * @param index Stack index of the value.
+ * @return The array object.
+ */
+LuastructArray *check_array(lua_State *state, int index);
+
+/**
+ * Get the array object at the given stack index without raising an error.
+ * Unlike check_array, vectors are not reloaded from their header.
+ * @param state Lua state.
+ * @param index Stack index of the value.
+ * @return The array object, or NULL if the value is not an array.
+ */
+LuastructArray *test_array(lua_State *state, int index);
+
+/**
+ * Reload the data pointer and the size of a vector array from its header,
+ * which C code may have changed since the array was last used.
+ * Raises an error if the count in the header exceeds its capacity.
+ * @param state Lua state.
+ * @param array Vector array object.
+ */
+void sync_vector_array(lua_State *state, LuastructArray *array);
+
+/**
+ * Reload an array over a C header, a vector or a ring buffer, from its header.
+ * Does nothing for other arrays.
+ * @param state Lua state.
+ * @param array Array object.
+ */
+void sync_array(lua_State *state, LuastructArray *array);
+
+/**
+ * Read a count, a capacity or a position stored in a C header.
+ * @param type Integer type of the value: int32, uint32, int64 or uint64.
+ * @param data Pointer to the value.
+ * @return The value, or -1 if it does not fit in a lua_Integer.
+ */
+lua_Integer read_header_size(LuastructType type, const void *data);
+
+/**
+ * Push the table tracking the proxies taken from the vector with the given
+ * header, creating it if needed. All the vector arrays over the same header
+ * share it.
+ * @param state Lua state.
+ * @param header Pointer to the vector header.
+ */
+void push_vector_tracker(lua_State *state, void *header);
+
+/**
+ * Multiply an element count by a size in bytes.
+ * Raises an error if the result does not fit in a size_t.
+ * @param state Lua state.
+ * @param count Number of elements.
+ * @param size Size of each element.
+ * @return The total size in bytes.
+ */
+size_t checked_mul_size(lua_State *state, size_t count, size_t size);
+
+/**
+ * Get the number of elements of an array. Sizes reported by a count getter
+ * are checked so that the array fits in the address space.
+ * @param state Lua state.
+ * @param desc Array descriptor.
+ * @return The number of elements in the array.
+ */
+lua_Integer get_array_size(lua_State *state, LuastructArrayDesc *desc);
+
+/**
+ * Get the size of the elements of an array, computing it from the
+ * element type the first time it is needed.
+ * @param state Lua state.
+ * @param desc Array descriptor.
+ * @return The size of each element in bytes.
+ */
+size_t get_array_elements_size(lua_State *state, LuastructArrayDesc *desc);
+
+/**
+ * Copy an array descriptor along with the descriptors it owns, so that the
+ * copy can be released with luastruct_free_array_desc independently.
+ * @param source Descriptor to copy.
+ * @param desc Descriptor to fill.
+ */
+void copy_array_desc(const LuastructArrayDesc *source, LuastructArrayDesc *desc);
+
+/**
+ * Whether the elements of two arrays have the same type, so that copying
+ * the bytes of one into the other is the same as assigning the elements.
+ * @param state Lua state.
+ * @param a First array descriptor.
+ * @param b Second array descriptor.
+ * @return True if the elements have the same type and size.
+ */
+bool same_array_elements(lua_State *state, LuastructArrayDesc *a, LuastructArrayDesc *b);
+
+/**
+ * Get the distance in bytes between consecutive elements of an array.
+ * For pointer element arrays this is the distance between the pointers.
+ * @param state Lua state.
+ * @param array Array object.
+ * @return The stride of the array.
+ */
+size_t get_array_stride(lua_State *state, LuastructArray *array);
+
+/**
+ * Whether the elements of an array are packed back to back in memory.
+ * @param state Lua state.
+ * @param array Array object.
+ * @return True if the array data is one contiguous block of elements.
+ */
+bool is_array_contiguous(lua_State *state, LuastructArray *array);
+
+/**
+ * Get a pointer to the data of an element of an array.
+ * @note The index is not bounds checked.
+ * @param state Lua state.
+ * @param array Array object.
+ * @param index Zero-based index of the element.
+ * @return Pointer to the element data.
+ */
+void *get_array_element(lua_State *state, LuastructArray *array, size_t index);
+
+/**
+ * Resolve a range of elements of an array into a span.
+ * Raises an error if the range wraps around the end of a ring buffer,
+ * use get_array_segments to handle those.
+ * @note The range is not bounds checked.
+ * @param state Lua state.
+ * @param array Array object.
+ * @param first Zero-based index of the first element.
+ * @param count Number of elements in the range.
+ * @param span Span to fill.
+ */
+void get_array_span(lua_State *state, LuastructArray *array, size_t first, size_t count, LuastructArraySpan *span);
+
+/**
+ * Resolve a range of elements of an array into contiguous spans, in order.
+ * Every array but a ring buffer whose range wraps around has one segment.
+ * @note The range is not bounds checked.
+ * @param state Lua state.
+ * @param array Array object.
+ * @param first Zero-based index of the first element.
+ * @param count Number of elements in the range.
+ * @param spans LUAS_MAX_SEGMENTS spans to fill.
+ * @return The number of spans filled.
+ */
+size_t get_array_segments(lua_State *state, LuastructArray *array, size_t first, size_t count, LuastructArraySpan *spans);
+
+/**
+ * Push a uint64 value, which is an integer unless it is above
+ * LUA_MAXINTEGER, where the overflow policy decides.
+ * @param state Lua state.
+ * @param value Value to push.
+ * @param overflow Policy for values above LUA_MAXINTEGER.
+ */
+void push_uint64(lua_State *state, uint64_t value, LuastructOverflow overflow);
+
+/**
+ * Convert the value at the given stack index to a uint64. Negative integers
+ * wrap around unless the overflow policy rejects them, and integral floats
+ * up to 2^64 are accepted with the float policy.
+ * @param state Lua state.
+ * @param index Stack index of the value.
+ * @param overflow Policy for values above LUA_MAXINTEGER.
+ * @return The value.
+ */
+uint64_t check_uint64(lua_State *state, int index, LuastructOverflow overflow);
+
+/**
+ * Write the value at the given stack index into an array element,
+ * performing the same type and range checks as the __newindex method.
+ * @param state Lua state.
+ * @param desc Array descriptor.
+ * @param data Pointer to the element data.
+ * @param value_index Stack index of the value to write.
+ */
+void set_array_element(lua_State *state, LuastructArrayDesc *desc, void *data, int value_index);
+
+/**
+ * Push the value of an array element onto the stack.
+ * Elements that are structs, enums or arrays are pushed as proxies.
+ * @param state Lua state.
+ * @param desc Array descriptor.
+ * @param data Pointer to the element data.
+ * @return The number of values pushed onto the stack.
+ */
+int push_array_element(lua_State *state, LuastructArrayDesc *desc, void *data);
+
+/**
+ * Find a field of a struct by its path. A path is a field name, or several
+ * names separated by dots to reach into nested struct fields. Every field
+ * but the last must be a struct stored inline.
+ * Raises an error if the path does not name a field.
+ * @param state Lua state.
+ * @param st Struct type.
+ * @param path Field path.
+ * @param offset Receives the offset of the field from the start of the struct.
+ * @param readonly Receives whether any field along the path is read-only.
+ * @return The last field of the path.
+ */
+LuastructStructField *find_struct_field_path(lua_State *state, LuastructStruct *st, const char *path, uint32_t *offset, bool *readonly);
+
+/**
+ * Make the proxy on top of the stack keep alive the Lua-owned buffer its
+ * parent points into. Does nothing if the parent does not live in such a
+ * buffer or the value on top of the stack is not a proxy. When the parent
+ * lives in a vector buffer, the proxy is also registered with the tracker
+ * of the vector so that it follows the buffer when it moves.
+ * @param state Lua state.
+ * @param parent_index Absolute stack index of the array or object the proxy was taken from.
+ */
+void inherit_buffer_owner(lua_State *state, int parent_index);
+
+/**
+ * Create an array object over the given data.
+ * @param state Lua state.
+ * @param data Pointer to the first element.
+ * @param array_info Array descriptor, which must outlive the object.
+ * @return The number of values pushed onto the stack.
+ */
+int luastruct_new_array(lua_State *state, void *data, LuastructArrayDesc *array_info);
+
+/**
+ * Create an array object that does not use the descriptor of a struct field,
+ * such as a view over another array. The descriptor is copied into the object.
+ * @param state Lua state.
+ * @param data Pointer to the first element.
+ * @param array_info Array descriptor to copy.
+ * @param stride Distance in bytes between elements, or 0 if they are packed.
+ * @return The number of values pushed onto the stack.
+ */
+int luastruct_new_array_view(lua_State *state, void *data, const LuastructArrayDesc *array_info, size_t stride);
+
+/**
+ * Resolve the key of the elements of an array. If the value at the given
+ * stack index is nil or absent the elements themselves are the key,
+ * otherwise it must be the path of a field of the struct elements.
+ * Raises an error if the key is not a number, a boolean or an enum.
+ * @param state Lua state.
+ * @param desc Array descriptor.
+ * @param index Stack index of the field name.
+ * @param key Key to fill.
+ */
+void check_array_key(lua_State *state, LuastructArrayDesc *desc, int index, LuastructArrayKey *key);
+
+/**
+ * Whether the values of a key are floating point numbers.
+ */
+#define LUAS_KEY_IS_FLOAT(key) ((key)->type == LUAST_FLOAT)
+
+/**
+ * Read the key of an element as an integer.
+ * @param key Element key.
+ * @param element Pointer to the element data.
+ * @return The key value.
+ */
+lua_Integer read_array_key_integer(const LuastructArrayKey *key, const void *element);
+
+/**
+ * Read the key of an element as a float.
+ * @param key Element key.
+ * @param element Pointer to the element data.
+ * @return The key value.
+ */
+lua_Number read_array_key_number(const LuastructArrayKey *key, const void *element);
+
+/**
+ * Hash the value of a key. The bits are mixed so that keys that only differ
+ * in their high bits or are multiples of a table size still spread over
+ * the slots of a power of two sized table.
+ * @param is_float Whether the key is the float number rather than the integer.
+ * @param integer Integer key value.
+ * @param number Float key value.
+ * @return The hash of the key.
+ */
+size_t hash_array_key(bool is_float, lua_Integer integer, lua_Number number);
+
+/**
+ * A predicate compiled from a where() query: the conjunction of its
+ * conditions. Its layout is private to array_where.c.
+ */
+typedef struct LuastructWherePlan LuastructWherePlan;
+
+/**
+ * Compile a where() query over the elements of an array descriptor, either a
+ * string such as "hp > 0 and team == 2" or a table of conditions. The plan
+ * is pushed onto the stack as a userdata.
+ * @param state Lua state.
+ * @param desc Descriptor of the elements the query applies to.
+ * @param index Stack index of the query.
+ * @return The plan.
+ */
+LuastructWherePlan *push_where_plan(lua_State *state, LuastructArrayDesc *desc, int index);
+
+/**
+ * Whether an element matches all the conditions of a plan.
+ * @param plan Compiled plan.
+ * @param element Pointer to the element data.
+ * @return True if the element matches.
+ */
+bool match_where_plan(const LuastructWherePlan *plan, const void *element);
+
+/**
+ * Create a list object over the head of an intrusive linked list.
+ * @param state Lua state.
+ * @param data Pointer to the head pointer, or to the sentinel node.
+ * @param array_info Descriptor of the list, with its layout.
+ * @return The number of values pushed onto the stack.
+ */
+int luastruct_new_list(lua_State *state, void *data, LuastructArrayDesc *array_info);
+
+/**
+ * Create a map object over the header of a C hash map.
+ * @param state Lua state.
+ * @param data Pointer to the map header.
+ * @param array_info Descriptor of the map, with its layout.
+ * @return The number of values pushed onto the stack.
+ */
+int luastruct_new_map(lua_State *state, void *data, LuastructArrayDesc *array_info);
+
+int luastruct_array_assign(lua_State *state);
+int luastruct_array_fill(lua_State *state);
+int luastruct_array_setrange(lua_State *state);
+int luastruct_array_tobytes(lua_State *state);
+int luastruct_array_frombytes(lua_State *state);
+int luastruct_array_copy(lua_State *state);
+int luastruct_array_swap(lua_State *state);
+int luastruct_array_reverse(lua_State *state);
+int luastruct_array_rotate(lua_State *state);
+int luastruct_array_equals(lua_State *state);
+int luastruct_array_diff(lua_State *state);
+int luastruct_array_sum(lua_State *state);
+int luastruct_array_min(lua_State *state);
+int luastruct_array_max(lua_State *state);
+int luastruct_array_minmax(lua_State *state);
+int luastruct_array_mean(lua_State *state);
+int luastruct_array_dot(lua_State *state);
+int luastruct_array_find(lua_State *state);
+int luastruct_array_count(lua_State *state);
+int luastruct_array_indexof_all(lua_State *state);
+int luastruct_array_sort(lua_State *state);
+int luastruct_array_bsearch(lua_State *state);
+int luastruct_array_lower_bound(lua_State *state);
+int luastruct_array_upper_bound(lua_State *state);
+int luastruct_array_column(lua_State *state);
+int luastruct_array_view(lua_State *state);
+int luastruct_array_at(lua_State *state);
+int luastruct_array_index_by(lua_State *state);
+int luastruct_array_where(lua_State *state);
+int luastruct_array_aggregate(lua_State *state);
+int luastruct_array_add(lua_State *state);
+int luastruct_array_mul(lua_State *state);
+int luastruct_array_axpy(lua_State *state);
+int luastruct_array_clamp(lua_State *state);
+int luastruct_array_lerp(lua_State *state);
+int luastruct_array_popcount(lua_State *state);
+int luastruct_array_first_set(lua_State *state);
+int luastruct_array_band(lua_State *state);
+int luastruct_array_bor(lua_State *state);
+int luastruct_array_bxor(lua_State *state);
+int luastruct_array_bandnot(lua_State *state);
+int luastruct_array_frombools(lua_State *state);
+int luastruct_array_tobools(lua_State *state);
+int luastruct_array_push(lua_State *state);
+int luastruct_array_pop(lua_State *state);
+int luastruct_array_reserve(lua_State *state);
+int luastruct_array_resize(lua_State *state);
+int luastruct_array_capacity(lua_State *state);
+
+#endif
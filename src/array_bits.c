@@ -0,0 +1,223 @@
+// SPDX-License-Identifier: GPL-3.0-only
+
+#include <stdlib.h>
+#include <string.h>
+#include <lua.h>
+#include <lualib.h>
+#include <lauxlib.h>
+#include "luastruct.h"
+#include "array.h"
+#include "simd.h"
+#include "debug.h"
+
+/**
+ * Check that the value at the given stack index is a packed bit array.
+ * @param state Lua state.
+ * @param index Stack index of the array.
+ * @param count Receives the number of bits of the array.
+ * @return The array object.
+ */
+static LuastructArray *check_bit_array(lua_State *state, int index, size_t *count) {
+    LuastructArray *array = check_array(state, index);
+    LuastructArrayDesc *array_info = array->array_info;
+    *count = 0;
+    if(array_info->elements_type != LUAST_BITFIELD) {
+        luaL_error(state, "Array elements are not packed bits: %s", luastruct_name_for_type(array_info->elements_type));
+        return NULL;
+    }
+    *count = get_array_size(state, array_info);
+    return array;
+}
+
+static void check_writable(lua_State *state, LuastructArray *array) {
+    if(array->array_info->elements_are_readonly) {
+        luaL_error(state, "Array is read-only");
+    }
+}
+
+/**
+ * Resolve the bool array at the given stack index, which must have as many
+ * elements as the bit array it is converted from or to.
+ */
+static LuastructArray *check_bool_span(lua_State *state, int index, size_t count, LuastructArraySpan *span) {
+    LuastructArray *array = check_array(state, index);
+    LuastructArrayDesc *array_info = array->array_info;
+    if(array_info->elements_type != LUAST_BOOL) {
+        luaL_error(state, "Array elements are not booleans: %s", luastruct_name_for_type(array_info->elements_type));
+        return NULL;
+    }
+    lua_Integer size = get_array_size(state, array_info);
+    if((size_t)size != count) {
+        luaL_error(state, "Array lengths do not match: %I != %I", (lua_Integer)count, size);
+        return NULL;
+    }
+    get_array_span(state, array, 0, count, span);
+    return array;
+}
+
+/**
+ * Mask of the bits of the last byte of a bit array that are part of it.
+ * Only meaningful when count is not a multiple of 8.
+ */
+static uint8_t tail_mask(size_t count) {
+    return (uint8_t)((1u << (count & 7)) - 1);
+}
+
+static uint64_t load_word(const uint8_t *data) {
+    uint64_t word;
+    memcpy(&word, data, sizeof(word));
+    return word;
+}
+
+/**
+ * Find the first set bit at or after a position.
+ * @return The zero-based position of the bit, or count if there is none.
+ */
+static size_t find_first_set(const uint8_t *data, size_t first, size_t count) {
+    size_t byte = first / 8;
+    size_t bytes = (count + 7) / 8;
+    unsigned bits = data[byte] & (0xFFu << (first & 7));
+    while(bits == 0) {
+        byte++;
+        while(byte + 8 <= bytes && load_word(data + byte) == 0) {
+            byte += 8;
+        }
+        if(byte >= bytes) {
+            return count;
+        }
+        bits = data[byte];
+    }
+    // Bits past the end of the array only live in the last byte, after every valid bit
+    size_t position = byte * 8 + __builtin_ctz(bits);
+    return position < count ? position : count;
+}
+
+int luastruct_array_popcount(lua_State *state) {
+    size_t count;
+    LuastructArray *array = check_bit_array(state, 1, &count);
+    const uint8_t *data = array->data;
+    uint64_t set = simd_popcount(data, count / 8);
+    if(count % 8 != 0) {
+        set += __builtin_popcount(data[count / 8] & tail_mask(count));
+    }
+    lua_pushinteger(state, (lua_Integer)set);
+    return 1;
+}
+
+int luastruct_array_first_set(lua_State *state) {
+    size_t count;
+    LuastructArray *array = check_bit_array(state, 1, &count);
+    lua_Integer first = luaL_optinteger(state, 2, 1);
+    if(first < 1) {
+        return luaL_error(state, "Index out of bounds: %I", first);
+    }
+    if((lua_Unsigned)first > count) {
+        lua_pushnil(state);
+        return 1;
+    }
+    size_t position = find_first_set(array->data, first - 1, count);
+    if(position == count) {
+        lua_pushnil(state);
+        return 1;
+    }
+    lua_pushinteger(state, position + 1);
+    return 1;
+}
+
+/**
+ * Combine the bit array at index 2 into the one at index 1. The bits of the
+ * last byte that are not part of the array are left as they are, so the
+ * array may share its last word with other data.
+ */
+static int combine_bit_arrays(lua_State *state, LuastructBitOp op) {
+    size_t count;
+    size_t other_count;
+    LuastructArray *array = check_bit_array(state, 1, &count);
+    LuastructArray *other = check_bit_array(state, 2, &other_count);
+    check_writable(state, array);
+    if(count != other_count) {
+        return luaL_error(state, "Array lengths do not match: %I != %I", (lua_Integer)count, (lua_Integer)other_count);
+    }
+
+    uint8_t *dst = array->data;
+    const uint8_t *src = other->data;
+    size_t bytes = (count + 7) / 8;
+    if(src != dst && src < dst + bytes && dst < src + bytes) {
+        uint8_t *copy = lua_newuserdata(state, bytes);
+        memcpy(copy, src, bytes);
+        src = copy;
+    }
+
+    simd_combine_bits(dst, src, count / 8, op);
+    if(count % 8 != 0) {
+        uint8_t mask = tail_mask(count);
+        uint8_t last = dst[count / 8];
+        simd_combine_bits(&last, src + count / 8, 1, op);
+        dst[count / 8] = (dst[count / 8] & ~mask) | (last & mask);
+    }
+    lua_settop(state, 1);
+    return 1;
+}
+
+int luastruct_array_band(lua_State *state) {
+    return combine_bit_arrays(state, LUAS_BITS_AND);
+}
+
+int luastruct_array_bor(lua_State *state) {
+    return combine_bit_arrays(state, LUAS_BITS_OR);
+}
+
+int luastruct_array_bxor(lua_State *state) {
+    return combine_bit_arrays(state, LUAS_BITS_XOR);
+}
+
+int luastruct_array_bandnot(lua_State *state) {
+    return combine_bit_arrays(state, LUAS_BITS_ANDNOT);
+}
+
+int luastruct_array_frombools(lua_State *state) {
+    size_t count;
+    LuastructArray *array = check_bit_array(state, 1, &count);
+    check_writable(state, array);
+    LuastructArraySpan span;
+    check_bool_span(state, 2, count, &span);
+
+    uint8_t *data = array->data;
+    size_t i = 0;
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+    if(LUAS_SPAN_IS_CONTIGUOUS(&span) && sizeof(bool) == 1) {
+        // Gather the low bit of 8 bools into the top byte of the product
+        for(; i + 8 <= count; i += 8) {
+            uint64_t bools = load_word(span.data + i) & UINT64_C(0x0101010101010101);
+            data[i / 8] = (uint8_t)((bools * UINT64_C(0x0102040810204080)) >> 56);
+        }
+    }
+#endif
+    for(; i + 8 <= count; i += 8) {
+        uint8_t byte = 0;
+        for(int bit = 0; bit < 8; bit++) {
+            byte |= (uint8_t)(*(const bool *)LUAS_SPAN_ELEMENT(&span, i + bit) ? 1u << bit : 0);
+        }
+        data[i / 8] = byte;
+    }
+    for(; i < count; i++) {
+        LUAS_BIT_SET(data, i, *(const bool *)LUAS_SPAN_ELEMENT(&span, i));
+    }
+    lua_settop(state, 1);
+    return 1;
+}
+
+int luastruct_array_tobools(lua_State *state) {
+    size_t count;
+    LuastructArray *array = check_bit_array(state, 1, &count);
+    LuastructArraySpan span;
+    LuastructArray *bools = check_bool_span(state, 2, count, &span);
+    check_writable(state, bools);
+
+    const uint8_t *data = array->data;
+    for(size_t i = 0; i < count; i++) {
+        *(bool *)LUAS_SPAN_ELEMENT(&span, i) = LUAS_BIT_GET(data, i);
+    }
+    lua_settop(state, 2);
+    return 1;
+}
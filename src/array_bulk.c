@@ -0,0 +1,298 @@
+// SPDX-License-Identifier: GPL-3.0-only
+
+#include <stdlib.h>
+#include <string.h>
+#include <lua.h>
+#include <lualib.h>
+#include <lauxlib.h>
+#include "luastruct.h"
+#include "array.h"
+#include "debug.h"
+
+static void check_writable_range(lua_State *state, LuastructArray *array, lua_Integer first, lua_Integer count) {
+    if(array->array_info->elements_are_readonly) {
+        luaL_error(state, "Array is read-only");
+    }
+    if(count <= 0) {
+        return;
+    }
+    lua_Integer size = get_array_size(state, array->array_info);
+    if(first < 1 || first > size) {
+        luaL_error(state, "Tried to set an index out of bounds: %I", first);
+    }
+    if(count > size - first + 1) {
+        luaL_error(state, "Tried to set an index out of bounds: %I", first + count - 1);
+    }
+}
+
+static void push_source_value(lua_State *state, int source, bool from_table, size_t index) {
+    if(from_table) {
+        lua_rawgeti(state, source, index + 1);
+    }
+    else {
+        lua_pushvalue(state, source + index);
+    }
+}
+
+/**
+ * Write count values into the array starting at the one-based index first.
+ * Values are taken from the keys 1..count of the table at source, or from the
+ * stack slots source..source + count - 1. The range must be checked by the caller.
+ * Every value is converted before the first one is stored, so that an invalid
+ * value leaves the array untouched.
+ */
+static void write_elements(lua_State *state, LuastructArray *array, lua_Integer first, size_t count, int source, bool from_table) {
+    LuastructArrayDesc *array_info = array->array_info;
+    LuastructArraySpan spans[LUAS_MAX_SEGMENTS];
+    size_t segments = get_array_segments(state, array, first - 1, count, spans);
+    size_t elements_size = get_array_elements_size(state, array_info);
+    uint8_t *staging = lua_newuserdata(state, checked_mul_size(state, count, elements_size));
+
+    LUAS_DEBUG_MSG("Writing %zu elements from index #%lld of array at 0x%.8X of type \"%s\"\n", count, (long long)first, array->data, luastruct_name_for_type(array_info->elements_type));
+
+    #define STAGED(i) (staging + (i) * elements_size)
+    #define CONVERT_INTEGER_ELEMENTS(ctype, type_name, min, max) \
+        for(size_t i = 0; i < count; i++) { \
+            int isnum; \
+            push_source_value(state, source, from_table, i); \
+            lua_Integer value = lua_tointegerx(state, -1, &isnum); \
+            if(!isnum) { \
+                luaL_error(state, "Value #%I is not an integer", (lua_Integer)(i + 1)); \
+            } \
+            if(value < min || value > max) { \
+                luaL_error(state, "Value out of range for " type_name ": %I", value); \
+            } \
+            *(ctype *)STAGED(i) = value; \
+            lua_pop(state, 1); \
+        }
+
+    switch(array_info->elements_type) {
+        case LUAST_INT8:
+            CONVERT_INTEGER_ELEMENTS(int8_t, "int8", INT8_MIN, INT8_MAX);
+            break;
+        case LUAST_INT16:
+            CONVERT_INTEGER_ELEMENTS(int16_t, "int16", INT16_MIN, INT16_MAX);
+            break;
+        case LUAST_INT32:
+            CONVERT_INTEGER_ELEMENTS(int32_t, "int32", INT32_MIN, INT32_MAX);
+            break;
+        case LUAST_UINT8:
+            CONVERT_INTEGER_ELEMENTS(uint8_t, "uint8", 0, UINT8_MAX);
+            break;
+        case LUAST_UINT16:
+            CONVERT_INTEGER_ELEMENTS(uint16_t, "uint16", 0, UINT16_MAX);
+            break;
+        case LUAST_UINT32:
+            CONVERT_INTEGER_ELEMENTS(uint32_t, "uint32", 0, UINT32_MAX);
+            break;
+        case LUAST_FLOAT:
+            for(size_t i = 0; i < count; i++) {
+                int isnum;
+                push_source_value(state, source, from_table, i);
+                lua_Number value = lua_tonumberx(state, -1, &isnum);
+                if(!isnum) {
+                    luaL_error(state, "Value #%I is not a number", (lua_Integer)(i + 1));
+                }
+                *(float *)STAGED(i) = value;
+                lua_pop(state, 1);
+            }
+            break;
+        case LUAST_BOOL:
+            for(size_t i = 0; i < count; i++) {
+                push_source_value(state, source, from_table, i);
+                *(bool *)STAGED(i) = lua_toboolean(state, -1);
+                lua_pop(state, 1);
+            }
+            break;
+        default:
+            for(size_t i = 0; i < count; i++) {
+                push_source_value(state, source, from_table, i);
+                set_array_element(state, array_info, STAGED(i), lua_gettop(state));
+                lua_pop(state, 1);
+            }
+            break;
+    }
+
+    // A ring buffer that wraps around continues in the second span
+    size_t staged = 0;
+    for(size_t s = 0; s < segments; s++) {
+        LuastructArraySpan *span = &spans[s];
+        if(LUAS_SPAN_IS_CONTIGUOUS(span)) {
+            memcpy(span->data, STAGED(staged), span->count * elements_size);
+        }
+        else {
+            size_t distance = get_prefetch_distance(state);
+            for(size_t i = 0; i < span->count; i++) {
+                prefetch_span_element(span, i, 0, distance);
+                memcpy(LUAS_SPAN_ELEMENT(span, i), STAGED(staged + i), elements_size);
+            }
+        }
+        staged += span->count;
+    }
+    lua_pop(state, 1);
+
+    #undef CONVERT_INTEGER_ELEMENTS
+    #undef STAGED
+}
+
+/**
+ * Replicate the element at the start of a contiguous block over the following
+ * count - 1 slots. Single byte patterns are delegated to memset, everything else
+ * is copied in doubling chunks.
+ */
+static void fill_pattern(void *data, size_t elements_size, size_t count) {
+    uint8_t *bytes = data;
+    bool uniform = true;
+    for(size_t i = 1; i < elements_size && uniform; i++) {
+        uniform = bytes[i] == bytes[0];
+    }
+    if(uniform) {
+        memset(bytes + elements_size, bytes[0], (count - 1) * elements_size);
+        return;
+    }
+    size_t total = count * elements_size;
+    size_t filled = elements_size;
+    while(filled < total) {
+        size_t chunk = filled < total - filled ? filled : total - filled;
+        memcpy(bytes + filled, bytes, chunk);
+        filled += chunk;
+    }
+}
+
+int luastruct_array_assign(lua_State *state) {
+    LuastructArray *array = check_array(state, 1);
+    luaL_checktype(state, 2, LUA_TTABLE);
+
+    lua_Integer count = lua_rawlen(state, 2);
+    lua_Integer size = get_array_size(state, array->array_info);
+    if(count > size) {
+        return luaL_error(state, "Table has more elements than the array: %I > %I", count, size);
+    }
+    check_writable_range(state, array, 1, count);
+    write_elements(state, array, 1, count, 2, true);
+    return 0;
+}
+
+int luastruct_array_fill(lua_State *state) {
+    LuastructArray *array = check_array(state, 1);
+    luaL_checkany(state, 2);
+
+    LuastructArrayDesc *array_info = array->array_info;
+    lua_Integer first = luaL_optinteger(state, 3, 1);
+    lua_Integer last = lua_isnoneornil(state, 4) ? get_array_size(state, array_info) : luaL_checkinteger(state, 4);
+    if(last < first) {
+        return 0;
+    }
+    check_writable_range(state, array, first, last - first + 1);
+
+    size_t count = last - first + 1;
+    size_t elements_size = get_array_elements_size(state, array_info);
+    void *data = get_array_element(state, array, first - 1);
+    set_array_element(state, array_info, data, 2);
+    if(!is_array_contiguous(state, array)) {
+        for(size_t i = 1; i < count; i++) {
+            memcpy(get_array_element(state, array, first - 1 + i), data, elements_size);
+        }
+        return 0;
+    }
+    LuastructArraySpan spans[LUAS_MAX_SEGMENTS];
+    size_t segments = get_array_segments(state, array, first - 1, count, spans);
+    fill_pattern(data, elements_size, spans[0].count);
+    if(segments > 1) {
+        memcpy(spans[1].data, data, elements_size);
+        fill_pattern(spans[1].data, elements_size, spans[1].count);
+    }
+    return 0;
+}
+
+int luastruct_array_setrange(lua_State *state) {
+    LuastructArray *array = check_array(state, 1);
+    lua_Integer first = luaL_checkinteger(state, 2);
+    lua_Integer count = lua_gettop(state) - 2;
+
+    check_writable_range(state, array, first, count);
+    write_elements(state, array, first, count, 3, false);
+    return 0;
+}
+
+static void check_readable_range(lua_State *state, LuastructArray *array, lua_Integer first, lua_Integer last) {
+    lua_Integer size = get_array_size(state, array->array_info);
+    // An empty range may start just past the end, so that empty arrays can be read
+    if(first < 1 || first > size + 1 || (first > size && last >= first)) {
+        luaL_error(state, "Index out of bounds: %I", first);
+    }
+    if(last < first - 1 || last > size) {
+        luaL_error(state, "Index out of bounds: %I", last);
+    }
+}
+
+int luastruct_array_tobytes(lua_State *state) {
+    LuastructArray *array = check_array(state, 1);
+    LuastructArrayDesc *array_info = array->array_info;
+    lua_Integer first = luaL_optinteger(state, 2, 1);
+    lua_Integer last = lua_isnoneornil(state, 3) ? get_array_size(state, array_info) : luaL_checkinteger(state, 3);
+    check_readable_range(state, array, first, last);
+    if(last < first) {
+        lua_pushliteral(state, "");
+        return 1;
+    }
+
+    size_t count = last - first + 1;
+    size_t elements_size = get_array_elements_size(state, array_info);
+    size_t length = checked_mul_size(state, count, elements_size);
+    LuastructArraySpan spans[LUAS_MAX_SEGMENTS];
+    size_t segments = get_array_segments(state, array, first - 1, count, spans);
+    bool contiguous = is_array_contiguous(state, array);
+    if(contiguous && segments == 1) {
+        lua_pushlstring(state, (const char *)spans[0].data, length);
+        return 1;
+    }
+
+    luaL_Buffer buffer;
+    char *bytes = luaL_buffinitsize(state, &buffer, length);
+    if(contiguous) {
+        // The two segments of a ring buffer, oldest elements first
+        memcpy(bytes, spans[0].data, spans[0].count * elements_size);
+        memcpy(bytes + spans[0].count * elements_size, spans[1].data, spans[1].count * elements_size);
+    }
+    else {
+        for(size_t i = 0; i < count; i++) {
+            memcpy(bytes + i * elements_size, get_array_element(state, array, first - 1 + i), elements_size);
+        }
+    }
+    luaL_pushresultsize(&buffer, length);
+    return 1;
+}
+
+int luastruct_array_frombytes(lua_State *state) {
+    LuastructArray *array = check_array(state, 1);
+    size_t length;
+    const char *bytes = luaL_checklstring(state, 2, &length);
+    lua_Integer first = luaL_optinteger(state, 3, 1);
+
+    LuastructArrayDesc *array_info = array->array_info;
+    size_t elements_size = get_array_elements_size(state, array_info);
+    if(length % elements_size != 0) {
+        return luaL_error(state, "String length is not a multiple of the element size: %I %% %I", (lua_Integer)length, (lua_Integer)elements_size);
+    }
+
+    size_t count = length / elements_size;
+    check_writable_range(state, array, first, count);
+    if(count == 0) {
+        return 0;
+    }
+    if(is_array_contiguous(state, array)) {
+        LuastructArraySpan spans[LUAS_MAX_SEGMENTS];
+        size_t segments = get_array_segments(state, array, first - 1, count, spans);
+        size_t head = spans[0].count * elements_size;
+        memcpy(spans[0].data, bytes, head);
+        if(segments > 1) {
+            memcpy(spans[1].data, bytes + head, length - head);
+        }
+        return 0;
+    }
+    for(size_t i = 0; i < count; i++) {
+        memcpy(get_array_element(state, array, first - 1 + i), bytes + i * elements_size, elements_size);
+    }
+    return 0;
+}
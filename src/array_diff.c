@@ -0,0 +1,159 @@
+// SPDX-License-Identifier: GPL-3.0-only
+
+#include <stdlib.h>
+#include <string.h>
+#include <lua.h>
+#include <lualib.h>
+#include <lauxlib.h>
+#include "luastruct.h"
+#include "array.h"
+#include "simd.h"
+#include "debug.h"
+
+/**
+ * Check that the elements of an array can be compared as blocks of
+ * elements_size bytes.
+ * @return The size of the elements.
+ */
+static size_t check_comparable_array(lua_State *state, LuastructArray *array) {
+    if(array->array_info->elements_type == LUAST_BITFIELD) {
+        luaL_error(state, "Packed bit arrays cannot be compared");
+    }
+    return get_array_elements_size(state, array->array_info);
+}
+
+/**
+ * Get the bytes of the first count elements of an array, packed back to
+ * back. Arrays that are not one contiguous block are gathered into a
+ * buffer pushed onto the stack, which the caller must keep there while the
+ * bytes are in use.
+ */
+static const uint8_t *get_array_bytes(lua_State *state, LuastructArray *array, size_t count, size_t elements_size) {
+    if(count == 0) {
+        return NULL;
+    }
+    LuastructArraySpan spans[LUAS_MAX_SEGMENTS];
+    size_t segments = get_array_segments(state, array, 0, count, spans);
+    if(segments == 1 && LUAS_SPAN_IS_CONTIGUOUS(&spans[0])) {
+        return spans[0].data;
+    }
+    uint8_t *bytes = lua_newuserdata(state, checked_mul_size(state, count, elements_size));
+    uint8_t *cursor = bytes;
+    for(size_t s = 0; s < segments; s++) {
+        if(LUAS_SPAN_IS_CONTIGUOUS(&spans[s])) {
+            memcpy(cursor, spans[s].data, spans[s].count * elements_size);
+            cursor += spans[s].count * elements_size;
+            continue;
+        }
+        for(size_t i = 0; i < spans[s].count; i++) {
+            memcpy(cursor, LUAS_SPAN_ELEMENT(&spans[s], i), elements_size);
+            cursor += elements_size;
+        }
+    }
+    return bytes;
+}
+
+/**
+ * Resolve the snapshot an array is compared with: a byte string such as
+ * the result of tobytes(), or another array.
+ * @param state Lua state.
+ * @param array Array being compared.
+ * @param index Stack index of the snapshot.
+ * @param bytes Receives the bytes of the snapshot.
+ * @param length Receives the number of bytes of the snapshot.
+ * @return False if the snapshot is an array of another element type.
+ */
+static bool get_snapshot_bytes(lua_State *state, LuastructArray *array, int index, const uint8_t **bytes, size_t *length) {
+    if(lua_type(state, index) == LUA_TSTRING) {
+        *bytes = (const uint8_t *)lua_tolstring(state, index, length);
+        return true;
+    }
+    LuastructArray *snapshot = check_array(state, index);
+    if(!same_array_elements(state, array->array_info, snapshot->array_info)) {
+        return false;
+    }
+    size_t elements_size = get_array_elements_size(state, snapshot->array_info);
+    size_t count = get_array_size(state, snapshot->array_info);
+    *length = count * elements_size;
+    *bytes = get_array_bytes(state, snapshot, count, elements_size);
+    return true;
+}
+
+int luastruct_array_equals(lua_State *state) {
+    LuastructArray *array = check_array(state, 1);
+    luaL_checkany(state, 2);
+    size_t elements_size = check_comparable_array(state, array);
+    size_t count = get_array_size(state, array->array_info);
+
+    const uint8_t *other;
+    size_t other_length;
+    if(!get_snapshot_bytes(state, array, 2, &other, &other_length) || other_length != count * elements_size) {
+        lua_pushboolean(state, false);
+        return 1;
+    }
+    const uint8_t *bytes = get_array_bytes(state, array, count, elements_size);
+    lua_pushboolean(state, other_length == 0 || memcmp(bytes, other, other_length) == 0);
+    return 1;
+}
+
+static void push_range(lua_State *state, int result, lua_Integer position, lua_Integer first, lua_Integer last) {
+    lua_createtable(state, 2, 0);
+    lua_pushinteger(state, first);
+    lua_rawseti(state, -2, 1);
+    lua_pushinteger(state, last);
+    lua_rawseti(state, -2, 2);
+    lua_rawseti(state, result, position);
+}
+
+int luastruct_array_diff(lua_State *state) {
+    LuastructArray *array = check_array(state, 1);
+    luaL_checkany(state, 2);
+    size_t elements_size = check_comparable_array(state, array);
+    size_t count = get_array_size(state, array->array_info);
+
+    const uint8_t *other;
+    size_t other_length;
+    if(!get_snapshot_bytes(state, array, 2, &other, &other_length)) {
+        return luaL_error(state, "Snapshot elements are not of the array element type");
+    }
+    if(elements_size == 0 || other_length % elements_size != 0) {
+        return luaL_error(state, "Snapshot length is not a multiple of the element size: %I %% %I", (lua_Integer)other_length, (lua_Integer)elements_size);
+    }
+    size_t other_count = other_length / elements_size;
+    size_t common = count < other_count ? count : other_count;
+    const uint8_t *bytes = get_array_bytes(state, array, count, elements_size);
+
+    lua_newtable(state);
+    int result = lua_gettop(state);
+    lua_Integer ranges = 0;
+    size_t end = 0;
+    size_t total = common * elements_size;
+    size_t offset = 0;
+    while(offset < total) {
+        offset += simd_mismatch(bytes + offset, other + offset, total - offset);
+        if(offset >= total) {
+            break;
+        }
+        // Changed runs are expected to be short, so their end is found one element at a time
+        size_t first = offset / elements_size;
+        end = first + 1;
+        while(end < common && memcmp(bytes + end * elements_size, other + end * elements_size, elements_size) != 0) {
+            end++;
+        }
+        push_range(state, result, ++ranges, first + 1, end);
+        offset = end * elements_size;
+    }
+    if(count > common) {
+        // Elements added since the snapshot was taken extend a range that reaches them
+        if(ranges > 0 && end == common) {
+            lua_rawgeti(state, result, ranges);
+            lua_pushinteger(state, count);
+            lua_rawseti(state, -2, 2);
+            lua_pop(state, 1);
+        }
+        else {
+            push_range(state, result, ++ranges, common + 1, count);
+        }
+    }
+    return 1;
+}
@@ -0,0 +1,282 @@
+// SPDX-License-Identifier: GPL-3.0-only
+
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <lua.h>
+#include <lualib.h>
+#include <lauxlib.h>
+#include "luastruct.h"
+#include "array.h"
+#include "debug.h"
+
+static const char *ARRAY_INDEX_METATABLE_NAME = "luastruct_array_index";
+
+#define INDEX_MIN_CAPACITY 16
+
+/**
+ * Slot of the hash table of an index. A slot is empty when its position
+ * is 0, otherwise position is the one-based index of the element.
+ */
+typedef struct IndexSlot {
+    union {
+        lua_Integer integer;
+        lua_Number number;
+    } key;
+    size_t position;
+} IndexSlot;
+
+/**
+ * Hash index from the key of the elements of an array to their position.
+ * The table uses open addressing with linear probing and is kept at most
+ * half full. Its slots live in a userdata referenced by the uservalue of the
+ * index, next to the array itself, so all of it is owned by the Lua state.
+ */
+typedef struct LuastructArrayIndex {
+    LuastructArrayKey key;
+    LuastructArray *array;
+    lua_Integer count;
+    size_t keys;
+    size_t mask;
+    IndexSlot *slots;
+} LuastructArrayIndex;
+
+enum {
+    INDEX_ARRAY = 1,
+    INDEX_SLOTS = 2
+};
+
+size_t hash_array_key(bool is_float, lua_Integer integer, lua_Number number) {
+    uint64_t bits = (uint64_t)integer;
+    if(is_float) {
+        bits = 0;
+        if(number != 0) {
+            memcpy(&bits, &number, sizeof(number) < sizeof(bits) ? sizeof(number) : sizeof(bits));
+        }
+    }
+    // Finalizer of MurmurHash3
+    bits ^= bits >> 33;
+    bits *= UINT64_C(0xff51afd7ed558ccd);
+    bits ^= bits >> 33;
+    bits *= UINT64_C(0xc4ceb9fe1a85ec53);
+    bits ^= bits >> 33;
+    return (size_t)bits;
+}
+
+/**
+ * Find the slot holding a key, or the empty slot where it would be inserted.
+ */
+static IndexSlot *find_slot(LuastructArrayIndex *index, bool is_float, lua_Integer integer, lua_Number number) {
+    size_t i = hash_array_key(is_float, integer, number) & index->mask;
+    for(;;) {
+        IndexSlot *slot = &index->slots[i];
+        if(slot->position == 0) {
+            return slot;
+        }
+        if(is_float ? slot->key.number == number : slot->key.integer == integer) {
+            return slot;
+        }
+        i = (i + 1) & index->mask;
+    }
+}
+
+/**
+ * Rebuild the hash table of an index from the current elements of its array.
+ * When several elements have the same key the first one is kept.
+ * @param index_idx Absolute stack index of the index object.
+ */
+static void build_index(lua_State *state, LuastructArrayIndex *index, int index_idx) {
+    LuastructArray *array = index->array;
+    lua_Integer count = get_array_size(state, array->array_info);
+    LuastructArraySpan spans[LUAS_MAX_SEGMENTS];
+    size_t segments = get_array_segments(state, array, 0, count, spans);
+
+    size_t capacity = INDEX_MIN_CAPACITY;
+    while(capacity / 2 < (size_t)count) {
+        if(capacity > SIZE_MAX / 2) {
+            luaL_error(state, "Array too large");
+            return;
+        }
+        capacity <<= 1;
+    }
+    size_t size = checked_mul_size(state, capacity, sizeof(IndexSlot));
+    IndexSlot *slots = lua_newuserdata(state, size);
+    memset(slots, 0, size);
+
+    lua_getuservalue(state, index_idx);
+    lua_insert(state, -2);
+    lua_rawseti(state, -2, INDEX_SLOTS);
+    lua_pop(state, 1);
+
+    index->slots = slots;
+    index->mask = capacity - 1;
+    index->count = count;
+    index->keys = 0;
+
+    bool is_float = LUAS_KEY_IS_FLOAT(&index->key);
+    size_t distance = get_prefetch_distance(state);
+    size_t position = 0;
+    for(size_t s = 0; s < segments; s++) {
+        LuastructArraySpan *span = &spans[s];
+        for(size_t i = 0; i < span->count; i++) {
+            prefetch_span_element(span, i, index->key.offset, distance);
+            void *element = LUAS_SPAN_ELEMENT(span, i);
+            lua_Integer integer = 0;
+            lua_Number number = 0;
+            if(is_float) {
+                number = read_array_key_number(&index->key, element);
+                if(isnan(number)) {
+                    continue;
+                }
+            }
+            else {
+                integer = read_array_key_integer(&index->key, element);
+            }
+            IndexSlot *slot = find_slot(index, is_float, integer, number);
+            if(slot->position == 0) {
+                if(is_float) {
+                    slot->key.number = number;
+                }
+                else {
+                    slot->key.integer = integer;
+                }
+                slot->position = position + i + 1;
+                index->keys++;
+            }
+        }
+        position += span->count;
+    }
+}
+
+static LuastructArrayIndex *check_index(lua_State *state, int idx) {
+    return luaL_checkudata(state, idx, ARRAY_INDEX_METATABLE_NAME);
+}
+
+/**
+ * Rebuild the index if the number of elements of its array changed since
+ * it was built.
+ */
+static void refresh_index(lua_State *state, LuastructArrayIndex *index, int index_idx) {
+    sync_array(state, index->array);
+    if(get_array_size(state, index->array->array_info) != index->count) {
+        build_index(state, index, index_idx);
+    }
+}
+
+/**
+ * Look up the element with the given key.
+ * @return The one-based index of the element, or 0 if there is none.
+ */
+static size_t lookup_index(LuastructArrayIndex *index, bool is_float, lua_Integer integer, lua_Number number) {
+    return find_slot(index, is_float, integer, number)->position;
+}
+
+/**
+ * Whether an element still has the key it was indexed under.
+ */
+static bool element_has_key(lua_State *state, LuastructArrayIndex *index, size_t position, bool is_float, lua_Integer integer, lua_Number number) {
+    LuastructArraySpan span;
+    get_array_span(state, index->array, position - 1, 1, &span);
+    void *element = LUAS_SPAN_ELEMENT(&span, 0);
+    if(is_float) {
+        return read_array_key_number(&index->key, element) == number;
+    }
+    return read_array_key_integer(&index->key, element) == integer;
+}
+
+/**
+ * Get the element with the given key and its index, or nil if there is none.
+ * The index is rebuilt when the array was resized, or when the element found
+ * no longer has the key. Keys changed in place are only found again after
+ * idx:rebuild().
+ */
+static int array_index_get(lua_State *state) {
+    LuastructArrayIndex *index = check_index(state, 1);
+    luaL_checkany(state, 2);
+    refresh_index(state, index, 1);
+
+    bool is_float = LUAS_KEY_IS_FLOAT(&index->key);
+    lua_Integer integer = 0;
+    lua_Number number = 0;
+    int isnum = 1;
+    if(lua_isboolean(state, 2)) {
+        integer = lua_toboolean(state, 2);
+        number = integer;
+    }
+    else if(is_float) {
+        number = lua_tonumberx(state, 2, &isnum);
+    }
+    else {
+        integer = lua_tointegerx(state, 2, &isnum);
+    }
+    if(!isnum || (is_float && isnan(number))) {
+        lua_pushnil(state);
+        return 1;
+    }
+
+    size_t position = lookup_index(index, is_float, integer, number);
+    if(position != 0 && !element_has_key(state, index, position, is_float, integer, number)) {
+        build_index(state, index, 1);
+        position = lookup_index(index, is_float, integer, number);
+    }
+    if(position == 0) {
+        lua_pushnil(state);
+        return 1;
+    }
+
+    LuastructArraySpan span;
+    get_array_span(state, index->array, position - 1, 1, &span);
+    lua_getuservalue(state, 1);
+    lua_rawgeti(state, -1, INDEX_ARRAY);
+    push_array_element(state, index->array->array_info, LUAS_SPAN_ELEMENT(&span, 0));
+    inherit_buffer_owner(state, lua_gettop(state) - 1);
+    lua_pushinteger(state, position);
+    return 2;
+}
+
+static int array_index_rebuild(lua_State *state) {
+    LuastructArrayIndex *index = check_index(state, 1);
+    build_index(state, index, 1);
+    lua_settop(state, 1);
+    return 1;
+}
+
+static int array_index__len(lua_State *state) {
+    LuastructArrayIndex *index = check_index(state, 1);
+    refresh_index(state, index, 1);
+    lua_pushinteger(state, index->keys);
+    return 1;
+}
+
+static const struct luaL_Reg array_index_methods[] = {
+    {"get", array_index_get},
+    {"rebuild", array_index_rebuild},
+    {NULL, NULL}
+};
+
+int luastruct_array_index_by(lua_State *state) {
+    LuastructArray *array = check_array(state, 1);
+    lua_settop(state, 2);
+
+    LuastructArrayIndex *index = lua_newuserdata(state, sizeof(LuastructArrayIndex));
+    check_array_key(state, array->array_info, 2, &index->key);
+    index->array = array;
+    index->slots = NULL;
+
+    lua_createtable(state, 2, 0);
+    lua_pushvalue(state, 1);
+    lua_rawseti(state, -2, INDEX_ARRAY);
+    lua_setuservalue(state, -2);
+
+    if(luaL_newmetatable(state, ARRAY_INDEX_METATABLE_NAME) != 0) {
+        lua_newtable(state);
+        luaL_setfuncs(state, array_index_methods, 0);
+        lua_setfield(state, -2, "__index");
+        lua_pushcfunction(state, array_index__len);
+        lua_setfield(state, -2, "__len");
+    }
+    lua_setmetatable(state, -2);
+
+    build_index(state, index, lua_gettop(state));
+    return 1;
+}
@@ -0,0 +1,226 @@
+// SPDX-License-Identifier: GPL-3.0-only
+
+#include <stdlib.h>
+#include <string.h>
+#include <lua.h>
+#include <lualib.h>
+#include <lauxlib.h>
+#include "luastruct.h"
+#include "array.h"
+#include "debug.h"
+
+int luastruct_array__index(lua_State *state);
+int luastruct_array__newindex(lua_State *state);
+
+/*
+ * Metamethods specialized for one element type and layout. They run only on
+ * arrays whose metatable was chosen for that kind, so they can skip the type
+ * switch and the descriptor flags, and rely on array->stride being resolved.
+ * Anything but an integer index is left to the generic metamethods.
+ */
+
+#define VALUE_ELEMENT(array, index) ((array)->data + ((index) - 1) * (array)->stride)
+#define POINTER_ELEMENT(array, index) (*(void **)VALUE_ELEMENT(array, index))
+
+#define DEFINE_INDEX(kind, ctype, ELEMENT, PUSH) \
+    static int array_##kind##__index(lua_State *state) { \
+        LuastructArray *array = lua_touserdata(state, 1); \
+        int isnum; \
+        lua_Integer index = lua_tointegerx(state, 2, &isnum); \
+        if(!isnum) { \
+            return luastruct_array__index(state); \
+        } \
+        if(index < 1 || index > get_array_size(state, array->array_info)) { \
+            lua_pushnil(state); \
+            return 1; \
+        } \
+        PUSH(state, *(ctype *)ELEMENT(array, index)); \
+        return 1; \
+    }
+
+#define DEFINE_NEWINDEX(kind, ctype, ELEMENT, CHECK) \
+    static int array_##kind##__newindex(lua_State *state) { \
+        LuastructArray *array = lua_touserdata(state, 1); \
+        lua_Integer index = luaL_checkinteger(state, 2); \
+        if(index < 1 || index > get_array_size(state, array->array_info)) { \
+            return luaL_error(state, "Tried to set an index out of bounds: %I", index); \
+        } \
+        CHECK(ctype) \
+        *(ctype *)ELEMENT(array, index) = value; \
+        return 0; \
+    }
+
+#define CHECK_RANGE(ctype, min, max, name) \
+    lua_Integer value = luaL_checkinteger(state, 3); \
+    if(value < (min) || value > (max)) { \
+        return luaL_error(state, "Value out of range for " name ": %I", value); \
+    }
+#define CHECK_INT8(ctype) CHECK_RANGE(ctype, INT8_MIN, INT8_MAX, "int8")
+#define CHECK_INT16(ctype) CHECK_RANGE(ctype, INT16_MIN, INT16_MAX, "int16")
+#define CHECK_INT32(ctype) CHECK_RANGE(ctype, INT32_MIN, INT32_MAX, "int32")
+#define CHECK_UINT8(ctype) CHECK_RANGE(ctype, 0, UINT8_MAX, "uint8")
+#define CHECK_UINT16(ctype) CHECK_RANGE(ctype, 0, UINT16_MAX, "uint16")
+#define CHECK_UINT32(ctype) CHECK_RANGE(ctype, 0, UINT32_MAX, "uint32")
+#define CHECK_INT64(ctype) lua_Integer value = luaL_checkinteger(state, 3);
+#define CHECK_UINT64(ctype) uint64_t value = check_uint64(state, 3, array->array_info->overflow);
+#define CHECK_FLOAT(ctype) lua_Number value = luaL_checknumber(state, 3);
+#define CHECK_BOOL(ctype) bool value = lua_toboolean(state, 3);
+
+#define PUSH_INTEGER(state, value) lua_pushinteger(state, (lua_Integer)(value))
+#define PUSH_UINT64(state, value) push_uint64(state, value, array->array_info->overflow)
+#define PUSH_NUMBER(state, value) lua_pushnumber(state, value)
+#define PUSH_BOOLEAN(state, value) lua_pushboolean(state, value)
+
+/**
+ * Stamp out the accessors of a primitive kind and its table of variants,
+ * indexed by (pointers + 2 * readonly). Read-only variants keep the generic
+ * __newindex, which reports the error.
+ */
+#define DEFINE_PRIMITIVE_KIND(kind, ctype, PUSH, CHECK) \
+    DEFINE_INDEX(kind, ctype, VALUE_ELEMENT, PUSH) \
+    DEFINE_INDEX(kind##_ptr, ctype, POINTER_ELEMENT, PUSH) \
+    DEFINE_NEWINDEX(kind, ctype, VALUE_ELEMENT, CHECK) \
+    DEFINE_NEWINDEX(kind##_ptr, ctype, POINTER_ELEMENT, CHECK) \
+    static const LuastructArrayKind kind##_kinds[4] = { \
+        {"luastruct_array_" #kind, array_##kind##__index, array_##kind##__newindex}, \
+        {"luastruct_array_" #kind "_ptr", array_##kind##_ptr__index, array_##kind##_ptr__newindex}, \
+        {"luastruct_array_" #kind "_ro", array_##kind##__index, luastruct_array__newindex}, \
+        {"luastruct_array_" #kind "_ptr_ro", array_##kind##_ptr__index, luastruct_array__newindex} \
+    };
+
+DEFINE_PRIMITIVE_KIND(int8, int8_t, PUSH_INTEGER, CHECK_INT8)
+DEFINE_PRIMITIVE_KIND(int16, int16_t, PUSH_INTEGER, CHECK_INT16)
+DEFINE_PRIMITIVE_KIND(int32, int32_t, PUSH_INTEGER, CHECK_INT32)
+DEFINE_PRIMITIVE_KIND(int64, int64_t, PUSH_INTEGER, CHECK_INT64)
+DEFINE_PRIMITIVE_KIND(uint8, uint8_t, PUSH_INTEGER, CHECK_UINT8)
+DEFINE_PRIMITIVE_KIND(uint16, uint16_t, PUSH_INTEGER, CHECK_UINT16)
+DEFINE_PRIMITIVE_KIND(uint32, uint32_t, PUSH_INTEGER, CHECK_UINT32)
+DEFINE_PRIMITIVE_KIND(uint64, uint64_t, PUSH_UINT64, CHECK_UINT64)
+DEFINE_PRIMITIVE_KIND(float, float, PUSH_NUMBER, CHECK_FLOAT)
+DEFINE_PRIMITIVE_KIND(boolean, bool, PUSH_BOOLEAN, CHECK_BOOL)
+
+#undef DEFINE_PRIMITIVE_KIND
+
+/*
+ * Struct and enum elements are pushed as objects of the element type.
+ * Writes copy a whole object and go through set_array_element.
+ */
+#define DEFINE_OBJECT_KIND(kind, ELEMENT, readonly) \
+    static int array_##kind##__index(lua_State *state) { \
+        LuastructArray *array = lua_touserdata(state, 1); \
+        int isnum; \
+        lua_Integer index = lua_tointegerx(state, 2, &isnum); \
+        if(!isnum) { \
+            return luastruct_array__index(state); \
+        } \
+        if(index < 1 || index > get_array_size(state, array->array_info)) { \
+            lua_pushnil(state); \
+            return 1; \
+        } \
+        LuastructTypeInfo *type_info = array->array_info->elements_type_info; \
+        luastruct_new_object(state, type_info->name, ELEMENT(array, index), readonly); \
+        inherit_buffer_owner(state, 1); \
+        return 1; \
+    } \
+    static int array_##kind##__newindex(lua_State *state) { \
+        LuastructArray *array = lua_touserdata(state, 1); \
+        lua_Integer index = luaL_checkinteger(state, 2); \
+        if(index < 1 || index > get_array_size(state, array->array_info)) { \
+            return luaL_error(state, "Tried to set an index out of bounds: %I", index); \
+        } \
+        set_array_element(state, array->array_info, ELEMENT(array, index), 3); \
+        return 0; \
+    }
+
+DEFINE_OBJECT_KIND(object, VALUE_ELEMENT, false)
+DEFINE_OBJECT_KIND(object_ptr, POINTER_ELEMENT, false)
+DEFINE_OBJECT_KIND(object_ro, VALUE_ELEMENT, true)
+DEFINE_OBJECT_KIND(object_ptr_ro, POINTER_ELEMENT, true)
+
+#undef DEFINE_OBJECT_KIND
+
+/*
+ * Packed bits are indexed by bit rather than by element address, and are
+ * never stored behind pointers.
+ */
+static int array_bits__index(lua_State *state) {
+    LuastructArray *array = lua_touserdata(state, 1);
+    int isnum;
+    lua_Integer index = lua_tointegerx(state, 2, &isnum);
+    if(!isnum) {
+        return luastruct_array__index(state);
+    }
+    if(index < 1 || index > get_array_size(state, array->array_info)) {
+        lua_pushnil(state);
+        return 1;
+    }
+    lua_pushboolean(state, LUAS_BIT_GET(array->data, index - 1));
+    return 1;
+}
+
+static int array_bits__newindex(lua_State *state) {
+    LuastructArray *array = lua_touserdata(state, 1);
+    lua_Integer index = luaL_checkinteger(state, 2);
+    if(index < 1 || index > get_array_size(state, array->array_info)) {
+        return luaL_error(state, "Tried to set an index out of bounds: %I", index);
+    }
+    LUAS_BIT_SET(array->data, index - 1, lua_toboolean(state, 3));
+    return 0;
+}
+
+static const LuastructArrayKind bits_kinds[2] = {
+    {"luastruct_array_bits", array_bits__index, array_bits__newindex},
+    {"luastruct_array_bits_ro", array_bits__index, luastruct_array__newindex}
+};
+
+static const LuastructArrayKind struct_kinds[4] = {
+    {"luastruct_array_struct", array_object__index, array_object__newindex},
+    {"luastruct_array_struct_ptr", array_object_ptr__index, array_object_ptr__newindex},
+    {"luastruct_array_struct_ro", array_object_ro__index, luastruct_array__newindex},
+    {"luastruct_array_struct_ptr_ro", array_object_ptr_ro__index, luastruct_array__newindex}
+};
+
+static const LuastructArrayKind enum_kinds[4] = {
+    {"luastruct_array_enum", array_object__index, array_object__newindex},
+    {"luastruct_array_enum_ptr", array_object_ptr__index, array_object_ptr__newindex},
+    {"luastruct_array_enum_ro", array_object_ro__index, luastruct_array__newindex},
+    {"luastruct_array_enum_ptr_ro", array_object_ptr_ro__index, luastruct_array__newindex}
+};
+
+const LuastructArrayKind *get_array_kind(LuastructArrayDesc *desc) {
+    if(desc->vector || desc->ring) {
+        // Vectors and rings must reload their header, which only the generic metamethods do
+        return NULL;
+    }
+    int variant = (desc->elements_are_pointers ? 1 : 0) + (desc->elements_are_readonly ? 2 : 0);
+    switch(desc->elements_type) {
+        case LUAST_INT8:
+            return &int8_kinds[variant];
+        case LUAST_INT16:
+            return &int16_kinds[variant];
+        case LUAST_INT32:
+            return &int32_kinds[variant];
+        case LUAST_INT64:
+            return &int64_kinds[variant];
+        case LUAST_UINT8:
+            return &uint8_kinds[variant];
+        case LUAST_UINT16:
+            return &uint16_kinds[variant];
+        case LUAST_UINT32:
+            return &uint32_kinds[variant];
+        case LUAST_UINT64:
+            return &uint64_kinds[variant];
+        case LUAST_FLOAT:
+            return &float_kinds[variant];
+        case LUAST_BOOL:
+            return &boolean_kinds[variant];
+        case LUAST_STRUCT:
+            return &struct_kinds[variant];
+        case LUAST_ENUM:
+            return &enum_kinds[variant];
+        case LUAST_BITFIELD:
+            return &bits_kinds[desc->elements_are_readonly ? 1 : 0];
+        default:
+            return NULL;
+    }
+}
@@ -0,0 +1,234 @@
+// SPDX-License-Identifier: GPL-3.0-only
+
+#include <stdlib.h>
+#include <string.h>
+#include <lua.h>
+#include <lualib.h>
+#include <lauxlib.h>
+#include "luastruct.h"
+#include "array.h"
+#include "debug.h"
+
+static const char *LIST_METATABLE_NAME = "luastruct_list";
+
+/**
+ * A list object. The head is the address of the list field: the pointer
+ * to the first node, or the sentinel node.
+ */
+typedef struct LuastructList {
+    void *head;
+    LuastructArrayDesc *list_info;
+} LuastructList;
+
+/**
+ * Position of a walk along a list. Cycles are detected with Brent's method:
+ * the node reached after a power of two steps is remembered, and a node
+ * linking back to it means the list loops, which costs one comparison per
+ * node and no allocation.
+ */
+typedef struct ListWalk {
+    const LuastructListDesc *layout;
+    uint8_t *end;
+    uint8_t *node;
+    size_t steps;
+    uint8_t *mark;
+    size_t next_mark;
+} ListWalk;
+
+static LuastructList *check_list(lua_State *state, int index) {
+    return luaL_checkudata(state, index, LIST_METATABLE_NAME);
+}
+
+static void start_walk(LuastructList *list, ListWalk *walk) {
+    const LuastructListDesc *layout = list->list_info->list;
+    uint8_t *head = list->head;
+    walk->layout = layout;
+    walk->end = layout->sentinel ? head : NULL;
+    walk->node = layout->sentinel ? *(uint8_t **)(head + layout->next_offset) : *(uint8_t **)head;
+    walk->steps = 0;
+    walk->mark = NULL;
+    walk->next_mark = 1;
+}
+
+/**
+ * Get the next node of a walk.
+ * Raises an error if the list loops or is longer than its maximum length.
+ * @return The node, or NULL at the end of the list.
+ */
+static uint8_t *next_node(lua_State *state, ListWalk *walk) {
+    uint8_t *node = walk->node;
+    if(node == NULL || node == walk->end) {
+        return NULL;
+    }
+    walk->steps++;
+    if(walk->layout->max_length && walk->steps > walk->layout->max_length) {
+        luaL_error(state, "List is longer than %I nodes", (lua_Integer)walk->layout->max_length);
+        return NULL;
+    }
+    uint8_t *next = *(uint8_t **)(node + walk->layout->next_offset);
+    if(next != NULL && (next == walk->mark || next == node)) {
+        luaL_error(state, "List has a cycle after %I nodes", (lua_Integer)walk->steps);
+        return NULL;
+    }
+    if(walk->steps == walk->next_mark) {
+        walk->mark = node;
+        walk->next_mark *= 2;
+    }
+    walk->node = next;
+    return node;
+}
+
+/**
+ * Push a node as an element of the list, which keeps the buffer the list
+ * lives in alive like any other proxy.
+ */
+static void push_node(lua_State *state, LuastructList *list, uint8_t *node, int list_index) {
+    push_array_element(state, list->list_info, node);
+    inherit_buffer_owner(state, list_index);
+}
+
+static int luastruct_list__len(lua_State *state) {
+    LuastructList *list = check_list(state, 1);
+    ListWalk walk;
+    start_walk(list, &walk);
+    lua_Integer count = 0;
+    while(next_node(state, &walk)) {
+        count++;
+    }
+    lua_pushinteger(state, count);
+    return 1;
+}
+
+/**
+ * Iterator over the nodes of a list, with the list and the walk as upvalues.
+ */
+static int list_iterator(lua_State *state) {
+    LuastructList *list = check_list(state, lua_upvalueindex(1));
+    ListWalk *walk = lua_touserdata(state, lua_upvalueindex(2));
+    uint8_t *node = next_node(state, walk);
+    if(!node) {
+        return 0;
+    }
+    lua_pushinteger(state, walk->steps);
+    push_node(state, list, node, lua_upvalueindex(1));
+    return 2;
+}
+
+static void push_list_iterator(lua_State *state, LuastructList *list, int list_index) {
+    lua_pushvalue(state, list_index);
+    ListWalk *walk = lua_newuserdata(state, sizeof(ListWalk));
+    start_walk(list, walk);
+    lua_pushcclosure(state, list_iterator, 2);
+}
+
+static int luastruct_list__pairs(lua_State *state) {
+    LuastructList *list = check_list(state, 1);
+    push_list_iterator(state, list, 1);
+    lua_pushvalue(state, 1);
+    lua_pushnil(state);
+    return 3;
+}
+
+static int luastruct_list_iter(lua_State *state) {
+    LuastructList *list = check_list(state, 1);
+    push_list_iterator(state, list, 1);
+    return 1;
+}
+
+static int luastruct_list_len(lua_State *state) {
+    LuastructList *list = check_list(state, 1);
+    lua_Integer cap = luaL_optinteger(state, 2, LUA_MAXINTEGER);
+    if(cap < 0) {
+        return luaL_error(state, "Length cap is negative: %I", cap);
+    }
+    ListWalk walk;
+    start_walk(list, &walk);
+    lua_Integer count = 0;
+    while(count < cap && next_node(state, &walk)) {
+        count++;
+    }
+    lua_pushinteger(state, count);
+    return 1;
+}
+
+static int luastruct_list_find(lua_State *state) {
+    LuastructList *list = check_list(state, 1);
+    const char *path = luaL_checkstring(state, 2);
+    luaL_checkany(state, 3);
+    lua_settop(state, 3);
+
+    lua_createtable(state, 0, 1);
+    lua_pushvalue(state, 3);
+    lua_setfield(state, -2, path);
+    LuastructWherePlan *plan = push_where_plan(state, list->list_info, -1);
+
+    ListWalk walk;
+    start_walk(list, &walk);
+    uint8_t *node;
+    while((node = next_node(state, &walk)) != NULL) {
+        if(match_where_plan(plan, node)) {
+            push_node(state, list, node, 1);
+            lua_pushinteger(state, walk.steps);
+            return 2;
+        }
+    }
+    lua_pushnil(state);
+    return 1;
+}
+
+static int luastruct_list_filter(lua_State *state) {
+    LuastructList *list = check_list(state, 1);
+    lua_settop(state, 2);
+    bool by_function = lua_type(state, 2) == LUA_TFUNCTION;
+    LuastructWherePlan *plan = by_function ? NULL : push_where_plan(state, list->list_info, 2);
+
+    lua_newtable(state);
+    int result = lua_gettop(state);
+    lua_Integer matches = 0;
+    ListWalk walk;
+    start_walk(list, &walk);
+    uint8_t *node;
+    while((node = next_node(state, &walk)) != NULL) {
+        if(by_function) {
+            lua_pushvalue(state, 2);
+            push_node(state, list, node, 1);
+            lua_call(state, 1, 1);
+            bool match = lua_toboolean(state, -1);
+            lua_pop(state, 1);
+            if(!match) {
+                continue;
+            }
+        }
+        else if(!match_where_plan(plan, node)) {
+            continue;
+        }
+        push_node(state, list, node, 1);
+        lua_rawseti(state, result, ++matches);
+    }
+    return 1;
+}
+
+static const struct luaL_Reg list_methods[] = {
+    {"iter", luastruct_list_iter},
+    {"len", luastruct_list_len},
+    {"find", luastruct_list_find},
+    {"filter", luastruct_list_filter},
+    {NULL, NULL}
+};
+
+int luastruct_new_list(lua_State *state, void *data, LuastructArrayDesc *array_info) {
+    LuastructList *list = lua_newuserdata(state, sizeof(LuastructList));
+    list->head = data;
+    list->list_info = array_info;
+    if(luaL_newmetatable(state, LIST_METATABLE_NAME) != 0) {
+        lua_newtable(state);
+        luaL_setfuncs(state, list_methods, 0);
+        lua_setfield(state, -2, "__index");
+        lua_pushcfunction(state, luastruct_list__len);
+        lua_setfield(state, -2, "__len");
+        lua_pushcfunction(state, luastruct_list__pairs);
+        lua_setfield(state, -2, "__pairs");
+    }
+    lua_setmetatable(state, -2);
+    return 1;
+}
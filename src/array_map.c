@@ -0,0 +1,335 @@
+// SPDX-License-Identifier: GPL-3.0-only
+
+#include <stdlib.h>
+#include <string.h>
+#include <lua.h>
+#include <lualib.h>
+#include <lauxlib.h>
+#include "luastruct.h"
+#include "array.h"
+#include "simd.h"
+#include "debug.h"
+
+static const char *MAP_METATABLE_NAME = "luastruct_map";
+
+size_t get_type_size(lua_State *state, LuastructType type, void *type_info);
+
+/**
+ * A map object over the header of a C hash map.
+ */
+typedef struct LuastructMap {
+    uint8_t *header;
+    LuastructArrayDesc *map_info;
+} LuastructMap;
+
+/**
+ * Slots of a map, loaded from its header every time the map is used since
+ * C code may grow the map and move them.
+ */
+typedef struct MapSlots {
+    const uint8_t *keys;
+    uint8_t *values;
+    const uint8_t *occupied;
+    size_t capacity;
+    size_t key_size;
+    size_t value_size;
+} MapSlots;
+
+/**
+ * A key looked up from Lua, stored the way it is stored in the slots.
+ */
+typedef struct MapKey {
+    union {
+        uint64_t align;
+        uint8_t bytes[sizeof(uint64_t)];
+    } stored;
+    uint64_t value;
+} MapKey;
+
+static LuastructMap *check_map(lua_State *state, int index) {
+    return luaL_checkudata(state, index, MAP_METATABLE_NAME);
+}
+
+static void load_slots(lua_State *state, LuastructMap *map, MapSlots *slots) {
+    const LuastructMapDesc *layout = map->map_info->map;
+    lua_Integer capacity = read_header_size(layout->size_type, map->header + layout->capacity_offset);
+    if(capacity < 0) {
+        luaL_error(state, "Map capacity is invalid");
+        return;
+    }
+    slots->keys = *(uint8_t **)(map->header + layout->keys_offset);
+    slots->values = *(uint8_t **)(map->header + layout->values_offset);
+    slots->occupied = *(uint8_t **)(map->header + layout->occupied_offset);
+    slots->capacity = (size_t)capacity;
+    slots->key_size = get_type_size(state, layout->key_type, NULL);
+    slots->value_size = get_array_elements_size(state, map->map_info);
+    if(capacity > 0 && (!slots->keys || !slots->values || !slots->occupied)) {
+        luaL_error(state, "Map has a capacity of %I but no slots", capacity);
+    }
+}
+
+/**
+ * Read a key from a slot as uint64_t, the way C converts it.
+ */
+static uint64_t read_key(LuastructType type, const void *key) {
+    switch(type) {
+        #define READ_CASE(type, name) case type: return (uint64_t)*(const name##_t *)key;
+        LUAS_FOREACH_INTEGER_TYPE(READ_CASE)
+        #undef READ_CASE
+        default:
+            return *(const uint64_t *)key;
+    }
+}
+
+/**
+ * Convert the value at the given stack index to a key of the map.
+ * @return False if the value is not an integer that fits in the key type,
+ * in which case no slot can hold it.
+ */
+static bool to_map_key(lua_State *state, const LuastructMapDesc *layout, int index, MapKey *key) {
+    int is_integer = 0;
+    lua_Integer value = lua_tointegerx(state, index, &is_integer);
+    if(!is_integer || lua_type(state, index) != LUA_TNUMBER) {
+        return false;
+    }
+    memset(&key->stored, 0, sizeof(key->stored));
+    switch(layout->key_type) {
+        #define STORE_CASE(type, name) \
+        case type: { \
+            name##_t stored = (name##_t)value; \
+            if((lua_Integer)stored != value) { \
+                return false; \
+            } \
+            memcpy(key->stored.bytes, &stored, sizeof(stored)); \
+            break; \
+        }
+        // 64-bit unsigned keys above LUA_MAXINTEGER are seen as negative integers
+        LUAS_FOREACH_INTEGER_TYPE(STORE_CASE)
+        #undef STORE_CASE
+        default:
+            return false;
+    }
+    key->value = read_key(layout->key_type, key->stored.bytes);
+    return true;
+}
+
+static void push_map_key(lua_State *state, LuastructType type, uint64_t value) {
+    switch(type) {
+        #define PUSH_CASE(type, name) case type: lua_pushinteger(state, (lua_Integer)(name##_t)value); break;
+        LUAS_FOREACH_INTEGER_TYPE(PUSH_CASE)
+        #undef PUSH_CASE
+        default:
+            lua_pushinteger(state, (lua_Integer)value);
+            break;
+    }
+}
+
+static uint64_t hash_map_key(const LuastructMapDesc *layout, const MapKey *key, size_t key_size) {
+    switch(layout->hash) {
+        case LUAS_HASH_IDENTITY:
+            return key->value;
+        case LUAS_HASH_FNV1A: {
+            uint64_t hash = UINT64_C(14695981039346656037);
+            for(size_t i = 0; i < key_size; i++) {
+                hash ^= key->stored.bytes[i];
+                hash *= UINT64_C(1099511628211);
+            }
+            return hash;
+        }
+        case LUAS_HASH_MURMUR3: {
+            uint64_t hash = key->value;
+            hash ^= hash >> 33;
+            hash *= UINT64_C(0xff51afd7ed558ccd);
+            hash ^= hash >> 33;
+            hash *= UINT64_C(0xc4ceb9fe1a85ec53);
+            hash ^= hash >> 33;
+            return hash;
+        }
+        default:
+            return layout->hash_function(key->stored.bytes, key_size, layout->userdata);
+    }
+}
+
+/**
+ * Find the slot holding a key by linear probing from its hash.
+ * @return True if the key is in the map.
+ */
+static bool find_map_slot(const LuastructMapDesc *layout, const MapSlots *slots, const MapKey *key, size_t *slot) {
+    size_t capacity = slots->capacity;
+    if(capacity == 0) {
+        return false;
+    }
+    uint64_t hash = hash_map_key(layout, key, slots->key_size);
+    size_t i = (capacity & (capacity - 1)) == 0 ? (size_t)(hash & (capacity - 1)) : (size_t)(hash % capacity);
+    for(size_t probes = 0; probes < capacity; probes++) {
+        if(!LUAS_BIT_GET(slots->occupied, i)) {
+            return false;
+        }
+        if(memcmp(slots->keys + i * slots->key_size, key->stored.bytes, slots->key_size) == 0) {
+            *slot = i;
+            return true;
+        }
+        if(++i == capacity) {
+            i = 0;
+        }
+    }
+    return false;
+}
+
+/**
+ * Get the first occupied slot at or after the slot i, skipping 64 free
+ * slots at a time.
+ * @return The slot, or the capacity if there is none.
+ */
+static size_t next_occupied_slot(const MapSlots *slots, size_t i) {
+    while(i < slots->capacity) {
+        if((i & 63) == 0 && i + 64 <= slots->capacity) {
+            uint64_t word;
+            memcpy(&word, slots->occupied + i / 8, sizeof(word));
+            if(word == 0) {
+                i += 64;
+                continue;
+            }
+        }
+        if(LUAS_BIT_GET(slots->occupied, i)) {
+            return i;
+        }
+        i++;
+    }
+    return slots->capacity;
+}
+
+static void push_map_value(lua_State *state, LuastructMap *map, const MapSlots *slots, size_t slot, int map_index) {
+    push_array_element(state, map->map_info, slots->values + slot * slots->value_size);
+    inherit_buffer_owner(state, map_index);
+}
+
+static int luastruct_map__index(lua_State *state) {
+    LuastructMap *map = check_map(state, 1);
+    if(lua_type(state, 2) == LUA_TSTRING) {
+        lua_getmetatable(state, 1);
+        lua_getfield(state, -1, "__methods");
+        lua_pushvalue(state, 2);
+        lua_rawget(state, -2);
+        return 1;
+    }
+    const LuastructMapDesc *layout = map->map_info->map;
+    MapSlots slots;
+    MapKey key;
+    size_t slot;
+    load_slots(state, map, &slots);
+    if(!to_map_key(state, layout, 2, &key) || !find_map_slot(layout, &slots, &key, &slot)) {
+        lua_pushnil(state);
+        return 1;
+    }
+    push_map_value(state, map, &slots, slot, 1);
+    return 1;
+}
+
+static int luastruct_map__newindex(lua_State *state) {
+    LuastructMap *map = check_map(state, 1);
+    const LuastructMapDesc *layout = map->map_info->map;
+    if(map->map_info->elements_are_readonly) {
+        return luaL_error(state, "Map is read-only");
+    }
+    MapSlots slots;
+    MapKey key;
+    size_t slot;
+    load_slots(state, map, &slots);
+    if(!to_map_key(state, layout, 2, &key) || !find_map_slot(layout, &slots, &key, &slot)) {
+        // Inserting would bypass whatever bookkeeping the C code does on insertion
+        return luaL_error(state, "Key is not in the map: %s", luaL_tolstring(state, 2, NULL));
+    }
+    set_array_element(state, map->map_info, slots.values + slot * slots.value_size, 3);
+    return 0;
+}
+
+static int luastruct_map__len(lua_State *state) {
+    LuastructMap *map = check_map(state, 1);
+    MapSlots slots;
+    load_slots(state, map, &slots);
+    uint64_t count = 0;
+    if(slots.capacity > 0) {
+        count = simd_popcount(slots.occupied, slots.capacity / 8);
+        if(slots.capacity % 8) {
+            count += __builtin_popcount(slots.occupied[slots.capacity / 8] & ((1u << (slots.capacity % 8)) - 1));
+        }
+    }
+    lua_pushinteger(state, (lua_Integer)count);
+    return 1;
+}
+
+/**
+ * Iterator over the occupied slots of a map, with the map and the next slot
+ * to look at as upvalues.
+ */
+static int map_iterator(lua_State *state) {
+    LuastructMap *map = check_map(state, lua_upvalueindex(1));
+    MapSlots slots;
+    load_slots(state, map, &slots);
+    size_t slot = next_occupied_slot(&slots, (size_t)lua_tointeger(state, lua_upvalueindex(2)));
+    if(slot >= slots.capacity) {
+        return 0;
+    }
+    lua_pushinteger(state, (lua_Integer)slot + 1);
+    lua_replace(state, lua_upvalueindex(2));
+    push_map_key(state, map->map_info->map->key_type, read_key(map->map_info->map->key_type, slots.keys + slot * slots.key_size));
+    push_map_value(state, map, &slots, slot, lua_upvalueindex(1));
+    return 2;
+}
+
+static int luastruct_map__pairs(lua_State *state) {
+    check_map(state, 1);
+    lua_pushvalue(state, 1);
+    lua_pushinteger(state, 0);
+    lua_pushcclosure(state, map_iterator, 2);
+    lua_pushvalue(state, 1);
+    lua_pushnil(state);
+    return 3;
+}
+
+static int luastruct_map_contains(lua_State *state) {
+    LuastructMap *map = check_map(state, 1);
+    luaL_checkany(state, 2);
+    const LuastructMapDesc *layout = map->map_info->map;
+    MapSlots slots;
+    MapKey key;
+    size_t slot;
+    load_slots(state, map, &slots);
+    lua_pushboolean(state, to_map_key(state, layout, 2, &key) && find_map_slot(layout, &slots, &key, &slot));
+    return 1;
+}
+
+static int luastruct_map_capacity(lua_State *state) {
+    LuastructMap *map = check_map(state, 1);
+    MapSlots slots;
+    load_slots(state, map, &slots);
+    lua_pushinteger(state, (lua_Integer)slots.capacity);
+    return 1;
+}
+
+static const struct luaL_Reg map_methods[] = {
+    {"contains", luastruct_map_contains},
+    {"capacity", luastruct_map_capacity},
+    {NULL, NULL}
+};
+
+int luastruct_new_map(lua_State *state, void *data, LuastructArrayDesc *array_info) {
+    LuastructMap *map = lua_newuserdata(state, sizeof(LuastructMap));
+    map->header = data;
+    map->map_info = array_info;
+    if(luaL_newmetatable(state, MAP_METATABLE_NAME) != 0) {
+        lua_pushcfunction(state, luastruct_map__index);
+        lua_setfield(state, -2, "__index");
+        lua_pushcfunction(state, luastruct_map__newindex);
+        lua_setfield(state, -2, "__newindex");
+        lua_pushcfunction(state, luastruct_map__len);
+        lua_setfield(state, -2, "__len");
+        lua_pushcfunction(state, luastruct_map__pairs);
+        lua_setfield(state, -2, "__pairs");
+        luaL_newlib(state, map_methods);
+        lua_setfield(state, -2, "__methods");
+    }
+    lua_setmetatable(state, -2);
+    return 1;
+}
@@ -0,0 +1,735 @@
+// SPDX-License-Identifier: GPL-3.0-only
+
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <lua.h>
+#include <lualib.h>
+#include <lauxlib.h>
+#include "luastruct.h"
+#include "array.h"
+#include "simd.h"
+#include "debug.h"
+
+typedef enum MathOperation {
+    MATH_ADD,
+    MATH_MUL,
+    MATH_AXPY,
+    MATH_CLAMP,
+    MATH_LERP
+} MathOperation;
+
+/**
+ * A number given as an argument, kept as an integer when it is one so that
+ * integer arrays are updated with exact integer arithmetic.
+ */
+typedef struct MathScalar {
+    bool is_integer;
+    lua_Integer integer;
+    lua_Number number;
+} MathScalar;
+
+/**
+ * The right-hand side of an operation: either an array, walked through its
+ * span in logical order, or a number applied to every element.
+ */
+typedef struct MathOperand {
+    bool is_array;
+    LuastructArraySpan span;
+    LuastructArrayKey key;
+    MathScalar scalar;
+} MathOperand;
+
+/**
+ * An element-wise operation on the elements of an array, applied to one
+ * segment at a time. span is the segment being applied and first the index
+ * of its first element. The parameters are k for axpy, lo and hi for clamp
+ * and t for lerp.
+ */
+typedef struct MathPlan {
+    MathOperation operation;
+    LuastructArraySpan segments[LUAS_MAX_SEGMENTS];
+    size_t segment_count;
+    size_t count;
+    LuastructArraySpan span;
+    size_t first;
+    LuastructArrayKey key;
+    MathOperand operand;
+    MathScalar k;
+    MathScalar hi;
+    bool saturate;
+} MathPlan;
+
+static bool is_numeric_type(LuastructType type) {
+    switch(type) {
+        #define INTEGER_CASE(type, name) case type:
+        LUAS_FOREACH_INTEGER_TYPE(INTEGER_CASE)
+        #undef INTEGER_CASE
+        case LUAST_FLOAT:
+            return true;
+        default:
+            return false;
+    }
+}
+
+static void get_integer_range(LuastructType type, lua_Integer *min, lua_Integer *max) {
+    switch(type) {
+        case LUAST_INT8:
+            *min = INT8_MIN;
+            *max = INT8_MAX;
+            break;
+        case LUAST_INT16:
+            *min = INT16_MIN;
+            *max = INT16_MAX;
+            break;
+        case LUAST_INT32:
+            *min = INT32_MIN;
+            *max = INT32_MAX;
+            break;
+        case LUAST_UINT8:
+            *min = 0;
+            *max = UINT8_MAX;
+            break;
+        case LUAST_UINT16:
+            *min = 0;
+            *max = UINT16_MAX;
+            break;
+        case LUAST_UINT32:
+            *min = 0;
+            *max = UINT32_MAX;
+            break;
+        default:
+            *min = LUA_MININTEGER;
+            *max = LUA_MAXINTEGER;
+            break;
+    }
+}
+
+static void check_scalar(lua_State *state, int index, MathScalar *scalar) {
+    scalar->number = luaL_checknumber(state, index);
+    scalar->is_integer = lua_isinteger(state, index);
+    scalar->integer = scalar->is_integer ? lua_tointeger(state, index) : 0;
+}
+
+/**
+ * Resolve an array whose elements must be numbers into its segments.
+ */
+static LuastructArray *check_numeric_segments(lua_State *state, int index, LuastructArraySpan *spans, size_t *segments, LuastructArrayKey *key) {
+    LuastructArray *array = check_array(state, index);
+    LuastructType type = array->array_info->elements_type;
+    if(!is_numeric_type(type)) {
+        luaL_error(state, "Array elements are not numeric: %s", luastruct_name_for_type(type));
+        return NULL;
+    }
+    lua_pushnil(state);
+    check_array_key(state, array->array_info, -1, key);
+    lua_pop(state, 1);
+    *segments = get_array_segments(state, array, 0, get_array_size(state, array->array_info), spans);
+    return array;
+}
+
+/**
+ * Copy the elements of an array operand into a scratch buffer, in logical
+ * order and back to back.
+ */
+static void copy_operand(lua_State *state, MathOperand *operand, LuastructArraySpan *spans, size_t segments) {
+    size_t elements_size = spans[0].elements_size;
+    size_t count = 0;
+    for(size_t s = 0; s < segments; s++) {
+        count += spans[s].count;
+    }
+    uint8_t *copy = lua_newuserdata(state, checked_mul_size(state, count, elements_size));
+    uint8_t *next = copy;
+    for(size_t s = 0; s < segments; s++) {
+        for(size_t i = 0; i < spans[s].count; i++) {
+            memcpy(next, LUAS_SPAN_ELEMENT(&spans[s], i), elements_size);
+            next += elements_size;
+        }
+    }
+    operand->span = spans[0];
+    operand->span.data = copy;
+    operand->span.count = count;
+    operand->span.stride = elements_size;
+    operand->span.elements_are_pointers = false;
+}
+
+static void check_operand(lua_State *state, int index, MathPlan *plan) {
+    MathOperand *operand = &plan->operand;
+    operand->is_array = lua_type(state, index) != LUA_TNUMBER;
+    if(!operand->is_array) {
+        check_scalar(state, index, &operand->scalar);
+        return;
+    }
+    LuastructArraySpan spans[LUAS_MAX_SEGMENTS];
+    size_t segments;
+    check_numeric_segments(state, index, spans, &segments, &operand->key);
+    if(segments > 1) {
+        // A ring buffer that wraps is read in logical order from a copy
+        copy_operand(state, operand, spans, segments);
+    }
+    else {
+        operand->span = spans[0];
+    }
+    if(operand->span.count != plan->count) {
+        luaL_error(state, "Array lengths do not match: %I != %I", (lua_Integer)plan->count, (lua_Integer)operand->span.count);
+    }
+}
+
+/**
+ * Whether two spans may share memory.
+ */
+static bool spans_overlap(const LuastructArraySpan *a, const LuastructArraySpan *b) {
+    if(a->count == 0 || b->count == 0) {
+        return false;
+    }
+    uint8_t *a_end = a->data + (a->count - 1) * a->stride + a->elements_size;
+    uint8_t *b_end = b->data + (b->count - 1) * b->stride + b->elements_size;
+    return a->data < b_end && b->data < a_end;
+}
+
+/**
+ * Copy the operand into a scratch buffer if writing the destination could
+ * change operand elements that have not been read yet. Operands that are
+ * the destination itself are safe, since each element is read before it is
+ * written.
+ */
+static void separate_operand(lua_State *state, MathPlan *plan) {
+    LuastructArraySpan *src = &plan->operand.span;
+    if(!plan->operand.is_array || src->elements_are_pointers) {
+        return;
+    }
+    for(size_t s = 0; s < plan->segment_count; s++) {
+        LuastructArraySpan *dst = &plan->segments[s];
+        if(dst->elements_are_pointers || (plan->segment_count == 1 && src->data == dst->data && src->stride == dst->stride)) {
+            continue;
+        }
+        if(spans_overlap(src, dst)) {
+            copy_operand(state, &plan->operand, src, 1);
+            return;
+        }
+    }
+}
+
+/*
+ * Integer arithmetic on lua_Integer that reports overflow. On overflow the
+ * result is the bound in the direction of the exact result.
+ */
+
+static lua_Integer checked_add(lua_Integer a, lua_Integer b, bool *overflow) {
+    if(b > 0 && a > LUA_MAXINTEGER - b) {
+        *overflow = true;
+        return LUA_MAXINTEGER;
+    }
+    if(b < 0 && a < LUA_MININTEGER - b) {
+        *overflow = true;
+        return LUA_MININTEGER;
+    }
+    return a + b;
+}
+
+static lua_Integer checked_mul(lua_Integer a, lua_Integer b, bool *overflow) {
+    bool overflows;
+    if(a > 0) {
+        overflows = b > 0 ? a > LUA_MAXINTEGER / b : b < LUA_MININTEGER / a;
+    }
+    else {
+        overflows = b > 0 ? a < LUA_MININTEGER / b : a != 0 && b < LUA_MAXINTEGER / a;
+    }
+    if(overflows) {
+        *overflow = true;
+        return (a < 0) != (b < 0) ? LUA_MININTEGER : LUA_MAXINTEGER;
+    }
+    return a * b;
+}
+
+/*
+ * Integer arithmetic for uint64 elements. The element is unsigned and the
+ * other value is a signed Lua integer, or unsigned when it is read from
+ * uint64 elements too, passed as a magnitude and a sign. On overflow the
+ * result is the bound in the direction of the exact result.
+ */
+
+static uint64_t add_uint64(uint64_t a, uint64_t magnitude, bool negative, bool *overflow) {
+    if(negative) {
+        if(magnitude > a) {
+            *overflow = true;
+            return 0;
+        }
+        return a - magnitude;
+    }
+    if(magnitude > UINT64_MAX - a) {
+        *overflow = true;
+        return UINT64_MAX;
+    }
+    return a + magnitude;
+}
+
+/**
+ * Product of two magnitudes, or false if it is above UINT64_MAX.
+ */
+static bool mul_magnitudes(uint64_t a, uint64_t b, uint64_t *product) {
+    if(a != 0 && b > UINT64_MAX / a) {
+        return false;
+    }
+    *product = a * b;
+    return true;
+}
+
+static uint64_t integer_magnitude(lua_Integer value) {
+    return value < 0 ? 0 - (uint64_t)value : (uint64_t)value;
+}
+
+static uint64_t compute_uint64(const MathPlan *plan, uint64_t a, uint64_t b, bool b_negative, bool *overflow) {
+    uint64_t product;
+    switch(plan->operation) {
+        case MATH_ADD:
+            return add_uint64(a, b, b_negative, overflow);
+        case MATH_MUL:
+            if(!mul_magnitudes(a, b, &product)) {
+                *overflow = true;
+                return b_negative ? 0 : UINT64_MAX;
+            }
+            if(b_negative && product != 0) {
+                *overflow = true;
+                return 0;
+            }
+            return product;
+        case MATH_AXPY: {
+            bool negative = (plan->k.integer < 0) != b_negative;
+            if(!mul_magnitudes(integer_magnitude(plan->k.integer), b, &product)) {
+                *overflow = true;
+                return negative ? 0 : UINT64_MAX;
+            }
+            return add_uint64(a, product, negative && product != 0, overflow);
+        }
+        case MATH_CLAMP: {
+            // The bounds were rounded to uint64 values and keep their bits
+            uint64_t lo = (uint64_t)plan->k.integer;
+            uint64_t hi = (uint64_t)plan->hi.integer;
+            return a < lo ? lo : a > hi ? hi : a;
+        }
+        default:
+            return a;
+    }
+}
+
+static lua_Integer compute_integer(const MathPlan *plan, lua_Integer a, lua_Integer b, bool *overflow) {
+    switch(plan->operation) {
+        case MATH_ADD:
+            return checked_add(a, b, overflow);
+        case MATH_MUL:
+            return checked_mul(a, b, overflow);
+        case MATH_AXPY:
+            return checked_add(a, checked_mul(plan->k.integer, b, overflow), overflow);
+        case MATH_CLAMP:
+            return a < plan->k.integer ? plan->k.integer : a > plan->hi.integer ? plan->hi.integer : a;
+        default:
+            return a;
+    }
+}
+
+static lua_Number compute_number(const MathPlan *plan, lua_Number a, lua_Number b) {
+    switch(plan->operation) {
+        case MATH_ADD:
+            return a + b;
+        case MATH_MUL:
+            return a * b;
+        case MATH_AXPY:
+            return a + plan->k.number * b;
+        case MATH_CLAMP: {
+            lua_Number value = plan->k.number > a ? plan->k.number : a;
+            return plan->hi.number < value ? plan->hi.number : value;
+        }
+        case MATH_LERP:
+            return a + (b - a) * plan->k.number;
+        default:
+            return a;
+    }
+}
+
+static void store_integer(LuastructType type, void *data, lua_Integer value) {
+    switch(type) {
+        #define INTEGER_CASE(type, name) \
+            case type: \
+                *(name##_t *)data = (name##_t)value; \
+                break;
+        LUAS_FOREACH_INTEGER_TYPE(INTEGER_CASE)
+        #undef INTEGER_CASE
+        default:
+            break;
+    }
+}
+
+/**
+ * Whether the operation can be carried out with integer arithmetic: the
+ * elements, the operand and the parameters are all integers.
+ */
+static bool is_integer_plan(const MathPlan *plan) {
+    const MathOperand *operand = &plan->operand;
+    if(LUAS_KEY_IS_FLOAT(&plan->key) || plan->operation == MATH_LERP) {
+        return false;
+    }
+    if(plan->operation == MATH_CLAMP) {
+        return plan->k.is_integer && plan->hi.is_integer;
+    }
+    if(operand->is_array ? LUAS_KEY_IS_FLOAT(&operand->key) : !operand->scalar.is_integer) {
+        return false;
+    }
+    return plan->operation != MATH_AXPY || plan->k.is_integer;
+}
+
+/**
+ * Compute the new value of a uint64 element, returned as its bits. Results
+ * computed with floats are rounded to the nearest integer. Values below 0 or
+ * above UINT64_MAX are saturated, or raise the same error as __newindex.
+ */
+static lua_Integer compute_uint64_element(lua_State *state, const MathPlan *plan, bool integer_plan, size_t i) {
+    const MathOperand *operand = &plan->operand;
+    void *element = LUAS_SPAN_ELEMENT(&plan->span, i);
+    void *operand_element = operand->is_array ? LUAS_SPAN_ELEMENT(&operand->span, plan->first + i) : NULL;
+
+    uint64_t value;
+    bool overflow = false;
+    if(integer_plan) {
+        uint64_t a = (uint64_t)read_array_key_integer(&plan->key, element);
+        lua_Integer b = operand_element ? read_array_key_integer(&operand->key, operand_element) : operand->scalar.integer;
+        if(operand_element && operand->key.type == LUAST_UINT64) {
+            value = compute_uint64(plan, a, (uint64_t)b, false, &overflow);
+        }
+        else {
+            value = compute_uint64(plan, a, integer_magnitude(b), b < 0, &overflow);
+        }
+    }
+    else {
+        lua_Number b = operand_element ? read_array_key_number(&operand->key, operand_element) : operand->scalar.number;
+        lua_Number number = floor(compute_number(plan, read_array_key_number(&plan->key, element), b) + 0.5);
+        lua_Number limit = -2 * (lua_Number)LUA_MININTEGER;
+        if(!(number >= 0)) {
+            overflow = true;
+            value = 0;
+        }
+        else if(number >= limit) {
+            overflow = true;
+            value = UINT64_MAX;
+        }
+        else {
+            value = (uint64_t)number;
+        }
+    }
+
+    if(overflow && !plan->saturate) {
+        luaL_error(state, "Value out of range for %s", luastruct_name_for_type(plan->key.type));
+        return 0;
+    }
+    return (lua_Integer)value;
+}
+
+/**
+ * Compute the new value of an integer element. Results computed with
+ * floats are rounded to the nearest integer. Values out of the range of
+ * the element type are saturated, or raise the same error as __newindex.
+ */
+static lua_Integer compute_integer_element(lua_State *state, const MathPlan *plan, bool integer_plan, size_t i) {
+    if(plan->key.type == LUAST_UINT64) {
+        return compute_uint64_element(state, plan, integer_plan, i);
+    }
+    const MathOperand *operand = &plan->operand;
+    void *element = LUAS_SPAN_ELEMENT(&plan->span, i);
+    void *operand_element = operand->is_array ? LUAS_SPAN_ELEMENT(&operand->span, plan->first + i) : NULL;
+    lua_Integer min, max;
+    get_integer_range(plan->key.type, &min, &max);
+
+    lua_Integer value;
+    bool overflow = false;
+    if(integer_plan) {
+        lua_Integer b = operand_element ? read_array_key_integer(&operand->key, operand_element) : operand->scalar.integer;
+        value = compute_integer(plan, read_array_key_integer(&plan->key, element), b, &overflow);
+    }
+    else {
+        lua_Number b = operand_element ? read_array_key_number(&operand->key, operand_element) : operand->scalar.number;
+        lua_Number number = floor(compute_number(plan, read_array_key_number(&plan->key, element), b) + 0.5);
+        lua_Number limit = -(lua_Number)LUA_MININTEGER;
+        if(isnan(number)) {
+            overflow = true;
+            value = 0;
+        }
+        else if(number < -limit) {
+            overflow = true;
+            value = LUA_MININTEGER;
+        }
+        else if(number >= limit) {
+            overflow = true;
+            value = LUA_MAXINTEGER;
+        }
+        else {
+            value = (lua_Integer)number;
+        }
+    }
+
+    if(overflow || value < min || value > max) {
+        if(!plan->saturate) {
+            if(overflow) {
+                luaL_error(state, "Value out of range for %s", luastruct_name_for_type(plan->key.type));
+            }
+            else {
+                luaL_error(state, "Value out of range for %s: %I", luastruct_name_for_type(plan->key.type), value);
+            }
+            return 0;
+        }
+        value = value < min ? min : value > max ? max : value;
+    }
+    return value;
+}
+
+/**
+ * Make the segment s of the array the one the plan applies to.
+ */
+static void select_segment(MathPlan *plan, size_t s) {
+    plan->first = 0;
+    for(size_t i = 0; i < s; i++) {
+        plan->first += plan->segments[i].count;
+    }
+    plan->span = plan->segments[s];
+}
+
+static void check_integer(lua_State *state, MathPlan *plan) {
+    bool integer_plan = is_integer_plan(plan);
+    for(size_t s = 0; s < plan->segment_count; s++) {
+        select_segment(plan, s);
+        for(size_t i = 0; i < plan->span.count; i++) {
+            compute_integer_element(state, plan, integer_plan, i);
+        }
+    }
+}
+
+static void apply_integer(lua_State *state, const MathPlan *plan) {
+    bool integer_plan = is_integer_plan(plan);
+    for(size_t i = 0; i < plan->span.count; i++) {
+        lua_Integer value = compute_integer_element(state, plan, integer_plan, i);
+        store_integer(plan->key.type, LUAS_SPAN_ELEMENT(&plan->span, i), value);
+    }
+}
+
+/**
+ * Run a float operation through the vector kernels. Both the elements and
+ * an array operand must be contiguous floats.
+ * @return False if the operation has no kernel for its operands.
+ */
+static bool apply_float_simd(const MathPlan *plan) {
+    const MathOperand *operand = &plan->operand;
+    if(!LUAS_SPAN_IS_CONTIGUOUS(&plan->span)) {
+        return false;
+    }
+    float *y = (float *)plan->span.data;
+    size_t count = plan->span.count;
+    if(!operand->is_array) {
+        float b = operand->scalar.number;
+        switch(plan->operation) {
+            case MATH_ADD:
+                simd_shift_float(y, b, count);
+                return true;
+            case MATH_MUL:
+                simd_scale_float(y, b, count);
+                return true;
+            case MATH_CLAMP:
+                simd_clamp_float(y, plan->k.number, plan->hi.number, count);
+                return true;
+            default:
+                return false;
+        }
+    }
+    if(operand->span.elements_type != LUAST_FLOAT || !LUAS_SPAN_IS_CONTIGUOUS(&operand->span)) {
+        return false;
+    }
+    const float *x = (const float *)operand->span.data + plan->first;
+    switch(plan->operation) {
+        case MATH_ADD:
+            simd_axpy_float(y, x, 1.0f, count);
+            return true;
+        case MATH_MUL:
+            simd_mul_float(y, x, count);
+            return true;
+        case MATH_AXPY:
+            simd_axpy_float(y, x, plan->k.number, count);
+            return true;
+        case MATH_LERP:
+            simd_lerp_float(y, x, plan->k.number, count);
+            return true;
+        default:
+            return false;
+    }
+}
+
+/**
+ * Float elements are computed in single precision, like the vector kernels,
+ * so that the result does not depend on the layout of the operands.
+ */
+static void apply_float(const MathPlan *plan) {
+    if(apply_float_simd(plan)) {
+        return;
+    }
+    const MathOperand *operand = &plan->operand;
+    float k = plan->k.number;
+    float hi = plan->hi.number;
+    for(size_t i = 0; i < plan->span.count; i++) {
+        float *y = LUAS_SPAN_ELEMENT(&plan->span, i);
+        float x = operand->is_array ? (float)read_array_key_number(&operand->key, LUAS_SPAN_ELEMENT(&operand->span, plan->first + i)) : (float)operand->scalar.number;
+        switch(plan->operation) {
+            case MATH_ADD:
+                *y = *y + x;
+                break;
+            case MATH_MUL:
+                *y = *y * x;
+                break;
+            case MATH_AXPY:
+                *y = *y + k * x;
+                break;
+            case MATH_CLAMP: {
+                float value = k > *y ? k : *y;
+                *y = hi < value ? hi : value;
+                break;
+            }
+            case MATH_LERP:
+                *y = *y + (x - *y) * k;
+                break;
+        }
+    }
+}
+
+/**
+ * Parse the array an operation updates. Integer results out of range are
+ * saturated if the argument at saturate_index is true, and raise an error
+ * otherwise.
+ */
+static void check_target(lua_State *state, MathPlan *plan, MathOperation operation, int saturate_index) {
+    LuastructArray *array = check_numeric_segments(state, 1, plan->segments, &plan->segment_count, &plan->key);
+    if(array->array_info->elements_are_readonly) {
+        luaL_error(state, "Array is read-only");
+    }
+    plan->count = 0;
+    for(size_t s = 0; s < plan->segment_count; s++) {
+        plan->count += plan->segments[s].count;
+    }
+    plan->operation = operation;
+    plan->operand.is_array = false;
+    plan->saturate = lua_toboolean(state, saturate_index);
+}
+
+static int apply_plan(lua_State *state, MathPlan *plan) {
+    separate_operand(state, plan);
+    bool is_float = LUAS_KEY_IS_FLOAT(&plan->key);
+    if(!is_float && !plan->saturate) {
+        // Check every result first so that a range error leaves the array untouched
+        check_integer(state, plan);
+    }
+    for(size_t s = 0; s < plan->segment_count; s++) {
+        select_segment(plan, s);
+        if(is_float) {
+            apply_float(plan);
+        }
+        else {
+            apply_integer(state, plan);
+        }
+    }
+    lua_settop(state, 1);
+    return 1;
+}
+
+int luastruct_array_add(lua_State *state) {
+    MathPlan plan;
+    check_target(state, &plan, MATH_ADD, 3);
+    check_operand(state, 2, &plan);
+    return apply_plan(state, &plan);
+}
+
+int luastruct_array_mul(lua_State *state) {
+    MathPlan plan;
+    check_target(state, &plan, MATH_MUL, 3);
+    check_operand(state, 2, &plan);
+    return apply_plan(state, &plan);
+}
+
+int luastruct_array_axpy(lua_State *state) {
+    MathPlan plan;
+    check_target(state, &plan, MATH_AXPY, 4);
+    check_scalar(state, 2, &plan.k);
+    check_operand(state, 3, &plan);
+    return apply_plan(state, &plan);
+}
+
+/**
+ * Round a clamp bound of an integer array to the nearest integer inside
+ * the range.
+ */
+static void round_clamp_bound(MathScalar *bound, bool upper) {
+    if(bound->is_integer) {
+        return;
+    }
+    lua_Number limit = -(lua_Number)LUA_MININTEGER;
+    lua_Number number = upper ? floor(bound->number) : ceil(bound->number);
+    bound->integer = number >= limit ? LUA_MAXINTEGER : number < -limit ? LUA_MININTEGER : (lua_Integer)number;
+    bound->number = bound->integer;
+    bound->is_integer = true;
+}
+
+/**
+ * Round a clamp bound of a uint64 array to the nearest uint64 inside the
+ * range, kept as the bits of an integer.
+ */
+static void round_uint64_clamp_bound(MathScalar *bound, bool upper) {
+    lua_Number limit = -2 * (lua_Number)LUA_MININTEGER;
+    uint64_t value;
+    if(bound->is_integer) {
+        value = bound->integer < 0 ? 0 : (uint64_t)bound->integer;
+    }
+    else {
+        lua_Number number = upper ? floor(bound->number) : ceil(bound->number);
+        value = !(number > 0) ? 0 : number >= limit ? UINT64_MAX : (uint64_t)number;
+    }
+    bound->integer = (lua_Integer)value;
+    bound->is_integer = true;
+}
+
+int luastruct_array_clamp(lua_State *state) {
+    MathPlan plan;
+    check_target(state, &plan, MATH_CLAMP, 4);
+    check_scalar(state, 2, &plan.k);
+    check_scalar(state, 3, &plan.hi);
+    if(!(plan.k.number <= plan.hi.number)) {
+        return luaL_error(state, "Invalid range: %f > %f", lua_tonumber(state, 2), lua_tonumber(state, 3));
+    }
+    if(!LUAS_KEY_IS_FLOAT(&plan.key)) {
+        MathScalar nearest = plan.k;
+        nearest.number = floor(plan.k.number + 0.5);
+        bool empty;
+        if(plan.key.type == LUAST_UINT64) {
+            round_uint64_clamp_bound(&plan.k, false);
+            round_uint64_clamp_bound(&plan.hi, true);
+            round_uint64_clamp_bound(&nearest, false);
+            empty = (lua_Unsigned)plan.k.integer > (lua_Unsigned)plan.hi.integer;
+        }
+        else {
+            round_clamp_bound(&plan.k, false);
+            round_clamp_bound(&plan.hi, true);
+            round_clamp_bound(&nearest, false);
+            empty = plan.k.integer > plan.hi.integer;
+        }
+        if(empty) {
+            // No integer lies in the range, so every element becomes the one nearest to its lower bound
+            plan.k = nearest;
+            plan.hi = nearest;
+        }
+    }
+    // Bounds beyond the range of the element type clamp to the range
+    plan.saturate = true;
+    plan.operand.scalar = plan.k;
+    return apply_plan(state, &plan);
+}
+
+int luastruct_array_lerp(lua_State *state) {
+    MathPlan plan;
+    check_target(state, &plan, MATH_LERP, 4);
+    check_operand(state, 2, &plan);
+    check_scalar(state, 3, &plan.k);
+    return apply_plan(state, &plan);
+}
@@ -0,0 +1,163 @@
+// SPDX-License-Identifier: GPL-3.0-only
+
+#include <stdlib.h>
+#include <string.h>
+#include <lua.h>
+#include <lualib.h>
+#include <lauxlib.h>
+#include "luastruct.h"
+#include "array.h"
+#include "debug.h"
+
+/**
+ * Check that the elements of an array can be moved around as blocks of
+ * elements_size bytes.
+ * @return The size of the elements.
+ */
+static size_t check_movable_array(lua_State *state, LuastructArray *array) {
+    LuastructArrayDesc *array_info = array->array_info;
+    if(array_info->elements_are_readonly) {
+        luaL_error(state, "Array is read-only");
+    }
+    if(array_info->elements_type == LUAST_BITFIELD) {
+        luaL_error(state, "Packed bit arrays cannot be reordered");
+    }
+    size_t elements_size = get_array_elements_size(state, array_info);
+    if(elements_size == 0) {
+        luaL_error(state, "Array elements have no fixed size");
+    }
+    return elements_size;
+}
+
+static void check_index(lua_State *state, LuastructArray *array, lua_Integer index) {
+    if(index < 1 || index > get_array_size(state, array->array_info)) {
+        luaL_error(state, "Index out of bounds: %I", index);
+    }
+}
+
+static void check_range(lua_State *state, LuastructArray *array, lua_Integer first, lua_Integer count) {
+    check_index(state, array, first);
+    if(count > get_array_size(state, array->array_info) - first + 1) {
+        luaL_error(state, "Range of %I elements from index %I is out of bounds", count, first);
+    }
+}
+
+static void swap_blocks(uint8_t *a, uint8_t *b, size_t size) {
+    uint8_t tmp[64];
+    while(size > 0) {
+        size_t chunk = size < sizeof(tmp) ? size : sizeof(tmp);
+        memcpy(tmp, a, chunk);
+        memcpy(a, b, chunk);
+        memcpy(b, tmp, chunk);
+        a += chunk;
+        b += chunk;
+        size -= chunk;
+    }
+}
+
+/**
+ * Reverse the order of count elements starting at the zero-based index first.
+ * A contiguous range is reversed in place from both ends; any other range
+ * swaps the elements one pair at a time.
+ */
+static void reverse_elements(lua_State *state, LuastructArray *array, size_t elements_size, size_t first, size_t count) {
+    if(count < 2) {
+        return;
+    }
+    LuastructArraySpan spans[LUAS_MAX_SEGMENTS];
+    if(get_array_segments(state, array, first, count, spans) == 1 && LUAS_SPAN_IS_CONTIGUOUS(&spans[0])) {
+        uint8_t *low = spans[0].data;
+        uint8_t *high = low + (count - 1) * elements_size;
+        while(low < high) {
+            swap_blocks(low, high, elements_size);
+            low += elements_size;
+            high -= elements_size;
+        }
+        return;
+    }
+    for(size_t i = first, j = first + count - 1; i < j; i++, j--) {
+        swap_blocks(get_array_element(state, array, i), get_array_element(state, array, j), elements_size);
+    }
+}
+
+int luastruct_array_copy(lua_State *state) {
+    LuastructArray *dst = check_array(state, 1);
+    lua_Integer dst_first = luaL_checkinteger(state, 2);
+    LuastructArray *src = check_array(state, 3);
+    lua_Integer src_first = luaL_checkinteger(state, 4);
+    lua_Integer count = luaL_checkinteger(state, 5);
+
+    size_t elements_size = check_movable_array(state, dst);
+    if(!same_array_elements(state, dst->array_info, src->array_info)) {
+        return luaL_error(state, "Arrays have different element types: %s and %s", luastruct_name_for_type(dst->array_info->elements_type), luastruct_name_for_type(src->array_info->elements_type));
+    }
+    if(count < 0) {
+        return luaL_error(state, "Element count is negative: %I", count);
+    }
+    if(count == 0) {
+        return 0;
+    }
+    check_range(state, dst, dst_first, count);
+    check_range(state, src, src_first, count);
+
+    LuastructArraySpan dst_spans[LUAS_MAX_SEGMENTS];
+    LuastructArraySpan src_spans[LUAS_MAX_SEGMENTS];
+    size_t dst_segments = get_array_segments(state, dst, dst_first - 1, count, dst_spans);
+    size_t src_segments = get_array_segments(state, src, src_first - 1, count, src_spans);
+    if(dst_segments == 1 && src_segments == 1 && LUAS_SPAN_IS_CONTIGUOUS(&dst_spans[0]) && LUAS_SPAN_IS_CONTIGUOUS(&src_spans[0])) {
+        memmove(dst_spans[0].data, src_spans[0].data, (size_t)count * elements_size);
+        return 0;
+    }
+
+    // Strided, pointer or wrapping ranges may overlap in any order, so the source is read whole first
+    uint8_t *staging = lua_newuserdata(state, checked_mul_size(state, count, elements_size));
+    for(lua_Integer i = 0; i < count; i++) {
+        memcpy(staging + i * elements_size, get_array_element(state, src, src_first - 1 + i), elements_size);
+    }
+    for(lua_Integer i = 0; i < count; i++) {
+        memcpy(get_array_element(state, dst, dst_first - 1 + i), staging + i * elements_size, elements_size);
+    }
+    lua_pop(state, 1);
+    return 0;
+}
+
+int luastruct_array_swap(lua_State *state) {
+    LuastructArray *array = check_array(state, 1);
+    lua_Integer i = luaL_checkinteger(state, 2);
+    lua_Integer j = luaL_checkinteger(state, 3);
+
+    size_t elements_size = check_movable_array(state, array);
+    check_index(state, array, i);
+    check_index(state, array, j);
+    if(i != j) {
+        swap_blocks(get_array_element(state, array, i - 1), get_array_element(state, array, j - 1), elements_size);
+    }
+    return 0;
+}
+
+int luastruct_array_reverse(lua_State *state) {
+    LuastructArray *array = check_array(state, 1);
+    size_t elements_size = check_movable_array(state, array);
+    reverse_elements(state, array, elements_size, 0, get_array_size(state, array->array_info));
+    return 0;
+}
+
+int luastruct_array_rotate(lua_State *state) {
+    LuastructArray *array = check_array(state, 1);
+    lua_Integer shift = luaL_checkinteger(state, 2);
+
+    size_t elements_size = check_movable_array(state, array);
+    size_t count = get_array_size(state, array->array_info);
+    if(count < 2) {
+        return 0;
+    }
+    // Rotating by k moves the element i to i + k, which is the last k elements followed by the others
+    size_t k = (size_t)(shift % (lua_Integer)count + (lua_Integer)count) % count;
+    if(k == 0) {
+        return 0;
+    }
+    reverse_elements(state, array, elements_size, 0, count);
+    reverse_elements(state, array, elements_size, 0, k);
+    reverse_elements(state, array, elements_size, k, count - k);
+    return 0;
+}
@@ -0,0 +1,704 @@
+// SPDX-License-Identifier: GPL-3.0-only
+
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <lua.h>
+#include <lualib.h>
+#include <lauxlib.h>
+#include "luastruct.h"
+#include "array.h"
+#include "simd.h"
+#include "debug.h"
+
+/*
+ * Scalar kernels for every integer element type. These walk any span, so
+ * they also serve as the gather loop for pointer element arrays.
+ */
+#define DEFINE_INTEGER_KERNELS(type, name) \
+    static lua_Integer sum_##name(LuastructArraySpan *span) { \
+        lua_Unsigned sum = 0; \
+        for(size_t i = 0; i < span->count; i++) { \
+            sum += (lua_Integer)*(name##_t *)LUAS_SPAN_ELEMENT(span, i); \
+        } \
+        return sum; \
+    } \
+    static void minmax_##name(LuastructArraySpan *span, lua_Integer *min, lua_Integer *max) { \
+        name##_t low = *(name##_t *)LUAS_SPAN_ELEMENT(span, 0); \
+        name##_t high = low; \
+        for(size_t i = 1; i < span->count; i++) { \
+            name##_t value = *(name##_t *)LUAS_SPAN_ELEMENT(span, i); \
+            if(value < low) { \
+                low = value; \
+            } \
+            if(value > high) { \
+                high = value; \
+            } \
+        } \
+        *min = low; \
+        *max = high; \
+    } \
+    static lua_Integer dot_##name(LuastructArraySpan *a, LuastructArraySpan *b) { \
+        lua_Unsigned sum = 0; \
+        for(size_t i = 0; i < a->count; i++) { \
+            sum += (lua_Unsigned)*(name##_t *)LUAS_SPAN_ELEMENT(a, i) * (lua_Unsigned)*(name##_t *)LUAS_SPAN_ELEMENT(b, i); \
+        } \
+        return sum; \
+    }
+
+LUAS_FOREACH_INTEGER_TYPE(DEFINE_INTEGER_KERNELS)
+
+#undef DEFINE_INTEGER_KERNELS
+
+static lua_Number sum_float(LuastructArraySpan *span) {
+    if(LUAS_SPAN_IS_CONTIGUOUS(span)) {
+        return simd_sum_float((const float *)span->data, span->count);
+    }
+    double sum = 0;
+    for(size_t i = 0; i < span->count; i++) {
+        sum += *(float *)LUAS_SPAN_ELEMENT(span, i);
+    }
+    return sum;
+}
+
+static void minmax_float(LuastructArraySpan *span, lua_Number *min, lua_Number *max) {
+    float low = *(float *)LUAS_SPAN_ELEMENT(span, 0);
+    float high = low;
+    if(LUAS_SPAN_IS_CONTIGUOUS(span)) {
+        simd_minmax_float((const float *)span->data, span->count, &low, &high);
+    }
+    else {
+        for(size_t i = 1; i < span->count; i++) {
+            float value = *(float *)LUAS_SPAN_ELEMENT(span, i);
+            if(value < low) {
+                low = value;
+            }
+            if(value > high) {
+                high = value;
+            }
+        }
+    }
+    *min = low;
+    *max = high;
+}
+
+static lua_Number dot_float(LuastructArraySpan *a, LuastructArraySpan *b) {
+    if(LUAS_SPAN_IS_CONTIGUOUS(a) && LUAS_SPAN_IS_CONTIGUOUS(b)) {
+        return simd_dot_float((const float *)a->data, (const float *)b->data, a->count);
+    }
+    double sum = 0;
+    for(size_t i = 0; i < a->count; i++) {
+        sum += (double)*(float *)LUAS_SPAN_ELEMENT(a, i) * *(float *)LUAS_SPAN_ELEMENT(b, i);
+    }
+    return sum;
+}
+
+static lua_Integer sum_integers(LuastructArraySpan *span) {
+    if(span->elements_type == LUAST_INT32 && LUAS_SPAN_IS_CONTIGUOUS(span)) {
+        return simd_sum_int32((const int32_t *)span->data, span->count);
+    }
+    if((span->elements_type == LUAST_INT64 || span->elements_type == LUAST_UINT64) && LUAS_SPAN_IS_CONTIGUOUS(span)) {
+        return (lua_Integer)simd_sum_int64((const uint64_t *)span->data, span->count);
+    }
+    switch(span->elements_type) {
+        #define SUM_CASE(type, name) case type: return sum_##name(span);
+        LUAS_FOREACH_INTEGER_TYPE(SUM_CASE)
+        #undef SUM_CASE
+        default:
+            return 0;
+    }
+}
+
+static void minmax_integers(LuastructArraySpan *span, lua_Integer *min, lua_Integer *max) {
+    if(span->elements_type == LUAST_INT32 && LUAS_SPAN_IS_CONTIGUOUS(span)) {
+        int32_t low = *(int32_t *)span->data;
+        int32_t high = low;
+        simd_minmax_int32((const int32_t *)span->data, span->count, &low, &high);
+        *min = low;
+        *max = high;
+        return;
+    }
+    if(span->elements_type == LUAST_INT64 && LUAS_SPAN_IS_CONTIGUOUS(span)) {
+        int64_t low = *(int64_t *)span->data;
+        int64_t high = low;
+        simd_minmax_int64((const int64_t *)span->data, span->count, &low, &high);
+        *min = low;
+        *max = high;
+        return;
+    }
+    if(span->elements_type == LUAST_UINT64 && LUAS_SPAN_IS_CONTIGUOUS(span)) {
+        uint64_t low = *(uint64_t *)span->data;
+        uint64_t high = low;
+        simd_minmax_uint64((const uint64_t *)span->data, span->count, &low, &high);
+        *min = (lua_Integer)low;
+        *max = (lua_Integer)high;
+        return;
+    }
+    switch(span->elements_type) {
+        #define MINMAX_CASE(type, name) case type: minmax_##name(span, min, max); break;
+        LUAS_FOREACH_INTEGER_TYPE(MINMAX_CASE)
+        #undef MINMAX_CASE
+        default:
+            break;
+    }
+}
+
+static lua_Integer dot_integers(LuastructArraySpan *a, LuastructArraySpan *b) {
+    if(a->elements_type == LUAST_INT32 && LUAS_SPAN_IS_CONTIGUOUS(a) && LUAS_SPAN_IS_CONTIGUOUS(b)) {
+        return simd_dot_int32((const int32_t *)a->data, (const int32_t *)b->data, a->count);
+    }
+    switch(a->elements_type) {
+        #define DOT_CASE(type, name) case type: return dot_##name(a, b);
+        LUAS_FOREACH_INTEGER_TYPE(DOT_CASE)
+        #undef DOT_CASE
+        default:
+            return 0;
+    }
+}
+
+/**
+ * Compare integers read from elements of the given type. uint64 elements
+ * are carried in the bits of a lua_Integer, so they compare as unsigned.
+ */
+static bool integer_less(LuastructType type, lua_Integer a, lua_Integer b) {
+    return type == LUAST_UINT64 ? (lua_Unsigned)a < (lua_Unsigned)b : a < b;
+}
+
+static bool is_integer_type(LuastructType type) {
+    switch(type) {
+        #define INTEGER_CASE(type, name) case type:
+        LUAS_FOREACH_INTEGER_TYPE(INTEGER_CASE)
+        #undef INTEGER_CASE
+            return true;
+        default:
+            return false;
+    }
+}
+
+/**
+ * Check that the array at the given stack index has numeric elements and
+ * resolve them into contiguous segments, two for a ring buffer that wraps.
+ * @return The number of segments.
+ */
+static size_t check_numeric_array(lua_State *state, int index, LuastructArraySpan *spans) {
+    LuastructArray *array = check_array(state, index);
+    LuastructType type = array->array_info->elements_type;
+    if(type != LUAST_FLOAT && !is_integer_type(type)) {
+        luaL_error(state, "Array elements are not numeric: %s", luastruct_name_for_type(type));
+    }
+    return get_array_segments(state, array, 0, get_array_size(state, array->array_info), spans);
+}
+
+static size_t count_segments(const LuastructArraySpan *spans, size_t segments) {
+    size_t count = 0;
+    for(size_t i = 0; i < segments; i++) {
+        count += spans[i].count;
+    }
+    return count;
+}
+
+static lua_Number sum_float_segments(LuastructArraySpan *spans, size_t segments) {
+    lua_Number sum = 0;
+    for(size_t i = 0; i < segments; i++) {
+        sum += sum_float(&spans[i]);
+    }
+    return sum;
+}
+
+static lua_Integer sum_integer_segments(LuastructArraySpan *spans, size_t segments) {
+    lua_Unsigned sum = 0;
+    for(size_t i = 0; i < segments; i++) {
+        sum += (lua_Unsigned)sum_integers(&spans[i]);
+    }
+    return sum;
+}
+
+/**
+ * Push an integer computed from elements of the array at index 1, which
+ * follows the overflow policy of the array for uint64 elements.
+ */
+static void push_integer_result(lua_State *state, LuastructType type, lua_Integer value) {
+    if(type == LUAST_UINT64) {
+        push_uint64(state, (uint64_t)value, check_array(state, 1)->array_info->overflow);
+        return;
+    }
+    lua_pushinteger(state, value);
+}
+
+int luastruct_array_sum(lua_State *state) {
+    LuastructArraySpan spans[LUAS_MAX_SEGMENTS];
+    size_t segments = check_numeric_array(state, 1, spans);
+    if(spans[0].elements_type == LUAST_FLOAT) {
+        lua_pushnumber(state, sum_float_segments(spans, segments));
+    }
+    else {
+        push_integer_result(state, spans[0].elements_type, sum_integer_segments(spans, segments));
+    }
+    return 1;
+}
+
+static int push_minmax(lua_State *state, bool push_min, bool push_max) {
+    LuastructArraySpan spans[LUAS_MAX_SEGMENTS];
+    size_t segments = check_numeric_array(state, 1, spans);
+    if(count_segments(spans, segments) == 0) {
+        lua_pushnil(state);
+        return 1;
+    }
+    if(spans[0].elements_type == LUAST_FLOAT) {
+        lua_Number min, max;
+        minmax_float(&spans[0], &min, &max);
+        for(size_t i = 1; i < segments; i++) {
+            lua_Number low, high;
+            minmax_float(&spans[i], &low, &high);
+            min = low < min ? low : min;
+            max = high > max ? high : max;
+        }
+        if(push_min) {
+            lua_pushnumber(state, min);
+        }
+        if(push_max) {
+            lua_pushnumber(state, max);
+        }
+    }
+    else {
+        LuastructType type = spans[0].elements_type;
+        lua_Integer min, max;
+        minmax_integers(&spans[0], &min, &max);
+        for(size_t i = 1; i < segments; i++) {
+            lua_Integer low, high;
+            minmax_integers(&spans[i], &low, &high);
+            min = integer_less(type, low, min) ? low : min;
+            max = integer_less(type, max, high) ? high : max;
+        }
+        if(push_min) {
+            push_integer_result(state, type, min);
+        }
+        if(push_max) {
+            push_integer_result(state, type, max);
+        }
+    }
+    return push_min + push_max;
+}
+
+int luastruct_array_min(lua_State *state) {
+    return push_minmax(state, true, false);
+}
+
+int luastruct_array_max(lua_State *state) {
+    return push_minmax(state, false, true);
+}
+
+int luastruct_array_minmax(lua_State *state) {
+    return push_minmax(state, true, true);
+}
+
+int luastruct_array_mean(lua_State *state) {
+    LuastructArraySpan spans[LUAS_MAX_SEGMENTS];
+    size_t segments = check_numeric_array(state, 1, spans);
+    size_t count = count_segments(spans, segments);
+    if(count == 0) {
+        lua_pushnil(state);
+        return 1;
+    }
+    lua_Number sum;
+    if(spans[0].elements_type == LUAST_FLOAT) {
+        sum = sum_float_segments(spans, segments);
+    }
+    else if(spans[0].elements_type == LUAST_UINT64) {
+        sum = (lua_Number)(lua_Unsigned)sum_integer_segments(spans, segments);
+    }
+    else {
+        sum = (lua_Number)sum_integer_segments(spans, segments);
+    }
+    lua_pushnumber(state, sum / count);
+    return 1;
+}
+
+/**
+ * Fill a span with count elements of another span, starting at the
+ * zero-based index first.
+ */
+static void get_span_piece(const LuastructArraySpan *span, size_t first, size_t count, LuastructArraySpan *piece) {
+    *piece = *span;
+    piece->data += first * span->stride;
+    piece->count = count;
+}
+
+int luastruct_array_dot(lua_State *state) {
+    LuastructArraySpan a[LUAS_MAX_SEGMENTS], b[LUAS_MAX_SEGMENTS];
+    size_t a_segments = check_numeric_array(state, 1, a);
+    size_t b_segments = check_numeric_array(state, 2, b);
+    if(a->elements_type != b->elements_type) {
+        return luaL_error(state, "Array element types do not match: %s != %s", luastruct_name_for_type(a->elements_type), luastruct_name_for_type(b->elements_type));
+    }
+    size_t count = count_segments(a, a_segments);
+    if(count != count_segments(b, b_segments)) {
+        return luaL_error(state, "Array lengths do not match: %I != %I", (lua_Integer)count, (lua_Integer)count_segments(b, b_segments));
+    }
+
+    // Segments of the two arrays may end at different elements, so the products are summed between every boundary of either
+    lua_Number number_sum = 0;
+    lua_Unsigned integer_sum = 0;
+    size_t a_first = 0, b_first = 0;
+    for(size_t done = 0, i = 0, j = 0; done < count;) {
+        size_t length = a[i].count - a_first < b[j].count - b_first ? a[i].count - a_first : b[j].count - b_first;
+        LuastructArraySpan a_piece, b_piece;
+        get_span_piece(&a[i], a_first, length, &a_piece);
+        get_span_piece(&b[j], b_first, length, &b_piece);
+        if(a->elements_type == LUAST_FLOAT) {
+            number_sum += dot_float(&a_piece, &b_piece);
+        }
+        else {
+            integer_sum += (lua_Unsigned)dot_integers(&a_piece, &b_piece);
+        }
+        done += length;
+        a_first += length;
+        b_first += length;
+        if(a_first == a[i].count) {
+            i++;
+            a_first = 0;
+        }
+        if(b_first == b[j].count) {
+            j++;
+            b_first = 0;
+        }
+    }
+    if(a->elements_type == LUAST_FLOAT) {
+        lua_pushnumber(state, number_sum);
+    }
+    else {
+        push_integer_result(state, a->elements_type, (lua_Integer)integer_sum);
+    }
+    return 1;
+}
+
+#define AGGREGATE_MAX_COLUMNS 16
+#define AGGREGATE_MIN_CAPACITY 16
+
+typedef enum AggregateOperation {
+    AGGREGATE_SUM,
+    AGGREGATE_MIN,
+    AGGREGATE_MAX,
+    AGGREGATE_MEAN
+} AggregateOperation;
+
+static const char *const AGGREGATE_OPERATIONS[] = { "sum", "min", "max", "mean", NULL };
+
+typedef union AggregateValue {
+    lua_Integer integer;
+    lua_Number number;
+} AggregateValue;
+
+/**
+ * One value computed for every group: an operation over a field.
+ * Fields given in a list are reported in a table keyed by field name.
+ */
+typedef struct AggregateColumn {
+    LuastructArrayKey key;
+    AggregateOperation operation;
+    bool by_number;
+    const char *field;
+    bool in_table;
+} AggregateColumn;
+
+/**
+ * Slot of the group hash table, followed by the values of the columns.
+ * A slot is empty when its count is 0.
+ */
+typedef struct AggregateGroup {
+    AggregateValue key;
+    size_t count;
+    AggregateValue values[];
+} AggregateGroup;
+
+typedef struct AggregateTable {
+    uint8_t *groups;
+    size_t group_size;
+    size_t mask;
+    size_t used;
+    bool key_is_float;
+} AggregateTable;
+
+#define AGGREGATE_GROUP(table, i) ((AggregateGroup *)((table)->groups + (i) * (table)->group_size))
+
+static AggregateGroup *find_group(AggregateTable *table, AggregateValue key) {
+    bool is_float = table->key_is_float;
+    size_t i = hash_array_key(is_float, key.integer, key.number) & table->mask;
+    for(;;) {
+        AggregateGroup *group = AGGREGATE_GROUP(table, i);
+        if(group->count == 0 || (is_float ? group->key.number == key.number : group->key.integer == key.integer)) {
+            return group;
+        }
+        i = (i + 1) & table->mask;
+    }
+}
+
+/**
+ * Allocate the groups of a table as a userdata that replaces the value at
+ * buffer_index, moving the groups already in the table.
+ */
+static void resize_groups(lua_State *state, AggregateTable *table, size_t capacity, int buffer_index) {
+    size_t size = checked_mul_size(state, capacity, table->group_size);
+    uint8_t *groups = lua_newuserdata(state, size);
+    memset(groups, 0, size);
+
+    AggregateTable old = *table;
+    table->groups = groups;
+    table->mask = capacity - 1;
+    if(old.groups) {
+        for(size_t i = 0; i <= old.mask; i++) {
+            AggregateGroup *group = AGGREGATE_GROUP(&old, i);
+            if(group->count != 0) {
+                memcpy(find_group(table, group->key), group, table->group_size);
+            }
+        }
+    }
+    lua_replace(state, buffer_index);
+}
+
+static void update_group(AggregateGroup *group, const AggregateColumn *columns, size_t count, const void *element) {
+    group->count++;
+    for(size_t c = 0; c < count; c++) {
+        const AggregateColumn *column = &columns[c];
+        AggregateValue *value = &group->values[c];
+        if(column->by_number) {
+            lua_Number number = read_array_key_number(&column->key, element);
+            if(group->count == 1) {
+                value->number = number;
+            }
+            else if(column->operation == AGGREGATE_SUM || column->operation == AGGREGATE_MEAN) {
+                value->number += number;
+            }
+            else if(column->operation == AGGREGATE_MIN ? number < value->number : number > value->number) {
+                value->number = number;
+            }
+        }
+        else {
+            lua_Integer integer = read_array_key_integer(&column->key, element);
+            if(group->count == 1) {
+                value->integer = integer;
+            }
+            else if(column->operation == AGGREGATE_SUM) {
+                value->integer = (lua_Unsigned)value->integer + (lua_Unsigned)integer;
+            }
+            else if(column->operation == AGGREGATE_MIN ? integer_less(column->key.type, integer, value->integer) : integer_less(column->key.type, value->integer, integer)) {
+                value->integer = integer;
+            }
+        }
+    }
+}
+
+/**
+ * Push the table of the values of a group.
+ */
+static void push_group(lua_State *state, const AggregateGroup *group, const AggregateColumn *columns, size_t count, bool with_count) {
+    lua_createtable(state, 0, count + 1);
+    if(with_count) {
+        lua_pushinteger(state, group->count);
+        lua_setfield(state, -2, "count");
+    }
+    for(size_t c = 0; c < count; c++) {
+        const AggregateColumn *column = &columns[c];
+        const AggregateValue *value = &group->values[c];
+        if(group->count == 0 && column->operation != AGGREGATE_SUM) {
+            continue;
+        }
+        const char *name = AGGREGATE_OPERATIONS[column->operation];
+        if(column->in_table) {
+            if(lua_getfield(state, -1, name) == LUA_TNIL) {
+                lua_pop(state, 1);
+                lua_newtable(state);
+                lua_pushvalue(state, -1);
+                lua_setfield(state, -3, name);
+            }
+        }
+        if(column->operation == AGGREGATE_MEAN) {
+            lua_pushnumber(state, value->number / group->count);
+        }
+        else if(column->by_number) {
+            lua_pushnumber(state, group->count == 0 ? 0 : value->number);
+        }
+        else if(column->key.type == LUAST_UINT64) {
+            push_uint64(state, group->count == 0 ? 0 : (uint64_t)value->integer, column->key.overflow);
+        }
+        else {
+            lua_pushinteger(state, group->count == 0 ? 0 : value->integer);
+        }
+        if(column->in_table) {
+            lua_setfield(state, -2, column->field);
+            lua_pop(state, 1);
+        }
+        else {
+            lua_setfield(state, -2, name);
+        }
+    }
+}
+
+/**
+ * Resolve the key named by an aggregate option, where true stands for the
+ * elements themselves.
+ */
+static void check_aggregate_key(lua_State *state, LuastructArrayDesc *desc, int index, LuastructArrayKey *key) {
+    if(lua_isboolean(state, index) && lua_toboolean(state, index)) {
+        lua_pushnil(state);
+        check_array_key(state, desc, -1, key);
+        lua_pop(state, 1);
+        return;
+    }
+    check_array_key(state, desc, index, key);
+}
+
+static void add_aggregate_column(lua_State *state, LuastructArrayDesc *desc, AggregateColumn *columns, size_t *count, AggregateOperation operation, int field_index, bool in_table) {
+    if(*count == AGGREGATE_MAX_COLUMNS) {
+        luaL_error(state, "Too many aggregates, at most %d are supported", AGGREGATE_MAX_COLUMNS);
+        return;
+    }
+    AggregateColumn *column = &columns[*count];
+    check_aggregate_key(state, desc, field_index, &column->key);
+    column->operation = operation;
+    column->by_number = LUAS_KEY_IS_FLOAT(&column->key) || operation == AGGREGATE_MEAN;
+    column->field = lua_tostring(state, field_index);
+    column->in_table = in_table;
+    (*count)++;
+}
+
+/**
+ * Whether the values of the key at the given path are booleans, which are
+ * keyed by the integer of their storage.
+ */
+static bool is_boolean_key(lua_State *state, LuastructArrayDesc *desc, const char *path) {
+    if(!path) {
+        return desc->elements_type == LUAST_BOOL;
+    }
+    uint32_t offset;
+    bool readonly;
+    return find_struct_field_path(state, desc->elements_type_info, path, &offset, &readonly)->type == LUAST_BOOL;
+}
+
+/**
+ * Compute per-group statistics in a single pass over the array.
+ * Arguments are (arr, { by = field, count = true, sum = field or { fields },
+ * min = ..., max = ..., mean = ... }), where true instead of a field stands
+ * for the elements themselves. The result maps each value of the group field
+ * to a table of the statistics of its elements, or is the table of the
+ * statistics of all elements if there is no group field.
+ */
+int luastruct_array_aggregate(lua_State *state) {
+    LuastructArray *array = check_array(state, 1);
+    LuastructArrayDesc *array_info = array->array_info;
+    luaL_checktype(state, 2, LUA_TTABLE);
+    lua_settop(state, 2);
+
+    lua_pushnil(state);
+    while(lua_next(state, 2) != 0) {
+        lua_pop(state, 1);
+        const char *option = lua_type(state, -1) == LUA_TSTRING ? lua_tostring(state, -1) : NULL;
+        bool known = option && (strcmp(option, "by") == 0 || strcmp(option, "count") == 0);
+        for(int operation = AGGREGATE_SUM; option && !known && operation <= AGGREGATE_MEAN; operation++) {
+            known = strcmp(option, AGGREGATE_OPERATIONS[operation]) == 0;
+        }
+        if(!known) {
+            return luaL_error(state, "Unknown aggregate option: %s", option ? option : luaL_typename(state, -1));
+        }
+    }
+
+    lua_getfield(state, 2, "by");
+    bool grouped = !lua_isnil(state, 3);
+    LuastructArrayKey by;
+    if(grouped) {
+        check_aggregate_key(state, array_info, 3, &by);
+    }
+    bool boolean_groups = grouped && is_boolean_key(state, array_info, lua_type(state, 3) == LUA_TSTRING ? lua_tostring(state, 3) : NULL);
+    lua_getfield(state, 2, "count");
+    bool with_count = lua_toboolean(state, 4);
+
+    AggregateColumn columns[AGGREGATE_MAX_COLUMNS];
+    size_t count = 0;
+    for(int operation = AGGREGATE_SUM; operation <= AGGREGATE_MEAN; operation++) {
+        int type = lua_getfield(state, 2, AGGREGATE_OPERATIONS[operation]);
+        if(type == LUA_TTABLE) {
+            lua_Integer length = luaL_len(state, -1);
+            for(lua_Integer i = 1; i <= length; i++) {
+                lua_rawgeti(state, -1, i);
+                add_aggregate_column(state, array_info, columns, &count, operation, lua_gettop(state), true);
+                lua_pop(state, 1);
+            }
+        }
+        else if(type != LUA_TNIL) {
+            add_aggregate_column(state, array_info, columns, &count, operation, lua_gettop(state), false);
+        }
+        lua_pop(state, 1);
+    }
+
+    AggregateTable table = {
+        .groups = NULL,
+        .group_size = sizeof(AggregateGroup) + count * sizeof(AggregateValue),
+        .mask = 0,
+        .used = 0,
+        .key_is_float = grouped && LUAS_KEY_IS_FLOAT(&by)
+    };
+    lua_pushnil(state);
+    int buffer_index = lua_gettop(state);
+    resize_groups(state, &table, AGGREGATE_MIN_CAPACITY, buffer_index);
+
+    LuastructArraySpan spans[LUAS_MAX_SEGMENTS];
+    size_t segments = get_array_segments(state, array, 0, get_array_size(state, array_info), spans);
+    size_t prefetch_offset = grouped ? by.offset : count > 0 ? columns[0].key.offset : 0;
+    size_t distance = get_prefetch_distance(state);
+    for(size_t s = 0; s < segments; s++) {
+        LuastructArraySpan *span = &spans[s];
+        for(size_t i = 0; i < span->count; i++) {
+            prefetch_span_element(span, i, prefetch_offset, distance);
+            void *element = LUAS_SPAN_ELEMENT(span, i);
+            AggregateValue key = { .integer = 0 };
+            if(table.key_is_float) {
+                key.number = read_array_key_number(&by, element);
+                if(isnan(key.number)) {
+                    continue;
+                }
+            }
+            else if(grouped) {
+                key.integer = read_array_key_integer(&by, element);
+            }
+            AggregateGroup *group = find_group(&table, key);
+            if(group->count == 0) {
+                if(table.used + 1 > (table.mask + 1) / 2) {
+                    resize_groups(state, &table, (table.mask + 1) * 2, buffer_index);
+                    group = find_group(&table, key);
+                }
+                group->key = key;
+                table.used++;
+            }
+            update_group(group, columns, count, element);
+        }
+    }
+
+    if(!grouped) {
+        AggregateValue key = { .integer = 0 };
+        push_group(state, find_group(&table, key), columns, count, with_count);
+        return 1;
+    }
+
+    lua_createtable(state, 0, table.used);
+    for(size_t i = 0; i <= table.mask; i++) {
+        AggregateGroup *group = AGGREGATE_GROUP(&table, i);
+        if(group->count == 0) {
+            continue;
+        }
+        if(boolean_groups) {
+            lua_pushboolean(state, group->key.integer != 0);
+        }
+        else if(table.key_is_float) {
+            lua_pushnumber(state, group->key.number);
+        }
+        else if(by.type == LUAST_UINT64) {
+            push_uint64(state, (uint64_t)group->key.integer, by.overflow);
+        }
+        else {
+            lua_pushinteger(state, group->key.integer);
+        }
+        push_group(state, group, columns, count, with_count);
+        lua_rawset(state, -3);
+    }
+    return 1;
+}
@@ -0,0 +1,314 @@
+// SPDX-License-Identifier: GPL-3.0-only
+
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <lua.h>
+#include <lualib.h>
+#include <lauxlib.h>
+#include "luastruct.h"
+#include "array.h"
+#include "simd.h"
+#include "debug.h"
+
+/**
+ * Convert a value searched for in a uint64 array like check_uint64 does:
+ * negative integers only stand for large values if the array wraps, and
+ * integral floats up to 2^64 are the values read back as floats.
+ */
+static bool get_uint64_search_value(lua_State *state, int index, LuastructOverflow overflow, uint8_t *value) {
+    uint64_t element;
+    int isnum;
+    lua_Integer integer = lua_tointegerx(state, index, &isnum);
+    if(isnum) {
+        if(integer < 0 && overflow != LUAS_OVERFLOW_WRAP) {
+            return false;
+        }
+        element = (uint64_t)integer;
+    }
+    else {
+        lua_Number number = lua_tonumberx(state, index, &isnum);
+        if(!isnum || !(number >= 0 && number < 18446744073709551616.0) || number != floor(number)) {
+            return false;
+        }
+        element = (uint64_t)number;
+    }
+    memcpy(value, &element, sizeof(element));
+    return true;
+}
+
+/**
+ * Convert the Lua value at the given index into the in-memory representation
+ * of an element. Returns false if no element of the array can be equal to it,
+ * e.g. a fractional number in an integer array or a value out of range.
+ */
+static bool get_search_value(lua_State *state, int index, LuastructArraySpan *span, LuastructOverflow overflow, uint8_t *value) {
+    LuastructType type = span->elements_type;
+    if(type == LUAST_UINT64) {
+        return get_uint64_search_value(state, index, overflow, value);
+    }
+    if(type == LUAST_ENUM) {
+        switch(span->elements_size) {
+            case 1:
+                type = LUAST_INT8;
+                break;
+            case 2:
+                type = LUAST_INT16;
+                break;
+            default:
+                type = LUAST_INT32;
+                break;
+        }
+    }
+
+    switch(type) {
+        #define INTEGER_CASE(type, name) \
+            case type: { \
+                int isnum; \
+                lua_Integer number = lua_tointegerx(state, index, &isnum); \
+                name##_t element = (name##_t)number; \
+                if(!isnum || (lua_Integer)element != number) { \
+                    return false; \
+                } \
+                memcpy(value, &element, sizeof(element)); \
+                return true; \
+            }
+        LUAS_FOREACH_INTEGER_TYPE(INTEGER_CASE)
+        #undef INTEGER_CASE
+        case LUAST_FLOAT: {
+            int isnum;
+            lua_Number number = lua_tonumberx(state, index, &isnum);
+            float element = number;
+            if(!isnum || element != number) {
+                return false;
+            }
+            memcpy(value, &element, sizeof(element));
+            return true;
+        }
+        case LUAST_BOOL:
+            value[0] = lua_toboolean(state, index);
+            return true;
+        default:
+            luaL_error(state, "Cannot search arrays of type %s", luastruct_name_for_type(span->elements_type));
+            return false;
+    }
+}
+
+static bool span_element_equals(LuastructArraySpan *span, size_t index, const uint8_t *value) {
+    void *element = LUAS_SPAN_ELEMENT(span, index);
+    if(span->elements_type == LUAST_FLOAT) {
+        return *(float *)element == *(const float *)value;
+    }
+    return memcmp(element, value, span->elements_size) == 0;
+}
+
+/**
+ * Find the first element equal to value at or after from.
+ * @return The zero-based index of the element, or span->count if there is none.
+ */
+static size_t span_find(LuastructArraySpan *span, size_t from, const uint8_t *value) {
+    if(from >= span->count) {
+        return span->count;
+    }
+    if(LUAS_SPAN_IS_CONTIGUOUS(span)) {
+        const void *data = span->data + from * span->elements_size;
+        if(span->elements_type == LUAST_FLOAT) {
+            return from + simd_find_float(data, span->count - from, *(const float *)value);
+        }
+        return from + simd_find_equal(data, span->count - from, span->elements_size, value);
+    }
+    for(size_t i = from; i < span->count; i++) {
+        if(span_element_equals(span, i, value)) {
+            return i;
+        }
+    }
+    return span->count;
+}
+
+static size_t span_count(LuastructArraySpan *span, const uint8_t *value) {
+    if(LUAS_SPAN_IS_CONTIGUOUS(span)) {
+        if(span->elements_type == LUAST_FLOAT) {
+            return simd_count_float((const float *)span->data, span->count, *(const float *)value);
+        }
+        return simd_count_equal(span->data, span->count, span->elements_size, value);
+    }
+    size_t matches = 0;
+    for(size_t i = 0; i < span->count; i++) {
+        matches += span_element_equals(span, i, value);
+    }
+    return matches;
+}
+
+/**
+ * Parse the arguments shared by the search methods: the array, the value and
+ * the optional one-based inclusive bounds. The spans cover the bounds, in two
+ * segments for a ring buffer that wraps around, and first receives the
+ * one-based index of the first element of the first span.
+ */
+static bool check_search_arguments(lua_State *state, LuastructArraySpan *spans, size_t *segments, lua_Integer *first, uint8_t *value) {
+    LuastructArray *array = check_array(state, 1);
+    luaL_checkany(state, 2);
+
+    lua_Integer size = get_array_size(state, array->array_info);
+    *first = luaL_optinteger(state, 3, 1);
+    lua_Integer last = lua_isnoneornil(state, 4) ? size : luaL_checkinteger(state, 4);
+    if(*first < 1 || *first > size + 1) {
+        luaL_error(state, "Index out of bounds: %I", *first);
+    }
+    if(last > size) {
+        luaL_error(state, "Index out of bounds: %I", last);
+    }
+    if(last < *first) {
+        last = *first - 1;
+    }
+
+    *segments = get_array_segments(state, array, *first - 1, last - *first + 1, spans);
+    return get_search_value(state, 2, &spans[0], array->array_info->overflow, value);
+}
+
+int luastruct_array_find(lua_State *state) {
+    LuastructArraySpan spans[LUAS_MAX_SEGMENTS];
+    size_t segments;
+    lua_Integer first;
+    uint8_t value[8];
+    if(!check_search_arguments(state, spans, &segments, &first, value)) {
+        lua_pushnil(state);
+        return 1;
+    }
+    for(size_t i = 0; i < segments; i++) {
+        size_t index = span_find(&spans[i], 0, value);
+        if(index < spans[i].count) {
+            lua_pushinteger(state, first + index);
+            return 1;
+        }
+        first += spans[i].count;
+    }
+    lua_pushnil(state);
+    return 1;
+}
+
+int luastruct_array_count(lua_State *state) {
+    LuastructArraySpan spans[LUAS_MAX_SEGMENTS];
+    size_t segments;
+    lua_Integer first;
+    uint8_t value[8];
+    if(!check_search_arguments(state, spans, &segments, &first, value)) {
+        lua_pushinteger(state, 0);
+        return 1;
+    }
+    size_t matches = 0;
+    for(size_t i = 0; i < segments; i++) {
+        matches += span_count(&spans[i], value);
+    }
+    lua_pushinteger(state, matches);
+    return 1;
+}
+
+int luastruct_array_indexof_all(lua_State *state) {
+    LuastructArraySpan spans[LUAS_MAX_SEGMENTS];
+    size_t segments;
+    lua_Integer first;
+    uint8_t value[8];
+    bool searchable = check_search_arguments(state, spans, &segments, &first, value);
+    lua_newtable(state);
+    if(!searchable) {
+        return 1;
+    }
+    lua_Integer matches = 0;
+    for(size_t i = 0; i < segments; i++) {
+        LuastructArraySpan *span = &spans[i];
+        size_t index = span_find(span, 0, value);
+        while(index < span->count) {
+            lua_pushinteger(state, first + index);
+            lua_rawseti(state, -2, ++matches);
+            index = span_find(span, index + 1, value);
+        }
+        first += span->count;
+    }
+    return 1;
+}
+
+/**
+ * Compare the key of an element with the value being searched for.
+ * @return A negative number, zero or a positive number if the element key is
+ * less than, equal to or greater than the value.
+ */
+static int compare_key(const LuastructArrayKey *key, const void *element, bool integer_value, lua_Integer integer, lua_Number number) {
+    if(integer_value && key->type == LUAST_UINT64) {
+        // Sorted in unsigned order, where negative values stand for large ones if they wrap
+        if(integer < 0 && key->overflow != LUAS_OVERFLOW_WRAP) {
+            return 1;
+        }
+        lua_Unsigned element_key = (lua_Unsigned)read_array_key_integer(key, element);
+        return (element_key > (lua_Unsigned)integer) - (element_key < (lua_Unsigned)integer);
+    }
+    if(integer_value && !LUAS_KEY_IS_FLOAT(key)) {
+        lua_Integer element_key = read_array_key_integer(key, element);
+        return (element_key > integer) - (element_key < integer);
+    }
+    lua_Number element_key = read_array_key_number(key, element);
+    return (element_key > number) - (element_key < number);
+}
+
+/**
+ * Binary search over an array sorted in ascending order by a key.
+ * Arguments are (arr, [field,] value).
+ * @param upper Whether to find the first element greater than the value
+ * instead of the first element not less than it.
+ * @param exact Whether the element found must be equal to the value.
+ * @return The one-based index of the element found, the array size plus one
+ * if every element is smaller, or 0 if exact and there is no equal element.
+ */
+static lua_Integer bound_search(lua_State *state, bool upper, bool exact) {
+    LuastructArray *array = check_array(state, 1);
+    if(lua_gettop(state) < 3) {
+        lua_pushnil(state);
+        lua_insert(state, 2);
+    }
+    LuastructArrayKey key;
+    check_array_key(state, array->array_info, 2, &key);
+    lua_Number number = luaL_checknumber(state, 3);
+    bool integer_value = lua_isinteger(state, 3);
+    lua_Integer integer = integer_value ? lua_tointeger(state, 3) : 0;
+
+    // Probing by logical index also covers ring buffers that wrap around
+    size_t count = get_array_size(state, array->array_info);
+    size_t low = 0;
+    size_t high = count;
+    while(low < high) {
+        size_t mid = low + (high - low) / 2;
+        int order = compare_key(&key, get_array_element(state, array, mid), integer_value, integer, number);
+        if(order < 0 || (upper && order == 0)) {
+            low = mid + 1;
+        }
+        else {
+            high = mid;
+        }
+    }
+
+    if(exact && (low == count || compare_key(&key, get_array_element(state, array, low), integer_value, integer, number) != 0)) {
+        return 0;
+    }
+    return low + 1;
+}
+
+int luastruct_array_bsearch(lua_State *state) {
+    lua_Integer index = bound_search(state, false, true);
+    if(index == 0) {
+        lua_pushnil(state);
+    }
+    else {
+        lua_pushinteger(state, index);
+    }
+    return 1;
+}
+
+int luastruct_array_lower_bound(lua_State *state) {
+    lua_pushinteger(state, bound_search(state, false, false));
+    return 1;
+}
+
+int luastruct_array_upper_bound(lua_State *state) {
+    lua_pushinteger(state, bound_search(state, true, false));
+    return 1;
+}
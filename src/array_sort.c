@@ -0,0 +1,331 @@
+// SPDX-License-Identifier: GPL-3.0-only
+
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <lua.h>
+#include <lualib.h>
+#include <lauxlib.h>
+#include "luastruct.h"
+#include "array.h"
+#include "debug.h"
+
+#define INSERTION_SORT_THRESHOLD 16
+#define COUNTING_SORT_THRESHOLD 1024
+
+/**
+ * Element key and position used when elements are sorted indirectly. The
+ * position breaks ties, which makes the sort stable.
+ */
+typedef struct SortEntry {
+    union {
+        lua_Integer integer;
+        lua_Number number;
+    } key;
+    size_t index;
+} SortEntry;
+
+#define VALUE_LESS(a, b) ((a) < (b))
+#define FLOAT_LESS(a, b) (isnan(b) ? !isnan(a) : (a) < (b))
+#define FLOAT_GREATER(a, b) (isnan(b) ? !isnan(a) : (a) > (b))
+#define ENTRY_INTEGER_LESS(a, b) ((a).key.integer < (b).key.integer || ((a).key.integer == (b).key.integer && (a).index < (b).index))
+#define ENTRY_INTEGER_GREATER(a, b) ((a).key.integer > (b).key.integer || ((a).key.integer == (b).key.integer && (a).index < (b).index))
+#define ENTRY_NUMBER_LESS(a, b) (FLOAT_LESS((a).key.number, (b).key.number) || (!FLOAT_LESS((b).key.number, (a).key.number) && (a).index < (b).index))
+#define ENTRY_NUMBER_GREATER(a, b) (FLOAT_GREATER((a).key.number, (b).key.number) || (!FLOAT_GREATER((b).key.number, (a).key.number) && (a).index < (b).index))
+
+/*
+ * Introsort: median of three quicksort that falls back to heapsort when the
+ * recursion gets too deep and to insertion sort for short ranges. Only the
+ * smaller partition is recursed into, so the stack depth is logarithmic.
+ */
+#define DEFINE_INTROSORT(name, type, LESS) \
+    static void insertion_sort_##name(type *a, size_t n) { \
+        for(size_t i = 1; i < n; i++) { \
+            type value = a[i]; \
+            size_t j = i; \
+            while(j > 0 && LESS(value, a[j - 1])) { \
+                a[j] = a[j - 1]; \
+                j--; \
+            } \
+            a[j] = value; \
+        } \
+    } \
+    static void sift_down_##name(type *a, size_t root, size_t n) { \
+        type value = a[root]; \
+        size_t child; \
+        while((child = 2 * root + 1) < n) { \
+            if(child + 1 < n && LESS(a[child], a[child + 1])) { \
+                child++; \
+            } \
+            if(!LESS(value, a[child])) { \
+                break; \
+            } \
+            a[root] = a[child]; \
+            root = child; \
+        } \
+        a[root] = value; \
+    } \
+    static void heap_sort_##name(type *a, size_t n) { \
+        for(size_t i = n / 2; i > 0; i--) { \
+            sift_down_##name(a, i - 1, n); \
+        } \
+        for(size_t i = n - 1; i > 0; i--) { \
+            type top = a[0]; \
+            a[0] = a[i]; \
+            a[i] = top; \
+            sift_down_##name(a, 0, i); \
+        } \
+    } \
+    static void introsort_loop_##name(type *a, size_t n, int depth) { \
+        while(n > INSERTION_SORT_THRESHOLD) { \
+            if(depth-- == 0) { \
+                heap_sort_##name(a, n); \
+                return; \
+            } \
+            size_t mid = n / 2; \
+            type tmp; \
+            if(LESS(a[mid], a[0])) { tmp = a[mid]; a[mid] = a[0]; a[0] = tmp; } \
+            if(LESS(a[n - 1], a[0])) { tmp = a[n - 1]; a[n - 1] = a[0]; a[0] = tmp; } \
+            if(LESS(a[n - 1], a[mid])) { tmp = a[n - 1]; a[n - 1] = a[mid]; a[mid] = tmp; } \
+            type pivot = a[mid]; \
+            size_t i = 0; \
+            size_t j = n - 1; \
+            for(;;) { \
+                while(LESS(a[i], pivot)) { \
+                    i++; \
+                } \
+                while(LESS(pivot, a[j])) { \
+                    j--; \
+                } \
+                if(i >= j) { \
+                    break; \
+                } \
+                tmp = a[i]; \
+                a[i] = a[j]; \
+                a[j] = tmp; \
+                i++; \
+                j--; \
+            } \
+            size_t left = j + 1; \
+            if(left < n - left) { \
+                introsort_loop_##name(a, left, depth); \
+                a += left; \
+                n -= left; \
+            } \
+            else { \
+                introsort_loop_##name(a + left, n - left, depth); \
+                n = left; \
+            } \
+        } \
+        insertion_sort_##name(a, n); \
+    } \
+    static void introsort_##name(type *a, size_t n) { \
+        int depth = 0; \
+        for(size_t i = n; i > 1; i >>= 1) { \
+            depth += 2; \
+        } \
+        introsort_loop_##name(a, n, depth); \
+    }
+
+#define DEFINE_VALUE_INTROSORT(type, name) DEFINE_INTROSORT(name, name##_t, VALUE_LESS)
+LUAS_FOREACH_INTEGER_TYPE(DEFINE_VALUE_INTROSORT)
+#undef DEFINE_VALUE_INTROSORT
+
+DEFINE_INTROSORT(float, float, FLOAT_LESS)
+DEFINE_INTROSORT(float_descending, float, FLOAT_GREATER)
+DEFINE_INTROSORT(entry_integer, SortEntry, ENTRY_INTEGER_LESS)
+DEFINE_INTROSORT(entry_integer_descending, SortEntry, ENTRY_INTEGER_GREATER)
+DEFINE_INTROSORT(entry_number, SortEntry, ENTRY_NUMBER_LESS)
+DEFINE_INTROSORT(entry_number_descending, SortEntry, ENTRY_NUMBER_GREATER)
+
+#undef DEFINE_INTROSORT
+
+/*
+ * Counting sort for the narrow integer types: a single histogram pass over
+ * the data followed by writing every value back in order.
+ */
+#define DEFINE_COUNTING_SORT(name, min, max) \
+    static void counting_sort_##name(name##_t *a, size_t n, size_t *counts) { \
+        memset(counts, 0, ((max) - (min) + 1) * sizeof(size_t)); \
+        for(size_t i = 0; i < n; i++) { \
+            counts[a[i] - (min)]++; \
+        } \
+        size_t k = 0; \
+        for(int32_t value = (min); value <= (max); value++) { \
+            for(size_t c = counts[value - (min)]; c > 0; c--) { \
+                a[k++] = (name##_t)value; \
+            } \
+        } \
+    }
+
+DEFINE_COUNTING_SORT(int8, INT8_MIN, INT8_MAX)
+DEFINE_COUNTING_SORT(uint8, 0, UINT8_MAX)
+DEFINE_COUNTING_SORT(int16, INT16_MIN, INT16_MAX)
+DEFINE_COUNTING_SORT(uint16, 0, UINT16_MAX)
+
+#undef DEFINE_COUNTING_SORT
+
+static void reverse_elements(uint8_t *data, size_t count, size_t size) {
+    uint8_t tmp[8];
+    for(size_t i = 0, j = count - 1; i < j; i++, j--) {
+        memcpy(tmp, data + i * size, size);
+        memcpy(data + i * size, data + j * size, size);
+        memcpy(data + j * size, tmp, size);
+    }
+}
+
+/**
+ * Sort a contiguous span of primitive values in place.
+ */
+static void sort_values(lua_State *state, LuastructArraySpan *span, LuastructType type, bool descending) {
+    size_t counts[UINT8_MAX + 1];
+    switch(type) {
+        case LUAST_INT8:
+            counting_sort_int8((int8_t *)span->data, span->count, counts);
+            break;
+        case LUAST_UINT8:
+            counting_sort_uint8((uint8_t *)span->data, span->count, counts);
+            break;
+        case LUAST_INT16:
+        case LUAST_UINT16:
+            if(span->count < COUNTING_SORT_THRESHOLD) {
+                if(type == LUAST_INT16) {
+                    introsort_int16((int16_t *)span->data, span->count);
+                }
+                else {
+                    introsort_uint16((uint16_t *)span->data, span->count);
+                }
+                break;
+            }
+            size_t *wide_counts = lua_newuserdata(state, (UINT16_MAX + 1) * sizeof(size_t));
+            if(type == LUAST_INT16) {
+                counting_sort_int16((int16_t *)span->data, span->count, wide_counts);
+            }
+            else {
+                counting_sort_uint16((uint16_t *)span->data, span->count, wide_counts);
+            }
+            lua_pop(state, 1);
+            break;
+        case LUAST_INT32:
+            introsort_int32((int32_t *)span->data, span->count);
+            break;
+        case LUAST_INT64:
+            introsort_int64((int64_t *)span->data, span->count);
+            break;
+        case LUAST_UINT32:
+            introsort_uint32((uint32_t *)span->data, span->count);
+            break;
+        case LUAST_UINT64:
+            introsort_uint64((uint64_t *)span->data, span->count);
+            break;
+        case LUAST_FLOAT:
+            if(descending) {
+                introsort_float_descending((float *)span->data, span->count);
+            }
+            else {
+                introsort_float((float *)span->data, span->count);
+            }
+            return;
+        default:
+            luaL_error(state, "Cannot sort arrays of type %s", luastruct_name_for_type(type));
+            return;
+    }
+    if(descending) {
+        reverse_elements(span->data, span->count, span->elements_size);
+    }
+}
+
+/**
+ * Sort any span by a key: the keys are gathered with their positions, sorted,
+ * and the resulting permutation is applied by following its cycles, so each
+ * element (or pointer slot) is moved exactly once.
+ */
+static void sort_entries(lua_State *state, LuastructArraySpan *span, LuastructArrayKey *key, bool descending) {
+    size_t slot_size = span->elements_are_pointers ? sizeof(void *) : span->elements_size;
+    SortEntry *entries = lua_newuserdata(state, checked_mul_size(state, span->count, sizeof(SortEntry)));
+    uint8_t *tmp = lua_newuserdata(state, slot_size);
+
+    bool is_float = LUAS_KEY_IS_FLOAT(key);
+    for(size_t i = 0; i < span->count; i++) {
+        void *element = LUAS_SPAN_ELEMENT(span, i);
+        if(is_float) {
+            entries[i].key.number = read_array_key_number(key, element);
+        }
+        else {
+            entries[i].key.integer = read_array_key_integer(key, element);
+            if(key->type == LUAST_UINT64) {
+                // Flipping the sign bit orders uint64 keys as signed integers
+                entries[i].key.integer ^= LUA_MININTEGER;
+            }
+        }
+        entries[i].index = i;
+    }
+
+    if(is_float) {
+        if(descending) {
+            introsort_entry_number_descending(entries, span->count);
+        }
+        else {
+            introsort_entry_number(entries, span->count);
+        }
+    }
+    else {
+        if(descending) {
+            introsort_entry_integer_descending(entries, span->count);
+        }
+        else {
+            introsort_entry_integer(entries, span->count);
+        }
+    }
+
+    for(size_t start = 0; start < span->count; start++) {
+        if(entries[start].index == start) {
+            continue;
+        }
+        memcpy(tmp, span->data + start * span->stride, slot_size);
+        size_t current = start;
+        for(;;) {
+            size_t source = entries[current].index;
+            entries[current].index = current;
+            if(source == start) {
+                memcpy(span->data + current * span->stride, tmp, slot_size);
+                break;
+            }
+            memcpy(span->data + current * span->stride, span->data + source * span->stride, slot_size);
+            current = source;
+        }
+    }
+    lua_pop(state, 2);
+}
+
+int luastruct_array_sort(lua_State *state) {
+    LuastructArray *array = check_array(state, 1);
+    LuastructArrayDesc *array_info = array->array_info;
+    if(array_info->elements_are_readonly) {
+        return luaL_error(state, "Array is read-only");
+    }
+
+    lua_settop(state, 3);
+    if(lua_isboolean(state, 2)) {
+        lua_rotate(state, 2, 1);
+    }
+    bool by_field = !lua_isnil(state, 2);
+    bool descending = lua_toboolean(state, 3);
+
+    LuastructArrayKey key;
+    check_array_key(state, array_info, 2, &key);
+
+    LuastructArraySpan span;
+    get_array_span(state, array, 0, get_array_size(state, array_info), &span);
+    if(span.count < 2) {
+        return 0;
+    }
+
+    if(!by_field && LUAS_SPAN_IS_CONTIGUOUS(&span)) {
+        sort_values(state, &span, key.type, descending);
+    }
+    else {
+        sort_entries(state, &span, &key, descending);
+    }
+    return 0;
+}
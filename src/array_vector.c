@@ -0,0 +1,341 @@
+// SPDX-License-Identifier: GPL-3.0-only
+
+#include <stdlib.h>
+#include <string.h>
+#include <lua.h>
+#include <lualib.h>
+#include <lauxlib.h>
+#include "luastruct.h"
+#include "array.h"
+#include "debug.h"
+
+/**
+ * Smallest capacity a vector grows to, so that pushing to an empty vector
+ * does not reallocate on each of its first elements.
+ */
+#define VECTOR_MIN_CAPACITY 4
+
+static const char *VECTOR_REGISTRY_NAME = "luastruct_vectors";
+
+void luastruct_move_object(lua_State *state, int index, void *data);
+void luastruct_invalidate_object(lua_State *state, int index);
+
+lua_Integer read_header_size(LuastructType type, const void *data) {
+    switch(type) {
+        case LUAST_INT32:
+            return *(const int32_t *)data;
+        case LUAST_UINT32:
+            return *(const uint32_t *)data;
+        case LUAST_INT64:
+            return *(const int64_t *)data;
+        default: {
+            uint64_t size = *(const uint64_t *)data;
+            return size > (uint64_t)LUA_MAXINTEGER ? -1 : (lua_Integer)size;
+        }
+    }
+}
+
+static lua_Integer read_vector_size(const LuastructVectorDesc *layout, const uint8_t *data) {
+    return read_header_size(layout->size_type, data);
+}
+
+static void write_vector_size(const LuastructVectorDesc *layout, uint8_t *data, size_t size) {
+    switch(layout->size_type) {
+        case LUAST_INT32:
+            *(int32_t *)data = (int32_t)size;
+            break;
+        case LUAST_UINT32:
+            *(uint32_t *)data = (uint32_t)size;
+            break;
+        case LUAST_INT64:
+            *(int64_t *)data = (int64_t)size;
+            break;
+        default:
+            *(uint64_t *)data = size;
+            break;
+    }
+}
+
+static size_t max_vector_size(const LuastructVectorDesc *layout) {
+    switch(layout->size_type) {
+        case LUAST_INT32:
+            return INT32_MAX;
+        case LUAST_UINT32:
+            return UINT32_MAX;
+        default:
+            return LUA_MAXINTEGER;
+    }
+}
+
+void sync_vector_array(lua_State *state, LuastructArray *array) {
+    LuastructVectorArray *vector = (LuastructVectorArray *)array;
+    const LuastructVectorDesc *layout = array->array_info->vector;
+    uint8_t *header = vector->header;
+    lua_Integer count = read_vector_size(layout, header + layout->count_offset);
+    lua_Integer capacity = read_vector_size(layout, header + layout->capacity_offset);
+    if(count < 0 || capacity < 0) {
+        luaL_error(state, "Vector size is out of range");
+        return;
+    }
+    if(count > capacity) {
+        luaL_error(state, "Vector count exceeds its capacity: %I > %I", count, capacity);
+        return;
+    }
+    void *data = *(void **)(header + layout->data_offset);
+    if(data == NULL && capacity > 0) {
+        luaL_error(state, "Vector has a capacity but no buffer");
+        return;
+    }
+    array->data = data;
+    vector->view.desc.array_size = count;
+}
+
+void push_vector_tracker(lua_State *state, void *header) {
+    if(lua_getfield(state, LUA_REGISTRYINDEX, VECTOR_REGISTRY_NAME) == LUA_TNIL) {
+        lua_pop(state, 1);
+        lua_newtable(state);
+        lua_newtable(state);
+        lua_pushstring(state, "v");
+        lua_setfield(state, -2, "__mode");
+        lua_setmetatable(state, -2);
+        lua_pushvalue(state, -1);
+        lua_setfield(state, LUA_REGISTRYINDEX, VECTOR_REGISTRY_NAME);
+    }
+    if(lua_rawgetp(state, -1, header) == LUA_TNIL) {
+        lua_pop(state, 1);
+        // The proxies are weak keys so that tracking them does not keep them alive
+        lua_newtable(state);
+        lua_newtable(state);
+        lua_pushstring(state, "k");
+        lua_setfield(state, -2, "__mode");
+        lua_setmetatable(state, -2);
+        lua_pushvalue(state, -1);
+        lua_rawsetp(state, -3, header);
+    }
+    lua_remove(state, -2);
+}
+
+/**
+ * Move the tracker of a vector whose header moved along with the buffer
+ * it lives in, so that arrays created over the new header share it.
+ */
+static void move_vector_tracker(lua_State *state, void *old_header, void *header) {
+    lua_getfield(state, LUA_REGISTRYINDEX, VECTOR_REGISTRY_NAME);
+    lua_rawgetp(state, -1, old_header);
+    lua_rawsetp(state, -2, header);
+    lua_pushnil(state);
+    lua_rawsetp(state, -2, old_header);
+    lua_pop(state, 1);
+}
+
+/**
+ * Update the proxies taken from a vector whose data lies in [first, last).
+ * When the buffer moved they are shifted by delta bytes, when the elements
+ * were removed the objects are invalidated. Views over removed elements
+ * still point into the buffer, which a vector never shrinks.
+ */
+static void update_proxies(lua_State *state, void *header, uint8_t *first, uint8_t *last, ptrdiff_t delta, bool invalidate) {
+    push_vector_tracker(state, header);
+    int tracker = lua_gettop(state);
+    lua_pushnil(state);
+    while(lua_next(state, tracker) != 0) {
+        lua_pop(state, 1);
+        if(lua_type(state, -1) != LUA_TUSERDATA) {
+            continue;
+        }
+        int proxy = lua_gettop(state);
+        LuastructStructObject *obj = luaL_testudata(state, proxy, OBJECT_METATABLE_NAME);
+        if(obj) {
+            uint8_t *data = obj->data;
+            if(!obj->invalid && data >= first && data < last) {
+                if(invalidate) {
+                    luastruct_invalidate_object(state, proxy);
+                }
+                else {
+                    luastruct_move_object(state, proxy, data + delta);
+                }
+            }
+            continue;
+        }
+        LuastructArray *array = invalidate ? NULL : test_array(state, proxy);
+        if(!array) {
+            continue;
+        }
+        if(array->array_info->vector) {
+            LuastructVectorArray *vector = (LuastructVectorArray *)array;
+            uint8_t *data = vector->header;
+            if(data >= first && data < last) {
+                move_vector_tracker(state, vector->header, data + delta);
+                vector->header = data + delta;
+            }
+        }
+        else {
+            uint8_t *data = array->data;
+            if(data >= first && data <= last) {
+                array->data = data + delta;
+            }
+        }
+    }
+    lua_pop(state, 1);
+}
+
+static LuastructVectorArray *check_vector(lua_State *state, int index, bool writable) {
+    LuastructArray *array = check_array(state, index);
+    if(!array->array_info->vector) {
+        luaL_error(state, "Array is not a vector");
+        return NULL;
+    }
+    if(writable && array->array_info->elements_are_readonly) {
+        luaL_error(state, "Array is read-only");
+        return NULL;
+    }
+    return (LuastructVectorArray *)array;
+}
+
+static size_t get_vector_capacity(LuastructVectorArray *vector) {
+    const LuastructVectorDesc *layout = vector->view.desc.vector;
+    return read_vector_size(layout, (uint8_t *)vector->header + layout->capacity_offset);
+}
+
+static void set_vector_count(LuastructVectorArray *vector, size_t count) {
+    const LuastructVectorDesc *layout = vector->view.desc.vector;
+    write_vector_size(layout, (uint8_t *)vector->header + layout->count_offset, count);
+    vector->view.desc.array_size = count;
+}
+
+/**
+ * Reallocate the buffer of a vector so that it holds at least capacity
+ * elements. The proxies to the elements are rebased if the buffer moves.
+ */
+static void reserve_vector(lua_State *state, LuastructVectorArray *vector, size_t capacity) {
+    const LuastructVectorDesc *layout = vector->view.desc.vector;
+    LuastructArray *array = &vector->view.array;
+    size_t old_capacity = get_vector_capacity(vector);
+    if(capacity <= old_capacity) {
+        return;
+    }
+    if(capacity > max_vector_size(layout)) {
+        luaL_error(state, "Vector too large: %I elements", (lua_Integer)capacity);
+        return;
+    }
+
+    size_t old_size = old_capacity * array->stride;
+    size_t size = checked_mul_size(state, capacity, array->stride);
+    uint8_t *old_data = array->data;
+    uint8_t *data = layout->realloc(layout->userdata, old_capacity ? old_data : NULL, old_size, size);
+    if(!data) {
+        luaL_error(state, "Failed to grow vector to %I elements", (lua_Integer)capacity);
+        return;
+    }
+    LUAS_DEBUG_MSG("Vector at 0x%.8X grew from %zu to %zu elements\n", vector->header, old_capacity, capacity);
+
+    uint8_t *header = vector->header;
+    *(void **)(header + layout->data_offset) = data;
+    write_vector_size(layout, header + layout->capacity_offset, capacity);
+    array->data = data;
+    if(old_capacity && data != old_data) {
+        update_proxies(state, header, old_data, old_data + old_size, data - old_data, false);
+    }
+}
+
+/**
+ * Grow a vector geometrically so that it can hold count elements, which
+ * makes a sequence of pushes take amortized constant time.
+ */
+static void grow_vector(lua_State *state, LuastructVectorArray *vector, size_t count) {
+    size_t capacity = get_vector_capacity(vector);
+    if(count <= capacity) {
+        return;
+    }
+    size_t max_size = max_vector_size(vector->view.desc.vector);
+    capacity = capacity < VECTOR_MIN_CAPACITY ? VECTOR_MIN_CAPACITY : capacity > max_size / 2 ? max_size : capacity * 2;
+    reserve_vector(state, vector, capacity < count ? count : capacity);
+}
+
+static void remove_elements(lua_State *state, LuastructVectorArray *vector, size_t first, size_t count) {
+    LuastructArray *array = &vector->view.array;
+    uint8_t *data = array->data;
+    update_proxies(state, vector->header, data + first * array->stride, data + count * array->stride, 0, true);
+    set_vector_count(vector, first);
+}
+
+int luastruct_array_push(lua_State *state) {
+    LuastructVectorArray *vector = check_vector(state, 1, true);
+    LuastructArray *array = &vector->view.array;
+    size_t count = vector->view.desc.array_size;
+    grow_vector(state, vector, count + 1);
+
+    uint8_t *slot = (uint8_t *)array->data + count * array->stride;
+    if(lua_isnoneornil(state, 2)) {
+        memset(slot, 0, array->stride);
+    }
+    else {
+        set_array_element(state, array->array_info, slot, 2);
+    }
+    set_vector_count(vector, count + 1);
+    push_array_element(state, array->array_info, slot);
+    inherit_buffer_owner(state, 1);
+    return 1;
+}
+
+int luastruct_array_pop(lua_State *state) {
+    LuastructVectorArray *vector = check_vector(state, 1, true);
+    LuastructArray *array = &vector->view.array;
+    LuastructArrayDesc *array_info = array->array_info;
+    size_t count = array_info->array_size;
+    if(count == 0) {
+        lua_pushnil(state);
+        return 1;
+    }
+
+    uint8_t *slot = (uint8_t *)array->data + (count - 1) * array->stride;
+    if(array_info->elements_type == LUAST_STRUCT || array_info->elements_type == LUAST_ENUM) {
+        // The slot is no longer part of the vector, so the element is returned as a copy
+        luastruct_new_object(state, ((LuastructTypeInfo *)array_info->elements_type_info)->name, NULL, false);
+        LuastructStructObject *obj = lua_touserdata(state, -1);
+        memcpy(obj->data, slot, array->stride);
+    }
+    else {
+        push_array_element(state, array_info, slot);
+    }
+    remove_elements(state, vector, count - 1, count);
+    return 1;
+}
+
+int luastruct_array_reserve(lua_State *state) {
+    LuastructVectorArray *vector = check_vector(state, 1, true);
+    lua_Integer capacity = luaL_checkinteger(state, 2);
+    if(capacity < 0) {
+        return luaL_error(state, "Array size is negative");
+    }
+    reserve_vector(state, vector, capacity);
+    lua_settop(state, 1);
+    return 1;
+}
+
+int luastruct_array_resize(lua_State *state) {
+    LuastructVectorArray *vector = check_vector(state, 1, true);
+    LuastructArray *array = &vector->view.array;
+    lua_Integer size = luaL_checkinteger(state, 2);
+    if(size < 0) {
+        return luaL_error(state, "Array size is negative");
+    }
+
+    size_t count = vector->view.desc.array_size;
+    if((size_t)size > count) {
+        grow_vector(state, vector, size);
+        memset((uint8_t *)array->data + count * array->stride, 0, (size - count) * array->stride);
+        set_vector_count(vector, size);
+    }
+    else if((size_t)size < count) {
+        remove_elements(state, vector, size, count);
+    }
+    lua_settop(state, 1);
+    return 1;
+}
+
+int luastruct_array_capacity(lua_State *state) {
+    LuastructVectorArray *vector = check_vector(state, 1, false);
+    lua_pushinteger(state, get_vector_capacity(vector));
+    return 1;
+}
@@ -0,0 +1,415 @@
+// SPDX-License-Identifier: GPL-3.0-only
+
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <lua.h>
+#include <lualib.h>
+#include <lauxlib.h>
+#include "luastruct.h"
+#include "array.h"
+#include "debug.h"
+
+#define WHERE_MAX_CONDITIONS 16
+#define WHERE_MAX_TOKEN 64
+
+typedef enum WhereOperator {
+    WHERE_EQ,
+    WHERE_NE,
+    WHERE_LT,
+    WHERE_LE,
+    WHERE_GT,
+    WHERE_GE
+} WhereOperator;
+
+/**
+ * One comparison of a predicate plan: the key of the elements, resolved to
+ * an offset and a type, against a constant. Comparisons are made on
+ * integers unless the key or the constant is a float, and on unsigned
+ * integers for uint64 keys.
+ */
+typedef struct WhereCondition {
+    LuastructArrayKey key;
+    WhereOperator op;
+    bool by_number;
+    lua_Integer integer;
+    lua_Number number;
+} WhereCondition;
+
+struct LuastructWherePlan {
+    size_t count;
+    WhereCondition conditions[WHERE_MAX_CONDITIONS];
+};
+
+static const char *const WHERE_MODES[] = { "indices", "count", "iter", NULL };
+
+enum {
+    WHERE_MODE_INDICES,
+    WHERE_MODE_COUNT,
+    WHERE_MODE_ITER
+};
+
+static bool check_where_operator(const char *name, WhereOperator *op) {
+    static const struct {
+        const char *name;
+        WhereOperator op;
+    } operators[] = {
+        {"==", WHERE_EQ}, {"=", WHERE_EQ}, {"~=", WHERE_NE}, {"!=", WHERE_NE},
+        {"<", WHERE_LT}, {"<=", WHERE_LE}, {">", WHERE_GT}, {">=", WHERE_GE}
+    };
+    for(size_t i = 0; i < sizeof(operators) / sizeof(operators[0]); i++) {
+        if(strcmp(operators[i].name, name) == 0) {
+            *op = operators[i].op;
+            return true;
+        }
+    }
+    return false;
+}
+
+/**
+ * Get the enum type of the key named by path, or NULL if it is not an enum.
+ * The path has already been checked by check_array_key.
+ */
+static LuastructEnum *get_key_enum(lua_State *state, LuastructArrayDesc *desc, const char *path) {
+    if(!path) {
+        return desc->elements_type == LUAST_ENUM ? desc->elements_type_info : NULL;
+    }
+    uint32_t offset;
+    bool readonly;
+    LuastructStructField *field = find_struct_field_path(state, desc->elements_type_info, path, &offset, &readonly);
+    return field->type == LUAST_ENUM ? field->type_info : NULL;
+}
+
+/**
+ * Convert the value a key is compared with. Enum keys also accept the name
+ * of one of their values or an enum object.
+ */
+static void check_where_value(lua_State *state, int index, LuastructEnum *enum_type, const char *path, WhereCondition *condition) {
+    bool key_is_float = LUAS_KEY_IS_FLOAT(&condition->key);
+    condition->by_number = key_is_float;
+    switch(lua_type(state, index)) {
+        case LUA_TBOOLEAN:
+            condition->integer = lua_toboolean(state, index);
+            condition->number = condition->integer;
+            return;
+        case LUA_TNUMBER:
+            condition->number = lua_tonumber(state, index);
+            if(lua_isinteger(state, index)) {
+                condition->integer = lua_tointeger(state, index);
+                // Negative constants stand for large uint64 values only if the key wraps
+                if(condition->key.type == LUAST_UINT64 && condition->integer < 0 && condition->key.overflow != LUAS_OVERFLOW_WRAP) {
+                    condition->by_number = true;
+                }
+            }
+            else {
+                condition->by_number = true;
+            }
+            return;
+        case LUA_TSTRING:
+            if(enum_type) {
+                const char *name = lua_tostring(state, index);
+                for(LuastructEnumValue *value = enum_type->values_by_name; value; value = value->next_by_name) {
+                    if(strcmp(value->name, name) == 0) {
+                        condition->integer = value->value;
+                        condition->number = value->value;
+                        return;
+                    }
+                }
+                luaL_error(state, "Enum %s has no value \"%s\"", enum_type->type_info.name, name);
+                return;
+            }
+            break;
+        case LUA_TUSERDATA: {
+            LuastructStructObject *obj = luaL_testudata(state, index, OBJECT_METATABLE_NAME);
+            if(enum_type && obj && !obj->invalid && obj->type == enum_type) {
+                LuastructArrayKey key = condition->key;
+                key.offset = 0;
+                key.pointer = false;
+                condition->integer = read_array_key_integer(&key, obj->data);
+                condition->number = condition->integer;
+                return;
+            }
+            break;
+        }
+        default:
+            break;
+    }
+    luaL_error(state, "Invalid value to compare %s with: %s", path ? path : "elements", luaL_typename(state, index));
+}
+
+/**
+ * Add a condition to a plan. The value to compare with is at the given
+ * stack index and path is NULL for conditions on the elements themselves.
+ */
+static void add_condition(lua_State *state, LuastructArrayDesc *desc, LuastructWherePlan *plan, const char *path, WhereOperator op, int value_index) {
+    if(plan->count == WHERE_MAX_CONDITIONS) {
+        luaL_error(state, "Too many conditions, at most %d are supported", WHERE_MAX_CONDITIONS);
+        return;
+    }
+    value_index = lua_absindex(state, value_index);
+    WhereCondition *condition = &plan->conditions[plan->count];
+    if(path) {
+        lua_pushstring(state, path);
+    }
+    else {
+        lua_pushnil(state);
+    }
+    check_array_key(state, desc, -1, &condition->key);
+    lua_pop(state, 1);
+    condition->op = op;
+    check_where_value(state, value_index, get_key_enum(state, desc, path), path, condition);
+    plan->count++;
+}
+
+/**
+ * Add the condition given as a value of a where table: either a constant to
+ * compare for equality or a {operator, constant} pair.
+ */
+static void add_table_condition(lua_State *state, LuastructArrayDesc *desc, LuastructWherePlan *plan, const char *path, int value_index) {
+    value_index = lua_absindex(state, value_index);
+    if(!lua_istable(state, value_index)) {
+        add_condition(state, desc, plan, path, WHERE_EQ, value_index);
+        return;
+    }
+    WhereOperator op;
+    lua_rawgeti(state, value_index, 1);
+    const char *name = lua_tostring(state, -1);
+    if(!name || !check_where_operator(name, &op)) {
+        luaL_error(state, "Invalid operator for %s", path ? path : "elements");
+        return;
+    }
+    lua_rawgeti(state, value_index, 2);
+    add_condition(state, desc, plan, path, op, -1);
+    lua_pop(state, 2);
+}
+
+/**
+ * Compile a where table: field paths map to conditions, and an
+ * {operator, constant} pair in the array part applies to the elements.
+ */
+static void compile_table(lua_State *state, LuastructArrayDesc *desc, LuastructWherePlan *plan, int index) {
+    if(lua_rawlen(state, index) > 0) {
+        add_table_condition(state, desc, plan, NULL, index);
+        return;
+    }
+    lua_pushnil(state);
+    while(lua_next(state, index) != 0) {
+        if(lua_type(state, -2) != LUA_TSTRING) {
+            luaL_error(state, "Invalid field name in where table: %s", luaL_typename(state, -2));
+            return;
+        }
+        add_table_condition(state, desc, plan, lua_tostring(state, -2), -1);
+        lua_pop(state, 1);
+    }
+}
+
+static const char *skip_spaces(const char *s) {
+    while(isspace((unsigned char)*s)) {
+        s++;
+    }
+    return s;
+}
+
+/**
+ * Read the next token of a where string into token: a name or number, or an
+ * operator made of comparison characters.
+ * @return The position after the token.
+ */
+static const char *read_token(lua_State *state, const char *s, char *token) {
+    s = skip_spaces(s);
+    size_t length = 0;
+    if(*s && strchr("=~!<>", *s)) {
+        while(*s && strchr("=~!<>", *s) && length < WHERE_MAX_TOKEN - 1) {
+            token[length++] = *s++;
+        }
+    }
+    else {
+        while(*s && (isalnum((unsigned char)*s) || strchr("_.+-", *s)) && length < WHERE_MAX_TOKEN - 1) {
+            token[length++] = *s++;
+        }
+    }
+    if(length == 0 && *s) {
+        luaL_error(state, "Unexpected character in where string: '%c'", *s);
+    }
+    token[length] = '\0';
+    return s;
+}
+
+/**
+ * Compile a where string: comparisons of the form "<field> <operator>
+ * <value>" joined by "and". The field may be omitted to compare the
+ * elements themselves, and the value is a number, true, false or the
+ * name of an enum value.
+ */
+static void compile_string(lua_State *state, LuastructArrayDesc *desc, LuastructWherePlan *plan, const char *query) {
+    char path[WHERE_MAX_TOKEN];
+    char token[WHERE_MAX_TOKEN];
+    const char *s = query;
+    for(;;) {
+        WhereOperator op;
+        s = read_token(state, s, path);
+        if(check_where_operator(path, &op)) {
+            path[0] = '\0';
+        }
+        else {
+            s = read_token(state, s, token);
+            if(!check_where_operator(token, &op)) {
+                luaL_error(state, "Expected an operator in where string: %s", query);
+                return;
+            }
+        }
+
+        s = read_token(state, s, token);
+        if(token[0] == '\0') {
+            luaL_error(state, "Expected a value in where string: %s", query);
+            return;
+        }
+        if(strcmp(token, "true") == 0 || strcmp(token, "false") == 0) {
+            lua_pushboolean(state, token[0] == 't');
+        }
+        else if(lua_stringtonumber(state, token) == 0) {
+            lua_pushstring(state, token);
+        }
+        add_condition(state, desc, plan, path[0] ? path : NULL, op, -1);
+        lua_pop(state, 1);
+
+        s = read_token(state, s, token);
+        if(token[0] == '\0') {
+            return;
+        }
+        if(strcmp(token, "and") != 0) {
+            luaL_error(state, "Expected \"and\" in where string: %s", query);
+            return;
+        }
+    }
+}
+
+#define COMPARE(op, a, b) \
+    ((op) == WHERE_EQ ? (a) == (b) : \
+     (op) == WHERE_NE ? (a) != (b) : \
+     (op) == WHERE_LT ? (a) < (b) : \
+     (op) == WHERE_LE ? (a) <= (b) : \
+     (op) == WHERE_GT ? (a) > (b) : (a) >= (b))
+
+bool match_where_plan(const LuastructWherePlan *plan, const void *element) {
+    for(size_t i = 0; i < plan->count; i++) {
+        const WhereCondition *condition = &plan->conditions[i];
+        bool match;
+        if(condition->by_number) {
+            match = COMPARE(condition->op, read_array_key_number(&condition->key, element), condition->number);
+        }
+        else if(condition->key.type == LUAST_UINT64) {
+            match = COMPARE(condition->op, (lua_Unsigned)read_array_key_integer(&condition->key, element), (lua_Unsigned)condition->integer);
+        }
+        else {
+            match = COMPARE(condition->op, read_array_key_integer(&condition->key, element), condition->integer);
+        }
+        if(!match) {
+            return false;
+        }
+    }
+    return true;
+}
+
+#undef COMPARE
+
+/**
+ * Find the first element matching a plan at or after the zero-based index
+ * from, walking the segments of an array in order.
+ * @return The zero-based index of the element, or the number of elements if
+ * there is none.
+ */
+static size_t find_match(const LuastructWherePlan *plan, LuastructArraySpan *spans, size_t segments, size_t from) {
+    size_t first = 0;
+    for(size_t s = 0; s < segments; s++) {
+        LuastructArraySpan *span = &spans[s];
+        for(size_t i = from > first ? from - first : 0; i < span->count; i++) {
+            if(match_where_plan(plan, LUAS_SPAN_ELEMENT(span, i))) {
+                return first + i;
+            }
+        }
+        first += span->count;
+    }
+    return first;
+}
+
+/**
+ * Iterator returned by where() in "iter" mode. The plan and the position of
+ * the last match are kept in upvalues, so iterating creates no table.
+ */
+static int where_iterator(lua_State *state) {
+    LuastructArray *array = check_array(state, lua_upvalueindex(1));
+    LuastructWherePlan *plan = lua_touserdata(state, lua_upvalueindex(2));
+    size_t position = lua_tointeger(state, lua_upvalueindex(3));
+
+    size_t count = get_array_size(state, array->array_info);
+    LuastructArraySpan spans[LUAS_MAX_SEGMENTS];
+    size_t segments = get_array_segments(state, array, 0, count, spans);
+    size_t index = find_match(plan, spans, segments, position);
+    if(index == count) {
+        lua_pushinteger(state, count);
+        lua_replace(state, lua_upvalueindex(3));
+        return 0;
+    }
+    lua_pushinteger(state, index + 1);
+    lua_replace(state, lua_upvalueindex(3));
+    lua_pushinteger(state, index + 1);
+    push_array_element(state, array->array_info, get_array_element(state, array, index));
+    inherit_buffer_owner(state, lua_upvalueindex(1));
+    return 2;
+}
+
+LuastructWherePlan *push_where_plan(lua_State *state, LuastructArrayDesc *desc, int index) {
+    index = lua_absindex(state, index);
+    LuastructWherePlan *plan = lua_newuserdata(state, sizeof(LuastructWherePlan));
+    plan->count = 0;
+    if(lua_type(state, index) == LUA_TSTRING) {
+        compile_string(state, desc, plan, lua_tostring(state, index));
+    }
+    else {
+        luaL_checktype(state, index, LUA_TTABLE);
+        compile_table(state, desc, plan, index);
+    }
+    return plan;
+}
+
+int luastruct_array_where(lua_State *state) {
+    LuastructArray *array = check_array(state, 1);
+    LuastructArrayDesc *array_info = array->array_info;
+    int mode = luaL_checkoption(state, 3, "indices", WHERE_MODES);
+    lua_settop(state, 2);
+
+    LuastructWherePlan *plan = push_where_plan(state, array_info, 2);
+
+    if(mode == WHERE_MODE_ITER) {
+        lua_pushvalue(state, 1);
+        lua_pushvalue(state, 3);
+        lua_pushinteger(state, 0);
+        lua_pushcclosure(state, where_iterator, 3);
+        return 1;
+    }
+
+    size_t count = get_array_size(state, array_info);
+    LuastructArraySpan spans[LUAS_MAX_SEGMENTS];
+    size_t segments = get_array_segments(state, array, 0, count, spans);
+    if(mode == WHERE_MODE_COUNT) {
+        size_t matches = 0;
+        for(size_t s = 0; s < segments; s++) {
+            for(size_t i = 0; i < spans[s].count; i++) {
+                matches += match_where_plan(plan, LUAS_SPAN_ELEMENT(&spans[s], i));
+            }
+        }
+        lua_pushinteger(state, matches);
+        return 1;
+    }
+
+    lua_newtable(state);
+    lua_Integer matches = 0;
+    size_t index = find_match(plan, spans, segments, 0);
+    while(index < count) {
+        lua_pushinteger(state, index + 1);
+        lua_rawseti(state, -2, ++matches);
+        index = find_match(plan, spans, segments, index + 1);
+    }
+    return 1;
+}
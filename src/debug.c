@@ -118,6 +118,9 @@ void luastruct_print_struct_definition(lua_State *state, const char *name) {
         }
         else if(field->type == LUAST_ARRAY) {
             LuastructArrayDesc *array = &field->array;
+            while(array->elements_type == LUAST_ARRAY) {
+                array = array->elements_type_info;
+            }
             type = luastruct_name_for_type(array->elements_type);
         }
 
@@ -136,8 +139,14 @@ void luastruct_print_struct_definition(lua_State *state, const char *name) {
         }
         strcat(row, field->field_name);
         if(field->type == LUAST_ARRAY) {
-            sprintf(buffer, "[%d]", field->array.array_size);
+            LuastructArrayDesc *array = &field->array;
+            sprintf(buffer, "[%d]", array->array_size);
             strcat(row, buffer);
+            while(array->elements_type == LUAST_ARRAY) {
+                array = array->elements_type_info;
+                sprintf(buffer, "[%d]", array->array_size);
+                strcat(row, buffer);
+            }
         }
         if(field->type == LUAST_BITFIELD) {
             sprintf(buffer, " : 1");
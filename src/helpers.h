@@ -41,6 +41,145 @@ enum {
 	luastruct_new_struct_array_field(state, #field, &array_desc, offsetof(struct type, field), true, false); \
 }
 
+#define LUAS_PRIMITIVE_MATRIX_FIELD(state, type, field, elements_type, elements_flags) { \
+	{ struct type; } \
+	LuastructArrayDesc row_desc; \
+	LuastructArrayDesc array_desc; \
+	luastruct_new_static_array_desc(state, elements_type, NULL, LUAS_SIZEOF_ARRAY(type, field[0]), elements_flags & LUAS_FIELD_POINTER, elements_flags & LUAS_FIELD_READONLY, &row_desc); \
+	luastruct_new_static_nested_array_desc(state, &row_desc, LUAS_SIZEOF_ARRAY(type, field), false, elements_flags & LUAS_FIELD_READONLY, &array_desc); \
+	luastruct_new_struct_array_field(state, #field, &array_desc, offsetof(struct type, field), false, false); \
+	luastruct_free_array_desc(&array_desc); \
+}
+
+/**
+ * Packed bit array of bit_count bits stored in field, which is usually an
+ * array of integer words such as uint64_t flags[N].
+ */
+#define LUAS_BIT_ARRAY_FIELD(state, type, field, bit_count, elements_flags) { \
+	{ struct type; } \
+	LuastructArrayDesc array_desc; \
+	luastruct_new_static_array_desc(state, LUAST_BITFIELD, NULL, bit_count, false, elements_flags & LUAS_FIELD_READONLY, &array_desc); \
+	luastruct_new_struct_array_field(state, #field, &array_desc, offsetof(struct type, field), false, false); \
+}
+
+#define LUAS_BIT_DYNAMIC_ARRAY_FIELD(state, type, field, array_size_counter, elements_flags) { \
+	{ struct type; } \
+	LuastructArrayDesc array_desc; \
+	luastruct_new_dynamic_array_desc(state, LUAST_BITFIELD, NULL, array_size_counter, false, elements_flags & LUAS_FIELD_READONLY, &array_desc); \
+	luastruct_new_struct_array_field(state, #field, &array_desc, offsetof(struct type, field), true, false); \
+}
+
+/**
+ * Layout of a vector header type whose data, count and capacity fields
+ * are of the given size type, growing through realloc_function.
+ */
+#define LUAS_VECTOR_LAYOUT(header_type, data, count, capacity, size_type, realloc_function, userdata) \
+	((LuastructVectorDesc){ offsetof(struct header_type, data), offsetof(struct header_type, count), offsetof(struct header_type, capacity), size_type, realloc_function, userdata })
+
+/**
+ * Vector of numbers or booleans whose header is stored in field.
+ * The layout is a LuastructVectorDesc, usually made with LUAS_VECTOR_LAYOUT.
+ */
+#define LUAS_PRIMITIVE_VECTOR_FIELD(state, type, field, elements_type, layout, elements_flags) { \
+	{ struct type; } \
+	LuastructArrayDesc array_desc; \
+	LuastructVectorDesc vector_desc = layout; \
+	luastruct_new_vector_desc(state, elements_type, NULL, &vector_desc, elements_flags & LUAS_FIELD_READONLY, &array_desc); \
+	luastruct_new_struct_array_field(state, #field, &array_desc, offsetof(struct type, field), false, false); \
+	luastruct_free_array_desc(&array_desc); \
+}
+
+#define LUAS_OBJREF_VECTOR_FIELD(state, type, field, elements_type, layout, elements_flags) { \
+	{ struct type; } \
+	LuastructArrayDesc array_desc; \
+	LuastructVectorDesc vector_desc = layout; \
+	luastruct_new_vector_desc(state, LUAST_STRUCT, #elements_type, &vector_desc, elements_flags & LUAS_FIELD_READONLY, &array_desc); \
+	luastruct_new_struct_array_field(state, #field, &array_desc, offsetof(struct type, field), false, false); \
+	luastruct_free_array_desc(&array_desc); \
+}
+
+/**
+ * Layout of a ring buffer header type whose elements are stored in the
+ * array field data and whose head and count fields are of the given size type.
+ */
+#define LUAS_RING_LAYOUT(header_type, data, head, count, size_type) \
+	((LuastructRingDesc){ offsetof(struct header_type, data), offsetof(struct header_type, head), offsetof(struct header_type, count), size_type, LUAS_SIZEOF_ARRAY(header_type, data) })
+
+/**
+ * Ring buffer of numbers or booleans whose header is stored in field.
+ * The layout is a LuastructRingDesc, usually made with LUAS_RING_LAYOUT.
+ */
+#define LUAS_PRIMITIVE_RING_FIELD(state, type, field, elements_type, layout, elements_flags) { \
+	{ struct type; } \
+	LuastructArrayDesc array_desc; \
+	LuastructRingDesc ring_desc = layout; \
+	luastruct_new_ring_desc(state, elements_type, NULL, &ring_desc, elements_flags & LUAS_FIELD_READONLY, &array_desc); \
+	luastruct_new_struct_array_field(state, #field, &array_desc, offsetof(struct type, field), false, false); \
+	luastruct_free_array_desc(&array_desc); \
+}
+
+#define LUAS_OBJREF_RING_FIELD(state, type, field, elements_type, layout, elements_flags) { \
+	{ struct type; } \
+	LuastructArrayDesc array_desc; \
+	LuastructRingDesc ring_desc = layout; \
+	luastruct_new_ring_desc(state, LUAST_STRUCT, #elements_type, &ring_desc, elements_flags & LUAS_FIELD_READONLY, &array_desc); \
+	luastruct_new_struct_array_field(state, #field, &array_desc, offsetof(struct type, field), false, false); \
+	luastruct_free_array_desc(&array_desc); \
+}
+
+/**
+ * Layout of a linked list whose nodes of type node_type link to the next
+ * one through their next field. Pass true for sentinel when the list field
+ * is the sentinel node of a circular list rather than a pointer to the first
+ * node, and the number of nodes above which walking the list fails, or 0.
+ */
+#define LUAS_LIST_LAYOUT(node_type, next, sentinel, max_length) \
+	((LuastructListDesc){ offsetof(struct node_type, next), sentinel, max_length })
+
+/**
+ * Linked list of structs whose head or sentinel node is stored in field.
+ * The layout is a LuastructListDesc, usually made with LUAS_LIST_LAYOUT.
+ */
+#define LUAS_OBJREF_LIST_FIELD(state, type, field, elements_type, layout, elements_flags) { \
+	{ struct type; } \
+	LuastructArrayDesc array_desc; \
+	LuastructListDesc list_desc = layout; \
+	luastruct_new_list_desc(state, #elements_type, &list_desc, elements_flags & LUAS_FIELD_READONLY, &array_desc); \
+	luastruct_new_struct_array_field(state, #field, &array_desc, offsetof(struct type, field), false, false); \
+	luastruct_free_array_desc(&array_desc); \
+}
+
+/**
+ * Layout of a hash map header type whose keys, values and occupied bitmap
+ * are pointers to its slots and whose capacity field is of the given size
+ * type. Keys are of the integer type key_type and placed with hash, which
+ * calls hash_function with userdata for LUAS_HASH_CUSTOM.
+ */
+#define LUAS_MAP_LAYOUT(header_type, keys, values, capacity, occupied, key_type, size_type, hash, hash_function, userdata) \
+	((LuastructMapDesc){ offsetof(struct header_type, keys), offsetof(struct header_type, values), offsetof(struct header_type, capacity), offsetof(struct header_type, occupied), key_type, size_type, hash, hash_function, userdata })
+
+/**
+ * Hash map of numbers or booleans whose header is stored in field.
+ * The layout is a LuastructMapDesc, usually made with LUAS_MAP_LAYOUT.
+ */
+#define LUAS_PRIMITIVE_MAP_FIELD(state, type, field, elements_type, layout, elements_flags) { \
+	{ struct type; } \
+	LuastructArrayDesc array_desc; \
+	LuastructMapDesc map_desc = layout; \
+	luastruct_new_map_desc(state, elements_type, NULL, &map_desc, elements_flags & LUAS_FIELD_READONLY, &array_desc); \
+	luastruct_new_struct_array_field(state, #field, &array_desc, offsetof(struct type, field), false, false); \
+	luastruct_free_array_desc(&array_desc); \
+}
+
+#define LUAS_OBJREF_MAP_FIELD(state, type, field, elements_type, layout, elements_flags) { \
+	{ struct type; } \
+	LuastructArrayDesc array_desc; \
+	LuastructMapDesc map_desc = layout; \
+	luastruct_new_map_desc(state, LUAST_STRUCT, #elements_type, &map_desc, elements_flags & LUAS_FIELD_READONLY, &array_desc); \
+	luastruct_new_struct_array_field(state, #field, &array_desc, offsetof(struct type, field), false, false); \
+	luastruct_free_array_desc(&array_desc); \
+}
+
 #define LUAS_OBJREF_FIELD(state, type, field, field_type, flags) { \
 	{ struct type; } \
 	{ struct field_type; } \
@@ -61,6 +200,17 @@ enum {
 	luastruct_new_struct_array_field(state, #field, &array_desc, offsetof(struct type, field), true, false); \
 }
 
+/**
+ * Set how the uint64 field, or the uint64 elements of the array field, of
+ * the struct on top of the stack are read and written above LUA_MAXINTEGER:
+ * LUAS_OVERFLOW_WRAP, LUAS_OVERFLOW_ERROR or LUAS_OVERFLOW_FLOAT.
+ */
+#define LUAS_FIELD_OVERFLOW(state, type, field, overflow) { \
+	{ struct type; } \
+	(void)sizeof(LUAS_STRUCT_FIELD(type, field)); \
+	luastruct_set_field_overflow(state, #field, overflow); \
+}
+
 #define LUAS_OBJECT(state, type, data, read_only) { \
 	{ struct type; } \
 	luastruct_new_object(state, #type, (void *)data, read_only); \
@@ -14,6 +14,7 @@ extern "C" {
 #define LUASTRUCT_TYPENAME_LENGTH 64
 
 static const char *STRUCT_METATABLE_NAME = "luastruct_struct";
+static const char *OBJECT_METATABLE_NAME = "luastruct_object";
 
 typedef enum LuastructType {
 	LUAST_STRUCT,
@@ -36,11 +37,130 @@ typedef enum LuastructType {
 	LUAST_METHOD
 } LuastructType;
 
+/**
+ * How a uint64 value above LUA_MAXINTEGER, which has no Lua integer
+ * representation, is read from or written to a field or an array element.
+ */
+typedef enum LuastructOverflow {
+	/** The value is seen as the negative integer with the same bits. */
+	LUAS_OVERFLOW_WRAP,
+	/** Reading the value raises an error, and so does writing a negative integer. */
+	LUAS_OVERFLOW_ERROR,
+	/** The value is read as a float, and integral floats up to 2^64 can be written. */
+	LUAS_OVERFLOW_FLOAT
+} LuastructOverflow;
+
 typedef struct LuastructTypeInfo {
 	LuastructType type;
 	char name[LUASTRUCT_TYPENAME_LENGTH];
 } LuastructTypeInfo;
 
+/**
+ * Allocator of vector buffers, with the same contract as lua_Alloc: it
+ * returns a block of nsize bytes holding the first min(osize, nsize) bytes
+ * of ptr, or NULL if the block cannot be allocated, in which case ptr is
+ * left untouched. ptr is NULL when osize is 0.
+ */
+typedef void *(*LuastructReallocFunction)(void *userdata, void *ptr, size_t osize, size_t nsize);
+
+/**
+ * Layout of a C vector header such as
+ * `struct { T *data; uint32_t count; uint32_t capacity; }`.
+ * The elements live in a separate buffer that grows through realloc.
+ */
+typedef struct LuastructVectorDesc {
+	uint32_t data_offset;
+	uint32_t count_offset;
+	uint32_t capacity_offset;
+	/**
+	 * The integer type of count and capacity: int32, uint32, int64 or uint64.
+	 */
+	LuastructType size_type;
+	LuastructReallocFunction realloc;
+	void *userdata;
+} LuastructVectorDesc;
+
+/**
+ * Layout of a fixed-capacity C ring buffer header such as
+ * `struct { T data[N]; uint32_t head; uint32_t count; }`.
+ * The oldest element is at data[head] and the elements wrap around
+ * the end of data.
+ */
+typedef struct LuastructRingDesc {
+	uint32_t data_offset;
+	uint32_t head_offset;
+	uint32_t count_offset;
+	/**
+	 * The integer type of head and count: int32, uint32, int64 or uint64.
+	 */
+	LuastructType size_type;
+	size_t capacity;
+} LuastructRingDesc;
+
+/**
+ * Layout of an intrusive singly or doubly linked list of structs such as
+ * `struct node { ...; struct node *next; }`. The list field is either the
+ * pointer to the first node, or a sentinel node of a circular list whose
+ * last node points back to it.
+ */
+typedef struct LuastructListDesc {
+	uint32_t next_offset;
+	/**
+	 * Whether the field is a sentinel node rather than a pointer to the first node.
+	 */
+	bool sentinel;
+	/**
+	 * Walking more nodes than this raises an error, 0 for no limit.
+	 * Cycles are detected either way.
+	 */
+	size_t max_length;
+} LuastructListDesc;
+
+/**
+ * Hash function a C hash map places its keys with.
+ */
+typedef enum LuastructHash {
+	/** The key value itself, converted to uint64_t. */
+	LUAS_HASH_IDENTITY,
+	/** 64-bit FNV-1a over the bytes of the key. */
+	LUAS_HASH_FNV1A,
+	/** The 64-bit finalizer of MurmurHash3 applied to the key value converted to uint64_t. */
+	LUAS_HASH_MURMUR3,
+	/** The hash_function of the map layout. */
+	LUAS_HASH_CUSTOM
+} LuastructHash;
+
+/**
+ * Hash of the size bytes of a key, for maps using LUAS_HASH_CUSTOM.
+ */
+typedef uint64_t (*LuastructHashFunction)(const void *key, size_t size, void *userdata);
+
+/**
+ * Layout of a C open-addressing hash map header such as
+ * `struct { K *keys; V *values; uint32_t capacity; uint64_t *occupied; }`.
+ * Slot i holds keys[i] and values[i] when bit i of the occupied bitmap is
+ * set, bit i being bit i % 8 of byte i / 8 of the bitmap. A key lives in the
+ * first slot found by linear probing from hash(key) % capacity, so that a
+ * lookup stops at the first free slot.
+ */
+typedef struct LuastructMapDesc {
+	uint32_t keys_offset;
+	uint32_t values_offset;
+	uint32_t capacity_offset;
+	uint32_t occupied_offset;
+	/**
+	 * The integer type of the keys.
+	 */
+	LuastructType key_type;
+	/**
+	 * The integer type of capacity: int32, uint32, int64 or uint64.
+	 */
+	LuastructType size_type;
+	LuastructHash hash;
+	LuastructHashFunction hash_function;
+	void *userdata;
+} LuastructMapDesc;
+
 typedef struct LuastructArrayDesc {
 	/** 
 	 * A function that can count the elements in the array.
@@ -60,9 +180,37 @@ typedef struct LuastructArrayDesc {
 	 */
 	size_t elements_size;
 	LuastructType elements_type;
+	/**
+	 * The struct or enum type of the elements, or the
+	 * descriptor of the inner arrays for nested arrays.
+	 */
 	void *elements_type_info;
 	bool elements_are_pointers;
 	bool elements_are_readonly;
+	/**
+	 * For vectors, the layout of the header the array points to.
+	 * The elements and their count are read from the header.
+	 */
+	LuastructVectorDesc *vector;
+	/**
+	 * For ring buffers, the layout of the header the array points to.
+	 * Index 1 of the array is the oldest element of the ring.
+	 */
+	LuastructRingDesc *ring;
+	/**
+	 * For linked lists, the layout of the nodes. The field is not an array
+	 * but a list object that is walked from its head.
+	 */
+	LuastructListDesc *list;
+	/**
+	 * For hash maps, the layout of the header. The field is not an array
+	 * but a map object indexed by keys.
+	 */
+	LuastructMapDesc *map;
+	/**
+	 * For uint64 elements, how values above LUA_MAXINTEGER are read and written.
+	 */
+	LuastructOverflow overflow;
 } LuastructArrayDesc;
 
 typedef struct LuastructStructField {
@@ -72,6 +220,10 @@ typedef struct LuastructStructField {
 	uint32_t offset;
 	bool pointer;
 	bool readonly;
+	/**
+	 * For uint64 fields, how values above LUA_MAXINTEGER are read and written.
+	 */
+	LuastructOverflow overflow;
 	struct LuastructStructField *next_by_offset;
 	struct LuastructStructField *next_by_name;
 	union {
@@ -123,6 +275,12 @@ typedef struct LuastructStructObject {
 typedef struct LuastructArray {
 	void *data;
 	LuastructArrayDesc *array_info;
+	/**
+	 * The distance in bytes between consecutive elements.
+	 * Zero means the elements are packed, which is the case
+	 * for every array except views such as struct columns.
+	 */
+	size_t stride;
 } LuastructArray;
 
 /**
@@ -173,6 +331,16 @@ void luastruct_new_struct_field(lua_State *state, const char *name, LuastructTyp
  */
 void luastruct_new_struct_bit_field(lua_State *state, const char *name, LuastructType type, uint32_t offset, uint32_t bit_offset, bool pointer, bool readonly);
 
+/**
+ * Set how a uint64 field, or the uint64 elements of an array field, are read
+ * and written when their value is above LUA_MAXINTEGER. Fields wrap such
+ * values to negative integers unless told otherwise.
+ * @param state Lua state.
+ * @param name Name of a field of the struct on top of the stack.
+ * @param overflow The policy for values above LUA_MAXINTEGER.
+ */
+void luastruct_set_field_overflow(lua_State *state, const char *name, LuastructOverflow overflow);
+
 /**
  * Creates a new dynamic array descriptor.
  * @param state The Lua state.
@@ -197,8 +365,104 @@ void luastruct_new_dynamic_array_desc(lua_State *state, LuastructType type, cons
  */
 void luastruct_new_static_array_desc(lua_State *state, LuastructType type, const char *type_name, size_t size, bool elements_are_pointers, bool readonly, LuastructArrayDesc *desc);
 
+/**
+ * Creates a new static array descriptor whose elements are arrays, such as
+ * `float matrix[4][4]`. The inner descriptor is copied into the new one, so
+ * the caller still owns it. Release the new descriptor with
+ * luastruct_free_array_desc once the fields using it are created.
+ * @param state The Lua state.
+ * @param inner The descriptor of each inner array. Inner arrays stored inline must have a static size.
+ * @param size The fixed size of the outer array.
+ * @param elements_are_pointers Whether the elements are pointers to the inner arrays.
+ * @param readonly Whether the array is read-only.
+ * @param desc A pointer to the LuastructArrayDesc structure to populate with the array descriptor.
+ */
+void luastruct_new_static_nested_array_desc(lua_State *state, const LuastructArrayDesc *inner, size_t size, bool elements_are_pointers, bool readonly, LuastructArrayDesc *desc);
+
+/**
+ * Creates a new dynamic array descriptor whose elements are arrays.
+ * The inner descriptor is copied into the new one, so the caller still owns
+ * it. Release the new descriptor with luastruct_free_array_desc.
+ * @param state The Lua state.
+ * @param inner The descriptor of each inner array. Inner arrays stored inline must have a static size.
+ * @param count_getter A Lua C function to retrieve the count of elements in the outer array.
+ * @param elements_are_pointers Whether the elements are pointers to the inner arrays.
+ * @param readonly Whether the array is read-only.
+ * @param desc A pointer to the LuastructArrayDesc structure to populate with the array descriptor.
+ */
+void luastruct_new_dynamic_nested_array_desc(lua_State *state, const LuastructArrayDesc *inner, lua_CFunction count_getter, bool elements_are_pointers, bool readonly, LuastructArrayDesc *desc);
+
+/**
+ * Creates a new vector descriptor. A vector field is the header of a C vector
+ * whose elements scripts can append with push(), pop(), reserve() and resize().
+ * The layout is copied and owned by the new descriptor, which is released
+ * with luastruct_free_array_desc.
+ * @param state The Lua state.
+ * @param type The type of the elements: a number, a boolean, a struct or an enum.
+ * @param type_name The name of the struct or enum type of the elements, NULL otherwise.
+ * @param vector The layout of the vector header and the allocator of its buffer.
+ * @param readonly Whether the vector is read-only, in which case it cannot grow either.
+ * @param desc A pointer to the LuastructArrayDesc structure to populate with the array descriptor.
+ */
+void luastruct_new_vector_desc(lua_State *state, LuastructType type, const char *type_name, const LuastructVectorDesc *vector, bool readonly, LuastructArrayDesc *desc);
+
+/**
+ * Creates a new ring buffer descriptor. A ring field is the header of a C
+ * ring buffer, seen from Lua as an array of its elements from the oldest to
+ * the newest. The layout is copied and owned by the new descriptor, which is
+ * released with luastruct_free_array_desc.
+ * @param state The Lua state.
+ * @param type The type of the elements: a number, a boolean, a struct or an enum.
+ * @param type_name The name of the struct or enum type of the elements, NULL otherwise.
+ * @param ring The layout of the ring buffer header.
+ * @param readonly Whether the ring buffer is read-only.
+ * @param desc A pointer to the LuastructArrayDesc structure to populate with the array descriptor.
+ */
+void luastruct_new_ring_desc(lua_State *state, LuastructType type, const char *type_name, const LuastructRingDesc *ring, bool readonly, LuastructArrayDesc *desc);
+
+/**
+ * Creates a new linked list descriptor. A list field is the head of an
+ * intrusive linked list of structs, seen from Lua as a list object that can
+ * be iterated, counted, searched and filtered without a metamethod call per
+ * node. The layout is copied and owned by the new descriptor, which is
+ * released with luastruct_free_array_desc.
+ * @param state The Lua state.
+ * @param type_name The name of the struct type of the nodes.
+ * @param list The layout of the nodes.
+ * @param readonly Whether the nodes are read-only.
+ * @param desc A pointer to the LuastructArrayDesc structure to populate with the list descriptor.
+ */
+void luastruct_new_list_desc(lua_State *state, const char *type_name, const LuastructListDesc *list, bool readonly, LuastructArrayDesc *desc);
+
+/**
+ * Creates a new hash map descriptor. A map field is the header of a C
+ * open-addressing hash map, seen from Lua as a map object whose values are
+ * looked up by key and iterated without visiting the free slots.
+ * The layout is copied and owned by the new descriptor, which is released
+ * with luastruct_free_array_desc.
+ * @param state The Lua state.
+ * @param type The type of the values.
+ * @param type_name The name of the type of the values, if they are structs or enums.
+ * @param map The layout of the header.
+ * @param readonly Whether the values are read-only.
+ * @param desc A pointer to the LuastructArrayDesc structure to populate with the map descriptor.
+ */
+void luastruct_new_map_desc(lua_State *state, LuastructType type, const char *type_name, const LuastructMapDesc *map, bool readonly, LuastructArrayDesc *desc);
+
+/**
+ * Releases what the descriptor creation functions allocated for a descriptor,
+ * such as the inner descriptors of a nested array or the layout of a vector,
+ * ring buffer, list or map.
+ * The descriptor itself is not freed.
+ * @param desc The descriptor to release.
+ */
+void luastruct_free_array_desc(LuastructArrayDesc *desc);
+
 /**
  * Creates a new struct field that represents an array in a Lua structure.
+ * The descriptor is copied into the field, which owns its copy: the caller
+ * still owns array_info and can use it for other fields before releasing it
+ * with luastruct_free_array_desc.
  * @param state The Lua state.
  * @param name The name of the field.
  * @param array_info A pointer to the LuastructArrayDesc structure describing the array.
@@ -208,6 +472,37 @@ void luastruct_new_static_array_desc(lua_State *state, LuastructType type, const
  */
 void luastruct_new_struct_array_field(lua_State *state, const char *name, LuastructArrayDesc *array_info, uint32_t offset, bool pointer, bool readonly);
 
+/**
+ * Create an array of count zeroed elements owned by Lua. The elements are
+ * stored contiguously, aligned to a cache line, in the same userdata as the
+ * array object and are freed when it is collected. Objects and arrays taken
+ * from the elements keep the array alive.
+ * @param state Lua state.
+ * @param type Type of the elements: a number, a boolean, a struct or an enum.
+ * @param type_name Name of the struct or enum type of the elements, NULL otherwise.
+ * @param count Number of elements.
+ * @return The number of values pushed onto the stack.
+ */
+int luastruct_new_owned_array(lua_State *state, LuastructType type, const char *type_name, size_t count);
+
+/**
+ * Lua function newarray(type, n) creating an owned array of n elements.
+ * The type is a struct type, the name of a registered struct or enum type,
+ * or the name of a primitive type such as "int32" or "float". Struct types
+ * also have a newarray(n) function bound to them: Type.newarray(n).
+ * @param state Lua state.
+ * @return The number of values pushed onto the stack.
+ */
+int luastruct_newarray(lua_State *state);
+
+/**
+ * Set how many elements ahead the loops over arrays of pointers prefetch,
+ * for every array of a state. 0 disables prefetching, the default is 16.
+ * @param state Lua state.
+ * @param distance Number of elements to look ahead.
+ */
+void luastruct_set_prefetch_distance(lua_State *state, size_t distance);
+
 /**
  * Create a new object.
  * @param state Lua state.
@@ -8,12 +8,15 @@
 #include "luastruct.h"
 #include "debug.h"
 
-static const char *OBJECT_METATABLE_NAME = "luastruct_object";
 static const char *OBJECT_REGISTRY_KEY_FORMAT = "%.8X_%s";
 static const char *OBJECT_REGISTRY_NAME = "luastruct_objects";
 
 int luastruct_get_type(lua_State *state, const char *name);
 int luastruct_new_array(lua_State *state, void *data, LuastructArrayDesc *array_info);
+size_t get_type_size(lua_State *state, LuastructType type, void *type_info);
+void inherit_buffer_owner(lua_State *state, int parent_index);
+void push_uint64(lua_State *state, uint64_t value, LuastructOverflow overflow);
+uint64_t check_uint64(lua_State *state, int index, LuastructOverflow overflow);
 
 int luastruct_get_objects_registry(lua_State *state) {
     lua_getfield(state, LUA_REGISTRYINDEX, OBJECT_REGISTRY_NAME);
@@ -22,7 +25,6 @@ int luastruct_get_objects_registry(lua_State *state) {
         lua_newtable(state);
         lua_pushvalue(state, -1);
         lua_setfield(state, LUA_REGISTRYINDEX, OBJECT_REGISTRY_NAME);
-        lua_getfield(state, LUA_REGISTRYINDEX, OBJECT_REGISTRY_NAME);
 
         /**
          * Set the metatable for the objects registry to use weak references.
@@ -54,6 +56,39 @@ int luastruct_get_object(lua_State *state, void *data, bool readonly) {
     return 1;
 }
 
+/**
+ * Remove an object from the objects registry,
+ * if it is the object registered for its address.
+ */
+static void unregister_object(lua_State *state, LuastructStructObject *obj) {
+    char key[LUASTRUCT_TYPENAME_LENGTH];
+    get_object_key(key, obj->data, obj->readonly);
+    luastruct_get_objects_registry(state);
+    if(lua_getfield(state, -1, key) == LUA_TUSERDATA && lua_touserdata(state, -1) == obj) {
+        lua_pushnil(state);
+        lua_setfield(state, -3, key);
+    }
+    lua_pop(state, 2);
+}
+
+void luastruct_move_object(lua_State *state, int index, void *data) {
+    LuastructStructObject *obj = lua_touserdata(state, index);
+    unregister_object(state, obj);
+    obj->data = data;
+    char key[LUASTRUCT_TYPENAME_LENGTH];
+    get_object_key(key, data, obj->readonly);
+    luastruct_get_objects_registry(state);
+    lua_pushvalue(state, index);
+    lua_setfield(state, -2, key);
+    lua_pop(state, 1);
+}
+
+void luastruct_invalidate_object(lua_State *state, int index) {
+    LuastructStructObject *obj = lua_touserdata(state, index);
+    unregister_object(state, obj);
+    obj->invalid = true;
+}
+
 int luastruct_object__gc(lua_State *state) {
     LuastructStructObject *obj = luaL_checkudata(state, 1, OBJECT_METATABLE_NAME);
     LuastructTypeInfo *type_info = obj->type;
@@ -108,6 +143,9 @@ int luastruct_object__index(lua_State *state) {
                 case LUAST_UINT32:
                     lua_pushinteger(state, *(uint32_t *)(data));
                     break;
+                case LUAST_UINT64:
+                    push_uint64(state, *(uint64_t *)(data), field->overflow);
+                    break;
                 case LUAST_FLOAT:
                     lua_pushnumber(state, *(float *)(data));
                     break;
@@ -117,9 +155,11 @@ int luastruct_object__index(lua_State *state) {
                 case LUAST_STRUCT:
                 case LUAST_ENUM:
                     luastruct_new_object(state, ((LuastructTypeInfo *)field->type_info)->name, data, readonly);
+                    inherit_buffer_owner(state, 1);
                     break;
                 case LUAST_ARRAY:
                     luastruct_new_array(state, data, &field->array);
+                    inherit_buffer_owner(state, 1);
                     break;
                 case LUAST_BITFIELD: {
                     switch(field->bitfield.size) {
@@ -144,7 +184,9 @@ int luastruct_object__index(lua_State *state) {
         }
         field = field->next_by_name;
     }
-    lua_pushnil(state);
+    luaL_getmetafield(state, 1, "__methods");
+    lua_pushvalue(state, 2);
+    lua_rawget(state, -2);
     return 1;
 }
 
@@ -197,6 +239,9 @@ int luastruct_object__newindex(lua_State *state) {
                     *(int32_t *)(data) = value;
                     break;
                 }
+                case LUAST_INT64:
+                    *(int64_t *)(data) = luaL_checkinteger(state, 3);
+                    break;
                 case LUAST_UINT8: {
                     lua_Integer value = luaL_checkinteger(state, 3);
                     if(value < 0 || value > UINT8_MAX) {
@@ -221,6 +266,9 @@ int luastruct_object__newindex(lua_State *state) {
                     *(uint32_t *)(data) = value;
                     break;
                 }
+                case LUAST_UINT64:
+                    *(uint64_t *)(data) = check_uint64(state, 3, field->overflow);
+                    break;
                 case LUAST_FLOAT: {
                     lua_Number value = luaL_checknumber(state, 3);
                     *(float *)(data) = value;
@@ -373,6 +421,41 @@ int luastruct_object__eq(lua_State *state) {
     return 1;
 }
 
+int luastruct_object_tobytes(lua_State *state) {
+    LuastructStructObject *obj = luaL_checkudata(state, 1, OBJECT_METATABLE_NAME);
+    if(!obj || obj->invalid) {
+        return luaL_error(state, "Object is invalid in tobytes method");
+    }
+    LuastructTypeInfo *type_info = obj->type;
+    lua_pushlstring(state, obj->data, get_type_size(state, type_info->type, type_info));
+    return 1;
+}
+
+int luastruct_object_frombytes(lua_State *state) {
+    LuastructStructObject *obj = luaL_checkudata(state, 1, OBJECT_METATABLE_NAME);
+    if(!obj || obj->invalid) {
+        return luaL_error(state, "Object is invalid in frombytes method");
+    }
+    if(obj->readonly) {
+        return luaL_error(state, "Object is read-only in frombytes method");
+    }
+    size_t length;
+    const char *bytes = luaL_checklstring(state, 2, &length);
+    LuastructTypeInfo *type_info = obj->type;
+    size_t size = get_type_size(state, type_info->type, type_info);
+    if(length != size) {
+        return luaL_error(state, "String length does not match the size of %s: %d != %d", type_info->name, (int)length, (int)size);
+    }
+    memcpy(obj->data, bytes, size);
+    return 0;
+}
+
+static const struct luaL_Reg luastruct_object_methods[] = {
+    {"tobytes", luastruct_object_tobytes},
+    {"frombytes", luastruct_object_frombytes},
+    {NULL, NULL}
+};
+
 static const struct luaL_Reg luastruct_object_metatable_methods[] = {
     {"__gc", luastruct_object__gc},
     {"__index", luastruct_object__index},
@@ -395,7 +478,8 @@ int luastruct_new_object(lua_State *state, const char *type_name, void *data, bo
         return luaL_error(state, "Invalid type for object: %s", type_name);
     }
 
-    if(luastruct_get_object(state, data, readonly) != 0) {
+    // Objects allocated here are never shared, so they are not looked up by address
+    if(data && luastruct_get_object(state, data, readonly) != 0) {
         LuastructStructObject *obj = lua_touserdata(state, -1);
         LuastructTypeInfo *obj_type_info = obj->type;
         if(!obj->invalid) {
@@ -405,6 +489,7 @@ int luastruct_new_object(lua_State *state, const char *type_name, void *data, bo
             LUAS_DEBUG_MSG("Using existing object of type \"%s\" at 0x%.8X (%s)\n", obj_type_info->name, data, readonly ? "ro" : "rw");
             return 1;
         }
+        lua_pop(state, 1);
     }
 
     LUAS_DEBUG_MSG("Creating object of type \"%s\" at 0x%.8X (%s)\n", type_name, data, readonly ? "ro" : "rw");
@@ -451,8 +536,13 @@ int luastruct_new_object(lua_State *state, const char *type_name, void *data, bo
 
     if(luaL_newmetatable(state, OBJECT_METATABLE_NAME) != 0) {
         luaL_setfuncs(state, luastruct_object_metatable_methods, 0);
+        luaL_newlib(state, luastruct_object_methods);
+        lua_setfield(state, -2, "__methods");
     }
     lua_setmetatable(state, -2);
+    if(!data) {
+        return 1;
+    }
     
     char object_key[LUASTRUCT_TYPENAME_LENGTH];
     get_object_key(object_key, data, readonly);
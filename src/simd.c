@@ -0,0 +1,1050 @@
+// SPDX-License-Identifier: GPL-3.0-only
+
+#include <stdbool.h>
+#include <string.h>
+#include "simd.h"
+
+#ifdef LUAS_SIMD_X86
+#include <immintrin.h>
+#define LUAS_TARGET_SSE2 __attribute__((target("sse2")))
+#define LUAS_TARGET_AVX2 __attribute__((target("avx2")))
+#endif
+
+static bool level_detected = false;
+static LuastructSimdLevel detected_level = LUAS_SIMD_SCALAR;
+static LuastructSimdLevel active_level = LUAS_SIMD_SCALAR;
+
+static LuastructSimdLevel detect_simd_level(void) {
+#ifdef LUAS_SIMD_X86
+    __builtin_cpu_init();
+    if(__builtin_cpu_supports("avx2")) {
+        return LUAS_SIMD_AVX2;
+    }
+    if(__builtin_cpu_supports("sse2")) {
+        return LUAS_SIMD_SSE2;
+    }
+#endif
+    return LUAS_SIMD_SCALAR;
+}
+
+LuastructSimdLevel simd_get_level(void) {
+    if(!level_detected) {
+        detected_level = detect_simd_level();
+        active_level = detected_level;
+        level_detected = true;
+    }
+    return active_level;
+}
+
+LuastructSimdLevel simd_set_level(LuastructSimdLevel level) {
+    simd_get_level();
+    active_level = level > detected_level ? detected_level : level;
+    return active_level;
+}
+
+/*
+ * Scalar kernels. These are also used to finish the tails the vector
+ * kernels leave behind.
+ */
+
+static double sum_float_scalar(const float *data, size_t count) {
+    double sum = 0;
+    for(size_t i = 0; i < count; i++) {
+        sum += data[i];
+    }
+    return sum;
+}
+
+static void minmax_float_scalar(const float *data, size_t count, float *min, float *max) {
+    for(size_t i = 0; i < count; i++) {
+        if(data[i] < *min) {
+            *min = data[i];
+        }
+        if(data[i] > *max) {
+            *max = data[i];
+        }
+    }
+}
+
+static double dot_float_scalar(const float *a, const float *b, size_t count) {
+    double sum = 0;
+    for(size_t i = 0; i < count; i++) {
+        sum += (double)a[i] * b[i];
+    }
+    return sum;
+}
+
+static int64_t sum_int32_scalar(const int32_t *data, size_t count) {
+    uint64_t sum = 0;
+    for(size_t i = 0; i < count; i++) {
+        sum += (int64_t)data[i];
+    }
+    return sum;
+}
+
+static void minmax_int32_scalar(const int32_t *data, size_t count, int32_t *min, int32_t *max) {
+    for(size_t i = 0; i < count; i++) {
+        if(data[i] < *min) {
+            *min = data[i];
+        }
+        if(data[i] > *max) {
+            *max = data[i];
+        }
+    }
+}
+
+static int64_t dot_int32_scalar(const int32_t *a, const int32_t *b, size_t count) {
+    uint64_t sum = 0;
+    for(size_t i = 0; i < count; i++) {
+        sum += (uint64_t)((int64_t)a[i] * b[i]);
+    }
+    return sum;
+}
+
+static uint64_t sum_int64_scalar(const uint64_t *data, size_t count) {
+    uint64_t sum = 0;
+    for(size_t i = 0; i < count; i++) {
+        sum += data[i];
+    }
+    return sum;
+}
+
+static void minmax_int64_scalar(const int64_t *data, size_t count, int64_t *min, int64_t *max) {
+    for(size_t i = 0; i < count; i++) {
+        if(data[i] < *min) {
+            *min = data[i];
+        }
+        if(data[i] > *max) {
+            *max = data[i];
+        }
+    }
+}
+
+static void minmax_uint64_scalar(const uint64_t *data, size_t count, uint64_t *min, uint64_t *max) {
+    for(size_t i = 0; i < count; i++) {
+        if(data[i] < *min) {
+            *min = data[i];
+        }
+        if(data[i] > *max) {
+            *max = data[i];
+        }
+    }
+}
+
+static size_t find_equal_scalar(const void *data, size_t count, size_t width, const void *value) {
+    const uint8_t *bytes = data;
+    for(size_t i = 0; i < count; i++) {
+        if(memcmp(bytes + i * width, value, width) == 0) {
+            return i;
+        }
+    }
+    return count;
+}
+
+static size_t count_equal_scalar(const void *data, size_t count, size_t width, const void *value) {
+    const uint8_t *bytes = data;
+    size_t matches = 0;
+    for(size_t i = 0; i < count; i++) {
+        matches += memcmp(bytes + i * width, value, width) == 0;
+    }
+    return matches;
+}
+
+static size_t find_float_scalar(const float *data, size_t count, float value) {
+    for(size_t i = 0; i < count; i++) {
+        if(data[i] == value) {
+            return i;
+        }
+    }
+    return count;
+}
+
+static size_t count_float_scalar(const float *data, size_t count, float value) {
+    size_t matches = 0;
+    for(size_t i = 0; i < count; i++) {
+        matches += data[i] == value;
+    }
+    return matches;
+}
+
+/*
+ * Element-wise kernels update y in place, in single precision.
+ */
+
+static void axpy_float_scalar(float *y, const float *x, float k, size_t count) {
+    for(size_t i = 0; i < count; i++) {
+        y[i] = y[i] + k * x[i];
+    }
+}
+
+static void mul_float_scalar(float *y, const float *x, size_t count) {
+    for(size_t i = 0; i < count; i++) {
+        y[i] = y[i] * x[i];
+    }
+}
+
+static void scale_float_scalar(float *y, float k, size_t count) {
+    for(size_t i = 0; i < count; i++) {
+        y[i] = y[i] * k;
+    }
+}
+
+static void shift_float_scalar(float *y, float c, size_t count) {
+    for(size_t i = 0; i < count; i++) {
+        y[i] = y[i] + c;
+    }
+}
+
+static void clamp_float_scalar(float *y, float lo, float hi, size_t count) {
+    for(size_t i = 0; i < count; i++) {
+        float value = lo > y[i] ? lo : y[i];
+        y[i] = hi < value ? hi : value;
+    }
+}
+
+static void lerp_float_scalar(float *y, const float *x, float t, size_t count) {
+    for(size_t i = 0; i < count; i++) {
+        y[i] = y[i] + (x[i] - y[i]) * t;
+    }
+}
+
+static uint64_t load_word(const uint8_t *data) {
+    uint64_t word;
+    memcpy(&word, data, sizeof(word));
+    return word;
+}
+
+static uint64_t popcount_scalar(const uint8_t *data, size_t size) {
+    uint64_t count = 0;
+    size_t i = 0;
+    for(; i + 8 <= size; i += 8) {
+        count += __builtin_popcountll(load_word(data + i));
+    }
+    for(; i < size; i++) {
+        count += __builtin_popcount(data[i]);
+    }
+    return count;
+}
+
+static uint8_t combine_byte(uint8_t a, uint8_t b, LuastructBitOp op) {
+    switch(op) {
+        case LUAS_BITS_AND:
+            return a & b;
+        case LUAS_BITS_OR:
+            return a | b;
+        case LUAS_BITS_XOR:
+            return a ^ b;
+        default:
+            return a & ~b;
+    }
+}
+
+static void combine_bits_scalar(uint8_t *dst, const uint8_t *src, size_t size, LuastructBitOp op) {
+    size_t i = 0;
+    for(; i + 8 <= size; i += 8) {
+        uint64_t a = load_word(dst + i);
+        uint64_t b = load_word(src + i);
+        switch(op) {
+            case LUAS_BITS_AND:
+                a &= b;
+                break;
+            case LUAS_BITS_OR:
+                a |= b;
+                break;
+            case LUAS_BITS_XOR:
+                a ^= b;
+                break;
+            default:
+                a &= ~b;
+                break;
+        }
+        memcpy(dst + i, &a, sizeof(a));
+    }
+    for(; i < size; i++) {
+        dst[i] = combine_byte(dst[i], src[i], op);
+    }
+}
+
+static size_t mismatch_scalar(const uint8_t *a, const uint8_t *b, size_t size) {
+    size_t i = 0;
+    while(i + 8 <= size && load_word(a + i) == load_word(b + i)) {
+        i += 8;
+    }
+    while(i < size && a[i] == b[i]) {
+        i++;
+    }
+    return i;
+}
+
+#ifdef LUAS_SIMD_X86
+
+/*
+ * SSE2 kernels
+ */
+
+LUAS_TARGET_SSE2
+static double sum_float_sse2(const float *data, size_t count) {
+    __m128d acc0 = _mm_setzero_pd();
+    __m128d acc1 = _mm_setzero_pd();
+    size_t i = 0;
+    for(; i + 4 <= count; i += 4) {
+        __m128 v = _mm_loadu_ps(data + i);
+        acc0 = _mm_add_pd(acc0, _mm_cvtps_pd(v));
+        acc1 = _mm_add_pd(acc1, _mm_cvtps_pd(_mm_movehl_ps(v, v)));
+    }
+    double lanes[2];
+    _mm_storeu_pd(lanes, _mm_add_pd(acc0, acc1));
+    return lanes[0] + lanes[1] + sum_float_scalar(data + i, count - i);
+}
+
+LUAS_TARGET_SSE2
+static void minmax_float_sse2(const float *data, size_t count, float *min, float *max) {
+    size_t i = 0;
+    if(count >= 4) {
+        __m128 vmin = _mm_loadu_ps(data);
+        __m128 vmax = vmin;
+        for(i = 4; i + 4 <= count; i += 4) {
+            __m128 v = _mm_loadu_ps(data + i);
+            vmin = _mm_min_ps(vmin, v);
+            vmax = _mm_max_ps(vmax, v);
+        }
+        float lanes_min[4], lanes_max[4];
+        _mm_storeu_ps(lanes_min, vmin);
+        _mm_storeu_ps(lanes_max, vmax);
+        minmax_float_scalar(lanes_min, 4, min, max);
+        minmax_float_scalar(lanes_max, 4, min, max);
+    }
+    minmax_float_scalar(data + i, count - i, min, max);
+}
+
+LUAS_TARGET_SSE2
+static double dot_float_sse2(const float *a, const float *b, size_t count) {
+    __m128d acc0 = _mm_setzero_pd();
+    __m128d acc1 = _mm_setzero_pd();
+    size_t i = 0;
+    for(; i + 4 <= count; i += 4) {
+        __m128 va = _mm_loadu_ps(a + i);
+        __m128 vb = _mm_loadu_ps(b + i);
+        acc0 = _mm_add_pd(acc0, _mm_mul_pd(_mm_cvtps_pd(va), _mm_cvtps_pd(vb)));
+        acc1 = _mm_add_pd(acc1, _mm_mul_pd(_mm_cvtps_pd(_mm_movehl_ps(va, va)), _mm_cvtps_pd(_mm_movehl_ps(vb, vb))));
+    }
+    double lanes[2];
+    _mm_storeu_pd(lanes, _mm_add_pd(acc0, acc1));
+    return lanes[0] + lanes[1] + dot_float_scalar(a + i, b + i, count - i);
+}
+
+LUAS_TARGET_SSE2
+static int64_t sum_int32_sse2(const int32_t *data, size_t count) {
+    __m128i acc = _mm_setzero_si128();
+    size_t i = 0;
+    for(; i + 4 <= count; i += 4) {
+        __m128i v = _mm_loadu_si128((const __m128i *)(data + i));
+        __m128i sign = _mm_srai_epi32(v, 31);
+        acc = _mm_add_epi64(acc, _mm_unpacklo_epi32(v, sign));
+        acc = _mm_add_epi64(acc, _mm_unpackhi_epi32(v, sign));
+    }
+    int64_t lanes[2];
+    _mm_storeu_si128((__m128i *)lanes, acc);
+    return (uint64_t)lanes[0] + (uint64_t)lanes[1] + (uint64_t)sum_int32_scalar(data + i, count - i);
+}
+
+LUAS_TARGET_SSE2
+static void minmax_int32_sse2(const int32_t *data, size_t count, int32_t *min, int32_t *max) {
+    size_t i = 0;
+    if(count >= 4) {
+        __m128i vmin = _mm_loadu_si128((const __m128i *)data);
+        __m128i vmax = vmin;
+        for(i = 4; i + 4 <= count; i += 4) {
+            __m128i v = _mm_loadu_si128((const __m128i *)(data + i));
+            __m128i lower = _mm_cmplt_epi32(v, vmin);
+            __m128i greater = _mm_cmpgt_epi32(v, vmax);
+            vmin = _mm_or_si128(_mm_and_si128(lower, v), _mm_andnot_si128(lower, vmin));
+            vmax = _mm_or_si128(_mm_and_si128(greater, v), _mm_andnot_si128(greater, vmax));
+        }
+        int32_t lanes_min[4], lanes_max[4];
+        _mm_storeu_si128((__m128i *)lanes_min, vmin);
+        _mm_storeu_si128((__m128i *)lanes_max, vmax);
+        minmax_int32_scalar(lanes_min, 4, min, max);
+        minmax_int32_scalar(lanes_max, 4, min, max);
+    }
+    minmax_int32_scalar(data + i, count - i, min, max);
+}
+
+LUAS_TARGET_SSE2
+static uint64_t sum_int64_sse2(const uint64_t *data, size_t count) {
+    __m128i acc0 = _mm_setzero_si128();
+    __m128i acc1 = _mm_setzero_si128();
+    size_t i = 0;
+    for(; i + 4 <= count; i += 4) {
+        acc0 = _mm_add_epi64(acc0, _mm_loadu_si128((const __m128i *)(data + i)));
+        acc1 = _mm_add_epi64(acc1, _mm_loadu_si128((const __m128i *)(data + i + 2)));
+    }
+    uint64_t lanes[2];
+    _mm_storeu_si128((__m128i *)lanes, _mm_add_epi64(acc0, acc1));
+    return lanes[0] + lanes[1] + sum_int64_scalar(data + i, count - i);
+}
+
+/*
+ * The search kernels compare a whole register at once and turn the result
+ * into a byte mask with movemask. Every matching element sets width bits,
+ * so the element index is the first set bit divided by width.
+ */
+
+static void broadcast_pattern(uint8_t *buffer, size_t buffer_size, size_t width, const void *value) {
+    for(size_t i = 0; i < buffer_size; i += width) {
+        memcpy(buffer + i, value, width);
+    }
+}
+
+LUAS_TARGET_SSE2
+static inline unsigned equal_mask_sse2(__m128i a, __m128i b, size_t width) {
+    __m128i equal;
+    switch(width) {
+        case 1:
+            equal = _mm_cmpeq_epi8(a, b);
+            break;
+        case 2:
+            equal = _mm_cmpeq_epi16(a, b);
+            break;
+        case 4:
+            equal = _mm_cmpeq_epi32(a, b);
+            break;
+        default:
+            /* No 64-bit compare in SSE2: both 32-bit halves must match */
+            equal = _mm_cmpeq_epi32(a, b);
+            equal = _mm_and_si128(equal, _mm_shuffle_epi32(equal, _MM_SHUFFLE(2, 3, 0, 1)));
+            break;
+    }
+    return _mm_movemask_epi8(equal);
+}
+
+LUAS_TARGET_SSE2
+static size_t find_equal_sse2(const void *data, size_t count, size_t width, const void *value) {
+    const uint8_t *bytes = data;
+    uint8_t buffer[16];
+    broadcast_pattern(buffer, sizeof(buffer), width, value);
+    __m128i pattern = _mm_loadu_si128((const __m128i *)buffer);
+    size_t lanes = 16 / width;
+    size_t i = 0;
+    for(; i + lanes <= count; i += lanes) {
+        unsigned mask = equal_mask_sse2(_mm_loadu_si128((const __m128i *)(bytes + i * width)), pattern, width);
+        if(mask != 0) {
+            return i + __builtin_ctz(mask) / width;
+        }
+    }
+    return i + find_equal_scalar(bytes + i * width, count - i, width, value);
+}
+
+LUAS_TARGET_SSE2
+static size_t count_equal_sse2(const void *data, size_t count, size_t width, const void *value) {
+    const uint8_t *bytes = data;
+    uint8_t buffer[16];
+    broadcast_pattern(buffer, sizeof(buffer), width, value);
+    __m128i pattern = _mm_loadu_si128((const __m128i *)buffer);
+    size_t lanes = 16 / width;
+    size_t matched_bits = 0;
+    size_t i = 0;
+    for(; i + lanes <= count; i += lanes) {
+        matched_bits += __builtin_popcount(equal_mask_sse2(_mm_loadu_si128((const __m128i *)(bytes + i * width)), pattern, width));
+    }
+    return matched_bits / width + count_equal_scalar(bytes + i * width, count - i, width, value);
+}
+
+LUAS_TARGET_SSE2
+static size_t find_float_sse2(const float *data, size_t count, float value) {
+    __m128 pattern = _mm_set1_ps(value);
+    size_t i = 0;
+    for(; i + 4 <= count; i += 4) {
+        int mask = _mm_movemask_ps(_mm_cmpeq_ps(_mm_loadu_ps(data + i), pattern));
+        if(mask != 0) {
+            return i + __builtin_ctz(mask);
+        }
+    }
+    return i + find_float_scalar(data + i, count - i, value);
+}
+
+LUAS_TARGET_SSE2
+static size_t count_float_sse2(const float *data, size_t count, float value) {
+    __m128 pattern = _mm_set1_ps(value);
+    size_t matches = 0;
+    size_t i = 0;
+    for(; i + 4 <= count; i += 4) {
+        matches += __builtin_popcount(_mm_movemask_ps(_mm_cmpeq_ps(_mm_loadu_ps(data + i), pattern)));
+    }
+    return matches + count_float_scalar(data + i, count - i, value);
+}
+
+LUAS_TARGET_SSE2
+static void axpy_float_sse2(float *y, const float *x, float k, size_t count) {
+    __m128 vk = _mm_set1_ps(k);
+    size_t i = 0;
+    for(; i + 4 <= count; i += 4) {
+        _mm_storeu_ps(y + i, _mm_add_ps(_mm_loadu_ps(y + i), _mm_mul_ps(vk, _mm_loadu_ps(x + i))));
+    }
+    axpy_float_scalar(y + i, x + i, k, count - i);
+}
+
+LUAS_TARGET_SSE2
+static void mul_float_sse2(float *y, const float *x, size_t count) {
+    size_t i = 0;
+    for(; i + 4 <= count; i += 4) {
+        _mm_storeu_ps(y + i, _mm_mul_ps(_mm_loadu_ps(y + i), _mm_loadu_ps(x + i)));
+    }
+    mul_float_scalar(y + i, x + i, count - i);
+}
+
+LUAS_TARGET_SSE2
+static void scale_float_sse2(float *y, float k, size_t count) {
+    __m128 vk = _mm_set1_ps(k);
+    size_t i = 0;
+    for(; i + 4 <= count; i += 4) {
+        _mm_storeu_ps(y + i, _mm_mul_ps(_mm_loadu_ps(y + i), vk));
+    }
+    scale_float_scalar(y + i, k, count - i);
+}
+
+LUAS_TARGET_SSE2
+static void shift_float_sse2(float *y, float c, size_t count) {
+    __m128 vc = _mm_set1_ps(c);
+    size_t i = 0;
+    for(; i + 4 <= count; i += 4) {
+        _mm_storeu_ps(y + i, _mm_add_ps(_mm_loadu_ps(y + i), vc));
+    }
+    shift_float_scalar(y + i, c, count - i);
+}
+
+LUAS_TARGET_SSE2
+static void clamp_float_sse2(float *y, float lo, float hi, size_t count) {
+    // Operand order keeps NaN elements as they are, like the scalar kernel
+    __m128 vlo = _mm_set1_ps(lo);
+    __m128 vhi = _mm_set1_ps(hi);
+    size_t i = 0;
+    for(; i + 4 <= count; i += 4) {
+        _mm_storeu_ps(y + i, _mm_min_ps(vhi, _mm_max_ps(vlo, _mm_loadu_ps(y + i))));
+    }
+    clamp_float_scalar(y + i, lo, hi, count - i);
+}
+
+LUAS_TARGET_SSE2
+static void lerp_float_sse2(float *y, const float *x, float t, size_t count) {
+    __m128 vt = _mm_set1_ps(t);
+    size_t i = 0;
+    for(; i + 4 <= count; i += 4) {
+        __m128 vy = _mm_loadu_ps(y + i);
+        _mm_storeu_ps(y + i, _mm_add_ps(vy, _mm_mul_ps(_mm_sub_ps(_mm_loadu_ps(x + i), vy), vt)));
+    }
+    lerp_float_scalar(y + i, x + i, t, count - i);
+}
+
+LUAS_TARGET_SSE2
+static void combine_bits_sse2(uint8_t *dst, const uint8_t *src, size_t size, LuastructBitOp op) {
+    size_t i = 0;
+    for(; i + 16 <= size; i += 16) {
+        __m128i a = _mm_loadu_si128((const __m128i *)(dst + i));
+        __m128i b = _mm_loadu_si128((const __m128i *)(src + i));
+        switch(op) {
+            case LUAS_BITS_AND:
+                a = _mm_and_si128(a, b);
+                break;
+            case LUAS_BITS_OR:
+                a = _mm_or_si128(a, b);
+                break;
+            case LUAS_BITS_XOR:
+                a = _mm_xor_si128(a, b);
+                break;
+            default:
+                a = _mm_andnot_si128(b, a);
+                break;
+        }
+        _mm_storeu_si128((__m128i *)(dst + i), a);
+    }
+    combine_bits_scalar(dst + i, src + i, size - i, op);
+}
+
+LUAS_TARGET_SSE2
+static size_t mismatch_sse2(const uint8_t *a, const uint8_t *b, size_t size) {
+    size_t i = 0;
+    for(; i + 16 <= size; i += 16) {
+        unsigned equal = _mm_movemask_epi8(_mm_cmpeq_epi8(_mm_loadu_si128((const __m128i *)(a + i)), _mm_loadu_si128((const __m128i *)(b + i))));
+        if(equal != 0xFFFF) {
+            return i + __builtin_ctz(~equal);
+        }
+    }
+    return i + mismatch_scalar(a + i, b + i, size - i);
+}
+
+/*
+ * AVX2 kernels
+ */
+
+LUAS_TARGET_AVX2
+static double sum_float_avx2(const float *data, size_t count) {
+    __m256d acc0 = _mm256_setzero_pd();
+    __m256d acc1 = _mm256_setzero_pd();
+    size_t i = 0;
+    for(; i + 8 <= count; i += 8) {
+        acc0 = _mm256_add_pd(acc0, _mm256_cvtps_pd(_mm_loadu_ps(data + i)));
+        acc1 = _mm256_add_pd(acc1, _mm256_cvtps_pd(_mm_loadu_ps(data + i + 4)));
+    }
+    double lanes[4];
+    _mm256_storeu_pd(lanes, _mm256_add_pd(acc0, acc1));
+    return lanes[0] + lanes[1] + lanes[2] + lanes[3] + sum_float_scalar(data + i, count - i);
+}
+
+LUAS_TARGET_AVX2
+static void minmax_float_avx2(const float *data, size_t count, float *min, float *max) {
+    size_t i = 0;
+    if(count >= 8) {
+        __m256 vmin = _mm256_loadu_ps(data);
+        __m256 vmax = vmin;
+        for(i = 8; i + 8 <= count; i += 8) {
+            __m256 v = _mm256_loadu_ps(data + i);
+            vmin = _mm256_min_ps(vmin, v);
+            vmax = _mm256_max_ps(vmax, v);
+        }
+        float lanes_min[8], lanes_max[8];
+        _mm256_storeu_ps(lanes_min, vmin);
+        _mm256_storeu_ps(lanes_max, vmax);
+        minmax_float_scalar(lanes_min, 8, min, max);
+        minmax_float_scalar(lanes_max, 8, min, max);
+    }
+    minmax_float_scalar(data + i, count - i, min, max);
+}
+
+LUAS_TARGET_AVX2
+static double dot_float_avx2(const float *a, const float *b, size_t count) {
+    __m256d acc0 = _mm256_setzero_pd();
+    __m256d acc1 = _mm256_setzero_pd();
+    size_t i = 0;
+    for(; i + 8 <= count; i += 8) {
+        acc0 = _mm256_add_pd(acc0, _mm256_mul_pd(_mm256_cvtps_pd(_mm_loadu_ps(a + i)), _mm256_cvtps_pd(_mm_loadu_ps(b + i))));
+        acc1 = _mm256_add_pd(acc1, _mm256_mul_pd(_mm256_cvtps_pd(_mm_loadu_ps(a + i + 4)), _mm256_cvtps_pd(_mm_loadu_ps(b + i + 4))));
+    }
+    double lanes[4];
+    _mm256_storeu_pd(lanes, _mm256_add_pd(acc0, acc1));
+    return lanes[0] + lanes[1] + lanes[2] + lanes[3] + dot_float_scalar(a + i, b + i, count - i);
+}
+
+LUAS_TARGET_AVX2
+static int64_t sum_int32_avx2(const int32_t *data, size_t count) {
+    __m256i acc0 = _mm256_setzero_si256();
+    __m256i acc1 = _mm256_setzero_si256();
+    size_t i = 0;
+    for(; i + 8 <= count; i += 8) {
+        acc0 = _mm256_add_epi64(acc0, _mm256_cvtepi32_epi64(_mm_loadu_si128((const __m128i *)(data + i))));
+        acc1 = _mm256_add_epi64(acc1, _mm256_cvtepi32_epi64(_mm_loadu_si128((const __m128i *)(data + i + 4))));
+    }
+    int64_t lanes[4];
+    _mm256_storeu_si256((__m256i *)lanes, _mm256_add_epi64(acc0, acc1));
+    return (uint64_t)lanes[0] + (uint64_t)lanes[1] + (uint64_t)lanes[2] + (uint64_t)lanes[3] + (uint64_t)sum_int32_scalar(data + i, count - i);
+}
+
+LUAS_TARGET_AVX2
+static void minmax_int32_avx2(const int32_t *data, size_t count, int32_t *min, int32_t *max) {
+    size_t i = 0;
+    if(count >= 8) {
+        __m256i vmin = _mm256_loadu_si256((const __m256i *)data);
+        __m256i vmax = vmin;
+        for(i = 8; i + 8 <= count; i += 8) {
+            __m256i v = _mm256_loadu_si256((const __m256i *)(data + i));
+            vmin = _mm256_min_epi32(vmin, v);
+            vmax = _mm256_max_epi32(vmax, v);
+        }
+        int32_t lanes_min[8], lanes_max[8];
+        _mm256_storeu_si256((__m256i *)lanes_min, vmin);
+        _mm256_storeu_si256((__m256i *)lanes_max, vmax);
+        minmax_int32_scalar(lanes_min, 8, min, max);
+        minmax_int32_scalar(lanes_max, 8, min, max);
+    }
+    minmax_int32_scalar(data + i, count - i, min, max);
+}
+
+LUAS_TARGET_AVX2
+static uint64_t sum_int64_avx2(const uint64_t *data, size_t count) {
+    __m256i acc0 = _mm256_setzero_si256();
+    __m256i acc1 = _mm256_setzero_si256();
+    size_t i = 0;
+    for(; i + 8 <= count; i += 8) {
+        acc0 = _mm256_add_epi64(acc0, _mm256_loadu_si256((const __m256i *)(data + i)));
+        acc1 = _mm256_add_epi64(acc1, _mm256_loadu_si256((const __m256i *)(data + i + 4)));
+    }
+    uint64_t lanes[4];
+    _mm256_storeu_si256((__m256i *)lanes, _mm256_add_epi64(acc0, acc1));
+    return lanes[0] + lanes[1] + lanes[2] + lanes[3] + sum_int64_scalar(data + i, count - i);
+}
+
+/**
+ * Fold groups of four 64-bit integers into per-lane minimums and maximums,
+ * from the first count / 4 * 4 elements. Values are XORed with bias before
+ * the signed comparisons, so a bias of INT64_MIN compares them as unsigned.
+ * @return The number of elements folded, at least 4.
+ */
+LUAS_TARGET_AVX2
+static size_t minmax_lanes_int64_avx2(const int64_t *data, size_t count, int64_t bias, int64_t *lanes_min, int64_t *lanes_max) {
+    __m256i vbias = _mm256_set1_epi64x(bias);
+    __m256i vmin = _mm256_xor_si256(_mm256_loadu_si256((const __m256i *)data), vbias);
+    __m256i vmax = vmin;
+    size_t i = 4;
+    for(; i + 4 <= count; i += 4) {
+        __m256i v = _mm256_xor_si256(_mm256_loadu_si256((const __m256i *)(data + i)), vbias);
+        vmin = _mm256_blendv_epi8(vmin, v, _mm256_cmpgt_epi64(vmin, v));
+        vmax = _mm256_blendv_epi8(vmax, v, _mm256_cmpgt_epi64(v, vmax));
+    }
+    _mm256_storeu_si256((__m256i *)lanes_min, _mm256_xor_si256(vmin, vbias));
+    _mm256_storeu_si256((__m256i *)lanes_max, _mm256_xor_si256(vmax, vbias));
+    return i;
+}
+
+LUAS_TARGET_AVX2
+static void minmax_int64_avx2(const int64_t *data, size_t count, int64_t *min, int64_t *max) {
+    size_t i = 0;
+    if(count >= 4) {
+        int64_t lanes_min[4], lanes_max[4];
+        i = minmax_lanes_int64_avx2(data, count, 0, lanes_min, lanes_max);
+        minmax_int64_scalar(lanes_min, 4, min, max);
+        minmax_int64_scalar(lanes_max, 4, min, max);
+    }
+    minmax_int64_scalar(data + i, count - i, min, max);
+}
+
+LUAS_TARGET_AVX2
+static void minmax_uint64_avx2(const uint64_t *data, size_t count, uint64_t *min, uint64_t *max) {
+    size_t i = 0;
+    if(count >= 4) {
+        uint64_t lanes_min[4], lanes_max[4];
+        i = minmax_lanes_int64_avx2((const int64_t *)data, count, INT64_MIN, (int64_t *)lanes_min, (int64_t *)lanes_max);
+        minmax_uint64_scalar(lanes_min, 4, min, max);
+        minmax_uint64_scalar(lanes_max, 4, min, max);
+    }
+    minmax_uint64_scalar(data + i, count - i, min, max);
+}
+
+LUAS_TARGET_AVX2
+static int64_t dot_int32_avx2(const int32_t *a, const int32_t *b, size_t count) {
+    __m256i acc = _mm256_setzero_si256();
+    size_t i = 0;
+    for(; i + 8 <= count; i += 8) {
+        __m256i va = _mm256_loadu_si256((const __m256i *)(a + i));
+        __m256i vb = _mm256_loadu_si256((const __m256i *)(b + i));
+        /* _mm256_mul_epi32 multiplies the even lanes; shift the odd ones down to reuse it */
+        acc = _mm256_add_epi64(acc, _mm256_mul_epi32(va, vb));
+        acc = _mm256_add_epi64(acc, _mm256_mul_epi32(_mm256_srli_epi64(va, 32), _mm256_srli_epi64(vb, 32)));
+    }
+    int64_t lanes[4];
+    _mm256_storeu_si256((__m256i *)lanes, acc);
+    return (uint64_t)lanes[0] + (uint64_t)lanes[1] + (uint64_t)lanes[2] + (uint64_t)lanes[3] + (uint64_t)dot_int32_scalar(a + i, b + i, count - i);
+}
+
+LUAS_TARGET_AVX2
+static inline unsigned equal_mask_avx2(__m256i a, __m256i b, size_t width) {
+    __m256i equal;
+    switch(width) {
+        case 1:
+            equal = _mm256_cmpeq_epi8(a, b);
+            break;
+        case 2:
+            equal = _mm256_cmpeq_epi16(a, b);
+            break;
+        case 4:
+            equal = _mm256_cmpeq_epi32(a, b);
+            break;
+        default:
+            equal = _mm256_cmpeq_epi64(a, b);
+            break;
+    }
+    return (unsigned)_mm256_movemask_epi8(equal);
+}
+
+LUAS_TARGET_AVX2
+static size_t find_equal_avx2(const void *data, size_t count, size_t width, const void *value) {
+    const uint8_t *bytes = data;
+    uint8_t buffer[32];
+    broadcast_pattern(buffer, sizeof(buffer), width, value);
+    __m256i pattern = _mm256_loadu_si256((const __m256i *)buffer);
+    size_t lanes = 32 / width;
+    size_t i = 0;
+    for(; i + lanes <= count; i += lanes) {
+        unsigned mask = equal_mask_avx2(_mm256_loadu_si256((const __m256i *)(bytes + i * width)), pattern, width);
+        if(mask != 0) {
+            return i + __builtin_ctz(mask) / width;
+        }
+    }
+    return i + find_equal_scalar(bytes + i * width, count - i, width, value);
+}
+
+LUAS_TARGET_AVX2
+static size_t count_equal_avx2(const void *data, size_t count, size_t width, const void *value) {
+    const uint8_t *bytes = data;
+    uint8_t buffer[32];
+    broadcast_pattern(buffer, sizeof(buffer), width, value);
+    __m256i pattern = _mm256_loadu_si256((const __m256i *)buffer);
+    size_t lanes = 32 / width;
+    size_t matched_bits = 0;
+    size_t i = 0;
+    for(; i + lanes <= count; i += lanes) {
+        matched_bits += __builtin_popcount(equal_mask_avx2(_mm256_loadu_si256((const __m256i *)(bytes + i * width)), pattern, width));
+    }
+    return matched_bits / width + count_equal_scalar(bytes + i * width, count - i, width, value);
+}
+
+LUAS_TARGET_AVX2
+static size_t find_float_avx2(const float *data, size_t count, float value) {
+    __m256 pattern = _mm256_set1_ps(value);
+    size_t i = 0;
+    for(; i + 8 <= count; i += 8) {
+        int mask = _mm256_movemask_ps(_mm256_cmp_ps(_mm256_loadu_ps(data + i), pattern, _CMP_EQ_OQ));
+        if(mask != 0) {
+            return i + __builtin_ctz(mask);
+        }
+    }
+    return i + find_float_scalar(data + i, count - i, value);
+}
+
+LUAS_TARGET_AVX2
+static size_t count_float_avx2(const float *data, size_t count, float value) {
+    __m256 pattern = _mm256_set1_ps(value);
+    size_t matches = 0;
+    size_t i = 0;
+    for(; i + 8 <= count; i += 8) {
+        matches += __builtin_popcount(_mm256_movemask_ps(_mm256_cmp_ps(_mm256_loadu_ps(data + i), pattern, _CMP_EQ_OQ)));
+    }
+    return matches + count_float_scalar(data + i, count - i, value);
+}
+
+LUAS_TARGET_AVX2
+static void axpy_float_avx2(float *y, const float *x, float k, size_t count) {
+    __m256 vk = _mm256_set1_ps(k);
+    size_t i = 0;
+    for(; i + 8 <= count; i += 8) {
+        _mm256_storeu_ps(y + i, _mm256_add_ps(_mm256_loadu_ps(y + i), _mm256_mul_ps(vk, _mm256_loadu_ps(x + i))));
+    }
+    axpy_float_scalar(y + i, x + i, k, count - i);
+}
+
+LUAS_TARGET_AVX2
+static void mul_float_avx2(float *y, const float *x, size_t count) {
+    size_t i = 0;
+    for(; i + 8 <= count; i += 8) {
+        _mm256_storeu_ps(y + i, _mm256_mul_ps(_mm256_loadu_ps(y + i), _mm256_loadu_ps(x + i)));
+    }
+    mul_float_scalar(y + i, x + i, count - i);
+}
+
+LUAS_TARGET_AVX2
+static void scale_float_avx2(float *y, float k, size_t count) {
+    __m256 vk = _mm256_set1_ps(k);
+    size_t i = 0;
+    for(; i + 8 <= count; i += 8) {
+        _mm256_storeu_ps(y + i, _mm256_mul_ps(_mm256_loadu_ps(y + i), vk));
+    }
+    scale_float_scalar(y + i, k, count - i);
+}
+
+LUAS_TARGET_AVX2
+static void shift_float_avx2(float *y, float c, size_t count) {
+    __m256 vc = _mm256_set1_ps(c);
+    size_t i = 0;
+    for(; i + 8 <= count; i += 8) {
+        _mm256_storeu_ps(y + i, _mm256_add_ps(_mm256_loadu_ps(y + i), vc));
+    }
+    shift_float_scalar(y + i, c, count - i);
+}
+
+LUAS_TARGET_AVX2
+static void clamp_float_avx2(float *y, float lo, float hi, size_t count) {
+    // Operand order keeps NaN elements as they are, like the scalar kernel
+    __m256 vlo = _mm256_set1_ps(lo);
+    __m256 vhi = _mm256_set1_ps(hi);
+    size_t i = 0;
+    for(; i + 8 <= count; i += 8) {
+        _mm256_storeu_ps(y + i, _mm256_min_ps(vhi, _mm256_max_ps(vlo, _mm256_loadu_ps(y + i))));
+    }
+    clamp_float_scalar(y + i, lo, hi, count - i);
+}
+
+LUAS_TARGET_AVX2
+static void lerp_float_avx2(float *y, const float *x, float t, size_t count) {
+    __m256 vt = _mm256_set1_ps(t);
+    size_t i = 0;
+    for(; i + 8 <= count; i += 8) {
+        __m256 vy = _mm256_loadu_ps(y + i);
+        _mm256_storeu_ps(y + i, _mm256_add_ps(vy, _mm256_mul_ps(_mm256_sub_ps(_mm256_loadu_ps(x + i), vy), vt)));
+    }
+    lerp_float_scalar(y + i, x + i, t, count - i);
+}
+
+/* Every CPU with AVX2 also has POPCNT, which the scalar kernel cannot assume */
+__attribute__((target("avx2,popcnt")))
+static uint64_t popcount_avx2(const uint8_t *data, size_t size) {
+    uint64_t count0 = 0;
+    uint64_t count1 = 0;
+    uint64_t count2 = 0;
+    uint64_t count3 = 0;
+    size_t i = 0;
+    for(; i + 32 <= size; i += 32) {
+        count0 += __builtin_popcountll(load_word(data + i));
+        count1 += __builtin_popcountll(load_word(data + i + 8));
+        count2 += __builtin_popcountll(load_word(data + i + 16));
+        count3 += __builtin_popcountll(load_word(data + i + 24));
+    }
+    for(; i + 8 <= size; i += 8) {
+        count0 += __builtin_popcountll(load_word(data + i));
+    }
+    for(; i < size; i++) {
+        count0 += __builtin_popcount(data[i]);
+    }
+    return count0 + count1 + count2 + count3;
+}
+
+LUAS_TARGET_AVX2
+static void combine_bits_avx2(uint8_t *dst, const uint8_t *src, size_t size, LuastructBitOp op) {
+    size_t i = 0;
+    for(; i + 32 <= size; i += 32) {
+        __m256i a = _mm256_loadu_si256((const __m256i *)(dst + i));
+        __m256i b = _mm256_loadu_si256((const __m256i *)(src + i));
+        switch(op) {
+            case LUAS_BITS_AND:
+                a = _mm256_and_si256(a, b);
+                break;
+            case LUAS_BITS_OR:
+                a = _mm256_or_si256(a, b);
+                break;
+            case LUAS_BITS_XOR:
+                a = _mm256_xor_si256(a, b);
+                break;
+            default:
+                a = _mm256_andnot_si256(b, a);
+                break;
+        }
+        _mm256_storeu_si256((__m256i *)(dst + i), a);
+    }
+    combine_bits_scalar(dst + i, src + i, size - i, op);
+}
+
+LUAS_TARGET_AVX2
+static size_t mismatch_avx2(const uint8_t *a, const uint8_t *b, size_t size) {
+    size_t i = 0;
+    // Two vectors per iteration, folded so that equal blocks cost a single test
+    for(; i + 64 <= size; i += 64) {
+        __m256i low = _mm256_cmpeq_epi8(_mm256_loadu_si256((const __m256i *)(a + i)), _mm256_loadu_si256((const __m256i *)(b + i)));
+        __m256i high = _mm256_cmpeq_epi8(_mm256_loadu_si256((const __m256i *)(a + i + 32)), _mm256_loadu_si256((const __m256i *)(b + i + 32)));
+        if((unsigned)_mm256_movemask_epi8(_mm256_and_si256(low, high)) != 0xFFFFFFFFu) {
+            unsigned equal = _mm256_movemask_epi8(low);
+            if(equal != 0xFFFFFFFFu) {
+                return i + __builtin_ctz(~equal);
+            }
+            return i + 32 + __builtin_ctz(~(unsigned)_mm256_movemask_epi8(high));
+        }
+    }
+    for(; i + 32 <= size; i += 32) {
+        unsigned equal = _mm256_movemask_epi8(_mm256_cmpeq_epi8(_mm256_loadu_si256((const __m256i *)(a + i)), _mm256_loadu_si256((const __m256i *)(b + i))));
+        if(equal != 0xFFFFFFFFu) {
+            return i + __builtin_ctz(~equal);
+        }
+    }
+    return i + mismatch_scalar(a + i, b + i, size - i);
+}
+
+#endif
+
+/*
+ * Dispatchers
+ */
+
+#ifdef LUAS_SIMD_X86
+#define SELECT(name) (simd_get_level() == LUAS_SIMD_AVX2 ? name##_avx2 : simd_get_level() == LUAS_SIMD_SSE2 ? name##_sse2 : name##_scalar)
+#define SELECT_AVX2(name) (simd_get_level() == LUAS_SIMD_AVX2 ? name##_avx2 : name##_scalar)
+#else
+#define SELECT(name) name##_scalar
+#define SELECT_AVX2(name) name##_scalar
+#endif
+
+double simd_sum_float(const float *data, size_t count) {
+    return SELECT(sum_float)(data, count);
+}
+
+void simd_minmax_float(const float *data, size_t count, float *min, float *max) {
+    SELECT(minmax_float)(data, count, min, max);
+}
+
+double simd_dot_float(const float *a, const float *b, size_t count) {
+    return SELECT(dot_float)(a, b, count);
+}
+
+int64_t simd_sum_int32(const int32_t *data, size_t count) {
+    return SELECT(sum_int32)(data, count);
+}
+
+void simd_minmax_int32(const int32_t *data, size_t count, int32_t *min, int32_t *max) {
+    SELECT(minmax_int32)(data, count, min, max);
+}
+
+int64_t simd_dot_int32(const int32_t *a, const int32_t *b, size_t count) {
+    /* SSE2 has no signed 32x32->64 multiply, so only AVX2 gets a vector path */
+    return SELECT_AVX2(dot_int32)(a, b, count);
+}
+
+uint64_t simd_sum_int64(const uint64_t *data, size_t count) {
+    return SELECT(sum_int64)(data, count);
+}
+
+void simd_minmax_int64(const int64_t *data, size_t count, int64_t *min, int64_t *max) {
+    /* SSE2 has no 64-bit comparison, so only AVX2 gets a vector path */
+    SELECT_AVX2(minmax_int64)(data, count, min, max);
+}
+
+void simd_minmax_uint64(const uint64_t *data, size_t count, uint64_t *min, uint64_t *max) {
+    SELECT_AVX2(minmax_uint64)(data, count, min, max);
+}
+
+size_t simd_find_equal(const void *data, size_t count, size_t width, const void *value) {
+    return SELECT(find_equal)(data, count, width, value);
+}
+
+size_t simd_count_equal(const void *data, size_t count, size_t width, const void *value) {
+    return SELECT(count_equal)(data, count, width, value);
+}
+
+size_t simd_find_float(const float *data, size_t count, float value) {
+    return SELECT(find_float)(data, count, value);
+}
+
+size_t simd_count_float(const float *data, size_t count, float value) {
+    return SELECT(count_float)(data, count, value);
+}
+
+void simd_axpy_float(float *y, const float *x, float k, size_t count) {
+    SELECT(axpy_float)(y, x, k, count);
+}
+
+void simd_mul_float(float *y, const float *x, size_t count) {
+    SELECT(mul_float)(y, x, count);
+}
+
+void simd_scale_float(float *y, float k, size_t count) {
+    SELECT(scale_float)(y, k, count);
+}
+
+void simd_shift_float(float *y, float c, size_t count) {
+    SELECT(shift_float)(y, c, count);
+}
+
+void simd_clamp_float(float *y, float lo, float hi, size_t count) {
+    SELECT(clamp_float)(y, lo, hi, count);
+}
+
+void simd_lerp_float(float *y, const float *x, float t, size_t count) {
+    SELECT(lerp_float)(y, x, t, count);
+}
+
+uint64_t simd_popcount(const uint8_t *data, size_t size) {
+    return SELECT_AVX2(popcount)(data, size);
+}
+
+void simd_combine_bits(uint8_t *dst, const uint8_t *src, size_t size, LuastructBitOp op) {
+    SELECT(combine_bits)(dst, src, size, op);
+}
+
+size_t simd_mismatch(const uint8_t *a, const uint8_t *b, size_t size) {
+    return SELECT(mismatch)(a, b, size);
+}
@@ -0,0 +1,112 @@
+// SPDX-License-Identifier: GPL-3.0-only
+
+/**
+ * simd.h
+ * Vectorized kernels over contiguous buffers used by the array methods.
+ * Every kernel has a scalar, an SSE2 and an AVX2 implementation; the widest
+ * one supported by the CPU is selected at runtime on the first call.
+ */
+
+#ifndef LUASTRUCT_SIMD_H
+#define LUASTRUCT_SIMD_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define LUAS_SIMD_X86
+#endif
+
+typedef enum LuastructSimdLevel {
+	LUAS_SIMD_SCALAR,
+	LUAS_SIMD_SSE2,
+	LUAS_SIMD_AVX2
+} LuastructSimdLevel;
+
+/**
+ * Get the instruction set used by the kernels.
+ * @return The active SIMD level.
+ */
+LuastructSimdLevel simd_get_level(void);
+
+/**
+ * Force the kernels to use a given instruction set. Levels not supported
+ * by the CPU are clamped to the best supported one.
+ * @param level SIMD level to use.
+ * @return The SIMD level actually selected.
+ */
+LuastructSimdLevel simd_set_level(LuastructSimdLevel level);
+
+/*
+ * The minmax kernels fold the buffer into the values already stored in
+ * min and max, so callers must seed them (usually with the first element).
+ */
+
+double simd_sum_float(const float *data, size_t count);
+void simd_minmax_float(const float *data, size_t count, float *min, float *max);
+double simd_dot_float(const float *a, const float *b, size_t count);
+
+int64_t simd_sum_int32(const int32_t *data, size_t count);
+void simd_minmax_int32(const int32_t *data, size_t count, int32_t *min, int32_t *max);
+int64_t simd_dot_int32(const int32_t *a, const int32_t *b, size_t count);
+
+/*
+ * 64-bit integer kernels. The sum wraps around modulo 2^64, which makes it
+ * the same for int64 and uint64 elements.
+ */
+
+uint64_t simd_sum_int64(const uint64_t *data, size_t count);
+void simd_minmax_int64(const int64_t *data, size_t count, int64_t *min, int64_t *max);
+void simd_minmax_uint64(const uint64_t *data, size_t count, uint64_t *min, uint64_t *max);
+
+/*
+ * Search kernels. Elements are compared bitwise against the width bytes
+ * at value; width must be 1, 2, 4 or 8. The float variants use IEEE
+ * equality instead, so 0.0 matches -0.0 and NaN matches nothing. The find
+ * kernels return count when there is no match.
+ */
+
+size_t simd_find_equal(const void *data, size_t count, size_t width, const void *value);
+size_t simd_count_equal(const void *data, size_t count, size_t width, const void *value);
+size_t simd_find_float(const float *data, size_t count, float value);
+size_t simd_count_float(const float *data, size_t count, float value);
+
+/*
+ * Element-wise kernels. They update y in place and compute in single
+ * precision: axpy is y += k * x, mul is y *= x, scale is y *= k, shift is
+ * y += c, clamp limits y to [lo, hi] leaving NaN as is, and lerp is
+ * y += (x - y) * t. x may be equal to y but must not partially overlap it.
+ */
+
+void simd_axpy_float(float *y, const float *x, float k, size_t count);
+void simd_mul_float(float *y, const float *x, size_t count);
+void simd_scale_float(float *y, float k, size_t count);
+void simd_shift_float(float *y, float c, size_t count);
+void simd_clamp_float(float *y, float lo, float hi, size_t count);
+void simd_lerp_float(float *y, const float *x, float t, size_t count);
+
+/*
+ * Bit kernels over packed bytes, processed 64 bits or more at a time.
+ * popcount counts the set bits of size bytes. combine_bits updates dst in
+ * place with dst & src, dst | src, dst ^ src or dst & ~src; src may be
+ * equal to dst but must not partially overlap it.
+ */
+
+typedef enum LuastructBitOp {
+	LUAS_BITS_AND,
+	LUAS_BITS_OR,
+	LUAS_BITS_XOR,
+	LUAS_BITS_ANDNOT
+} LuastructBitOp;
+
+uint64_t simd_popcount(const uint8_t *data, size_t size);
+void simd_combine_bits(uint8_t *dst, const uint8_t *src, size_t size, LuastructBitOp op);
+
+/*
+ * Comparison kernel. mismatch returns the offset of the first byte that
+ * differs between the size bytes of a and b, or size if they are equal.
+ */
+
+size_t simd_mismatch(const uint8_t *a, const uint8_t *b, size_t size);
+
+#endif
@@ -8,11 +8,16 @@
 const char *types_registry_name = "luastruct_types";
 
 int luastruct_new_array(lua_State *state, void *data, LuastructArrayDesc *array_info);
+void copy_array_desc(const LuastructArrayDesc *source, LuastructArrayDesc *desc);
+size_t checked_mul_size(lua_State *state, size_t count, size_t size);
 
 static void free_struct_fields_recursively(LuastructStructField *field) {
     if(field->next_by_offset) {
         free_struct_fields_recursively(field->next_by_offset);
     }
+    if(field->type == LUAST_ARRAY) {
+        luastruct_free_array_desc(&field->array);
+    }
     free(field);
 }
 
@@ -112,6 +117,20 @@ size_t get_type_size(lua_State *state, LuastructType type, void *type_info) {
             LuastructStruct *st = type_info;
             return st->size;
         }
+        case LUAST_ARRAY: {
+            if(type_info == NULL) {
+                return luaL_error(state, "Type info is NULL");
+            }
+            LuastructArrayDesc *inner = type_info;
+            if(inner->count_getter) {
+                return luaL_error(state, "Dynamic arrays have no fixed size");
+            }
+            if(inner->elements_type == LUAST_BITFIELD) {
+                return inner->array_size / 8 + (inner->array_size % 8 != 0);
+            }
+            size_t elements_size = inner->elements_are_pointers ? sizeof(void *) : get_type_size(state, inner->elements_type, inner->elements_type_info);
+            return checked_mul_size(state, inner->array_size, elements_size);
+        }
         case LUAST_ENUM: {
             if(type_info == NULL) {
                 return luaL_error(state, "Type info is NULL");
@@ -128,6 +147,8 @@ size_t get_type_size(lua_State *state, LuastructType type, void *type_info) {
                     return luaL_error(state, "Invalid enum type");
             }
         }
+        case LUAST_BITFIELD:
+            return luaL_error(state, "Packed bits have no element size");
         default:
             return luaL_error(state, "Invalid type for size: %d", type);
     }
@@ -140,11 +161,32 @@ int luastruct_get_types_registry(lua_State *state) {
         lua_newtable(state);
         lua_pushvalue(state, -1);
         lua_setfield(state, LUA_REGISTRYINDEX, types_registry_name);
-        lua_getfield(state, LUA_REGISTRYINDEX, types_registry_name);
     }
     return 1;
 }
 
+static int struct_newarray(lua_State *state) {
+    // Accept both Type.newarray(n) and Type:newarray(n)
+    if(lua_rawequal(state, 1, lua_upvalueindex(1))) {
+        lua_remove(state, 1);
+    }
+    lua_pushvalue(state, lua_upvalueindex(1));
+    lua_insert(state, 1);
+    return luastruct_newarray(state);
+}
+
+int luastruct_struct__index(lua_State *state) {
+    luastruct_check_struct(state, 1);
+    const char *key = luaL_checkstring(state, 2);
+    if(strcmp(key, "newarray") == 0) {
+        lua_pushvalue(state, 1);
+        lua_pushcclosure(state, struct_newarray, 1);
+        return 1;
+    }
+    lua_pushnil(state);
+    return 1;
+}
+
 int luastruct_struct__gc(lua_State *state) {
     LuastructStruct *st = luaL_checkudata(state, 1, STRUCT_METATABLE_NAME);
     if(!st) {
@@ -186,6 +228,8 @@ int luastruct_new_struct(lua_State *state, const char *name, const char *super_n
     if(metatable != 0) {
         lua_pushcfunction(state, luastruct_struct__gc);
         lua_setfield(state, -2, "__gc");
+        lua_pushcfunction(state, luastruct_struct__index);
+        lua_setfield(state, -2, "__index");
     }
     lua_setmetatable(state, -2);
 
@@ -219,6 +263,7 @@ void luastruct_new_struct_field(lua_State *state, const char *name, LuastructTyp
     field.offset = offset;
     field.pointer = pointer;
     field.readonly = readonly;
+    field.overflow = LUAS_OVERFLOW_WRAP;
 
     if(type == LUAST_STRUCT || type == LUAST_ENUM) {
         if(!type_name) {
@@ -249,7 +294,7 @@ void luastruct_new_struct_array_field(lua_State *state, const char *name, Luastr
         luaL_error(state, "Array info is NULL");
     }
 
-    if(array_info->count_getter == NULL && array_info->array_size == 0) {
+    if(array_info->count_getter == NULL && array_info->vector == NULL && array_info->ring == NULL && array_info->list == NULL && array_info->map == NULL && array_info->array_size == 0) {
         luaL_error(state, "Array info is invalid");
     }
 
@@ -261,7 +306,9 @@ void luastruct_new_struct_array_field(lua_State *state, const char *name, Luastr
     field.offset = offset;
     field.pointer = pointer;
     field.readonly = readonly;
-    field.array = *array_info;
+    field.overflow = LUAS_OVERFLOW_WRAP;
+    // Each field owns its copy, so one descriptor can be used for several fields
+    copy_array_desc(array_info, &field.array);
 
     insert_struct_field(st, &field);
 }
@@ -305,6 +352,7 @@ void luastruct_new_struct_bit_field(lua_State *state, const char *name, Luastruc
     field.offset = offset;
     field.pointer = pointer;
     field.readonly = readonly;
+    field.overflow = LUAS_OVERFLOW_WRAP;
     field.bitfield.size = size;
     field.bitfield.offset = bit_offset;
 
@@ -312,3 +360,35 @@ void luastruct_new_struct_bit_field(lua_State *state, const char *name, Luastruc
 }
 
 
+
+void luastruct_set_field_overflow(lua_State *state, const char *name, LuastructOverflow overflow) {
+    LuastructStruct *st = luastruct_check_struct(state, -1);
+    if(!st) {
+        luaL_error(state, "Invalid struct object");
+    }
+
+    LuastructStructField *field = st->fields_by_name;
+    while(field && strcmp(field->field_name, name) != 0) {
+        field = field->next_by_name;
+    }
+    if(!field) {
+        luaL_error(state, "Struct %s has no field \"%s\"", st->type_info.name, name);
+        return;
+    }
+    if(field->type == LUAST_UINT64) {
+        field->overflow = overflow;
+        return;
+    }
+    if(field->type == LUAST_ARRAY) {
+        // Rows of nested arrays are read through the descriptor of the innermost arrays
+        LuastructArrayDesc *desc = &field->array;
+        while(desc->elements_type == LUAST_ARRAY) {
+            desc = desc->elements_type_info;
+        }
+        if(desc->elements_type == LUAST_UINT64) {
+            desc->overflow = overflow;
+            return;
+        }
+    }
+    luaL_error(state, "Field \"%s\" is not of type uint64", name);
+}
@@ -0,0 +1,206 @@
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <check.h>
+#include <lua.h>
+#include <lualib.h>
+#include <lauxlib.h>
+#include "test_array.h"
+#include "debug.h"
+
+#define PLAYER_COUNT 1000
+
+typedef struct Player {
+    uint8_t team;
+    int16_t class_id;
+    int32_t kills;
+    float score;
+    bool bot;
+} Player;
+
+typedef struct Match {
+    int32_t round;
+    Player players[PLAYER_COUNT];
+    Player *player_pointers[PLAYER_COUNT];
+} Match;
+
+static lua_State *state = NULL;
+static TestStruct test_struct;
+static Match *match;
+
+void setup(void) {
+    state = luaL_newstate();
+    luaL_openlibs(state);
+    init_test_struct(&test_struct);
+    define_test_struct(state);
+
+    LUAS_STRUCT(state, Player);
+    LUAS_PRIMITIVE_FIELD(state, Player, team, LUAST_UINT8, 0);
+    LUAS_PRIMITIVE_FIELD(state, Player, class_id, LUAST_INT16, 0);
+    LUAS_PRIMITIVE_FIELD(state, Player, kills, LUAST_INT32, 0);
+    LUAS_PRIMITIVE_FIELD(state, Player, score, LUAST_FLOAT, 0);
+    LUAS_PRIMITIVE_FIELD(state, Player, bot, LUAST_BOOL, 0);
+    lua_pop(state, 1);
+
+    LUAS_STRUCT(state, Match);
+    LUAS_OBJREF_ARRAY_FIELD(state, Match, players, Player, 0);
+    LUAS_OBJREF_ARRAY_FIELD(state, Match, player_pointers, Player, LUAS_FIELD_POINTER);
+    lua_pop(state, 1);
+
+    match = calloc(1, sizeof(Match));
+    for(int i = 0; i < PLAYER_COUNT; i++) {
+        Player *player = &match->players[i];
+        player->team = i % 4;
+        player->class_id = (i * 7) % 100 - 50;
+        player->kills = i % 13;
+        player->score = (i % 8) * 0.5f;
+        player->bot = i % 5 == 0;
+        match->player_pointers[i] = player;
+    }
+
+    LUAS_OBJECT(state, TestStruct, &test_struct, false);
+}
+
+void teardown(void) {
+    lua_gc(state, LUA_GCCOLLECT, 0);
+    lua_close(state);
+    state = NULL;
+    free(match);
+}
+
+static int run(const char *statement, bool use_match) {
+    char script[2048];
+    snprintf(script, sizeof(script), "function test(obj) %s end", statement);
+    int res = luaL_dostring(state, script);
+    lua_getglobal(state, "test");
+    if(use_match) {
+        LUAS_OBJECT(state, Match, match, false);
+    }
+    else {
+        lua_pushvalue(state, -2);
+    }
+    res = lua_pcall(state, 1, 0, 0);
+    if(res != LUA_OK) {
+        lua_pop(state, 1);
+    }
+    return res;
+}
+
+START_TEST(test_aggregate_by_team) {
+    ck_assert_int_eq(run(
+        "local stats = obj.players:aggregate{ by = 'team', sum = 'score', count = true, max = 'kills' } "
+        "local expected = {} "
+        "for i = 1, #obj.players do "
+        "  local p = obj.players[i] "
+        "  local e = expected[p.team] or { count = 0, sum = 0, max = -1 } "
+        "  e.count = e.count + 1 "
+        "  e.sum = e.sum + p.score "
+        "  e.max = math.max(e.max, p.kills) "
+        "  expected[p.team] = e "
+        "end "
+        "local groups = 0 "
+        "for team, e in pairs(expected) do "
+        "  local s = stats[team] "
+        "  assert(s.count == e.count and s.sum == e.sum and s.max == e.max) "
+        "  assert(math.type(s.max) == 'integer' and s.min == nil and s.mean == nil) "
+        "  groups = groups + 1 "
+        "end "
+        "for _ in pairs(stats) do groups = groups - 1 end "
+        "assert(groups == 0) ",
+        true), LUA_OK);
+}
+END_TEST
+
+START_TEST(test_aggregate_many_groups) {
+    ck_assert_int_eq(run(
+        "local stats = obj.player_pointers:aggregate{ by = 'class_id', sum = { 'kills', 'score' }, min = 'kills', mean = 'kills' } "
+        "local n = 0 "
+        "for class_id, s in pairs(stats) do "
+        "  n = n + 1 "
+        "  local count, kills, score, min = 0, 0, 0, math.huge "
+        "  for i = 1, #obj.players do "
+        "    local p = obj.players[i] "
+        "    if p.class_id == class_id then "
+        "      count = count + 1 "
+        "      kills = kills + p.kills "
+        "      score = score + p.score "
+        "      min = math.min(min, p.kills) "
+        "    end "
+        "  end "
+        "  assert(s.count == nil) "
+        "  assert(s.sum.kills == kills and s.sum.score == score and s.min == min) "
+        "  assert(math.abs(s.mean - kills / count) < 1e-9) "
+        "end "
+        "assert(n == 100) ",
+        true), LUA_OK);
+}
+END_TEST
+
+START_TEST(test_aggregate_keys) {
+    ck_assert_int_eq(run(
+        "local by_bot = obj.players:aggregate{ by = 'bot', count = true } "
+        "assert(by_bot[true].count == 200 and by_bot[false].count == 800) "
+        "local by_score = obj.players:aggregate{ by = 'score', count = true, sum = 'kills' } "
+        "assert(by_score[0.5].count == 125 and by_score[3.5].count == 125) "
+        "local total = obj.players:aggregate{ count = true, sum = 'kills', max = 'score' } "
+        "assert(total.count == 1000 and total.max == 3.5) ",
+        true), LUA_OK);
+
+    int32_t values[5] = { 5, -1, 3, 3, 0 };
+    for(int i = 0; i < 5; i++) {
+        test_struct.static_int32[i] = values[i];
+    }
+    ck_assert_int_eq(run(
+        "local total = obj.static_int32:aggregate{ count = true, sum = true, min = true } "
+        "assert(total.count == 5 and total.sum == 10 and total.min == -1) "
+        "local by_value = obj.static_int32:aggregate{ by = true, count = true, sum = true } "
+        "assert(by_value[3].count == 2 and by_value[3].sum == 6 and by_value[-1].sum == -1) ",
+        false), LUA_OK);
+}
+END_TEST
+
+START_TEST(test_aggregate_errors) {
+    ck_assert_int_ne(run("obj.players:aggregate()", true), LUA_OK);
+    ck_assert_int_ne(run("obj.players:aggregate{ by = 'missing' }", true), LUA_OK);
+    ck_assert_int_ne(run("obj.players:aggregate{ by = 'team', sum = 'missing' }", true), LUA_OK);
+    ck_assert_int_ne(run("obj.players:aggregate{ by = 'team', median = 'kills' }", true), LUA_OK);
+    ck_assert_int_ne(run("obj.players:aggregate{ 'team' }", true), LUA_OK);
+    ck_assert_int_ne(run("obj.players:aggregate{ by = true }", true), LUA_OK);
+}
+END_TEST
+
+Suite *create_suite(void) {
+    Suite *s = suite_create("array_aggregate_method");
+
+    TCase *groups = tcase_create("groups");
+    tcase_add_checked_fixture(groups, setup, teardown);
+    tcase_add_test(groups, test_aggregate_by_team);
+    tcase_add_test(groups, test_aggregate_many_groups);
+    tcase_add_test(groups, test_aggregate_keys);
+    suite_add_tcase(s, groups);
+
+    TCase *errors = tcase_create("errors");
+    tcase_add_checked_fixture(errors, setup, teardown);
+    tcase_add_test(errors, test_aggregate_errors);
+    suite_add_tcase(s, errors);
+
+    return s;
+}
+
+int main(int argc, char *argv[]) {
+    Suite *s = create_suite();
+    SRunner *sr = srunner_create(s);
+
+    if(argc > 1) {
+        srunner_run(sr, NULL, argv[1], CK_NORMAL);
+    }
+    else {
+        srunner_run_all(sr, CK_NORMAL);
+    }
+
+    int number_failed = srunner_ntests_failed(sr);
+    srunner_free(sr);
+
+    return (number_failed == 0) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,245 @@
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <check.h>
+#include <lua.h>
+#include <lualib.h>
+#include <lauxlib.h>
+#include "test_array.h"
+#include "simd.h"
+#include "debug.h"
+
+#define BIT_COUNT 1000
+#define WORD_COUNT ((BIT_COUNT + 63) / 64)
+
+typedef struct Visibility {
+    int32_t version;
+    uint64_t visible[WORD_COUNT];
+    uint64_t hidden[WORD_COUNT];
+    uint64_t locked[WORD_COUNT];
+    uint8_t small[2];
+    bool flags[BIT_COUNT];
+} Visibility;
+
+static lua_State *state = NULL;
+static TestStruct test_struct;
+static Visibility *visibility;
+
+static bool get_bit(const uint64_t *words, size_t i) {
+    return (words[i / 64] >> (i % 64)) & 1;
+}
+
+void setup(void) {
+    state = luaL_newstate();
+    luaL_openlibs(state);
+    init_test_struct(&test_struct);
+    define_test_struct(state);
+
+    LUAS_STRUCT(state, Visibility);
+    LUAS_BIT_ARRAY_FIELD(state, Visibility, visible, BIT_COUNT, 0);
+    LUAS_BIT_ARRAY_FIELD(state, Visibility, hidden, BIT_COUNT, 0);
+    LUAS_BIT_ARRAY_FIELD(state, Visibility, locked, BIT_COUNT, LUAS_FIELD_READONLY);
+    LUAS_BIT_ARRAY_FIELD(state, Visibility, small, 11, 0);
+    LUAS_PRIMITIVE_ARRAY_FIELD(state, Visibility, flags, LUAST_BOOL, 0);
+    lua_pop(state, 1);
+
+    visibility = calloc(1, sizeof(Visibility));
+    for(size_t i = 0; i < BIT_COUNT; i++) {
+        if(i % 3 == 0) {
+            visibility->visible[i / 64] |= UINT64_C(1) << (i % 64);
+        }
+        if(i % 5 == 0) {
+            visibility->hidden[i / 64] |= UINT64_C(1) << (i % 64);
+        }
+        visibility->flags[i] = i % 7 == 0;
+    }
+    // Bits past the end of the arrays must never be read or written
+    visibility->visible[WORD_COUNT - 1] |= ~UINT64_C(0) << (BIT_COUNT % 64);
+    visibility->hidden[WORD_COUNT - 1] |= ~UINT64_C(0) << (BIT_COUNT % 64);
+    visibility->locked[3] = 0x10;
+
+    LUAS_OBJECT(state, TestStruct, &test_struct, false);
+}
+
+void teardown(void) {
+    simd_set_level(LUAS_SIMD_AVX2);
+    lua_gc(state, LUA_GCCOLLECT, 0);
+    lua_close(state);
+    state = NULL;
+    free(visibility);
+}
+
+static int run(const char *statement, bool use_visibility) {
+    char script[2048];
+    snprintf(script, sizeof(script), "function test(obj) %s end", statement);
+    int res = luaL_dostring(state, script);
+    lua_getglobal(state, "test");
+    if(use_visibility) {
+        LUAS_OBJECT(state, Visibility, visibility, false);
+    }
+    else {
+        lua_pushvalue(state, -2);
+    }
+    res = lua_pcall(state, 1, 0, 0);
+    if(res != LUA_OK) {
+        lua_pop(state, 1);
+    }
+    return res;
+}
+
+START_TEST(test_bit_indexing) {
+    ck_assert_int_eq(run(
+        "local visible = obj.visible "
+        "assert(#visible == 1000) "
+        "assert(visible[1] == true and visible[2] == false and visible[4] == true) "
+        "assert(visible[1000] == true and visible[1001] == nil and visible[0] == nil) "
+        "visible[2] = true "
+        "visible[1] = false "
+        "visible[1000] = nil "
+        "local n = 0 "
+        "for i, bit in pairs(obj.small) do n = n + 1 assert(bit == false) end "
+        "assert(n == 11) "
+        "obj.small[11] = 1 "
+        "assert(obj.small:at(11) == true and obj.locked[197] == true) ",
+        true), LUA_OK);
+    ck_assert(!get_bit(visibility->visible, 0));
+    ck_assert(get_bit(visibility->visible, 1));
+    ck_assert(!get_bit(visibility->visible, 999));
+    ck_assert(get_bit(visibility->visible, 1000));
+    ck_assert_int_eq(visibility->small[1], 0x04);
+
+    ck_assert_int_ne(run("obj.visible[1001] = true", true), LUA_OK);
+    ck_assert_int_ne(run("obj.locked[1] = true", true), LUA_OK);
+    ck_assert_int_ne(run("obj.visible:view(1, 64)", true), LUA_OK);
+    ck_assert_int_ne(run("obj.visible:sum()", true), LUA_OK);
+}
+END_TEST
+
+static void check_popcount(void) {
+    ck_assert_int_eq(run(
+        "assert(obj.visible:popcount() == 334) "
+        "assert(obj.hidden:popcount() == 200) "
+        "assert(obj.small:popcount() == 0 and obj.locked:popcount() == 1) "
+        "assert(obj.visible:first_set() == 1 and obj.visible:first_set(2) == 4) "
+        "assert(obj.hidden:first_set(997) == nil) "
+        "assert(obj.locked:first_set() == 197 and obj.locked:first_set(198) == nil) "
+        "assert(obj.small:first_set() == nil and obj.visible:first_set(5000) == nil) ",
+        true), LUA_OK);
+}
+
+START_TEST(test_popcount_scalar) {
+    simd_set_level(LUAS_SIMD_SCALAR);
+    check_popcount();
+}
+END_TEST
+
+START_TEST(test_popcount_avx2) {
+    simd_set_level(LUAS_SIMD_AVX2);
+    check_popcount();
+}
+END_TEST
+
+static void check_combine(LuastructSimdLevel level) {
+    simd_set_level(level);
+    ck_assert_int_eq(run(
+        "local visible, hidden = obj.visible, obj.hidden "
+        "visible:bor(hidden) "
+        "assert(visible:popcount() == 334 + 200 - 67) "
+        "visible:band(hidden) "
+        "assert(visible:popcount() == 200) "
+        "visible:bxor(obj.locked) "
+        "assert(visible:popcount() == 201 and visible[197]) "
+        "visible:bandnot(hidden):bandnot(obj.locked) "
+        "assert(visible:popcount() == 0 and visible:first_set() == nil) "
+        "hidden:bxor(hidden) "
+        "assert(hidden:popcount() == 0) ",
+        true), LUA_OK);
+    // The bits sharing the last word with the arrays are untouched
+    ck_assert_uint_eq(visibility->visible[WORD_COUNT - 1] >> (BIT_COUNT % 64), ~UINT64_C(0) >> (BIT_COUNT % 64));
+    ck_assert_uint_eq(visibility->hidden[WORD_COUNT - 1] >> (BIT_COUNT % 64), ~UINT64_C(0) >> (BIT_COUNT % 64));
+    ck_assert_uint_eq(visibility->visible[0], 0);
+}
+
+START_TEST(test_combine_scalar) {
+    check_combine(LUAS_SIMD_SCALAR);
+}
+END_TEST
+
+START_TEST(test_combine_sse2) {
+    check_combine(LUAS_SIMD_SSE2);
+}
+END_TEST
+
+START_TEST(test_combine_avx2) {
+    check_combine(LUAS_SIMD_AVX2);
+}
+END_TEST
+
+START_TEST(test_bool_conversions) {
+    ck_assert_int_eq(run(
+        "obj.visible:frombools(obj.flags) "
+        "assert(obj.visible:popcount() == obj.flags:count(true)) "
+        "for i = 1, 1000 do assert(obj.visible[i] == obj.flags[i]) end "
+        "obj.visible[2] = true "
+        "local flags = obj.visible:bxor(obj.hidden):tobools(obj.flags) "
+        "assert(#flags == 1000 and flags[1] == obj.flags[1]) "
+        "for i = 1, 1000 do assert(flags[i] == (((i - 1) % 7 == 0 or i == 2) ~= ((i - 1) % 5 == 0))) end ",
+        true), LUA_OK);
+    ck_assert_uint_eq(visibility->visible[WORD_COUNT - 1] >> (BIT_COUNT % 64), ~UINT64_C(0) >> (BIT_COUNT % 64));
+
+    ck_assert_int_ne(run("obj.small:frombools(obj.flags)", true), LUA_OK);
+    ck_assert_int_ne(run("obj.locked:frombools(obj.flags)", true), LUA_OK);
+    ck_assert_int_ne(run("obj.visible:frombools(obj.visible)", true), LUA_OK);
+    ck_assert_int_ne(run("obj.flags:popcount()", true), LUA_OK);
+    ck_assert_int_ne(run("obj.small:band(obj.visible)", true), LUA_OK);
+    ck_assert_int_ne(run("obj.locked:bor(obj.visible)", true), LUA_OK);
+    ck_assert_int_ne(run("obj.visible:first_set(0)", true), LUA_OK);
+}
+END_TEST
+
+Suite *create_suite(void) {
+    Suite *s = suite_create("array_bits");
+
+    TCase *indexing = tcase_create("indexing");
+    tcase_add_checked_fixture(indexing, setup, teardown);
+    tcase_add_test(indexing, test_bit_indexing);
+    suite_add_tcase(s, indexing);
+
+    TCase *popcount = tcase_create("popcount");
+    tcase_add_checked_fixture(popcount, setup, teardown);
+    tcase_add_test(popcount, test_popcount_scalar);
+    tcase_add_test(popcount, test_popcount_avx2);
+    suite_add_tcase(s, popcount);
+
+    TCase *combine = tcase_create("combine");
+    tcase_add_checked_fixture(combine, setup, teardown);
+    tcase_add_test(combine, test_combine_scalar);
+    tcase_add_test(combine, test_combine_sse2);
+    tcase_add_test(combine, test_combine_avx2);
+    suite_add_tcase(s, combine);
+
+    TCase *conversions = tcase_create("conversions");
+    tcase_add_checked_fixture(conversions, setup, teardown);
+    tcase_add_test(conversions, test_bool_conversions);
+    suite_add_tcase(s, conversions);
+
+    return s;
+}
+
+int main(int argc, char *argv[]) {
+    Suite *s = create_suite();
+    SRunner *sr = srunner_create(s);
+
+    if(argc > 1) {
+        srunner_run(sr, NULL, argv[1], CK_NORMAL);
+    }
+    else {
+        srunner_run_all(sr, CK_NORMAL);
+    }
+
+    int number_failed = srunner_ntests_failed(sr);
+    srunner_free(sr);
+
+    return (number_failed == 0) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
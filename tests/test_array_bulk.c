@@ -0,0 +1,230 @@
+#include <stdlib.h>
+#include <stdint.h>
+#include <check.h>
+#include <lua.h>
+#include <lualib.h>
+#include <lauxlib.h>
+#include "test_array.h"
+#include "debug.h"
+
+static lua_State *state = NULL;
+static TestStruct test_struct;
+
+void setup(void) {
+    state = luaL_newstate();
+    init_test_struct(&test_struct);
+    define_test_struct(state);
+    LUAS_OBJECT(state, TestStruct, &test_struct, false);
+}
+
+void teardown(void) {
+    lua_gc(state, LUA_GCCOLLECT, 0);
+    lua_close(state);
+    state = NULL;
+}
+
+static int run_test_function(const char *script) {
+    int res = luaL_dostring(state, script);
+    lua_getglobal(state, "test");
+    lua_pushvalue(state, -2);
+    res = lua_pcall(state, 1, 0, 0);
+    if(res != LUA_OK) {
+        lua_pop(state, 1);
+    }
+    return res;
+}
+
+START_TEST(test_assign_static_int32) {
+    ck_assert_int_eq(run_test_function("function test(obj) obj.static_int32:assign({ 1, -2, 3, 2147483647, 5 }) end"), LUA_OK);
+    ck_assert_int_eq(test_struct.static_int32[0], 1);
+    ck_assert_int_eq(test_struct.static_int32[1], -2);
+    ck_assert_int_eq(test_struct.static_int32[2], 3);
+    ck_assert_int_eq(test_struct.static_int32[3], INT32_MAX);
+    ck_assert_int_eq(test_struct.static_int32[4], 5);
+}
+END_TEST
+
+START_TEST(test_assign_partial) {
+    test_struct.static_uint8[3] = 42;
+    ck_assert_int_eq(run_test_function("function test(obj) obj.static_uint8:assign({ 7, 8 }) end"), LUA_OK);
+    ck_assert_int_eq(test_struct.static_uint8[0], 7);
+    ck_assert_int_eq(test_struct.static_uint8[1], 8);
+    ck_assert_int_eq(test_struct.static_uint8[3], 42);
+}
+END_TEST
+
+START_TEST(test_assign_dynamic_float) {
+    ck_assert_int_eq(run_test_function("function test(obj) obj.dynamic_number:assign({ 0.5, 1.5, 2.5, 3.5, 4.5 }) end"), LUA_OK);
+    for(int i = 0; i < 5; i++) {
+        ck_assert_float_eq(test_struct.dynamic_number[i], i + 0.5f);
+    }
+}
+END_TEST
+
+START_TEST(test_assign_boolean) {
+    ck_assert_int_eq(run_test_function("function test(obj) obj.static_boolean:assign({ true, false, true, false, true }) end"), LUA_OK);
+    for(int i = 0; i < 5; i++) {
+        ck_assert_int_eq(test_struct.static_boolean[i], i % 2 == 0);
+    }
+}
+END_TEST
+
+START_TEST(test_assign_value_out_of_range) {
+    ck_assert_int_ne(run_test_function("function test(obj) obj.static_int8:assign({ 1, 2, 128 }) end"), LUA_OK);
+    ck_assert_int_ne(run_test_function("function test(obj) obj.static_uint16:assign({ -1 }) end"), LUA_OK);
+    ck_assert_int_ne(run_test_function("function test(obj) obj.static_int32:assign({ 1, 'a' }) end"), LUA_OK);
+    // Nothing is written when any value is invalid
+    for(int i = 0; i < 5; i++) {
+        ck_assert_int_eq(test_struct.static_int8[i], 0);
+        ck_assert_int_eq(test_struct.static_int32[i], 0);
+    }
+}
+END_TEST
+
+START_TEST(test_write_all_or_nothing) {
+    test_struct.static_sub_struct[0].a = 5;
+    ck_assert_int_ne(run_test_function("function test(obj) obj.dynamic_number:assign({ 1.5, 2.5, {} }) end"), LUA_OK);
+    ck_assert_int_ne(run_test_function("function test(obj) obj.static_int16:setrange(2, 1, 2, 3, 40000) end"), LUA_OK);
+    ck_assert_int_ne(run_test_function("function test(obj) obj.static_sub_struct:assign({ obj.static_sub_struct[1], obj.static_sub_struct[1], 3 }) end"), LUA_OK);
+    for(int i = 0; i < 5; i++) {
+        ck_assert_float_eq(test_struct.dynamic_number[i], 0.0f);
+        ck_assert_int_eq(test_struct.static_int16[i], 0);
+    }
+    ck_assert_int_eq(test_struct.static_sub_struct[1].a, 0);
+
+    // Objects are read before any element is stored, so a swap keeps both values
+    ck_assert_int_eq(run_test_function("function test(obj) local s = obj.static_sub_struct s:assign({ s[2], s[1] }) end"), LUA_OK);
+    ck_assert_int_eq(test_struct.static_sub_struct[0].a, 0);
+    ck_assert_int_eq(test_struct.static_sub_struct[1].a, 5);
+}
+END_TEST
+
+START_TEST(test_fill_static_int16) {
+    ck_assert_int_eq(run_test_function("function test(obj) obj.static_int16:fill(-1234) end"), LUA_OK);
+    for(int i = 0; i < 5; i++) {
+        ck_assert_int_eq(test_struct.static_int16[i], -1234);
+    }
+}
+END_TEST
+
+START_TEST(test_fill_zero) {
+    for(int i = 0; i < 5; i++) {
+        test_struct.dynamic_uint32[i] = 0xDEADBEEF;
+    }
+    ck_assert_int_eq(run_test_function("function test(obj) obj.dynamic_uint32:fill(0) end"), LUA_OK);
+    for(int i = 0; i < 5; i++) {
+        ck_assert_int_eq(test_struct.dynamic_uint32[i], 0);
+    }
+}
+END_TEST
+
+START_TEST(test_fill_range) {
+    ck_assert_int_eq(run_test_function("function test(obj) obj.static_number:fill(2.25, 2, 4) end"), LUA_OK);
+    ck_assert_float_eq(test_struct.static_number[0], 0.0f);
+    ck_assert_float_eq(test_struct.static_number[1], 2.25f);
+    ck_assert_float_eq(test_struct.static_number[2], 2.25f);
+    ck_assert_float_eq(test_struct.static_number[3], 2.25f);
+    ck_assert_float_eq(test_struct.static_number[4], 0.0f);
+}
+END_TEST
+
+START_TEST(test_fill_value_out_of_range) {
+    ck_assert_int_ne(run_test_function("function test(obj) obj.static_uint8:fill(256) end"), LUA_OK);
+    for(int i = 0; i < 5; i++) {
+        ck_assert_int_eq(test_struct.static_uint8[i], 0);
+    }
+}
+END_TEST
+
+START_TEST(test_setrange_static_int32) {
+    ck_assert_int_eq(run_test_function("function test(obj) obj.static_int32:setrange(2, 10, 20, 30) end"), LUA_OK);
+    ck_assert_int_eq(test_struct.static_int32[0], 0);
+    ck_assert_int_eq(test_struct.static_int32[1], 10);
+    ck_assert_int_eq(test_struct.static_int32[2], 20);
+    ck_assert_int_eq(test_struct.static_int32[3], 30);
+    ck_assert_int_eq(test_struct.static_int32[4], 0);
+}
+END_TEST
+
+START_TEST(test_setrange_dynamic_int8) {
+    ck_assert_int_eq(run_test_function("function test(obj) obj.dynamic_int8:setrange(4, -128, 127) end"), LUA_OK);
+    ck_assert_int_eq(test_struct.dynamic_int8[3], INT8_MIN);
+    ck_assert_int_eq(test_struct.dynamic_int8[4], INT8_MAX);
+}
+END_TEST
+
+START_TEST(test_assign_out_of_bounds) {
+    ck_assert_int_ne(run_test_function("function test(obj) obj.static_int32:assign({ 1, 2, 3, 4, 5, 6 }) end"), LUA_OK);
+    ck_assert_int_eq(test_struct.static_int32[0], 0);
+}
+END_TEST
+
+START_TEST(test_fill_out_of_bounds) {
+    ck_assert_int_ne(run_test_function("function test(obj) obj.static_int32:fill(1, 0, 2) end"), LUA_OK);
+    ck_assert_int_ne(run_test_function("function test(obj) obj.static_int32:fill(1, 4, 6) end"), LUA_OK);
+    for(int i = 0; i < 5; i++) {
+        ck_assert_int_eq(test_struct.static_int32[i], 0);
+    }
+}
+END_TEST
+
+START_TEST(test_setrange_out_of_bounds) {
+    ck_assert_int_ne(run_test_function("function test(obj) obj.static_int32:setrange(5, 1, 2) end"), LUA_OK);
+    ck_assert_int_ne(run_test_function("function test(obj) obj.static_int32:setrange(0, 1) end"), LUA_OK);
+    ck_assert_int_eq(test_struct.static_int32[4], 0);
+}
+END_TEST
+
+Suite *create_suite(void) {
+    Suite *s = suite_create("array_bulk_methods");
+
+    TCase *assign = tcase_create("assign");
+    tcase_add_checked_fixture(assign, setup, teardown);
+    tcase_add_test(assign, test_assign_static_int32);
+    tcase_add_test(assign, test_assign_partial);
+    tcase_add_test(assign, test_assign_dynamic_float);
+    tcase_add_test(assign, test_assign_boolean);
+    tcase_add_test(assign, test_assign_value_out_of_range);
+    tcase_add_test(assign, test_write_all_or_nothing);
+    suite_add_tcase(s, assign);
+
+    TCase *fill = tcase_create("fill");
+    tcase_add_checked_fixture(fill, setup, teardown);
+    tcase_add_test(fill, test_fill_static_int16);
+    tcase_add_test(fill, test_fill_zero);
+    tcase_add_test(fill, test_fill_range);
+    tcase_add_test(fill, test_fill_value_out_of_range);
+    suite_add_tcase(s, fill);
+
+    TCase *setrange = tcase_create("setrange");
+    tcase_add_checked_fixture(setrange, setup, teardown);
+    tcase_add_test(setrange, test_setrange_static_int32);
+    tcase_add_test(setrange, test_setrange_dynamic_int8);
+    suite_add_tcase(s, setrange);
+
+    TCase *out_of_bounds = tcase_create("out_of_bounds");
+    tcase_add_checked_fixture(out_of_bounds, setup, teardown);
+    tcase_add_test(out_of_bounds, test_assign_out_of_bounds);
+    tcase_add_test(out_of_bounds, test_fill_out_of_bounds);
+    tcase_add_test(out_of_bounds, test_setrange_out_of_bounds);
+    suite_add_tcase(s, out_of_bounds);
+
+    return s;
+}
+
+int main(int argc, char *argv[]) {
+    Suite *s = create_suite();
+    SRunner *sr = srunner_create(s);
+
+    if(argc > 1) {
+        srunner_run(sr, NULL, argv[1], CK_NORMAL);
+    }
+    else {
+        srunner_run_all(sr, CK_NORMAL);
+    }
+
+    int number_failed = srunner_ntests_failed(sr);
+    srunner_free(sr);
+
+    return (number_failed == 0) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
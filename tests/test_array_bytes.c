@@ -0,0 +1,169 @@
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <check.h>
+#include <lua.h>
+#include <lualib.h>
+#include <lauxlib.h>
+#include "test_array.h"
+#include "debug.h"
+
+static lua_State *state = NULL;
+static TestStruct test_struct;
+
+void setup(void) {
+    state = luaL_newstate();
+    luaL_openlibs(state);
+    init_test_struct(&test_struct);
+    define_test_struct(state);
+    LUAS_OBJECT(state, TestStruct, &test_struct, false);
+}
+
+void teardown(void) {
+    lua_gc(state, LUA_GCCOLLECT, 0);
+    lua_close(state);
+    state = NULL;
+}
+
+static int run_test_function(const char *script, int n_results) {
+    int res = luaL_dostring(state, script);
+    lua_getglobal(state, "test");
+    lua_pushvalue(state, -2);
+    res = lua_pcall(state, 1, n_results, 0);
+    if(res != LUA_OK) {
+        lua_pop(state, 1);
+    }
+    return res;
+}
+
+START_TEST(test_tobytes_static_int32) {
+    for(int i = 0; i < 5; i++) {
+        test_struct.static_int32[i] = i * 1000 - 2000;
+    }
+    ck_assert_int_eq(run_test_function("function test(obj) return obj.static_int32:tobytes() end", 1), LUA_OK);
+    size_t length;
+    const char *bytes = lua_tolstring(state, -1, &length);
+    ck_assert_int_eq(length, sizeof(test_struct.static_int32));
+    ck_assert_int_eq(memcmp(bytes, test_struct.static_int32, length), 0);
+    lua_pop(state, 1);
+}
+END_TEST
+
+START_TEST(test_tobytes_range) {
+    for(int i = 0; i < 5; i++) {
+        test_struct.dynamic_uint16[i] = i + 1;
+    }
+    ck_assert_int_eq(run_test_function("function test(obj) return obj.dynamic_uint16:tobytes(2, 4) end", 1), LUA_OK);
+    size_t length;
+    const char *bytes = lua_tolstring(state, -1, &length);
+    ck_assert_int_eq(length, 3 * sizeof(uint16_t));
+    ck_assert_int_eq(memcmp(bytes, &test_struct.dynamic_uint16[1], length), 0);
+    lua_pop(state, 1);
+}
+END_TEST
+
+START_TEST(test_tobytes_structs) {
+    for(int i = 0; i < 5; i++) {
+        test_struct.static_sub_struct[i].a = i;
+        test_struct.static_sub_struct[i].d[4] = -i;
+    }
+    ck_assert_int_eq(run_test_function("function test(obj) return obj.static_sub_struct:tobytes(5) end", 1), LUA_OK);
+    size_t length;
+    const char *bytes = lua_tolstring(state, -1, &length);
+    ck_assert_int_eq(length, sizeof(SubStruct));
+    ck_assert_int_eq(memcmp(bytes, &test_struct.static_sub_struct[4], length), 0);
+    lua_pop(state, 1);
+}
+END_TEST
+
+START_TEST(test_frombytes_roundtrip) {
+    for(int i = 0; i < 5; i++) {
+        test_struct.static_number[i] = i * 0.25f;
+    }
+    ck_assert_int_eq(run_test_function("function test(obj) obj.dynamic_number:frombytes(obj.static_number:tobytes()) end", 0), LUA_OK);
+    ck_assert_int_eq(memcmp(test_struct.dynamic_number, test_struct.static_number, sizeof(test_struct.static_number)), 0);
+}
+END_TEST
+
+START_TEST(test_frombytes_offset) {
+    ck_assert_int_eq(run_test_function("function test(obj) obj.static_uint8:frombytes('\\1\\2', 4) end", 0), LUA_OK);
+    ck_assert_int_eq(test_struct.static_uint8[2], 0);
+    ck_assert_int_eq(test_struct.static_uint8[3], 1);
+    ck_assert_int_eq(test_struct.static_uint8[4], 2);
+}
+END_TEST
+
+START_TEST(test_frombytes_bad_length) {
+    ck_assert_int_ne(run_test_function("function test(obj) obj.static_int32:frombytes('abc') end", 0), LUA_OK);
+    ck_assert_int_ne(run_test_function("function test(obj) obj.static_int32:frombytes(string.rep('a', 24)) end", 0), LUA_OK);
+    ck_assert_int_ne(run_test_function("function test(obj) obj.static_uint8:frombytes('abc', 4) end", 0), LUA_OK);
+    for(int i = 0; i < 5; i++) {
+        ck_assert_int_eq(test_struct.static_int32[i], 0);
+        ck_assert_int_eq(test_struct.static_uint8[i], 0);
+    }
+}
+END_TEST
+
+START_TEST(test_tobytes_empty) {
+    lua_pushcfunction(state, luastruct_newarray);
+    lua_setglobal(state, "newarray");
+    ck_assert_int_eq(run_test_function(
+        "function test(obj) "
+        "    assert(newarray('int32', 0):tobytes() == '') "
+        "    assert(newarray('int32', 0):tobytes(1, 0) == '') "
+        "    assert(obj.static_int32:tobytes(6) == '' and obj.static_int32:tobytes(3, 2) == '') "
+        "end", 0), LUA_OK);
+    ck_assert_int_ne(run_test_function("function test(obj) return obj.static_int32:tobytes(7) end", 1), LUA_OK);
+    ck_assert_int_ne(run_test_function("function test(obj) return obj.static_int32:tobytes(6, 6) end", 1), LUA_OK);
+    ck_assert_int_ne(run_test_function("function test(obj) return newarray('int32', 0):tobytes(2, 1) end", 1), LUA_OK);
+}
+END_TEST
+
+START_TEST(test_tobytes_out_of_bounds) {
+    ck_assert_int_ne(run_test_function("function test(obj) return obj.static_int32:tobytes(0) end", 1), LUA_OK);
+    ck_assert_int_ne(run_test_function("function test(obj) return obj.static_int32:tobytes(1, 6) end", 1), LUA_OK);
+}
+END_TEST
+
+Suite *create_suite(void) {
+    Suite *s = suite_create("array_bytes_methods");
+
+    TCase *tobytes = tcase_create("tobytes");
+    tcase_add_checked_fixture(tobytes, setup, teardown);
+    tcase_add_test(tobytes, test_tobytes_static_int32);
+    tcase_add_test(tobytes, test_tobytes_range);
+    tcase_add_test(tobytes, test_tobytes_structs);
+    tcase_add_test(tobytes, test_tobytes_empty);
+    suite_add_tcase(s, tobytes);
+
+    TCase *frombytes = tcase_create("frombytes");
+    tcase_add_checked_fixture(frombytes, setup, teardown);
+    tcase_add_test(frombytes, test_frombytes_roundtrip);
+    tcase_add_test(frombytes, test_frombytes_offset);
+    suite_add_tcase(s, frombytes);
+
+    TCase *out_of_bounds = tcase_create("out_of_bounds");
+    tcase_add_checked_fixture(out_of_bounds, setup, teardown);
+    tcase_add_test(out_of_bounds, test_frombytes_bad_length);
+    tcase_add_test(out_of_bounds, test_tobytes_out_of_bounds);
+    suite_add_tcase(s, out_of_bounds);
+
+    return s;
+}
+
+int main(int argc, char *argv[]) {
+    Suite *s = create_suite();
+    SRunner *sr = srunner_create(s);
+
+    if(argc > 1) {
+        srunner_run(sr, NULL, argv[1], CK_NORMAL);
+    }
+    else {
+        srunner_run_all(sr, CK_NORMAL);
+    }
+
+    int number_failed = srunner_ntests_failed(sr);
+    srunner_free(sr);
+
+    return (number_failed == 0) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
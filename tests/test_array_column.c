@@ -0,0 +1,225 @@
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <check.h>
+#include <lua.h>
+#include <lualib.h>
+#include <lauxlib.h>
+#include "test_array.h"
+#include "debug.h"
+
+#define PARTICLE_COUNT 37
+
+typedef struct Vec2 {
+    float x;
+    float y;
+} Vec2;
+
+typedef struct Particle {
+    Vec2 pos;
+    int32_t id;
+    uint8_t flags;
+    int16_t *weight;
+} Particle;
+
+typedef struct World {
+    Particle particles[PARTICLE_COUNT];
+    Particle *particle_pointers[PARTICLE_COUNT];
+} World;
+
+static lua_State *state = NULL;
+static World *world;
+static int16_t weights[PARTICLE_COUNT];
+
+void setup(void) {
+    state = luaL_newstate();
+    luaL_openlibs(state);
+
+    LUAS_STRUCT(state, Vec2);
+    LUAS_PRIMITIVE_FIELD(state, Vec2, x, LUAST_FLOAT, 0);
+    LUAS_PRIMITIVE_FIELD(state, Vec2, y, LUAST_FLOAT, 0);
+    lua_pop(state, 1);
+
+    LUAS_STRUCT(state, Particle);
+    LUAS_OBJREF_FIELD(state, Particle, pos, Vec2, 0);
+    LUAS_PRIMITIVE_FIELD(state, Particle, id, LUAST_INT32, 0);
+    LUAS_PRIMITIVE_FIELD(state, Particle, flags, LUAST_UINT8, LUAS_FIELD_READONLY);
+    LUAS_PRIMITIVE_FIELD(state, Particle, weight, LUAST_INT16, LUAS_FIELD_POINTER);
+    lua_pop(state, 1);
+
+    LUAS_STRUCT(state, World);
+    LUAS_OBJREF_ARRAY_FIELD(state, World, particles, Particle, 0);
+    LUAS_OBJREF_ARRAY_FIELD(state, World, particle_pointers, Particle, LUAS_FIELD_POINTER);
+    lua_pop(state, 1);
+
+    world = calloc(1, sizeof(World));
+    for(int i = 0; i < PARTICLE_COUNT; i++) {
+        world->particles[i].pos.x = i * 0.5f;
+        world->particles[i].pos.y = -i;
+        world->particles[i].id = (i * 17) % PARTICLE_COUNT;
+        world->particles[i].flags = i % 3;
+        weights[i] = i * 10;
+        world->particles[i].weight = &weights[i];
+        world->particle_pointers[i] = &world->particles[i];
+    }
+
+    LUAS_OBJECT(state, World, world, false);
+    lua_setglobal(state, "world");
+}
+
+void teardown(void) {
+    lua_gc(state, LUA_GCCOLLECT, 0);
+    lua_close(state);
+    state = NULL;
+    free(world);
+}
+
+static int run(const char *script) {
+    int res = luaL_dostring(state, script);
+    if(res != LUA_OK) {
+        lua_pop(state, 1);
+    }
+    return res;
+}
+
+static lua_Number eval_number(const char *expression) {
+    char script[256];
+    snprintf(script, sizeof(script), "return %s", expression);
+    ck_assert_int_eq(luaL_dostring(state, script), LUA_OK);
+    lua_Number value = lua_tonumber(state, -1);
+    lua_pop(state, 1);
+    return value;
+}
+
+START_TEST(test_column_index) {
+    ck_assert_int_eq(eval_number("#world.particles:column('id')"), PARTICLE_COUNT);
+    ck_assert_int_eq(eval_number("world.particles:column('id')[3]"), world->particles[2].id);
+    ck_assert_float_eq(eval_number("world.particles:column('pos.y')[5]"), -4.0f);
+    ck_assert_float_eq(eval_number("world.particles:column('pos'):column('x')[7]"), 3.0f);
+    ck_assert_float_eq(eval_number("world.particles:column('pos')[9].x"), 4.0f);
+    ck_assert_int_eq(eval_number("world.particles:column('weight')[4]"), 30);
+    ck_assert_int_eq(run("assert(world.particles:column('id')[0] == nil)"), LUA_OK);
+    ck_assert_int_eq(run("assert(world.particles:column('id')[38] == nil)"), LUA_OK);
+}
+END_TEST
+
+START_TEST(test_column_newindex) {
+    ck_assert_int_eq(run("local ids = world.particles:column('id') ids[2] = 1000"), LUA_OK);
+    ck_assert_int_eq(world->particles[1].id, 1000);
+    ck_assert_int_eq(world->particles[0].id, 0);
+    ck_assert_int_eq(world->particles[2].id, 34);
+    ck_assert_int_eq(run("world.particles:column('weight')[1] = -5"), LUA_OK);
+    ck_assert_int_eq(weights[0], -5);
+    ck_assert_int_ne(run("world.particles:column('flags')[1] = 2"), LUA_OK);
+    ck_assert_int_ne(run("world.particles:column('id')[38] = 2"), LUA_OK);
+}
+END_TEST
+
+START_TEST(test_column_pairs) {
+    ck_assert_int_eq(run(
+        "local total, n = 0, 0\n"
+        "for i, y in pairs(world.particles:column('pos.y')) do total = total + y n = n + 1 end\n"
+        "assert(n == 37 and total == -666)\n"
+    ), LUA_OK);
+}
+END_TEST
+
+START_TEST(test_column_bulk) {
+    ck_assert_int_eq(eval_number("world.particles:column('pos.y'):sum()"), -666);
+    ck_assert_float_eq(eval_number("world.particles:column('pos.x'):max()"), 18.0f);
+    ck_assert_int_eq(eval_number("world.particles:column('id'):find(1)"), 25);
+    ck_assert_int_eq(eval_number("world.particles:column('flags'):count(2)"), 12);
+    ck_assert_float_eq(eval_number("world.particles:column('pos.x'):dot(world.particles:column('pos.x'))"), 0.25 * 36 * 37 * 73 / 6);
+
+    ck_assert_int_eq(run("world.particles:column('pos.x'):fill(2.5, 3, 4)"), LUA_OK);
+    ck_assert_float_eq(world->particles[2].pos.x, 2.5f);
+    ck_assert_float_eq(world->particles[3].pos.x, 2.5f);
+    ck_assert_float_eq(world->particles[4].pos.x, 2.0f);
+    ck_assert_float_eq(world->particles[2].pos.y, -2.0f);
+
+    ck_assert_int_eq(run("world.particles:column('id'):assign({9, 8, 7})"), LUA_OK);
+    ck_assert_int_eq(world->particles[0].id, 9);
+    ck_assert_int_eq(world->particles[2].id, 7);
+    ck_assert_int_eq(world->particles[3].id, 14);
+}
+END_TEST
+
+START_TEST(test_column_bytes) {
+    ck_assert_int_eq(run(
+        "local ids = world.particles:column('id')\n"
+        "local bytes = ids:tobytes(1, 3)\n"
+        "assert(#bytes == 12)\n"
+        "ids:frombytes(bytes, 5)\n"
+    ), LUA_OK);
+    for(int i = 0; i < 3; i++) {
+        ck_assert_int_eq(world->particles[4 + i].id, world->particles[i].id);
+    }
+    ck_assert_float_eq(world->particles[4].pos.x, 2.0f);
+}
+END_TEST
+
+START_TEST(test_column_sort) {
+    ck_assert_int_eq(run("world.particles:column('id'):sort()"), LUA_OK);
+    for(int i = 0; i < PARTICLE_COUNT; i++) {
+        ck_assert_int_eq(world->particles[i].id, i);
+        ck_assert_float_eq(world->particles[i].pos.x, i * 0.5f);
+    }
+    ck_assert_int_eq(run("world.particles:sort('pos.y')"), LUA_OK);
+    for(int i = 0; i < PARTICLE_COUNT; i++) {
+        ck_assert_float_eq(world->particles[i].pos.y, i - 36.0f);
+        ck_assert_int_eq(world->particles[i].id, 36 - i);
+    }
+}
+END_TEST
+
+START_TEST(test_column_errors) {
+    ck_assert_int_ne(run("world.particles:column('missing')"), LUA_OK);
+    ck_assert_int_ne(run("world.particles:column('pos.z')"), LUA_OK);
+    ck_assert_int_ne(run("world.particles:column('id.x')"), LUA_OK);
+    ck_assert_int_ne(run("world.particle_pointers:column('id')"), LUA_OK);
+    ck_assert_int_ne(run("world.particles:column('id'):column('id')"), LUA_OK);
+}
+END_TEST
+
+Suite *create_suite(void) {
+    Suite *s = suite_create("array_column_method");
+
+    TCase *index = tcase_create("index");
+    tcase_add_checked_fixture(index, setup, teardown);
+    tcase_add_test(index, test_column_index);
+    tcase_add_test(index, test_column_newindex);
+    tcase_add_test(index, test_column_pairs);
+    suite_add_tcase(s, index);
+
+    TCase *bulk = tcase_create("bulk");
+    tcase_add_checked_fixture(bulk, setup, teardown);
+    tcase_add_test(bulk, test_column_bulk);
+    tcase_add_test(bulk, test_column_bytes);
+    tcase_add_test(bulk, test_column_sort);
+    suite_add_tcase(s, bulk);
+
+    TCase *errors = tcase_create("errors");
+    tcase_add_checked_fixture(errors, setup, teardown);
+    tcase_add_test(errors, test_column_errors);
+    suite_add_tcase(s, errors);
+
+    return s;
+}
+
+int main(int argc, char *argv[]) {
+    Suite *s = create_suite();
+    SRunner *sr = srunner_create(s);
+
+    if(argc > 1) {
+        srunner_run(sr, NULL, argv[1], CK_NORMAL);
+    }
+    else {
+        srunner_run_all(sr, CK_NORMAL);
+    }
+
+    int number_failed = srunner_ntests_failed(sr);
+    srunner_free(sr);
+
+    return (number_failed == 0) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
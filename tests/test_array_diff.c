@@ -0,0 +1,295 @@
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <check.h>
+#include <lua.h>
+#include <lualib.h>
+#include <lauxlib.h>
+#include "test_array.h"
+#include "array.h"
+#include "simd.h"
+#include "debug.h"
+
+#define SAMPLE_COUNT 1000
+#define READING_COUNT 16
+#define RING_CAPACITY 8
+
+typedef struct Reading {
+    int32_t id;
+    float value;
+} Reading;
+
+typedef struct Window {
+    int16_t data[RING_CAPACITY];
+    uint32_t head;
+    uint32_t count;
+} Window;
+
+typedef struct Station {
+    int32_t version;
+    int32_t samples[SAMPLE_COUNT];
+    int32_t backup[SAMPLE_COUNT];
+    float levels[SAMPLE_COUNT];
+    Reading readings[READING_COUNT];
+    Reading *refs[READING_COUNT];
+    uint8_t flags[4];
+    Window window;
+    int32_t *log;
+} Station;
+
+static lua_State *state = NULL;
+static Station station;
+static int32_t log_entries[SAMPLE_COUNT];
+static lua_Integer log_count;
+
+static int get_log_count(lua_State *state) {
+    lua_pushinteger(state, log_count);
+    return 1;
+}
+
+void setup(void) {
+    state = luaL_newstate();
+    luaL_openlibs(state);
+
+    LUAS_STRUCT(state, Reading);
+    LUAS_PRIMITIVE_FIELD(state, Reading, id, LUAST_INT32, 0);
+    LUAS_PRIMITIVE_FIELD(state, Reading, value, LUAST_FLOAT, 0);
+    lua_pop(state, 1);
+
+    LUAS_STRUCT(state, Station);
+    LUAS_PRIMITIVE_ARRAY_FIELD(state, Station, samples, LUAST_INT32, 0);
+    LUAS_PRIMITIVE_ARRAY_FIELD(state, Station, backup, LUAST_INT32, 0);
+    LUAS_PRIMITIVE_ARRAY_FIELD(state, Station, levels, LUAST_FLOAT, 0);
+    LUAS_OBJREF_ARRAY_FIELD(state, Station, readings, Reading, 0);
+    LUAS_OBJREF_ARRAY_FIELD(state, Station, refs, Reading, LUAS_FIELD_POINTER);
+    LUAS_BIT_ARRAY_FIELD(state, Station, flags, 32, 0);
+    LUAS_PRIMITIVE_RING_FIELD(state, Station, window, LUAST_INT16, LUAS_RING_LAYOUT(Window, data, head, count, LUAST_UINT32), 0);
+    LUAS_PRIMITIVE_DYNAMIC_ARRAY_FIELD(state, Station, log, get_log_count, LUAST_INT32, 0);
+    lua_pop(state, 1);
+
+    lua_pushcfunction(state, luastruct_newarray);
+    lua_setglobal(state, "newarray");
+
+    memset(&station, 0, sizeof(station));
+    for(int i = 0; i < SAMPLE_COUNT; i++) {
+        station.samples[i] = i + 1;
+        station.backup[i] = i + 1;
+        station.levels[i] = i * 0.25f;
+        log_entries[i] = i + 1;
+    }
+    for(int i = 0; i < READING_COUNT; i++) {
+        station.readings[i].id = i + 1;
+        station.readings[i].value = i + 1;
+        station.refs[i] = &station.readings[READING_COUNT - 1 - i];
+    }
+    // The window holds 1 to 6 from slot 5, wrapping around after 3
+    station.window.head = 5;
+    station.window.count = 6;
+    for(int i = 0; i < 6; i++) {
+        station.window.data[(5 + i) % RING_CAPACITY] = i + 1;
+    }
+    station.log = log_entries;
+    log_count = 100;
+}
+
+void teardown(void) {
+    simd_set_level(LUAS_SIMD_AVX2);
+    lua_gc(state, LUA_GCCOLLECT, 0);
+    lua_close(state);
+    state = NULL;
+}
+
+static int run(const char *statement) {
+    char script[2048];
+    snprintf(script, sizeof(script),
+        "local function ranges(list) "
+        "    local parts = {} "
+        "    for i, range in ipairs(list) do parts[i] = range[1] .. '-' .. range[2] end "
+        "    return table.concat(parts, ',') "
+        "end "
+        "function test(obj) %s end", statement);
+    int res = luaL_dostring(state, script);
+    lua_getglobal(state, "test");
+    LUAS_OBJECT(state, Station, &station, false);
+    res = lua_pcall(state, 1, 0, 0);
+    if(res != LUA_OK) {
+        lua_pop(state, 1);
+    }
+    return res;
+}
+
+/**
+ * Every level must find the same first difference for any length and any
+ * position of the difference, including the tails the vector loops leave.
+ */
+START_TEST(test_kernel) {
+    uint8_t a[256];
+    uint8_t b[256];
+    for(size_t i = 0; i < sizeof(a); i++) {
+        a[i] = (uint8_t)(i * 7);
+    }
+    for(LuastructSimdLevel level = LUAS_SIMD_SCALAR; level <= LUAS_SIMD_AVX2; level++) {
+        simd_set_level(level);
+        for(size_t size = 0; size <= 200; size++) {
+            memcpy(b, a, sizeof(a));
+            ck_assert_uint_eq(simd_mismatch(a, b, size), size);
+            for(size_t at = 0; at < size; at++) {
+                b[at] ^= 0x10;
+                ck_assert_uint_eq(simd_mismatch(a, b, size), at);
+                ck_assert_uint_eq(simd_mismatch(a + 1, b + 1, size - 1), at == 0 ? size - 1 : at - 1);
+                b[at] ^= 0x10;
+            }
+        }
+    }
+}
+END_TEST
+
+START_TEST(test_equals) {
+    ck_assert_int_eq(run(
+        "local samples = obj.samples "
+        "assert(samples:equals(obj.backup) and samples:equals(samples:tobytes())) "
+        "assert(not samples:equals(obj.levels) and not samples:equals(samples:tobytes(1, 999))) "
+        "local copy = newarray('int32', 1000) "
+        "copy:frombytes(samples:tobytes()) "
+        "assert(samples:equals(copy) and copy:equals(samples)) "
+        "obj.backup[1000] = 0 "
+        "assert(not samples:equals(obj.backup) and not obj.backup:equals(copy)) "
+        "assert(obj.readings:equals(obj.readings:tobytes())) "
+        "assert(obj.window:equals(string.pack('hhhhhh', 1, 2, 3, 4, 5, 6))) "
+        "assert(not obj.window:equals(string.pack('hhhhhh', 1, 2, 3, 4, 5, 7))) "
+        "assert(obj.samples:view(1, 10):equals(obj.backup:view(1, 10))) "), LUA_OK);
+}
+END_TEST
+
+static void check_diff(void) {
+    ck_assert_int_eq(run(
+        "local samples = obj.samples "
+        "local snapshot = samples:tobytes() "
+        "local copy = newarray('int32', 1000) "
+        "copy:frombytes(snapshot) "
+        "assert(#samples:diff(snapshot) == 0 and #samples:diff(copy) == 0) "
+        "samples[1] = -1 "
+        "samples[17] = -1 samples[18] = -1 samples[19] = -1 "
+        "samples[500] = -1 "
+        "samples[999] = -1 samples[1000] = -1 "
+        "assert(ranges(samples:diff(snapshot)) == '1-1,17-19,500-500,999-1000') "
+        "assert(ranges(samples:diff(copy)) == '1-1,17-19,500-500,999-1000') "
+        "assert(ranges(copy:diff(samples)) == '1-1,17-19,500-500,999-1000') "
+        "assert(ranges(samples:diff(obj.backup)) == '1-1,17-19,500-500,999-1000') "
+        "obj.levels[300] = -0.0 "
+        "local levels = obj.levels:diff(newarray('float', 1000)) "
+        "assert(ranges(levels) == '2-1000') "), LUA_OK);
+    // Only one byte of the element changes
+    station.samples[700] ^= 0x01000000;
+    ck_assert_int_eq(run("assert(ranges(obj.samples:diff(obj.backup)) == '1-1,17-19,500-500,701-701,999-1000')"), LUA_OK);
+}
+
+START_TEST(test_diff_scalar) {
+    simd_set_level(LUAS_SIMD_SCALAR);
+    check_diff();
+}
+END_TEST
+
+START_TEST(test_diff_sse2) {
+    simd_set_level(LUAS_SIMD_SSE2);
+    check_diff();
+}
+END_TEST
+
+START_TEST(test_diff_avx2) {
+    simd_set_level(LUAS_SIMD_AVX2);
+    check_diff();
+}
+END_TEST
+
+START_TEST(test_diff_layouts) {
+    ck_assert_int_eq(run(
+        "local before = obj.readings:tobytes() "
+        "obj.readings[4].value = 40 "
+        "obj.readings[5].id = 50 "
+        "obj.readings[16].value = 0 "
+        "assert(ranges(obj.readings:diff(before)) == '4-5,16-16') "
+        "local refs = obj.refs:tobytes() "
+        "obj.readings[1].id = 10 "
+        "assert(ranges(obj.refs:diff(refs)) == '16-16') "
+        "assert(ranges(obj.readings:diff(obj.refs)) ~= '') "
+        "local ids = obj.readings:column('id') "
+        "local snapshot = ids:tobytes() "
+        "obj.readings[9].id = 90 "
+        "assert(ranges(ids:diff(snapshot)) == '9-9') "
+        "local window = obj.window "
+        "local saved = window:tobytes() "
+        "window[3] = 30 window[4] = 40 "
+        "assert(ranges(window:diff(saved)) == '3-4') "), LUA_OK);
+
+    // Elements appended after the snapshot are reported as changed
+    ck_assert_int_eq(run("snapshot = obj.log:tobytes()"), LUA_OK);
+    log_count = 110;
+    log_entries[99] = -1;
+    ck_assert_int_eq(run("assert(ranges(obj.log:diff(snapshot)) == '100-110')"), LUA_OK);
+    log_entries[98] = -1;
+    log_entries[99] = 100;
+    ck_assert_int_eq(run("assert(ranges(obj.log:diff(snapshot)) == '99-99,101-110')"), LUA_OK);
+    log_count = 50;
+    ck_assert_int_eq(run("assert(ranges(obj.log:diff(snapshot)) == '')"), LUA_OK);
+}
+END_TEST
+
+START_TEST(test_diff_errors) {
+    ck_assert_int_ne(run("obj.samples:diff(obj.levels)"), LUA_OK);
+    ck_assert_int_ne(run("obj.samples:diff('abc')"), LUA_OK);
+    ck_assert_int_ne(run("obj.samples:diff()"), LUA_OK);
+    ck_assert_int_ne(run("obj.samples:diff({})"), LUA_OK);
+    ck_assert_int_ne(run("obj.samples:equals(42)"), LUA_OK);
+    ck_assert_int_ne(run("obj.flags:diff(obj.flags:tobytes())"), LUA_OK);
+    ck_assert_int_ne(run("obj.flags:equals(obj.flags)"), LUA_OK);
+    ck_assert_int_eq(run("assert(#obj.samples:diff('') == 1 and obj.samples:diff('')[1][2] == 1000)"), LUA_OK);
+}
+END_TEST
+
+Suite *create_suite(void) {
+    Suite *s = suite_create("array_diff");
+
+    TCase *kernel = tcase_create("kernel");
+    tcase_add_checked_fixture(kernel, setup, teardown);
+    tcase_add_test(kernel, test_kernel);
+    suite_add_tcase(s, kernel);
+
+    TCase *equals = tcase_create("equals");
+    tcase_add_checked_fixture(equals, setup, teardown);
+    tcase_add_test(equals, test_equals);
+    suite_add_tcase(s, equals);
+
+    TCase *diff = tcase_create("diff");
+    tcase_add_checked_fixture(diff, setup, teardown);
+    tcase_add_test(diff, test_diff_scalar);
+    tcase_add_test(diff, test_diff_sse2);
+    tcase_add_test(diff, test_diff_avx2);
+    tcase_add_test(diff, test_diff_layouts);
+    suite_add_tcase(s, diff);
+
+    TCase *errors = tcase_create("errors");
+    tcase_add_checked_fixture(errors, setup, teardown);
+    tcase_add_test(errors, test_diff_errors);
+    suite_add_tcase(s, errors);
+
+    return s;
+}
+
+int main(int argc, char *argv[]) {
+    Suite *s = create_suite();
+    SRunner *sr = srunner_create(s);
+
+    if(argc > 1) {
+        srunner_run(sr, NULL, argv[1], CK_NORMAL);
+    }
+    else {
+        srunner_run_all(sr, CK_NORMAL);
+    }
+
+    int number_failed = srunner_ntests_failed(sr);
+    srunner_free(sr);
+
+    return (number_failed == 0) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
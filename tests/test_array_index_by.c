@@ -0,0 +1,265 @@
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <check.h>
+#include <lua.h>
+#include <lualib.h>
+#include <lauxlib.h>
+#include "test_array.h"
+#include "debug.h"
+
+#define MAX_UNITS 1000
+
+typedef struct Stats {
+    int16_t level;
+    float weight;
+} Stats;
+
+typedef struct Unit {
+    int64_t id;
+    Stats stats;
+    uint8_t team;
+} Unit;
+
+typedef struct IndexStruct {
+    int32_t version;
+    Unit units[8];
+    Unit *unit_pointers[8];
+    Unit *live_units;
+} IndexStruct;
+
+static lua_State *state = NULL;
+static TestStruct test_struct;
+static IndexStruct *index_struct;
+static int live_count;
+
+static int get_live_count(lua_State *state) {
+    lua_pushinteger(state, live_count);
+    return 1;
+}
+
+void setup(void) {
+    state = luaL_newstate();
+    luaL_openlibs(state);
+    init_test_struct(&test_struct);
+    define_test_struct(state);
+
+    LUAS_STRUCT(state, Stats);
+    LUAS_PRIMITIVE_FIELD(state, Stats, level, LUAST_INT16, 0);
+    LUAS_PRIMITIVE_FIELD(state, Stats, weight, LUAST_FLOAT, 0);
+    lua_pop(state, 1);
+
+    LUAS_STRUCT(state, Unit);
+    LUAS_PRIMITIVE_FIELD(state, Unit, id, LUAST_INT64, 0);
+    LUAS_OBJREF_FIELD(state, Unit, stats, Stats, 0);
+    LUAS_PRIMITIVE_FIELD(state, Unit, team, LUAST_UINT8, 0);
+    lua_pop(state, 1);
+
+    LUAS_STRUCT(state, IndexStruct);
+    LUAS_OBJREF_ARRAY_FIELD(state, IndexStruct, units, Unit, 0);
+    LUAS_OBJREF_ARRAY_FIELD(state, IndexStruct, unit_pointers, Unit, LUAS_FIELD_POINTER);
+    LUAS_OBJREF_DYNAMIC_ARRAY_FIELD(state, IndexStruct, live_units, get_live_count, Unit, 0);
+    lua_pop(state, 1);
+
+    index_struct = calloc(1, sizeof(IndexStruct));
+    int64_t ids[8] = { 1000000000000, 7, 19, 7, 100, -3, 0, 64 };
+    for(int i = 0; i < 8; i++) {
+        index_struct->units[i].id = ids[i];
+        index_struct->units[i].stats.level = i * 10;
+        index_struct->units[i].stats.weight = i * 0.5f;
+        index_struct->units[i].team = i % 3;
+        index_struct->unit_pointers[7 - i] = &index_struct->units[i];
+    }
+    index_struct->live_units = calloc(MAX_UNITS, sizeof(Unit));
+    for(int i = 0; i < MAX_UNITS; i++) {
+        index_struct->live_units[i].id = (int64_t)i << 32;
+    }
+    live_count = 10;
+
+    LUAS_OBJECT(state, TestStruct, &test_struct, false);
+}
+
+void teardown(void) {
+    lua_gc(state, LUA_GCCOLLECT, 0);
+    lua_close(state);
+    state = NULL;
+    free(index_struct->live_units);
+    free(index_struct);
+}
+
+static int run(const char *statement, bool use_index_struct) {
+    char script[1024];
+    snprintf(script, sizeof(script), "function test(obj) %s end", statement);
+    int res = luaL_dostring(state, script);
+    lua_getglobal(state, "test");
+    if(use_index_struct) {
+        LUAS_OBJECT(state, IndexStruct, index_struct, false);
+    }
+    else {
+        lua_pushvalue(state, -2);
+    }
+    res = lua_pcall(state, 1, 0, 0);
+    if(res != LUA_OK) {
+        lua_pop(state, 1);
+    }
+    return res;
+}
+
+START_TEST(test_index_by_field) {
+    ck_assert_int_eq(run(
+        "local idx = obj.units:index_by('id') "
+        "assert(#idx == 7) "
+        "local unit, i = idx:get(19) "
+        "assert(i == 3 and unit.id == 19 and unit.stats.level == 20) "
+        "unit.team = 9 "
+        "local big = idx:get(1000000000000) "
+        "assert(big.stats.level == 0) "
+        "assert(select(2, idx:get(7)) == 2) "
+        "assert(select(2, idx:get(-3)) == 6) "
+        "assert(select(2, idx:get(0)) == 7) "
+        "assert(select(2, idx:get(64.0)) == 8) "
+        "assert(idx:get(64.5) == nil) "
+        "assert(idx:get(5) == nil) "
+        "assert(idx:get('x') == nil) ",
+        true), LUA_OK);
+    ck_assert_int_eq(index_struct->units[2].team, 9);
+}
+END_TEST
+
+START_TEST(test_index_by_path) {
+    ck_assert_int_eq(run(
+        "local idx = obj.units:index_by('stats.level') "
+        "assert(select(2, idx:get(50)) == 6) "
+        "local weights = obj.units:index_by('stats.weight') "
+        "assert(select(2, weights:get(1.5)) == 4) "
+        "assert(weights:get(1.25) == nil) "
+        "local teams = obj.units:index_by('team') "
+        "assert(#teams == 3) "
+        "assert(select(2, teams:get(2)) == 3) "
+        "local pointers = obj.unit_pointers:index_by('id') "
+        "local unit, i = pointers:get(100) "
+        "assert(i == 4 and unit.id == 100) ",
+        true), LUA_OK);
+}
+END_TEST
+
+START_TEST(test_index_by_primitives) {
+    int32_t values[5] = { 5, -1, 3, 3, 0 };
+    bool flags[5] = { false, false, true, false, true };
+    for(int i = 0; i < 5; i++) {
+        test_struct.static_int32[i] = values[i];
+        test_struct.static_boolean[i] = flags[i];
+    }
+    ck_assert_int_eq(run(
+        "local idx = obj.static_int32:index_by() "
+        "assert(#idx == 4) "
+        "local value, i = idx:get(3) "
+        "assert(value == 3 and i == 3) "
+        "local flags = obj.static_boolean:index_by() "
+        "assert(select(2, flags:get(true)) == 3) "
+        "assert(select(2, flags:get(false)) == 1) ",
+        false), LUA_OK);
+}
+END_TEST
+
+START_TEST(test_index_by_rebuild) {
+    ck_assert_int_eq(run(
+        "idx = obj.live_units:index_by('id') "
+        "assert(#idx == 10) "
+        "assert(idx:get(20 << 32) == nil) ",
+        true), LUA_OK);
+
+    // Growing the array rebuilds the index on the next lookup
+    live_count = MAX_UNITS;
+    ck_assert_int_eq(run(
+        "assert(select(2, idx:get(999 << 32)) == 1000) "
+        "assert(#idx == 1000) ",
+        true), LUA_OK);
+
+    // A stale hit is detected and the index rebuilt
+    index_struct->live_units[5].id = 1;
+    index_struct->live_units[6].id = 5ll << 32;
+    ck_assert_int_eq(run(
+        "assert(select(2, idx:get(5 << 32)) == 7) ",
+        true), LUA_OK);
+
+    // New keys written in place need an explicit rebuild
+    index_struct->live_units[7].id = 2;
+    ck_assert_int_eq(run(
+        "assert(select(2, idx:get(1)) == 6) "
+        "assert(idx:get(2) == nil) "
+        "assert(idx:rebuild() == idx) "
+        "assert(select(2, idx:get(2)) == 8) ",
+        true), LUA_OK);
+
+    // Shrinking the array drops the elements past its end
+    live_count = 3;
+    ck_assert_int_eq(run(
+        "assert(idx:get(5 << 32) == nil) "
+        "assert(select(2, idx:get(2 << 32)) == 3) "
+        "assert(#idx == 3) ",
+        true), LUA_OK);
+}
+END_TEST
+
+START_TEST(test_index_by_keeps_array_alive) {
+    ck_assert_int_eq(run(
+        "idx = obj.units:index_by('id') ",
+        true), LUA_OK);
+    lua_gc(state, LUA_GCCOLLECT, 0);
+    ck_assert_int_eq(run(
+        "assert(idx:get(100).id == 100) ",
+        true), LUA_OK);
+}
+END_TEST
+
+START_TEST(test_index_by_errors) {
+    ck_assert_int_ne(run("obj.units:index_by()", true), LUA_OK);
+    ck_assert_int_ne(run("obj.units:index_by('missing')", true), LUA_OK);
+    ck_assert_int_ne(run("obj.units:index_by('stats')", true), LUA_OK);
+    ck_assert_int_ne(run("obj.static_int32:index_by('id')", false), LUA_OK);
+    ck_assert_int_ne(run("local idx = obj.static_int32:index_by() idx.get(obj, 1)", false), LUA_OK);
+}
+END_TEST
+
+Suite *create_suite(void) {
+    Suite *s = suite_create("array_index_by_method");
+
+    TCase *lookup = tcase_create("lookup");
+    tcase_add_checked_fixture(lookup, setup, teardown);
+    tcase_add_test(lookup, test_index_by_field);
+    tcase_add_test(lookup, test_index_by_path);
+    tcase_add_test(lookup, test_index_by_primitives);
+    suite_add_tcase(s, lookup);
+
+    TCase *rebuild = tcase_create("rebuild");
+    tcase_add_checked_fixture(rebuild, setup, teardown);
+    tcase_add_test(rebuild, test_index_by_rebuild);
+    tcase_add_test(rebuild, test_index_by_keeps_array_alive);
+    suite_add_tcase(s, rebuild);
+
+    TCase *errors = tcase_create("errors");
+    tcase_add_checked_fixture(errors, setup, teardown);
+    tcase_add_test(errors, test_index_by_errors);
+    suite_add_tcase(s, errors);
+
+    return s;
+}
+
+int main(int argc, char *argv[]) {
+    Suite *s = create_suite();
+    SRunner *sr = srunner_create(s);
+
+    if(argc > 1) {
+        srunner_run(sr, NULL, argv[1], CK_NORMAL);
+    }
+    else {
+        srunner_run_all(sr, CK_NORMAL);
+    }
+
+    int number_failed = srunner_ntests_failed(sr);
+    srunner_free(sr);
+
+    return (number_failed == 0) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,212 @@
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <check.h>
+#include <lua.h>
+#include <lualib.h>
+#include <lauxlib.h>
+#include "test_array.h"
+#include "debug.h"
+
+typedef struct KindStruct {
+    int64_t longs[3];
+    uint64_t ulongs[3];
+    int32_t *int_pointers[3];
+    uint16_t readonly_shorts[3];
+    SubStruct *sub_pointers[2];
+} KindStruct;
+
+static lua_State *state = NULL;
+static TestStruct test_struct;
+static KindStruct kind_struct;
+static int32_t pointed_ints[3];
+
+void setup(void) {
+    state = luaL_newstate();
+    luaL_openlibs(state);
+    init_test_struct(&test_struct);
+    define_test_struct(state);
+
+    LUAS_STRUCT(state, KindStruct);
+    LUAS_PRIMITIVE_ARRAY_FIELD(state, KindStruct, longs, LUAST_INT64, 0);
+    LUAS_PRIMITIVE_ARRAY_FIELD(state, KindStruct, ulongs, LUAST_UINT64, 0);
+    LUAS_PRIMITIVE_ARRAY_FIELD(state, KindStruct, int_pointers, LUAST_INT32, LUAS_FIELD_POINTER);
+    LUAS_PRIMITIVE_ARRAY_FIELD(state, KindStruct, readonly_shorts, LUAST_UINT16, LUAS_FIELD_READONLY);
+    LUAS_OBJREF_ARRAY_FIELD(state, KindStruct, sub_pointers, SubStruct, LUAS_FIELD_POINTER);
+    lua_pop(state, 1);
+
+    memset(&kind_struct, 0, sizeof(kind_struct));
+    for(int i = 0; i < 3; i++) {
+        pointed_ints[i] = (i + 1) * 10;
+        kind_struct.int_pointers[i] = &pointed_ints[2 - i];
+        kind_struct.readonly_shorts[i] = i + 1;
+    }
+    kind_struct.sub_pointers[0] = &test_struct.static_sub_struct[4];
+    kind_struct.sub_pointers[1] = &test_struct.static_sub_struct[0];
+    test_struct.static_sub_struct[4].a = 44;
+
+    LUAS_OBJECT(state, TestStruct, &test_struct, false);
+    lua_setglobal(state, "obj");
+    LUAS_OBJECT(state, KindStruct, &kind_struct, false);
+    lua_setglobal(state, "kinds");
+}
+
+void teardown(void) {
+    lua_gc(state, LUA_GCCOLLECT, 0);
+    lua_close(state);
+    state = NULL;
+}
+
+static int run(const char *script) {
+    int res = luaL_dostring(state, script);
+    if(res != LUA_OK) {
+        lua_pop(state, 1);
+    }
+    return res;
+}
+
+START_TEST(test_metatables) {
+    ck_assert_int_eq(run(
+        "local mt = getmetatable(obj.static_int32)\n"
+        "assert(mt == getmetatable(obj.dynamic_int32))\n"
+        "assert(mt ~= getmetatable(obj.static_int16))\n"
+        "assert(mt ~= getmetatable(kinds.int_pointers))\n"
+        "assert(getmetatable(obj.static_number) ~= getmetatable(obj.static_boolean))\n"
+        "assert(getmetatable(kinds.readonly_shorts) ~= getmetatable(obj.static_uint16))\n"
+        "assert(getmetatable(obj.static_sub_struct) ~= getmetatable(kinds.sub_pointers))\n"
+        "assert(mt.__methods == getmetatable(obj.static_number).__methods)\n"
+    ), LUA_OK);
+}
+END_TEST
+
+START_TEST(test_primitive_kinds) {
+    ck_assert_int_eq(run(
+        "obj.static_int8[1] = -128\n"
+        "obj.static_uint32[5] = 4294967295\n"
+        "obj.dynamic_number[2] = 0.5\n"
+        "obj.static_boolean[3] = true\n"
+        "kinds.longs[2] = math.mininteger\n"
+        "kinds.ulongs[3] = -1\n"
+        "assert(obj.static_int8[1] == -128 and obj.static_uint32[5] == 4294967295)\n"
+        "assert(obj.dynamic_number[2] == 0.5 and obj.static_boolean[3] == true)\n"
+        "assert(kinds.longs[2] == math.mininteger and kinds.ulongs[3] == -1)\n"
+        "assert(obj.static_int8[6] == nil and obj.static_int8['2'] == 0)\n"
+    ), LUA_OK);
+    ck_assert_int_eq(kind_struct.longs[1], INT64_MIN);
+    ck_assert(kind_struct.ulongs[2] == UINT64_MAX);
+    ck_assert_int_ne(run("obj.static_int8[1] = 128"), LUA_OK);
+    ck_assert_int_ne(run("obj.static_uint16[1] = -1"), LUA_OK);
+    ck_assert_int_ne(run("obj.static_int32[6] = 1"), LUA_OK);
+    ck_assert_int_ne(run("obj.static_number[1] = 'x'"), LUA_OK);
+}
+END_TEST
+
+START_TEST(test_pointer_kinds) {
+    ck_assert_int_eq(run(
+        "local p = kinds.int_pointers\n"
+        "assert(p[1] == 30 and p[3] == 10)\n"
+        "p[2] = 25\n"
+        "local s = kinds.sub_pointers\n"
+        "assert(s[1].a == 44)\n"
+        "s[2] = s[1]\n"
+    ), LUA_OK);
+    ck_assert_int_eq(pointed_ints[1], 25);
+    ck_assert_int_eq(test_struct.static_sub_struct[0].a, 44);
+}
+END_TEST
+
+START_TEST(test_readonly_kinds) {
+    ck_assert_int_eq(run("assert(kinds.readonly_shorts[2] == 2)"), LUA_OK);
+    ck_assert_int_ne(run("kinds.readonly_shorts[2] = 5"), LUA_OK);
+    ck_assert_int_eq(kind_struct.readonly_shorts[1], 2);
+}
+END_TEST
+
+START_TEST(test_methods_all_kinds) {
+    ck_assert_int_eq(run(
+        "obj.static_int16:fill(3)\n"
+        "assert(obj.static_int16:sum() == 15)\n"
+        "assert(kinds.int_pointers:max() == 30)\n"
+        "assert(kinds.readonly_shorts:find(3) == 3)\n"
+        "assert(#kinds.longs:view(2) == 2)\n"
+        "assert(obj.static_sub_struct:column('a')[1] == 0)\n"
+    ), LUA_OK);
+    ck_assert_int_ne(run("obj.static_int16.sum({})"), LUA_OK);
+    ck_assert_int_ne(run("obj.static_int16.sum(obj)"), LUA_OK);
+}
+END_TEST
+
+/**
+ * Bulk, reduce, search and sort methods must accept arrays of every
+ * specialized metatable, not only the generic one.
+ */
+START_TEST(test_methods_every_kind) {
+    ck_assert_int_eq(run(
+        "local arrays = {\n"
+        "    obj.static_int8, obj.static_int16, obj.static_int32,\n"
+        "    obj.static_uint8, obj.static_uint16, obj.static_uint32, obj.static_number,\n"
+        "    obj.dynamic_int8, obj.dynamic_int16, obj.dynamic_int32,\n"
+        "    obj.dynamic_uint8, obj.dynamic_uint16, obj.dynamic_uint32, obj.dynamic_number,\n"
+        "    kinds.longs, kinds.ulongs, kinds.int_pointers\n"
+        "}\n"
+        "for i, a in ipairs(arrays) do\n"
+        "    assert(getmetatable(a).__name ~= 'luastruct_array', i)\n"
+        "    a:fill(2)\n"
+        "    assert(a:sum() == 2 * #a and a:min() == 2, i)\n"
+        "    a[2] = 1\n"
+        "    a:sort()\n"
+        "    assert(a[1] == 1 and a:find(1) == 1, i)\n"
+        "    a:sort(true)\n"
+        "    assert(a[#a] == 1, i)\n"
+        "end\n"
+        "obj.static_boolean:fill(true)\n"
+        "assert(obj.static_boolean:count(true) == 5)\n"
+        "obj.static_sub_struct[3].a = -1\n"
+        "obj.static_sub_struct:sort('a')\n"
+        "assert(obj.static_sub_struct[1].a == -1)\n"
+        "kinds.sub_pointers:sort('a', true)\n"
+        "assert(kinds.sub_pointers[1].a == 44)\n"
+        "assert(kinds.readonly_shorts:sum() == 6)\n"
+    ), LUA_OK);
+    ck_assert_int_eq(pointed_ints[0], 2);
+    ck_assert_int_ne(run("kinds.readonly_shorts:fill(1)"), LUA_OK);
+    ck_assert_int_ne(run("kinds.readonly_shorts:sort()"), LUA_OK);
+}
+END_TEST
+
+Suite *create_suite(void) {
+    Suite *s = suite_create("array_kinds");
+
+    TCase *metatables = tcase_create("metatables");
+    tcase_add_checked_fixture(metatables, setup, teardown);
+    tcase_add_test(metatables, test_metatables);
+    tcase_add_test(metatables, test_methods_all_kinds);
+    tcase_add_test(metatables, test_methods_every_kind);
+    suite_add_tcase(s, metatables);
+
+    TCase *access = tcase_create("access");
+    tcase_add_checked_fixture(access, setup, teardown);
+    tcase_add_test(access, test_primitive_kinds);
+    tcase_add_test(access, test_pointer_kinds);
+    tcase_add_test(access, test_readonly_kinds);
+    suite_add_tcase(s, access);
+
+    return s;
+}
+
+int main(int argc, char *argv[]) {
+    Suite *s = create_suite();
+    SRunner *sr = srunner_create(s);
+
+    if(argc > 1) {
+        srunner_run(sr, NULL, argv[1], CK_NORMAL);
+    }
+    else {
+        srunner_run_all(sr, CK_NORMAL);
+    }
+
+    int number_failed = srunner_ntests_failed(sr);
+    srunner_free(sr);
+
+    return (number_failed == 0) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
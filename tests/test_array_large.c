@@ -0,0 +1,174 @@
+#define _DEFAULT_SOURCE
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <check.h>
+#include <lua.h>
+#include <lualib.h>
+#include <lauxlib.h>
+#include "helpers.h"
+#include "debug.h"
+
+#define GIB ((size_t)1 << 30)
+#define ARENA_SIZE (9 * GIB)
+#define BYTES_COUNT (5 * GIB)
+#define INTS_COUNT (((size_t)1 << 31) + 16)
+
+typedef struct Arena {
+    uint8_t *bytes;
+    int32_t *ints;
+    int64_t *huge;
+} Arena;
+
+static lua_State *state = NULL;
+static Arena arena;
+static void *region = MAP_FAILED;
+
+static int get_bytes_count(lua_State *state) {
+    lua_pushinteger(state, BYTES_COUNT);
+    return 1;
+}
+
+static int get_ints_count(lua_State *state) {
+    lua_pushinteger(state, INTS_COUNT);
+    return 1;
+}
+
+static int get_huge_count(lua_State *state) {
+    lua_pushinteger(state, LUA_MAXINTEGER / 2);
+    return 1;
+}
+
+void setup(void) {
+    state = luaL_newstate();
+    luaL_openlibs(state);
+
+    // Only the pages that are touched get backed by memory
+    if(sizeof(size_t) >= 8) {
+        region = mmap(NULL, ARENA_SIZE, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+    }
+    arena.bytes = region;
+    arena.ints = region;
+    arena.huge = region;
+
+    LUAS_STRUCT(state, Arena);
+    LUAS_PRIMITIVE_DYNAMIC_ARRAY_FIELD(state, Arena, bytes, get_bytes_count, LUAST_UINT8, 0);
+    LUAS_PRIMITIVE_DYNAMIC_ARRAY_FIELD(state, Arena, ints, get_ints_count, LUAST_INT32, 0);
+    LUAS_PRIMITIVE_DYNAMIC_ARRAY_FIELD(state, Arena, huge, get_huge_count, LUAST_INT64, 0);
+    lua_pop(state, 1);
+
+    LUAS_OBJECT(state, Arena, &arena, false);
+    lua_setglobal(state, "arena");
+}
+
+void teardown(void) {
+    lua_gc(state, LUA_GCCOLLECT, 0);
+    lua_close(state);
+    state = NULL;
+    if(region != MAP_FAILED) {
+        munmap(region, ARENA_SIZE);
+        region = MAP_FAILED;
+    }
+}
+
+static int run(const char *script) {
+    int res = luaL_dostring(state, script);
+    if(res != LUA_OK) {
+        lua_pop(state, 1);
+    }
+    return res;
+}
+
+START_TEST(test_large_index) {
+    if(region == MAP_FAILED) {
+        return;
+    }
+    ck_assert_int_eq(run(
+        "local bytes = arena.bytes\n"
+        "assert(#bytes == 5 * 2^30)\n"
+        "bytes[5 * 2^30] = 7\n"
+        "bytes[2^32 + 1] = 3\n"
+        "assert(bytes[5 * 2^30] == 7 and bytes[2^32 + 1] == 3 and bytes[1] == 0)\n"
+        "assert(bytes[5 * 2^30 + 1] == nil)\n"
+        "local ints = arena.ints\n"
+        "assert(#ints == 2^31 + 16)\n"
+        "ints[2^31 + 5] = -1\n"
+        "assert(ints[2^31 + 5] == -1)\n"
+    ), LUA_OK);
+    ck_assert_int_eq(arena.bytes[BYTES_COUNT - 1], 7);
+    ck_assert_int_eq(arena.bytes[(size_t)1 << 32], 3);
+    ck_assert_int_eq(arena.bytes[0], 0);
+    ck_assert_int_eq(arena.ints[((size_t)1 << 31) + 4], -1);
+    ck_assert_int_ne(run("arena.bytes[5 * 2^30 + 1] = 1"), LUA_OK);
+}
+END_TEST
+
+START_TEST(test_large_next) {
+    if(region == MAP_FAILED) {
+        return;
+    }
+    arena.bytes[BYTES_COUNT - 1] = 9;
+    ck_assert_int_eq(run(
+        "local next, bytes = pairs(arena.bytes)\n"
+        "local index, value = next(bytes, 5 * 2^30 - 1)\n"
+        "assert(index == 5 * 2^30 and value == 9)\n"
+        "assert(next(bytes, 5 * 2^30) == nil)\n"
+    ), LUA_OK);
+}
+END_TEST
+
+START_TEST(test_large_view) {
+    if(region == MAP_FAILED) {
+        return;
+    }
+    arena.ints[((size_t)1 << 31) + 9] = 42;
+    arena.bytes[((size_t)1 << 32) + 1] = 1;
+    ck_assert_int_eq(run(
+        "local v = arena.ints:view(2^31 + 1)\n"
+        "assert(#v == 16 and v:find(42) == 10 and v:sum() == 42)\n"
+        "assert(arena.bytes:view(2^32 + 1, 2^32 + 3):tobytes() == '\\0\\1\\0')\n"
+    ), LUA_OK);
+}
+END_TEST
+
+START_TEST(test_size_overflow) {
+    ck_assert_int_ne(run("return #arena.huge"), LUA_OK);
+    ck_assert_int_ne(run("return arena.huge[1]"), LUA_OK);
+}
+END_TEST
+
+Suite *create_suite(void) {
+    Suite *s = suite_create("array_large");
+
+    TCase *index = tcase_create("index");
+    tcase_add_checked_fixture(index, setup, teardown);
+    tcase_add_test(index, test_large_index);
+    tcase_add_test(index, test_large_next);
+    tcase_add_test(index, test_large_view);
+    suite_add_tcase(s, index);
+
+    TCase *overflow = tcase_create("overflow");
+    tcase_add_checked_fixture(overflow, setup, teardown);
+    tcase_add_test(overflow, test_size_overflow);
+    suite_add_tcase(s, overflow);
+
+    return s;
+}
+
+int main(int argc, char *argv[]) {
+    Suite *s = create_suite();
+    SRunner *sr = srunner_create(s);
+
+    if(argc > 1) {
+        srunner_run(sr, NULL, argv[1], CK_NORMAL);
+    }
+    else {
+        srunner_run_all(sr, CK_NORMAL);
+    }
+
+    int number_failed = srunner_ntests_failed(sr);
+    srunner_free(sr);
+
+    return (number_failed == 0) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
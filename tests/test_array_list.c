@@ -0,0 +1,238 @@
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <check.h>
+#include <lua.h>
+#include <lualib.h>
+#include <lauxlib.h>
+#include "test_array.h"
+#include "debug.h"
+
+#define NODE_COUNT 10
+
+typedef struct Node {
+    int32_t id;
+    float weight;
+    struct Node *next;
+    struct Node *prev;
+} Node;
+
+typedef struct Registry {
+    int32_t version;
+    Node *head;
+    Node sentinel;
+    Node *bounded;
+    Node *empty;
+    Node *first;
+    Node *second;
+} Registry;
+
+static lua_State *state = NULL;
+static Node nodes[NODE_COUNT];
+static Node ring_nodes[NODE_COUNT];
+static Registry registry;
+
+void setup(void) {
+    state = luaL_newstate();
+    luaL_openlibs(state);
+
+    LUAS_STRUCT(state, Node);
+    LUAS_PRIMITIVE_FIELD(state, Node, id, LUAST_INT32, 0);
+    LUAS_PRIMITIVE_FIELD(state, Node, weight, LUAST_FLOAT, 0);
+    lua_pop(state, 1);
+
+    LUAS_STRUCT(state, Registry);
+    LUAS_OBJREF_LIST_FIELD(state, Registry, head, Node, LUAS_LIST_LAYOUT(Node, next, false, 0), 0);
+    LUAS_OBJREF_LIST_FIELD(state, Registry, sentinel, Node, LUAS_LIST_LAYOUT(Node, next, true, 0), 0);
+    LUAS_OBJREF_LIST_FIELD(state, Registry, bounded, Node, LUAS_LIST_LAYOUT(Node, next, false, 5), LUAS_FIELD_READONLY);
+    LUAS_OBJREF_LIST_FIELD(state, Registry, empty, Node, LUAS_LIST_LAYOUT(Node, next, false, 0), 0);
+    {
+        // One descriptor shared by two fields of the same layout
+        LuastructArrayDesc desc;
+        LuastructListDesc layout = LUAS_LIST_LAYOUT(Node, next, false, 0);
+        luastruct_new_list_desc(state, "Node", &layout, false, &desc);
+        luastruct_new_struct_array_field(state, "first", &desc, offsetof(Registry, first), false, false);
+        luastruct_new_struct_array_field(state, "second", &desc, offsetof(Registry, second), false, false);
+        luastruct_free_array_desc(&desc);
+    }
+    lua_pop(state, 1);
+
+    // A singly linked list of nodes 1 to 10, and a circular doubly linked list of nodes 11 to 20
+    memset(&registry, 0, sizeof(registry));
+    memset(nodes, 0, sizeof(nodes));
+    memset(ring_nodes, 0, sizeof(ring_nodes));
+    for(int i = 0; i < NODE_COUNT; i++) {
+        nodes[i].id = i + 1;
+        nodes[i].weight = (i + 1) * 0.5f;
+        nodes[i].next = i + 1 < NODE_COUNT ? &nodes[i + 1] : NULL;
+        ring_nodes[i].id = NODE_COUNT + i + 1;
+        ring_nodes[i].next = i + 1 < NODE_COUNT ? &ring_nodes[i + 1] : &registry.sentinel;
+        ring_nodes[i].prev = i > 0 ? &ring_nodes[i - 1] : &registry.sentinel;
+    }
+    registry.head = &nodes[0];
+    registry.sentinel.next = &ring_nodes[0];
+    registry.sentinel.prev = &ring_nodes[NODE_COUNT - 1];
+    registry.bounded = &nodes[0];
+    registry.first = &nodes[0];
+    registry.second = &nodes[5];
+}
+
+void teardown(void) {
+    lua_gc(state, LUA_GCCOLLECT, 0);
+    lua_close(state);
+    state = NULL;
+}
+
+static int run(const char *statement) {
+    char script[2048];
+    snprintf(script, sizeof(script), "function test(obj) %s end", statement);
+    int res = luaL_dostring(state, script);
+    lua_getglobal(state, "test");
+    LUAS_OBJECT(state, Registry, &registry, false);
+    res = lua_pcall(state, 1, 0, 0);
+    if(res != LUA_OK) {
+        lua_pop(state, 1);
+    }
+    return res;
+}
+
+START_TEST(test_walk) {
+    ck_assert_int_eq(run(
+        "local list = obj.head "
+        "assert(#list == 10 and list:len() == 10 and list:len(4) == 4 and list:len(0) == 0) "
+        "local n = 0 "
+        "for i, node in pairs(list) do n = n + 1 assert(node.id == i and node.weight == i * 0.5) end "
+        "assert(n == 10) "
+        "n = 0 "
+        "for i, node in list:iter() do n = n + i end "
+        "assert(n == 55) "
+        "assert(#obj.empty == 0 and obj.empty:find('id', 1) == nil) "
+        "for _ in pairs(obj.empty) do error('empty list') end "
+        "local ring = obj.sentinel "
+        "assert(#ring == 10 and ring:len(20) == 10) "
+        "n = 0 "
+        "for i, node in pairs(ring) do n = n + 1 assert(node.id == 10 + i) end "
+        "assert(n == 10) "
+        "list:find('id', 3).weight = 30 "), LUA_OK);
+    ck_assert_float_eq(nodes[2].weight, 30.0f);
+
+    // C code relinks the list behind the back of the list object
+    ck_assert_int_eq(run("list = obj.head"), LUA_OK);
+    nodes[4].next = NULL;
+    ck_assert_int_eq(run("assert(#list == 5 and list:find('id', 6) == nil)"), LUA_OK);
+}
+END_TEST
+
+START_TEST(test_search) {
+    ck_assert_int_eq(run(
+        "local list = obj.head "
+        "local node, position = list:find('id', 7) "
+        "assert(node.id == 7 and position == 7) "
+        "assert(list:find('weight', 2.5).id == 5 and list:find('id', 11) == nil) "
+        "local heavy = list:filter('weight > 3') "
+        "assert(#heavy == 4 and heavy[1].id == 7 and heavy[4].id == 10) "
+        "local odd = list:filter({ id = {'<', 4} }) "
+        "assert(#odd == 3 and odd[3].id == 3) "
+        "local even = list:filter(function(node) return node.id % 2 == 0 end) "
+        "assert(#even == 5 and even[5].id == 10) "
+        "local found, at = obj.sentinel:find('id', 20) "
+        "assert(found.id == 20 and at == 10) "
+        "assert(#obj.sentinel:filter('id <= 12') == 2) "), LUA_OK);
+}
+END_TEST
+
+START_TEST(test_guards) {
+    // The bounded list holds more nodes than its maximum length
+    ck_assert_int_ne(run("return #obj.bounded"), LUA_OK);
+    ck_assert_int_eq(run("assert(obj.bounded:len(5) == 5 and obj.bounded:find('id', 2).id == 2)"), LUA_OK);
+    ck_assert_int_ne(run("obj.bounded:find('id', 8)"), LUA_OK);
+    ck_assert_int_ne(run("obj.bounded:find('id', 2).id = 3"), LUA_OK);
+
+    // A node linking to itself, then a longer loop back into the middle of the list
+    nodes[0].next = &nodes[0];
+    ck_assert_int_ne(run("return #obj.head"), LUA_OK);
+    nodes[0].next = &nodes[1];
+    nodes[NODE_COUNT - 1].next = &nodes[3];
+    ck_assert_int_ne(run("return #obj.head"), LUA_OK);
+    ck_assert_int_ne(run("for _ in pairs(obj.head) do end"), LUA_OK);
+    ck_assert_int_ne(run("obj.head:filter(function() return true end)"), LUA_OK);
+    ck_assert_int_ne(run("obj.head:len(100)"), LUA_OK);
+    ck_assert_int_eq(run("assert(obj.head:len(12) == 12 and obj.head:find('id', 10).id == 10)"), LUA_OK);
+}
+END_TEST
+
+/**
+ * Declare a list whose next pointer lies past the end of the nodes.
+ */
+static int new_outside_layout(lua_State *state) {
+    LuastructListDesc layout = { sizeof(Node) - sizeof(void *) / 2, false, 0 };
+    LuastructArrayDesc desc;
+    luastruct_new_list_desc(state, "Node", &layout, false, &desc);
+    luastruct_free_array_desc(&desc);
+    return 0;
+}
+
+START_TEST(test_shared_desc) {
+    ck_assert_int_eq(run(
+        "assert(#obj.first == 10 and #obj.second == 5) "
+        "assert(obj.first:find('id', 3).id == 3 and obj.second:find('id', 3) == nil) "), LUA_OK);
+}
+END_TEST
+
+START_TEST(test_list_errors) {
+    ck_assert_int_ne(run("obj.head = nil"), LUA_OK);
+    ck_assert_int_ne(run("obj.head:len(-1)"), LUA_OK);
+    ck_assert_int_ne(run("obj.head:find('missing', 1)"), LUA_OK);
+    ck_assert_int_ne(run("obj.head:filter('id >')"), LUA_OK);
+    ck_assert_int_ne(run("obj.head:sum()"), LUA_OK);
+
+    lua_pushcfunction(state, new_outside_layout);
+    ck_assert_int_ne(lua_pcall(state, 0, 0, 0), LUA_OK);
+    lua_pop(state, 1);
+}
+END_TEST
+
+Suite *create_suite(void) {
+    Suite *s = suite_create("array_list");
+
+    TCase *walk = tcase_create("walk");
+    tcase_add_checked_fixture(walk, setup, teardown);
+    tcase_add_test(walk, test_walk);
+    tcase_add_test(walk, test_shared_desc);
+    suite_add_tcase(s, walk);
+
+    TCase *search = tcase_create("search");
+    tcase_add_checked_fixture(search, setup, teardown);
+    tcase_add_test(search, test_search);
+    suite_add_tcase(s, search);
+
+    TCase *guards = tcase_create("guards");
+    tcase_add_checked_fixture(guards, setup, teardown);
+    tcase_add_test(guards, test_guards);
+    suite_add_tcase(s, guards);
+
+    TCase *errors = tcase_create("errors");
+    tcase_add_checked_fixture(errors, setup, teardown);
+    tcase_add_test(errors, test_list_errors);
+    suite_add_tcase(s, errors);
+
+    return s;
+}
+
+int main(int argc, char *argv[]) {
+    Suite *s = create_suite();
+    SRunner *sr = srunner_create(s);
+
+    if(argc > 1) {
+        srunner_run(sr, NULL, argv[1], CK_NORMAL);
+    }
+    else {
+        srunner_run_all(sr, CK_NORMAL);
+    }
+
+    int number_failed = srunner_ntests_failed(sr);
+    srunner_free(sr);
+
+    return (number_failed == 0) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
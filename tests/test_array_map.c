@@ -0,0 +1,366 @@
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <check.h>
+#include <lua.h>
+#include <lualib.h>
+#include <lauxlib.h>
+#include "test_array.h"
+#include "array.h"
+#include "debug.h"
+
+#define ITEM_CAPACITY 64
+#define SCORE_CAPACITY 100
+#define SPARSE_CAPACITY 1000
+#define BUCKET_CAPACITY 8
+
+typedef struct Item {
+    int32_t id;
+    float price;
+} Item;
+
+typedef struct ItemTable {
+    uint32_t *keys;
+    Item *values;
+    uint32_t capacity;
+    uint64_t *occupied;
+} ItemTable;
+
+typedef struct ScoreTable {
+    int64_t *keys;
+    float *values;
+    int64_t capacity;
+    uint8_t *occupied;
+} ScoreTable;
+
+typedef struct SmallTable {
+    int16_t *keys;
+    int32_t *values;
+    uint32_t capacity;
+    uint8_t *occupied;
+} SmallTable;
+
+typedef struct Catalog {
+    int32_t version;
+    ItemTable items;
+    ScoreTable scores;
+    ScoreTable frozen;
+    SmallTable sparse;
+    SmallTable buckets;
+    ScoreTable primary;
+    ScoreTable mirror;
+} Catalog;
+
+static lua_State *state = NULL;
+static Catalog catalog;
+
+static uint64_t murmur3(uint64_t hash) {
+    hash ^= hash >> 33;
+    hash *= UINT64_C(0xff51afd7ed558ccd);
+    hash ^= hash >> 33;
+    hash *= UINT64_C(0xc4ceb9fe1a85ec53);
+    hash ^= hash >> 33;
+    return hash;
+}
+
+static uint64_t fnv1a(const void *key, size_t size) {
+    uint64_t hash = UINT64_C(14695981039346656037);
+    for(size_t i = 0; i < size; i++) {
+        hash ^= ((const uint8_t *)key)[i];
+        hash *= UINT64_C(1099511628211);
+    }
+    return hash;
+}
+
+/**
+ * Every key lands in slot 6 of the buckets, so that lookups probe past the
+ * end of the slots and wrap around.
+ */
+static uint64_t constant_hash(const void *key, size_t size, void *userdata) {
+    ck_assert_int_eq(size, sizeof(int16_t));
+    ck_assert_ptr_eq(userdata, &catalog);
+    (void)key;
+    return 6;
+}
+
+/**
+ * Insert a key the way the C side of the maps does, by linear probing from
+ * its hash, and return its slot.
+ */
+static size_t insert_slot(uint64_t hash, size_t capacity, uint8_t *occupied) {
+    size_t i = hash % capacity;
+    while(LUAS_BIT_GET(occupied, i)) {
+        i = (i + 1) % capacity;
+    }
+    LUAS_BIT_SET(occupied, i, 1);
+    return i;
+}
+
+static void insert_item(uint32_t key, int32_t id, float price) {
+    size_t i = insert_slot(murmur3(key), ITEM_CAPACITY, (uint8_t *)catalog.items.occupied);
+    catalog.items.keys[i] = key;
+    catalog.items.values[i].id = id;
+    catalog.items.values[i].price = price;
+}
+
+static void insert_score(ScoreTable *table, int64_t key, float value) {
+    size_t i = insert_slot(fnv1a(&key, sizeof(key)), SCORE_CAPACITY, table->occupied);
+    table->keys[i] = key;
+    table->values[i] = value;
+}
+
+static void insert_small(SmallTable *table, uint64_t hash, int16_t key, int32_t value) {
+    size_t i = insert_slot(hash, table->capacity, table->occupied);
+    table->keys[i] = key;
+    table->values[i] = value;
+}
+
+void setup(void) {
+    state = luaL_newstate();
+    luaL_openlibs(state);
+
+    LUAS_STRUCT(state, Item);
+    LUAS_PRIMITIVE_FIELD(state, Item, id, LUAST_INT32, 0);
+    LUAS_PRIMITIVE_FIELD(state, Item, price, LUAST_FLOAT, 0);
+    lua_pop(state, 1);
+
+    LUAS_STRUCT(state, Catalog);
+    LUAS_OBJREF_MAP_FIELD(state, Catalog, items, Item, LUAS_MAP_LAYOUT(ItemTable, keys, values, capacity, occupied, LUAST_UINT32, LUAST_UINT32, LUAS_HASH_MURMUR3, NULL, NULL), 0);
+    LUAS_PRIMITIVE_MAP_FIELD(state, Catalog, scores, LUAST_FLOAT, LUAS_MAP_LAYOUT(ScoreTable, keys, values, capacity, occupied, LUAST_INT64, LUAST_INT64, LUAS_HASH_FNV1A, NULL, NULL), 0);
+    LUAS_PRIMITIVE_MAP_FIELD(state, Catalog, frozen, LUAST_FLOAT, LUAS_MAP_LAYOUT(ScoreTable, keys, values, capacity, occupied, LUAST_INT64, LUAST_INT64, LUAS_HASH_FNV1A, NULL, NULL), LUAS_FIELD_READONLY);
+    LUAS_PRIMITIVE_MAP_FIELD(state, Catalog, sparse, LUAST_INT32, LUAS_MAP_LAYOUT(SmallTable, keys, values, capacity, occupied, LUAST_INT16, LUAST_UINT32, LUAS_HASH_IDENTITY, NULL, NULL), 0);
+    LUAS_PRIMITIVE_MAP_FIELD(state, Catalog, buckets, LUAST_INT32, LUAS_MAP_LAYOUT(SmallTable, keys, values, capacity, occupied, LUAST_INT16, LUAST_UINT32, LUAS_HASH_CUSTOM, constant_hash, &catalog), 0);
+    {
+        // One descriptor shared by two fields of the same layout
+        LuastructArrayDesc desc;
+        LuastructMapDesc layout = LUAS_MAP_LAYOUT(ScoreTable, keys, values, capacity, occupied, LUAST_INT64, LUAST_INT64, LUAS_HASH_FNV1A, NULL, NULL);
+        luastruct_new_map_desc(state, LUAST_FLOAT, NULL, &layout, false, &desc);
+        luastruct_new_struct_array_field(state, "primary", &desc, offsetof(Catalog, primary), false, false);
+        luastruct_new_struct_array_field(state, "mirror", &desc, offsetof(Catalog, mirror), false, false);
+        luastruct_free_array_desc(&desc);
+    }
+    lua_pop(state, 1);
+
+    memset(&catalog, 0, sizeof(catalog));
+    catalog.items.keys = calloc(ITEM_CAPACITY, sizeof(uint32_t));
+    catalog.items.values = calloc(ITEM_CAPACITY, sizeof(Item));
+    catalog.items.occupied = calloc(ITEM_CAPACITY / 64, sizeof(uint64_t));
+    catalog.items.capacity = ITEM_CAPACITY;
+    for(int i = 1; i <= 40; i++) {
+        insert_item(i * 1000, i, i * 0.5f);
+    }
+    insert_item(UINT32_MAX, -1, -1);
+
+    catalog.scores.keys = calloc(SCORE_CAPACITY, sizeof(int64_t));
+    catalog.scores.values = calloc(SCORE_CAPACITY, sizeof(float));
+    catalog.scores.occupied = calloc((SCORE_CAPACITY + 7) / 8, 1);
+    catalog.scores.capacity = SCORE_CAPACITY;
+    for(int i = 1; i <= 30; i++) {
+        insert_score(&catalog.scores, (int64_t)i * -100000000000, i);
+    }
+    catalog.frozen = catalog.scores;
+    catalog.primary = catalog.scores;
+    catalog.mirror.capacity = 0;
+
+    // A few keys spread over a large map, including ones that collide
+    catalog.sparse.keys = calloc(SPARSE_CAPACITY, sizeof(int16_t));
+    catalog.sparse.values = calloc(SPARSE_CAPACITY, sizeof(int32_t));
+    catalog.sparse.occupied = calloc((SPARSE_CAPACITY + 7) / 8, 1);
+    catalog.sparse.capacity = SPARSE_CAPACITY;
+    const int16_t sparse_keys[] = { 3, 1003, 500, 999, -1 };
+    for(size_t i = 0; i < sizeof(sparse_keys) / sizeof(sparse_keys[0]); i++) {
+        insert_small(&catalog.sparse, (uint64_t)sparse_keys[i], sparse_keys[i], sparse_keys[i] * 2);
+    }
+
+    catalog.buckets.keys = calloc(BUCKET_CAPACITY, sizeof(int16_t));
+    catalog.buckets.values = calloc(BUCKET_CAPACITY, sizeof(int32_t));
+    catalog.buckets.occupied = calloc(1, 1);
+    catalog.buckets.capacity = BUCKET_CAPACITY;
+    for(int i = 1; i <= 5; i++) {
+        insert_small(&catalog.buckets, 6, i * 11, i);
+    }
+}
+
+void teardown(void) {
+    lua_gc(state, LUA_GCCOLLECT, 0);
+    lua_close(state);
+    state = NULL;
+    free(catalog.items.keys);
+    free(catalog.items.values);
+    free(catalog.items.occupied);
+    free(catalog.scores.keys);
+    free(catalog.scores.values);
+    free(catalog.scores.occupied);
+    free(catalog.sparse.keys);
+    free(catalog.sparse.values);
+    free(catalog.sparse.occupied);
+    free(catalog.buckets.keys);
+    free(catalog.buckets.values);
+    free(catalog.buckets.occupied);
+}
+
+static int run(const char *statement) {
+    char script[2048];
+    snprintf(script, sizeof(script), "function test(obj) %s end", statement);
+    int res = luaL_dostring(state, script);
+    lua_getglobal(state, "test");
+    LUAS_OBJECT(state, Catalog, &catalog, false);
+    res = lua_pcall(state, 1, 0, 0);
+    if(res != LUA_OK) {
+        lua_pop(state, 1);
+    }
+    return res;
+}
+
+START_TEST(test_lookup) {
+    ck_assert_int_eq(run(
+        "local items = obj.items "
+        "assert(#items == 41 and items:capacity() == 64) "
+        "for i = 1, 40 do assert(items[i * 1000].id == i and items[i * 1000].price == i * 0.5) end "
+        "assert(items[4294967295].id == -1 and items:contains(4294967295)) "
+        "assert(items[1] == nil and items[-1] == nil and items[2^40] == nil and items[1000.5] == nil) "
+        "assert(items[1000.0].id == 1 and not items:contains('1000') and items.missing == nil) "
+        "local scores = obj.scores "
+        "assert(#scores == 30 and scores:capacity() == 100) "
+        "for i = 1, 30 do assert(scores[i * -100000000000] == i) end "
+        "assert(scores[100000000000] == nil and not scores:contains(0)) "
+        "local sparse = obj.sparse "
+        "assert(#sparse == 5 and sparse[3] == 6 and sparse[1003] == 2006 and sparse[999] == 1998 and sparse[-1] == -2) "
+        "assert(sparse[500] == 1000 and sparse[4] == nil and sparse[40000] == nil) "
+        "local buckets = obj.buckets "
+        "assert(#buckets == 5 and buckets[11] == 1 and buckets[55] == 5 and buckets[66] == nil) "), LUA_OK);
+
+    // C code grows the map behind the back of the map object
+    ck_assert_int_eq(run("items = obj.items"), LUA_OK);
+    insert_item(123, 123, 1.5f);
+    ck_assert_int_eq(run("assert(#items == 42 and items[123].id == 123)"), LUA_OK);
+}
+END_TEST
+
+START_TEST(test_iteration) {
+    ck_assert_int_eq(run(
+        "local n, total = 0, 0 "
+        "for key, item in pairs(obj.items) do "
+        "    n = n + 1 "
+        "    if key ~= 4294967295 then assert(item.id * 1000 == key) total = total + item.id end "
+        "end "
+        "assert(n == 41 and total == 820) "
+        "local keys = {} "
+        "for key, value in pairs(obj.sparse) do assert(value == key * 2) keys[#keys + 1] = key end "
+        "table.sort(keys) "
+        "assert(#keys == 5 and keys[1] == -1 and keys[2] == 3 and keys[5] == 1003) "
+        "n = 0 "
+        "for key, value in pairs(obj.buckets) do n = n + 1 assert(value * 11 == key) end "
+        "assert(n == 5) "), LUA_OK);
+
+    // Iteration only follows the occupied bitmap, up to the last slot
+    memset(catalog.sparse.occupied, 0, (SPARSE_CAPACITY + 7) / 8);
+    ck_assert_int_eq(run("assert(#obj.sparse == 0) for _ in pairs(obj.sparse) do error('empty map') end"), LUA_OK);
+    LUAS_BIT_SET(catalog.sparse.occupied, SPARSE_CAPACITY - 1, 1);
+    ck_assert_int_eq(run("local n = 0 for _ in pairs(obj.sparse) do n = n + 1 end assert(n == 1 and #obj.sparse == 1)"), LUA_OK);
+}
+END_TEST
+
+START_TEST(test_write) {
+    ck_assert_int_eq(run(
+        "obj.items[5000].price = 99 "
+        "obj.scores[-300000000000] = 7.5 "
+        "obj.buckets[44] = -4 "), LUA_OK);
+    ck_assert_int_eq(run("assert(obj.items[5000].price == 99 and obj.frozen[-300000000000] == 7.5 and obj.buckets[44] == -4)"), LUA_OK);
+    ck_assert_int_ne(run("obj.scores[1] = 1"), LUA_OK);
+    ck_assert_int_ne(run("obj.scores[-100000000000] = 'x'"), LUA_OK);
+    ck_assert_int_ne(run("obj.frozen[-100000000000] = 1"), LUA_OK);
+    ck_assert_int_ne(run("obj.items = nil"), LUA_OK);
+}
+END_TEST
+
+/**
+ * Declare a map whose keys are floats.
+ */
+static int new_float_keys(lua_State *state) {
+    LuastructMapDesc layout = LUAS_MAP_LAYOUT(ScoreTable, keys, values, capacity, occupied, LUAST_FLOAT, LUAST_INT64, LUAS_HASH_FNV1A, NULL, NULL);
+    LuastructArrayDesc desc;
+    luastruct_new_map_desc(state, LUAST_FLOAT, NULL, &layout, false, &desc);
+    return 0;
+}
+
+/**
+ * Declare a map with a custom hash but no hash function.
+ */
+static int new_missing_hash(lua_State *state) {
+    LuastructMapDesc layout = LUAS_MAP_LAYOUT(ScoreTable, keys, values, capacity, occupied, LUAST_INT64, LUAST_INT64, LUAS_HASH_CUSTOM, NULL, NULL);
+    LuastructArrayDesc desc;
+    luastruct_new_map_desc(state, LUAST_FLOAT, NULL, &layout, false, &desc);
+    return 0;
+}
+
+START_TEST(test_shared_desc) {
+    ck_assert_int_eq(run(
+        "assert(#obj.primary == 30 and obj.primary[-200000000000] == 2) "
+        "assert(#obj.mirror == 0 and obj.mirror[-200000000000] == nil) "), LUA_OK);
+}
+END_TEST
+
+START_TEST(test_map_errors) {
+    catalog.scores.capacity = -1;
+    ck_assert_int_ne(run("return #obj.scores"), LUA_OK);
+    catalog.scores.capacity = SCORE_CAPACITY;
+    free(catalog.scores.keys);
+    catalog.scores.keys = NULL;
+    ck_assert_int_ne(run("return obj.scores[1]"), LUA_OK);
+    catalog.scores.capacity = 0;
+    ck_assert_int_eq(run("assert(#obj.scores == 0 and obj.scores[1] == nil) for _ in pairs(obj.scores) do error('empty map') end"), LUA_OK);
+
+    lua_pushcfunction(state, new_float_keys);
+    ck_assert_int_ne(lua_pcall(state, 0, 0, 0), LUA_OK);
+    lua_pop(state, 1);
+    lua_pushcfunction(state, new_missing_hash);
+    ck_assert_int_ne(lua_pcall(state, 0, 0, 0), LUA_OK);
+    lua_pop(state, 1);
+}
+END_TEST
+
+Suite *create_suite(void) {
+    Suite *s = suite_create("array_map");
+
+    TCase *lookup = tcase_create("lookup");
+    tcase_add_checked_fixture(lookup, setup, teardown);
+    tcase_add_test(lookup, test_lookup);
+    tcase_add_test(lookup, test_shared_desc);
+    suite_add_tcase(s, lookup);
+
+    TCase *iteration = tcase_create("iteration");
+    tcase_add_checked_fixture(iteration, setup, teardown);
+    tcase_add_test(iteration, test_iteration);
+    suite_add_tcase(s, iteration);
+
+    TCase *write = tcase_create("write");
+    tcase_add_checked_fixture(write, setup, teardown);
+    tcase_add_test(write, test_write);
+    suite_add_tcase(s, write);
+
+    TCase *errors = tcase_create("errors");
+    tcase_add_checked_fixture(errors, setup, teardown);
+    tcase_add_test(errors, test_map_errors);
+    suite_add_tcase(s, errors);
+
+    return s;
+}
+
+int main(int argc, char *argv[]) {
+    Suite *s = create_suite();
+    SRunner *sr = srunner_create(s);
+
+    if(argc > 1) {
+        srunner_run(sr, NULL, argv[1], CK_NORMAL);
+    }
+    else {
+        srunner_run_all(sr, CK_NORMAL);
+    }
+
+    int number_failed = srunner_ntests_failed(sr);
+    srunner_free(sr);
+
+    return (number_failed == 0) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,281 @@
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <check.h>
+#include <lua.h>
+#include <lualib.h>
+#include <lauxlib.h>
+#include "test_array.h"
+#include "simd.h"
+#include "debug.h"
+
+#define MATH_ARRAY_SIZE 37
+
+typedef struct Sample {
+    int16_t level;
+    float value;
+    int32_t id;
+} Sample;
+
+typedef struct MathStruct {
+    int32_t version;
+    float a[MATH_ARRAY_SIZE];
+    float b[MATH_ARRAY_SIZE];
+    int32_t ints[MATH_ARRAY_SIZE];
+    int8_t small[MATH_ARRAY_SIZE];
+    Sample samples[MATH_ARRAY_SIZE];
+} MathStruct;
+
+static lua_State *state = NULL;
+static TestStruct test_struct;
+static MathStruct math_struct;
+
+static void init_math_struct(void) {
+    for(int i = 0; i < MATH_ARRAY_SIZE; i++) {
+        math_struct.a[i] = (i % 11) * 0.75f - 2.0f;
+        math_struct.b[i] = (i % 7) * 0.5f + 0.125f;
+        math_struct.ints[i] = i * 3 - 50;
+        math_struct.small[i] = i * 3 - 50;
+        math_struct.samples[i].level = i;
+        math_struct.samples[i].value = i * 0.25f;
+        math_struct.samples[i].id = i;
+    }
+}
+
+void setup(void) {
+    state = luaL_newstate();
+    luaL_openlibs(state);
+    init_test_struct(&test_struct);
+    define_test_struct(state);
+
+    LUAS_STRUCT(state, Sample);
+    LUAS_PRIMITIVE_FIELD(state, Sample, level, LUAST_INT16, 0);
+    LUAS_PRIMITIVE_FIELD(state, Sample, value, LUAST_FLOAT, 0);
+    LUAS_PRIMITIVE_FIELD(state, Sample, id, LUAST_INT32, LUAS_FIELD_READONLY);
+    lua_pop(state, 1);
+
+    LUAS_STRUCT(state, MathStruct);
+    LUAS_PRIMITIVE_ARRAY_FIELD(state, MathStruct, a, LUAST_FLOAT, 0);
+    LUAS_PRIMITIVE_ARRAY_FIELD(state, MathStruct, b, LUAST_FLOAT, 0);
+    LUAS_PRIMITIVE_ARRAY_FIELD(state, MathStruct, ints, LUAST_INT32, 0);
+    LUAS_PRIMITIVE_ARRAY_FIELD(state, MathStruct, small, LUAST_INT8, 0);
+    LUAS_OBJREF_ARRAY_FIELD(state, MathStruct, samples, Sample, 0);
+    lua_pop(state, 1);
+    init_math_struct();
+
+    LUAS_OBJECT(state, TestStruct, &test_struct, false);
+}
+
+void teardown(void) {
+    simd_set_level(LUAS_SIMD_AVX2);
+    lua_gc(state, LUA_GCCOLLECT, 0);
+    lua_close(state);
+    state = NULL;
+}
+
+static int run(const char *statement, bool use_math_struct) {
+    char script[2048];
+    snprintf(script, sizeof(script), "function test(obj) %s end", statement);
+    int res = luaL_dostring(state, script);
+    lua_getglobal(state, "test");
+    if(use_math_struct) {
+        LUAS_OBJECT(state, MathStruct, &math_struct, false);
+    }
+    else {
+        lua_pushvalue(state, -2);
+    }
+    res = lua_pcall(state, 1, 0, 0);
+    if(res != LUA_OK) {
+        lua_pop(state, 1);
+    }
+    return res;
+}
+
+/**
+ * Run every float operation at the current SIMD level and compare the result
+ * with the same single-precision arithmetic done here.
+ */
+static void check_float_operations(void) {
+    float a[MATH_ARRAY_SIZE];
+    init_math_struct();
+    for(int i = 0; i < MATH_ARRAY_SIZE; i++) {
+        float x = math_struct.a[i];
+        float b = math_struct.b[i];
+        x = x + 1.5f;
+        x = x * 0.5f;
+        x = x + b;
+        x = x * b;
+        x = x + -2.0f * b;
+        x = x + (b - x) * 0.25f;
+        x = 1.0f > x ? 1.0f : x;
+        x = -0.5f > x ? -0.5f : x;
+        x = 2.5f < x ? 2.5f : x;
+        a[i] = x;
+    }
+    ck_assert_int_eq(run(
+        "obj.a:add(1.5):mul(0.5):add(obj.b):mul(obj.b) "
+        "obj.a:axpy(-2, obj.b):lerp(obj.b, 0.25) "
+        "obj.a:clamp(1, math.huge) "
+        "assert(obj.a:min() >= 1) "
+        "obj.a:clamp(-0.5, 2.5) ",
+        true), LUA_OK);
+    for(int i = 0; i < MATH_ARRAY_SIZE; i++) {
+        ck_assert_float_eq(math_struct.a[i], a[i]);
+    }
+}
+
+START_TEST(test_float_scalar) {
+    simd_set_level(LUAS_SIMD_SCALAR);
+    check_float_operations();
+}
+END_TEST
+
+START_TEST(test_float_sse2) {
+    simd_set_level(LUAS_SIMD_SSE2);
+    check_float_operations();
+}
+END_TEST
+
+START_TEST(test_float_avx2) {
+    simd_set_level(LUAS_SIMD_AVX2);
+    check_float_operations();
+}
+END_TEST
+
+START_TEST(test_integer_operations) {
+    ck_assert_int_eq(run(
+        "obj.ints:add(10):mul(2) "
+        "for i = 1, #obj.ints do assert(obj.ints[i] == ((i - 1) * 3 - 40) * 2) end "
+        "obj.ints:mul(0.5) "
+        "obj.ints:add(obj.small) "
+        "for i = 1, #obj.ints do assert(obj.ints[i] == ((i - 1) * 3 - 40) + obj.small[i]) end "
+        "obj.ints:axpy(-1, obj.small):add(0.4):add(0.6) "
+        "for i = 1, #obj.ints do assert(obj.ints[i] == (i - 1) * 3 - 39) end "
+        "obj.ints:clamp(-10.5, 20.5) "
+        "assert(obj.ints:min() == -10 and obj.ints:max() == 20) "
+        "obj.ints:lerp(obj.small, 0.5) "
+        "assert(obj.ints[1] == -30 and obj.ints[37] == 39) ",
+        true), LUA_OK);
+}
+END_TEST
+
+START_TEST(test_integer_empty_clamp) {
+    // A range holding no integer clamps every element to the integer nearest to its lower bound
+    ck_assert_int_eq(run(
+        "obj.ints:clamp(1.5, 1.7) "
+        "assert(obj.ints:min() == 2 and obj.ints:max() == 2) "
+        "obj.ints:clamp(-1.2, -1.1) "
+        "assert(obj.ints:min() == -1 and obj.ints:max() == -1) "
+        "obj.small:clamp(1000.2, 1000.4) "
+        "assert(obj.small:min() == 127 and obj.small:max() == 127) ",
+        true), LUA_OK);
+}
+END_TEST
+
+START_TEST(test_integer_range) {
+    ck_assert_int_ne(run("obj.small:add(100)", true), LUA_OK);
+    for(int i = 0; i < MATH_ARRAY_SIZE; i++) {
+        ck_assert_int_eq(math_struct.small[i], i * 3 - 50);
+    }
+    ck_assert_int_ne(run("obj.ints:mul(math.maxinteger)", true), LUA_OK);
+    ck_assert_int_eq(math_struct.ints[0], -50);
+
+    ck_assert_int_eq(run(
+        "obj.small:add(100, true) "
+        "assert(obj.small[1] == 50 and obj.small[37] == 127) "
+        "obj.small:mul(-1000, true) "
+        "assert(obj.small:max() == -128) "
+        "obj.small:clamp(-1000, 1000) "
+        "assert(obj.small[1] == -128) "
+        "obj.ints:mul(math.maxinteger, true) "
+        "assert(obj.ints[1] == -2147483648 and obj.ints[37] == 2147483647) ",
+        true), LUA_OK);
+}
+END_TEST
+
+START_TEST(test_views) {
+    ck_assert_int_eq(run(
+        "local values = obj.samples:column('value') "
+        "local levels = obj.samples:column('level') "
+        "values:add(levels):mul(2) "
+        "for i = 1, #values do assert(values[i] == (i - 1) * 2.5) end "
+        "levels:axpy(3, obj.ints:view(1, 37)) "
+        "assert(levels[1] == -150 and levels[37] == 3 * 58 + 36) "
+        "local head = obj.a:view(1, 36) "
+        "local tail = obj.a:view(2, 37) "
+        "local expected = {} "
+        "for i = 1, 36 do expected[i] = obj.a[i] + obj.a[i + 1] end "
+        "tail:add(head) "
+        "for i = 1, 36 do assert(obj.a[i + 1] == expected[i]) end "
+        "for i = 1, 36 do expected[i] = obj.b[i + 1] * obj.b[i] end "
+        "head = obj.b:view(1, 36) "
+        "tail = obj.b:view(2, 37) "
+        "head:mul(tail) "
+        "for i = 1, 36 do assert(obj.b[i] == expected[i]) end "
+        "obj.b:mul(obj.b) ",
+        true), LUA_OK);
+}
+END_TEST
+
+START_TEST(test_math_errors) {
+    ck_assert_int_ne(run("obj.static_boolean:add(1)", false), LUA_OK);
+    ck_assert_int_ne(run("obj.static_sub_struct:add(1)", false), LUA_OK);
+    ck_assert_int_ne(run("obj.static_int32:add('x')", false), LUA_OK);
+    ck_assert_int_ne(run("obj.static_int32:add(obj.static_boolean)", false), LUA_OK);
+    ck_assert_int_ne(run("obj.a:add(obj.a:view(1, 36))", true), LUA_OK);
+    ck_assert_int_ne(run("obj.a:axpy(obj.b, 2)", true), LUA_OK);
+    ck_assert_int_ne(run("obj.a:clamp(2, 1)", true), LUA_OK);
+    ck_assert_int_ne(run("obj.ints:clamp(1.8, 1.2)", true), LUA_OK);
+    ck_assert_int_ne(run("obj.a:clamp(0 / 0, 1)", true), LUA_OK);
+    ck_assert_int_ne(run("obj.samples:column('id'):add(1)", true), LUA_OK);
+    ck_assert_int_eq(math_struct.samples[0].id, 0);
+}
+END_TEST
+
+Suite *create_suite(void) {
+    Suite *s = suite_create("array_math_methods");
+
+    TCase *floats = tcase_create("floats");
+    tcase_add_checked_fixture(floats, setup, teardown);
+    tcase_add_test(floats, test_float_scalar);
+    tcase_add_test(floats, test_float_sse2);
+    tcase_add_test(floats, test_float_avx2);
+    suite_add_tcase(s, floats);
+
+    TCase *integers = tcase_create("integers");
+    tcase_add_checked_fixture(integers, setup, teardown);
+    tcase_add_test(integers, test_integer_operations);
+    tcase_add_test(integers, test_integer_range);
+    tcase_add_test(integers, test_integer_empty_clamp);
+    suite_add_tcase(s, integers);
+
+    TCase *views = tcase_create("views");
+    tcase_add_checked_fixture(views, setup, teardown);
+    tcase_add_test(views, test_views);
+    suite_add_tcase(s, views);
+
+    TCase *errors = tcase_create("errors");
+    tcase_add_checked_fixture(errors, setup, teardown);
+    tcase_add_test(errors, test_math_errors);
+    suite_add_tcase(s, errors);
+
+    return s;
+}
+
+int main(int argc, char *argv[]) {
+    Suite *s = create_suite();
+    SRunner *sr = srunner_create(s);
+
+    if(argc > 1) {
+        srunner_run(sr, NULL, argv[1], CK_NORMAL);
+    }
+    else {
+        srunner_run_all(sr, CK_NORMAL);
+    }
+
+    int number_failed = srunner_ntests_failed(sr);
+    srunner_free(sr);
+
+    return (number_failed == 0) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
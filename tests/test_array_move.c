@@ -0,0 +1,239 @@
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <check.h>
+#include <lua.h>
+#include <lualib.h>
+#include <lauxlib.h>
+#include "test_array.h"
+#include "debug.h"
+
+#define ID_COUNT 10
+#define PARTICLE_COUNT 8
+#define RING_CAPACITY 8
+
+typedef struct Particle {
+    int32_t id;
+    float x;
+    uint8_t tag[20];
+} Particle;
+
+typedef struct Samples {
+    int16_t data[RING_CAPACITY];
+    uint32_t head;
+    uint32_t count;
+} Samples;
+
+typedef struct World {
+    int32_t version;
+    int32_t ids[ID_COUNT];
+    int32_t spare[ID_COUNT];
+    float weights[ID_COUNT];
+    const int32_t frozen[ID_COUNT];
+    Particle particles[PARTICLE_COUNT];
+    Particle *refs[PARTICLE_COUNT];
+    Samples samples;
+} World;
+
+static lua_State *state = NULL;
+static World world;
+static Particle pool[PARTICLE_COUNT];
+
+void setup(void) {
+    state = luaL_newstate();
+    luaL_openlibs(state);
+
+    LUAS_STRUCT(state, Particle);
+    LUAS_PRIMITIVE_FIELD(state, Particle, id, LUAST_INT32, 0);
+    LUAS_PRIMITIVE_FIELD(state, Particle, x, LUAST_FLOAT, 0);
+    lua_pop(state, 1);
+
+    LUAS_STRUCT(state, World);
+    LUAS_PRIMITIVE_ARRAY_FIELD(state, World, ids, LUAST_INT32, 0);
+    LUAS_PRIMITIVE_ARRAY_FIELD(state, World, spare, LUAST_INT32, 0);
+    LUAS_PRIMITIVE_ARRAY_FIELD(state, World, weights, LUAST_FLOAT, 0);
+    LUAS_PRIMITIVE_ARRAY_FIELD(state, World, frozen, LUAST_INT32, LUAS_FIELD_READONLY);
+    LUAS_OBJREF_ARRAY_FIELD(state, World, particles, Particle, 0);
+    LUAS_OBJREF_ARRAY_FIELD(state, World, refs, Particle, LUAS_FIELD_POINTER);
+    LUAS_PRIMITIVE_RING_FIELD(state, World, samples, LUAST_INT16, LUAS_RING_LAYOUT(Samples, data, head, count, LUAST_UINT32), 0);
+    lua_pop(state, 1);
+
+    memset(&world, 0, sizeof(world));
+    for(int i = 0; i < ID_COUNT; i++) {
+        world.ids[i] = i + 1;
+        world.weights[i] = i + 1;
+    }
+    for(int i = 0; i < PARTICLE_COUNT; i++) {
+        world.particles[i].id = i + 1;
+        world.particles[i].x = (i + 1) * 10;
+        memset(world.particles[i].tag, i + 1, sizeof(world.particles[i].tag));
+        pool[i].id = i + 1;
+        pool[i].x = (i + 1) * 10;
+        world.refs[i] = &pool[(i * 3) % PARTICLE_COUNT];
+    }
+    // The ring holds 1 to 6 from slot 5, wrapping around after 3
+    world.samples.head = 5;
+    world.samples.count = 6;
+    for(int i = 0; i < 6; i++) {
+        world.samples.data[(5 + i) % RING_CAPACITY] = i + 1;
+    }
+}
+
+void teardown(void) {
+    lua_gc(state, LUA_GCCOLLECT, 0);
+    lua_close(state);
+    state = NULL;
+}
+
+static int run(const char *statement) {
+    char script[2048];
+    snprintf(script, sizeof(script),
+        "local function same(array, ...) "
+        "    local expected = {...} "
+        "    assert(#array == #expected, 'length ' .. #array) "
+        "    for i = 1, #expected do assert(array[i] == expected[i], 'element ' .. i .. ': ' .. tostring(array[i])) end "
+        "end "
+        "function test(obj) %s end", statement);
+    int res = luaL_dostring(state, script);
+    lua_getglobal(state, "test");
+    LUAS_OBJECT(state, World, &world, false);
+    res = lua_pcall(state, 1, 0, 0);
+    if(res != LUA_OK) {
+        lua_pop(state, 1);
+    }
+    return res;
+}
+
+START_TEST(test_copy) {
+    ck_assert_int_eq(run(
+        "local ids = obj.ids "
+        "ids:copy(3, ids, 1, 5) "
+        "same(ids, 1, 2, 1, 2, 3, 4, 5, 8, 9, 10) "
+        "ids:copy(1, ids, 4, 7) "
+        "same(ids, 2, 3, 4, 5, 8, 9, 10, 8, 9, 10) "
+        "obj.spare:copy(6, ids, 1, 5) "
+        "same(obj.spare, 0, 0, 0, 0, 0, 2, 3, 4, 5, 8) "
+        "ids:copy(10, obj.frozen, 1, 1) "
+        "ids:copy(1, ids, 1, 0) "
+        "assert(ids[10] == 0) "
+        "local particles = obj.particles "
+        "particles:copy(2, particles, 1, 3) "
+        "assert(particles[2].id == 1 and particles[4].id == 3 and particles[5].id == 5) "
+        "local xs = particles:column('x') "
+        "xs:copy(5, xs, 4, 4) "
+        "same(xs, 10, 10, 20, 30, 30, 50, 60, 70) "
+        "obj.refs:copy(1, particles, 5, 2) "
+        "assert(obj.refs[1].id == 5 and obj.refs[1].x == 30 and obj.refs[2].id == 6) "), LUA_OK);
+    // Particle data is copied whole, including the fields Lua does not see
+    ck_assert_int_eq(world.particles[1].tag[0], 1);
+    ck_assert_int_eq(world.particles[3].tag[19], 3);
+    ck_assert_int_eq(world.particles[4].tag[0], 5);
+    ck_assert_int_eq(pool[0].tag[0], 5);
+    ck_assert_ptr_eq(world.refs[1], &pool[3]);
+
+    ck_assert_int_eq(run(
+        "local samples = obj.samples "
+        "samples:copy(2, samples, 1, 4) "
+        "same(samples, 1, 1, 2, 3, 4, 6) "
+        "samples:copy(1, obj.samples, 3, 4) "
+        "same(samples, 2, 3, 4, 6, 4, 6) "), LUA_OK);
+}
+END_TEST
+
+START_TEST(test_reorder) {
+    ck_assert_int_eq(run(
+        "local ids = obj.ids "
+        "ids:swap(1, 10) "
+        "ids:swap(5, 5) "
+        "same(ids, 10, 2, 3, 4, 5, 6, 7, 8, 9, 1) "
+        "ids:reverse() "
+        "same(ids, 1, 9, 8, 7, 6, 5, 4, 3, 2, 10) "
+        "ids:rotate(3) "
+        "same(ids, 3, 2, 10, 1, 9, 8, 7, 6, 5, 4) "
+        "ids:rotate(-3) "
+        "same(ids, 1, 9, 8, 7, 6, 5, 4, 3, 2, 10) "
+        "ids:rotate(21) "
+        "same(ids, 10, 1, 9, 8, 7, 6, 5, 4, 3, 2) "
+        "ids:rotate(0) "
+        "assert(ids[1] == 10) "
+        "local particles = obj.particles "
+        "particles:reverse() "
+        "particles:rotate(1) "
+        "assert(particles[1].id == 1 and particles[2].id == 8 and particles[8].id == 2) "
+        "particles:column('x'):reverse() "
+        "assert(particles[1].x == 20 and particles[1].id == 1) "
+        "obj.refs:swap(1, 2) "
+        "assert(obj.refs[1].id == 4 and obj.refs[2].id == 1) "
+        "local samples = obj.samples "
+        "samples:reverse() "
+        "same(samples, 6, 5, 4, 3, 2, 1) "
+        "samples:rotate(-2) "
+        "same(samples, 4, 3, 2, 1, 6, 5) "
+        "samples:swap(1, 6) "
+        "same(samples, 5, 3, 2, 1, 6, 4) "), LUA_OK);
+    ck_assert_int_eq(world.particles[0].tag[0], 1);
+    ck_assert_int_eq(world.particles[1].tag[0], 8);
+    // The pointers stay in place, the particles they point to are swapped
+    ck_assert_ptr_eq(world.refs[0], &pool[0]);
+    ck_assert_int_eq(pool[0].id, 4);
+}
+END_TEST
+
+START_TEST(test_move_errors) {
+    ck_assert_int_ne(run("obj.ids:copy(1, obj.weights, 1, 1)"), LUA_OK);
+    ck_assert_int_ne(run("obj.ids:copy(1, obj.particles, 1, 1)"), LUA_OK);
+    ck_assert_int_ne(run("obj.frozen:copy(1, obj.ids, 1, 1)"), LUA_OK);
+    ck_assert_int_ne(run("obj.ids:copy(6, obj.ids, 1, 6)"), LUA_OK);
+    ck_assert_int_ne(run("obj.ids:copy(1, obj.ids, 0, 2)"), LUA_OK);
+    ck_assert_int_ne(run("obj.ids:copy(1, obj.ids, 1, -1)"), LUA_OK);
+    ck_assert_int_ne(run("obj.ids:copy(2, obj.ids, 1, math.maxinteger)"), LUA_OK);
+    ck_assert_int_ne(run("obj.ids:swap(0, 1)"), LUA_OK);
+    ck_assert_int_ne(run("obj.ids:swap(1, 11)"), LUA_OK);
+    ck_assert_int_ne(run("obj.frozen:swap(1, 2)"), LUA_OK);
+    ck_assert_int_ne(run("obj.frozen:reverse()"), LUA_OK);
+    ck_assert_int_ne(run("obj.frozen:rotate(1)"), LUA_OK);
+    ck_assert_int_ne(run("obj.ids:rotate()"), LUA_OK);
+    for(int i = 0; i < ID_COUNT; i++) {
+        ck_assert_int_eq(world.ids[i], i + 1);
+    }
+}
+END_TEST
+
+Suite *create_suite(void) {
+    Suite *s = suite_create("array_move");
+
+    TCase *copy = tcase_create("copy");
+    tcase_add_checked_fixture(copy, setup, teardown);
+    tcase_add_test(copy, test_copy);
+    suite_add_tcase(s, copy);
+
+    TCase *reorder = tcase_create("reorder");
+    tcase_add_checked_fixture(reorder, setup, teardown);
+    tcase_add_test(reorder, test_reorder);
+    suite_add_tcase(s, reorder);
+
+    TCase *errors = tcase_create("errors");
+    tcase_add_checked_fixture(errors, setup, teardown);
+    tcase_add_test(errors, test_move_errors);
+    suite_add_tcase(s, errors);
+
+    return s;
+}
+
+int main(int argc, char *argv[]) {
+    Suite *s = create_suite();
+    SRunner *sr = srunner_create(s);
+
+    if(argc > 1) {
+        srunner_run(sr, NULL, argv[1], CK_NORMAL);
+    }
+    else {
+        srunner_run_all(sr, CK_NORMAL);
+    }
+
+    int number_failed = srunner_ntests_failed(sr);
+    srunner_free(sr);
+
+    return (number_failed == 0) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,249 @@
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <check.h>
+#include <lua.h>
+#include <lualib.h>
+#include <lauxlib.h>
+#include "helpers.h"
+#include "debug.h"
+
+typedef struct Level {
+    float matrix[4][4];
+    uint8_t grid[64][64];
+    int16_t cube[2][3][4];
+    int32_t *rows[3];
+    int32_t **dynamic_rows;
+    int32_t before[2][3];
+    int32_t after[2][3];
+} Level;
+
+static lua_State *state = NULL;
+static Level *level;
+static int32_t row_data[3][4];
+
+static int get_rows_count(lua_State *state) {
+    lua_pushinteger(state, 3);
+    return 1;
+}
+
+static int get_row_length(lua_State *state) {
+    lua_pushinteger(state, 4);
+    return 1;
+}
+
+void setup(void) {
+    state = luaL_newstate();
+    luaL_openlibs(state);
+
+    LUAS_STRUCT(state, Level);
+    LUAS_PRIMITIVE_MATRIX_FIELD(state, Level, matrix, LUAST_FLOAT, 0);
+    LUAS_PRIMITIVE_MATRIX_FIELD(state, Level, grid, LUAST_UINT8, 0);
+    {
+        LuastructArrayDesc line_desc, plane_desc, cube_desc;
+        luastruct_new_static_array_desc(state, LUAST_INT16, NULL, 4, false, false, &line_desc);
+        luastruct_new_static_nested_array_desc(state, &line_desc, 3, false, false, &plane_desc);
+        luastruct_new_static_nested_array_desc(state, &plane_desc, 2, false, false, &cube_desc);
+        luastruct_new_struct_array_field(state, "cube", &cube_desc, offsetof(Level, cube), false, false);
+        luastruct_free_array_desc(&plane_desc);
+        luastruct_free_array_desc(&cube_desc);
+    }
+    {
+        LuastructArrayDesc row_desc, rows_desc;
+        luastruct_new_static_array_desc(state, LUAST_INT32, NULL, 4, false, false, &row_desc);
+        luastruct_new_static_nested_array_desc(state, &row_desc, 3, true, false, &rows_desc);
+        luastruct_new_struct_array_field(state, "rows", &rows_desc, offsetof(Level, rows), false, false);
+        luastruct_free_array_desc(&rows_desc);
+    }
+    {
+        LuastructArrayDesc row_desc, rows_desc;
+        luastruct_new_dynamic_array_desc(state, LUAST_INT32, NULL, get_row_length, false, false, &row_desc);
+        luastruct_new_dynamic_nested_array_desc(state, &row_desc, get_rows_count, true, false, &rows_desc);
+        luastruct_new_struct_array_field(state, "dynamic_rows", &rows_desc, offsetof(Level, dynamic_rows), true, false);
+        luastruct_free_array_desc(&rows_desc);
+    }
+    {
+        // One descriptor shared by two fields of the same shape
+        LuastructArrayDesc row_desc, mat_desc;
+        luastruct_new_static_array_desc(state, LUAST_INT32, NULL, 3, false, false, &row_desc);
+        luastruct_new_static_nested_array_desc(state, &row_desc, 2, false, false, &mat_desc);
+        luastruct_new_struct_array_field(state, "before", &mat_desc, offsetof(Level, before), false, false);
+        luastruct_new_struct_array_field(state, "after", &mat_desc, offsetof(Level, after), false, false);
+        luastruct_free_array_desc(&mat_desc);
+    }
+    lua_pop(state, 1);
+
+    level = calloc(1, sizeof(Level));
+    for(int i = 0; i < 4; i++) {
+        for(int j = 0; j < 4; j++) {
+            level->matrix[i][j] = i * 4 + j;
+        }
+    }
+    for(int i = 0; i < 2; i++) {
+        for(int j = 0; j < 3; j++) {
+            for(int k = 0; k < 4; k++) {
+                level->cube[i][j][k] = i * 100 + j * 10 + k;
+            }
+        }
+    }
+    for(int i = 0; i < 3; i++) {
+        for(int j = 0; j < 4; j++) {
+            row_data[i][j] = (2 - i) * 10 + j;
+        }
+        level->rows[i] = row_data[2 - i];
+    }
+    level->dynamic_rows = level->rows;
+
+    LUAS_OBJECT(state, Level, level, false);
+    lua_setglobal(state, "level");
+}
+
+void teardown(void) {
+    lua_gc(state, LUA_GCCOLLECT, 0);
+    lua_close(state);
+    state = NULL;
+    free(level);
+}
+
+static int run(const char *script) {
+    int res = luaL_dostring(state, script);
+    if(res != LUA_OK) {
+        lua_pop(state, 1);
+    }
+    return res;
+}
+
+START_TEST(test_matrix_index) {
+    ck_assert_int_eq(run(
+        "local m = level.matrix\n"
+        "assert(#m == 4 and #m[1] == 4)\n"
+        "assert(m[1][1] == 0 and m[2][3] == 6 and m[4][4] == 15)\n"
+        "assert(m[5] == nil and m[1][5] == nil)\n"
+        "m[3][2] = 42.5\n"
+        "local g = level.grid\n"
+        "assert(#g == 64 and #g[64] == 64)\n"
+        "g[64][64] = 5\n"
+        "g[2][1] = 7\n"
+    ), LUA_OK);
+    ck_assert_float_eq(level->matrix[2][1], 42.5f);
+    ck_assert_int_eq(level->grid[63][63], 5);
+    ck_assert_int_eq(level->grid[1][0], 7);
+    ck_assert_int_ne(run("level.matrix[1] = 1"), LUA_OK);
+}
+END_TEST
+
+START_TEST(test_matrix_at) {
+    ck_assert_int_eq(run(
+        "local m = level.matrix\n"
+        "assert(m:at(2, 3) == 6 and m:at(4, 1) == 12)\n"
+        "assert(m:at(5, 1) == nil and m:at(1, 0) == nil)\n"
+        "assert(m:at(3)[4] == 11)\n"
+        "local c = level.cube\n"
+        "assert(#c == 2 and #c[1] == 3 and #c[1][1] == 4)\n"
+        "assert(c[2][3][4] == 123 and c:at(2, 1, 3) == 102)\n"
+        "assert(c:at(1, 2)[1] == 10)\n"
+    ), LUA_OK);
+    ck_assert_int_ne(run("level.matrix:at(1, 1, 1)"), LUA_OK);
+    ck_assert_int_ne(run("level.matrix:at()"), LUA_OK);
+}
+END_TEST
+
+START_TEST(test_pointer_rows) {
+    ck_assert_int_eq(run(
+        "local r = level.rows\n"
+        "assert(#r == 3 and #r[1] == 4)\n"
+        "assert(r[1][1] == 0 and r[3][4] == 23 and r:at(2, 2) == 11)\n"
+        "r[2][3] = -1\n"
+        "local d = level.dynamic_rows\n"
+        "assert(#d == 3 and #d[3] == 4 and d:at(3, 4) == 23 and d[2][3] == -1)\n"
+    ), LUA_OK);
+    ck_assert_int_eq(row_data[1][2], -1);
+}
+END_TEST
+
+START_TEST(test_matrix_bulk) {
+    ck_assert_int_eq(run(
+        "local m = level.matrix\n"
+        "m[2]:fill(1)\n"
+        "assert(m[2]:sum() == 4)\n"
+        "assert(#m:tobytes() == 64)\n"
+        "m:view(3, 4)[1]:assign({9, 8, 7, 6})\n"
+        "assert(m:at(3, 4) == 6)\n"
+        "m[4]:sort(true)\n"
+        "assert(m:at(4, 1) == 15)\n"
+    ), LUA_OK);
+    ck_assert_float_eq(level->matrix[1][0], 1.0f);
+    ck_assert_float_eq(level->matrix[2][0], 9.0f);
+    ck_assert_float_eq(level->matrix[3][3], 12.0f);
+}
+END_TEST
+
+START_TEST(test_shared_desc) {
+    ck_assert_int_eq(run(
+        "level.before[1][2] = 5\n"
+        "level.after[2][3] = 7\n"
+        "assert(#level.before == 2 and #level.after[1] == 3)\n"
+        "assert(level.before:at(1, 2) == 5 and level.after:at(1, 2) == 0)\n"
+        "assert(level.after:at(2, 3) == 7 and level.before:at(2, 3) == 0)\n"
+    ), LUA_OK);
+    ck_assert_int_eq(level->before[0][1], 5);
+    ck_assert_int_eq(level->after[1][2], 7);
+}
+END_TEST
+
+static int nest_huge_rows(lua_State *state) {
+    LuastructArrayDesc row_desc, rows_desc;
+    luastruct_new_static_array_desc(state, LUAST_INT32, NULL, SIZE_MAX / 2, false, false, &row_desc);
+    luastruct_new_static_nested_array_desc(state, &row_desc, 2, false, false, &rows_desc);
+    luastruct_free_array_desc(&rows_desc);
+    return 0;
+}
+
+START_TEST(test_size_overflow) {
+    lua_pushcfunction(state, nest_huge_rows);
+    ck_assert_int_ne(lua_pcall(state, 0, 0, 0), LUA_OK);
+    ck_assert_ptr_nonnull(strstr(lua_tostring(state, -1), "Array too large"));
+    lua_pop(state, 1);
+}
+END_TEST
+
+Suite *create_suite(void) {
+    Suite *s = suite_create("array_nested");
+
+    TCase *index = tcase_create("index");
+    tcase_add_checked_fixture(index, setup, teardown);
+    tcase_add_test(index, test_matrix_index);
+    tcase_add_test(index, test_matrix_at);
+    tcase_add_test(index, test_pointer_rows);
+    tcase_add_test(index, test_shared_desc);
+    suite_add_tcase(s, index);
+
+    TCase *bulk = tcase_create("bulk");
+    tcase_add_checked_fixture(bulk, setup, teardown);
+    tcase_add_test(bulk, test_matrix_bulk);
+    suite_add_tcase(s, bulk);
+
+    TCase *errors = tcase_create("errors");
+    tcase_add_checked_fixture(errors, setup, teardown);
+    tcase_add_test(errors, test_size_overflow);
+    suite_add_tcase(s, errors);
+
+    return s;
+}
+
+int main(int argc, char *argv[]) {
+    Suite *s = create_suite();
+    SRunner *sr = srunner_create(s);
+
+    if(argc > 1) {
+        srunner_run(sr, NULL, argv[1], CK_NORMAL);
+    }
+    else {
+        srunner_run_all(sr, CK_NORMAL);
+    }
+
+    int number_failed = srunner_ntests_failed(sr);
+    srunner_free(sr);
+
+    return (number_failed == 0) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
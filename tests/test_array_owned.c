@@ -0,0 +1,197 @@
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <check.h>
+#include <lua.h>
+#include <lualib.h>
+#include <lauxlib.h>
+#include "test_array.h"
+#include "debug.h"
+
+typedef struct Vector2 {
+    float x;
+    float y;
+} Vector2;
+
+typedef struct Particle {
+    int32_t id;
+    Vector2 pos;
+    float mass;
+    int16_t history[4];
+} Particle;
+
+static lua_State *state = NULL;
+
+void setup(void) {
+    state = luaL_newstate();
+    luaL_openlibs(state);
+
+    LUAS_STRUCT(state, Vector2);
+    LUAS_PRIMITIVE_FIELD(state, Vector2, x, LUAST_FLOAT, 0);
+    LUAS_PRIMITIVE_FIELD(state, Vector2, y, LUAST_FLOAT, 0);
+    lua_pop(state, 1);
+
+    LUAS_STRUCT(state, Particle);
+    LUAS_PRIMITIVE_FIELD(state, Particle, id, LUAST_INT32, 0);
+    LUAS_OBJREF_FIELD(state, Particle, pos, Vector2, 0);
+    LUAS_PRIMITIVE_FIELD(state, Particle, mass, LUAST_FLOAT, 0);
+    LUAS_PRIMITIVE_ARRAY_FIELD(state, Particle, history, LUAST_INT16, 0);
+    lua_setglobal(state, "Particle");
+
+    lua_pushcfunction(state, luastruct_newarray);
+    lua_setglobal(state, "newarray");
+}
+
+void teardown(void) {
+    lua_gc(state, LUA_GCCOLLECT, 0);
+    lua_close(state);
+    state = NULL;
+}
+
+static int run(const char *statement) {
+    char script[2048];
+    snprintf(script, sizeof(script), "function test() %s end", statement);
+    int res = luaL_dostring(state, script);
+    lua_getglobal(state, "test");
+    res = lua_pcall(state, 0, 0, 0);
+    if(res != LUA_OK) {
+        lua_pop(state, 1);
+    }
+    return res;
+}
+
+START_TEST(test_struct_array) {
+    ck_assert_int_eq(run(
+        "local particles = Particle.newarray(100) "
+        "assert(#particles == 100) "
+        "for i, p in pairs(particles) do "
+        "  assert(p.id == 0 and p.mass == 0 and p.pos.x == 0 and p.history[4] == 0) "
+        "  p.id = i "
+        "  p.pos.x = i * 0.5 "
+        "  p.history[2] = -i "
+        "end "
+        "assert(particles[100].id == 100 and particles[7].pos.x == 3.5) "
+        "assert(particles:column('pos.x'):sum() == 2525) "
+        "assert(particles:at(3).history[2] == -3) "
+        "local other = Particle:newarray(3) "
+        "assert(#other == 3 and other[1].id == 0) "
+        "other[2] = particles[50] "
+        "assert(other[2].id == 50 and other[2].pos.x == 25) "
+        "assert(#Particle.newarray(0) == 0) "), LUA_OK);
+}
+END_TEST
+
+START_TEST(test_primitive_array) {
+    ck_assert_int_eq(run(
+        "local values = newarray('float', 1000) "
+        "for i = 1, #values do values[i] = i end "
+        "assert(values:sum() == 500500) "
+        "local flags = newarray('bool', 10) "
+        "flags[3] = true "
+        "assert(flags:count(true) == 1 and flags[1] == false) "
+        "local ids = newarray('uint16', 5) "
+        "ids:setrange(1, 5, 4, 3, 2, 1) "
+        "ids:sort() "
+        "assert(ids[1] == 1 and ids[5] == 5) "
+        "local particles = newarray('Particle', 2) "
+        "particles[2].id = 9 "
+        "assert(particles[2].id == 9) "), LUA_OK);
+
+    const char *types[] = { "int8", "float", "Particle" };
+    for(int i = 0; i < 3; i++) {
+        lua_pushcfunction(state, luastruct_newarray);
+        lua_pushstring(state, types[i]);
+        lua_pushinteger(state, 3);
+        ck_assert_int_eq(lua_pcall(state, 2, 1, 0), LUA_OK);
+        LuastructArray *array = lua_touserdata(state, -1);
+        ck_assert_uint_eq((uintptr_t)array->data % 64, 0);
+        lua_pop(state, 1);
+    }
+}
+END_TEST
+
+START_TEST(test_proxies_keep_buffer) {
+    ck_assert_int_eq(run(
+        "local weak = setmetatable({}, { __mode = 'v' }) "
+        "local function check(take) "
+        "  local particles = Particle.newarray(8) "
+        "  particles[3].id = 3 "
+        "  weak[1] = particles "
+        "  local proxy = take(particles) "
+        "  particles = nil "
+        "  collectgarbage() collectgarbage() "
+        "  assert(weak[1] ~= nil) "
+        "  local garbage = {} "
+        "  for i = 1, 100 do garbage[i] = Particle.newarray(8) end "
+        "  proxy = nil "
+        "  collectgarbage() collectgarbage() "
+        "  assert(weak[1] == nil) "
+        "end "
+        "check(function(a) local p = a[3] p.id = 30 return p end) "
+        "check(function(a) return a[3].pos end) "
+        "check(function(a) return a[3].history end) "
+        "check(function(a) return a:view(2, 4) end) "
+        "check(function(a) return a:column('mass') end) "
+        "check(function(a) local iter, array = pairs(a) local _, p = iter(array, 2) return p end) "
+        "check(function(a) return a:index_by('id'):get(3) end) "
+        "check(function(a) for _, p in a:where('id == 3', 'iter') do return p end end) "
+        "local p = Particle.newarray(4)[2] "
+        "collectgarbage() collectgarbage() "
+        "for i = 1, 100 do Particle.newarray(4) end "
+        "p.pos.y = 2 "
+        "p.history[4] = 7 "
+        "assert(p.pos.y == 2 and p.history[4] == 7) "), LUA_OK);
+}
+END_TEST
+
+START_TEST(test_newarray_errors) {
+    ck_assert_int_ne(run("newarray('string', 3)"), LUA_OK);
+    ck_assert_int_ne(run("newarray('Missing', 3)"), LUA_OK);
+    ck_assert_int_ne(run("newarray('int32', -1)"), LUA_OK);
+    ck_assert_int_ne(run("newarray('int32')"), LUA_OK);
+    ck_assert_int_ne(run("newarray({}, 3)"), LUA_OK);
+    ck_assert_int_ne(run("Particle.newarray('many')"), LUA_OK);
+    ck_assert_int_ne(run("newarray('float', math.maxinteger)"), LUA_OK);
+    ck_assert_int_eq(run("assert(Particle.missing == nil)"), LUA_OK);
+}
+END_TEST
+
+Suite *create_suite(void) {
+    Suite *s = suite_create("array_owned");
+
+    TCase *create = tcase_create("create");
+    tcase_add_checked_fixture(create, setup, teardown);
+    tcase_add_test(create, test_struct_array);
+    tcase_add_test(create, test_primitive_array);
+    suite_add_tcase(s, create);
+
+    TCase *lifetime = tcase_create("lifetime");
+    tcase_add_checked_fixture(lifetime, setup, teardown);
+    tcase_add_test(lifetime, test_proxies_keep_buffer);
+    suite_add_tcase(s, lifetime);
+
+    TCase *errors = tcase_create("errors");
+    tcase_add_checked_fixture(errors, setup, teardown);
+    tcase_add_test(errors, test_newarray_errors);
+    suite_add_tcase(s, errors);
+
+    return s;
+}
+
+int main(int argc, char *argv[]) {
+    Suite *s = create_suite();
+    SRunner *sr = srunner_create(s);
+
+    if(argc > 1) {
+        srunner_run(sr, NULL, argv[1], CK_NORMAL);
+    }
+    else {
+        srunner_run_all(sr, CK_NORMAL);
+    }
+
+    int number_failed = srunner_ntests_failed(sr);
+    srunner_free(sr);
+
+    return (number_failed == 0) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,173 @@
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <check.h>
+#include <lua.h>
+#include <lualib.h>
+#include <lauxlib.h>
+#include "test_array.h"
+#include "array.h"
+#include "debug.h"
+
+#define BODY_COUNT 200
+
+typedef struct Body {
+    int32_t id;
+    float mass;
+    int32_t group;
+} Body;
+
+typedef struct Scene {
+    int32_t version;
+    Body *bodies[BODY_COUNT];
+    float *masses[BODY_COUNT];
+    int32_t *ids[BODY_COUNT];
+} Scene;
+
+static lua_State *state = NULL;
+static Body *pool;
+static Scene *scene;
+
+void setup(void) {
+    state = luaL_newstate();
+    luaL_openlibs(state);
+
+    LUAS_STRUCT(state, Body);
+    LUAS_PRIMITIVE_FIELD(state, Body, id, LUAST_INT32, 0);
+    LUAS_PRIMITIVE_FIELD(state, Body, mass, LUAST_FLOAT, 0);
+    LUAS_PRIMITIVE_FIELD(state, Body, group, LUAST_INT32, 0);
+    lua_pop(state, 1);
+
+    LUAS_STRUCT(state, Scene);
+    LUAS_OBJREF_ARRAY_FIELD(state, Scene, bodies, Body, LUAS_FIELD_POINTER);
+    LUAS_PRIMITIVE_ARRAY_FIELD(state, Scene, masses, LUAST_FLOAT, LUAS_FIELD_POINTER);
+    LUAS_PRIMITIVE_ARRAY_FIELD(state, Scene, ids, LUAST_INT32, LUAS_FIELD_POINTER);
+    lua_pop(state, 1);
+
+    // Element i of the arrays points to a body far from element i - 1 in the pool
+    pool = calloc(BODY_COUNT, sizeof(Body));
+    scene = calloc(1, sizeof(Scene));
+    for(int i = 0; i < BODY_COUNT; i++) {
+        Body *body = &pool[(i * 77) % BODY_COUNT];
+        body->id = i + 1;
+        body->mass = (float)(i + 1);
+        body->group = i % 4;
+        scene->bodies[i] = body;
+        scene->masses[i] = &body->mass;
+        scene->ids[i] = &body->id;
+    }
+}
+
+void teardown(void) {
+    lua_gc(state, LUA_GCCOLLECT, 0);
+    lua_close(state);
+    state = NULL;
+    free(scene);
+    free(pool);
+}
+
+static int run(const char *statement) {
+    char script[2048];
+    snprintf(script, sizeof(script), "function test(obj) %s end", statement);
+    int res = luaL_dostring(state, script);
+    lua_getglobal(state, "test");
+    LUAS_OBJECT(state, Scene, scene, false);
+    res = lua_pcall(state, 1, 0, 0);
+    if(res != LUA_OK) {
+        lua_pop(state, 1);
+    }
+    return res;
+}
+
+/*
+ * Every check runs with prefetching disabled, one element ahead (where the
+ * slot prefetch reaches the end of the array first) and at the default distance.
+ */
+static const size_t distances[] = { 0, 1, LUAS_PREFETCH_DISTANCE };
+
+START_TEST(test_keyed) {
+    for(size_t d = 0; d < sizeof(distances) / sizeof(distances[0]); d++) {
+        luastruct_set_prefetch_distance(state, distances[d]);
+        ck_assert_int_eq(run(
+            "local bodies = obj.bodies "
+            "assert(bodies:index_by('id'):get(123).mass == 123) "
+            "local stats = bodies:aggregate{ by = 'group', sum = 'id', count = true } "
+            "assert(stats[0].count == 50 and stats[0].sum == 4950) "
+            "local n = 0 "
+            "for i, body in pairs(bodies) do n = n + 1 assert(body.id == i) end "
+            "assert(n == 200) "
+            "local iter, array = pairs(bodies) "
+            "local i, body = iter(array, 199) "
+            "assert(i == 200 and body.id == 200 and iter(array, 200) == nil) "), LUA_OK);
+    }
+}
+END_TEST
+
+START_TEST(test_bulk) {
+    for(size_t d = 0; d < sizeof(distances) / sizeof(distances[0]); d++) {
+        luastruct_set_prefetch_distance(state, distances[d]);
+        ck_assert_int_eq(run(
+            "local ids = obj.ids "
+            "local values = {} "
+            "for i = 1, 200 do values[i] = i end "
+            "assert(ids:tobytes() == string.pack(string.rep('i4', 200), table.unpack(values))) "
+            "ids:setrange(101, 5, 5, 5) "
+            "assert(ids[100] == 100 and ids[103] == 5 and ids[104] == 104) "
+            "ids:assign(values) "
+            "assert(ids:sum() == 20100) "
+            "obj.masses:setrange(198, -1, -2, -3) "
+            "assert(obj.bodies[199].mass == -2) "
+            "obj.masses:setrange(198, 198, 199, 200) "
+            "assert(obj.masses:sum() == 20100) "), LUA_OK);
+    }
+    for(int i = 0; i < BODY_COUNT; i++) {
+        ck_assert_int_eq(scene->bodies[i]->id, i + 1);
+        ck_assert_float_eq(scene->bodies[i]->mass, (float)(i + 1));
+    }
+}
+END_TEST
+
+START_TEST(test_per_state) {
+    lua_State *other = luaL_newstate();
+    ck_assert_uint_eq(get_prefetch_distance(state), LUAS_PREFETCH_DISTANCE);
+    luastruct_set_prefetch_distance(state, 0);
+    ck_assert_uint_eq(get_prefetch_distance(state), 0);
+    ck_assert_uint_eq(get_prefetch_distance(other), LUAS_PREFETCH_DISTANCE);
+    lua_close(other);
+}
+END_TEST
+
+Suite *create_suite(void) {
+    Suite *s = suite_create("array_prefetch");
+
+    TCase *keyed = tcase_create("keyed");
+    tcase_add_checked_fixture(keyed, setup, teardown);
+    tcase_add_test(keyed, test_keyed);
+    tcase_add_test(keyed, test_per_state);
+    suite_add_tcase(s, keyed);
+
+    TCase *bulk = tcase_create("bulk");
+    tcase_add_checked_fixture(bulk, setup, teardown);
+    tcase_add_test(bulk, test_bulk);
+    suite_add_tcase(s, bulk);
+
+    return s;
+}
+
+int main(int argc, char *argv[]) {
+    Suite *s = create_suite();
+    SRunner *sr = srunner_create(s);
+
+    if(argc > 1) {
+        srunner_run(sr, NULL, argv[1], CK_NORMAL);
+    }
+    else {
+        srunner_run_all(sr, CK_NORMAL);
+    }
+
+    int number_failed = srunner_ntests_failed(sr);
+    srunner_free(sr);
+
+    return (number_failed == 0) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
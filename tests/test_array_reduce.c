@@ -0,0 +1,225 @@
+#include <stdlib.h>
+#include <stdint.h>
+#include <check.h>
+#include <lua.h>
+#include <lualib.h>
+#include <lauxlib.h>
+#include "test_array.h"
+#include "simd.h"
+#include "debug.h"
+
+#define LARGE_ARRAY_SIZE 1027
+
+typedef struct LargeStruct {
+    float floats[LARGE_ARRAY_SIZE];
+    float other_floats[LARGE_ARRAY_SIZE];
+    int32_t ints[LARGE_ARRAY_SIZE];
+    int32_t other_ints[LARGE_ARRAY_SIZE];
+} LargeStruct;
+
+static lua_State *state = NULL;
+static TestStruct test_struct;
+static LargeStruct large_struct;
+
+void setup(void) {
+    state = luaL_newstate();
+    init_test_struct(&test_struct);
+    define_test_struct(state);
+
+    LUAS_STRUCT(state, LargeStruct);
+    LUAS_PRIMITIVE_ARRAY_FIELD(state, LargeStruct, floats, LUAST_FLOAT, 0);
+    LUAS_PRIMITIVE_ARRAY_FIELD(state, LargeStruct, other_floats, LUAST_FLOAT, 0);
+    LUAS_PRIMITIVE_ARRAY_FIELD(state, LargeStruct, ints, LUAST_INT32, 0);
+    LUAS_PRIMITIVE_ARRAY_FIELD(state, LargeStruct, other_ints, LUAST_INT32, 0);
+    lua_pop(state, 1);
+    for(int i = 0; i < LARGE_ARRAY_SIZE; i++) {
+        large_struct.floats[i] = (i % 17) * 0.5f - 3.0f;
+        large_struct.other_floats[i] = (i % 5) * 0.25f;
+        large_struct.ints[i] = (i * 7919) % 20011 - 10000;
+        large_struct.other_ints[i] = i % 3 - 1;
+    }
+    large_struct.floats[LARGE_ARRAY_SIZE - 1] = 100.0f;
+    large_struct.ints[LARGE_ARRAY_SIZE - 2] = INT32_MIN;
+
+    LUAS_OBJECT(state, TestStruct, &test_struct, false);
+}
+
+void teardown(void) {
+    simd_set_level(LUAS_SIMD_AVX2);
+    lua_gc(state, LUA_GCCOLLECT, 0);
+    lua_close(state);
+    state = NULL;
+}
+
+static int call_method(const char *array, const char *method, int n_results) {
+    lua_getfield(state, -1, array);
+    lua_getfield(state, -1, method);
+    lua_insert(state, -2);
+    int res = lua_pcall(state, 1, n_results, 0);
+    if(res != LUA_OK) {
+        lua_pop(state, 1);
+    }
+    return res;
+}
+
+START_TEST(test_sum_integers) {
+    for(int i = 0; i < 5; i++) {
+        test_struct.static_int8[i] = -100 + i;
+        test_struct.static_uint32[i] = UINT32_MAX - i;
+        test_struct.dynamic_int16[i] = i * 1000;
+    }
+    ck_assert_int_eq(call_method("static_int8", "sum", 1), LUA_OK);
+    ck_assert_int_eq(lua_tointeger(state, -1), -490);
+    lua_pop(state, 1);
+    ck_assert_int_eq(call_method("static_uint32", "sum", 1), LUA_OK);
+    ck_assert_int_eq(lua_tointeger(state, -1), 5 * (lua_Integer)UINT32_MAX - 10);
+    lua_pop(state, 1);
+    ck_assert_int_eq(call_method("dynamic_int16", "sum", 1), LUA_OK);
+    ck_assert_int_eq(lua_tointeger(state, -1), 10000);
+    lua_pop(state, 1);
+}
+END_TEST
+
+START_TEST(test_sum_float) {
+    for(int i = 0; i < 5; i++) {
+        test_struct.static_number[i] = i + 0.5f;
+    }
+    ck_assert_int_eq(call_method("static_number", "sum", 1), LUA_OK);
+    ck_assert_float_eq(lua_tonumber(state, -1), 12.5);
+    lua_pop(state, 1);
+    ck_assert_int_eq(call_method("static_number", "mean", 1), LUA_OK);
+    ck_assert_float_eq(lua_tonumber(state, -1), 2.5);
+    lua_pop(state, 1);
+}
+END_TEST
+
+START_TEST(test_minmax_integers) {
+    int16_t values[5] = { 3, -7, 12, 0, -2 };
+    for(int i = 0; i < 5; i++) {
+        test_struct.dynamic_int16[i] = values[i];
+    }
+    ck_assert_int_eq(call_method("dynamic_int16", "minmax", 2), LUA_OK);
+    ck_assert_int_eq(lua_tointeger(state, -2), -7);
+    ck_assert_int_eq(lua_tointeger(state, -1), 12);
+    lua_pop(state, 2);
+    ck_assert_int_eq(call_method("dynamic_int16", "min", 1), LUA_OK);
+    ck_assert_int_eq(lua_tointeger(state, -1), -7);
+    lua_pop(state, 1);
+    ck_assert_int_eq(call_method("dynamic_int16", "max", 1), LUA_OK);
+    ck_assert_int_eq(lua_tointeger(state, -1), 12);
+    lua_pop(state, 1);
+}
+END_TEST
+
+START_TEST(test_not_numeric) {
+    ck_assert_int_ne(call_method("static_boolean", "sum", 1), LUA_OK);
+    ck_assert_int_ne(call_method("static_sub_struct", "max", 1), LUA_OK);
+}
+END_TEST
+
+static void check_large_reductions(void) {
+    double float_sum = 0, float_dot = 0;
+    float float_min = large_struct.floats[0], float_max = large_struct.floats[0];
+    int64_t int_sum = 0, int_dot = 0;
+    int32_t int_min = large_struct.ints[0], int_max = large_struct.ints[0];
+    for(int i = 0; i < LARGE_ARRAY_SIZE; i++) {
+        float_sum += large_struct.floats[i];
+        float_dot += (double)large_struct.floats[i] * large_struct.other_floats[i];
+        float_min = large_struct.floats[i] < float_min ? large_struct.floats[i] : float_min;
+        float_max = large_struct.floats[i] > float_max ? large_struct.floats[i] : float_max;
+        int_sum += large_struct.ints[i];
+        int_dot += (int64_t)large_struct.ints[i] * large_struct.other_ints[i];
+        int_min = large_struct.ints[i] < int_min ? large_struct.ints[i] : int_min;
+        int_max = large_struct.ints[i] > int_max ? large_struct.ints[i] : int_max;
+    }
+
+    LUAS_OBJECT(state, LargeStruct, &large_struct, false);
+    ck_assert_int_eq(call_method("floats", "sum", 1), LUA_OK);
+    ck_assert_float_eq(lua_tonumber(state, -1), float_sum);
+    lua_pop(state, 1);
+    ck_assert_int_eq(call_method("floats", "minmax", 2), LUA_OK);
+    ck_assert_float_eq(lua_tonumber(state, -2), float_min);
+    ck_assert_float_eq(lua_tonumber(state, -1), float_max);
+    lua_pop(state, 2);
+    ck_assert_int_eq(call_method("ints", "sum", 1), LUA_OK);
+    ck_assert_int_eq(lua_tointeger(state, -1), int_sum);
+    lua_pop(state, 1);
+    ck_assert_int_eq(call_method("ints", "minmax", 2), LUA_OK);
+    ck_assert_int_eq(lua_tointeger(state, -2), int_min);
+    ck_assert_int_eq(lua_tointeger(state, -1), int_max);
+    lua_pop(state, 2);
+
+    int res = luaL_dostring(state, "function test(obj) return obj.floats:dot(obj.other_floats), obj.ints:dot(obj.other_ints) end");
+    lua_getglobal(state, "test");
+    lua_pushvalue(state, -2);
+    ck_assert_int_eq(lua_pcall(state, 1, 2, 0), LUA_OK);
+    ck_assert_float_eq(lua_tonumber(state, -2), float_dot);
+    ck_assert_int_eq(lua_tointeger(state, -1), int_dot);
+    lua_pop(state, 3);
+}
+
+START_TEST(test_large_scalar) {
+    ck_assert_int_eq(simd_set_level(LUAS_SIMD_SCALAR), LUAS_SIMD_SCALAR);
+    check_large_reductions();
+}
+END_TEST
+
+START_TEST(test_large_sse2) {
+    simd_set_level(LUAS_SIMD_SSE2);
+    check_large_reductions();
+}
+END_TEST
+
+START_TEST(test_large_avx2) {
+    simd_set_level(LUAS_SIMD_AVX2);
+    check_large_reductions();
+}
+END_TEST
+
+START_TEST(test_dot_mismatch) {
+    int res = luaL_dostring(state, "function test(obj) return obj.static_int32:dot(obj.static_int16) end");
+    lua_getglobal(state, "test");
+    lua_pushvalue(state, -2);
+    ck_assert_int_ne(lua_pcall(state, 1, 1, 0), LUA_OK);
+    lua_pop(state, 1);
+}
+END_TEST
+
+Suite *create_suite(void) {
+    Suite *s = suite_create("array_reduce_methods");
+
+    TCase *primitives = tcase_create("primitives");
+    tcase_add_checked_fixture(primitives, setup, teardown);
+    tcase_add_test(primitives, test_sum_integers);
+    tcase_add_test(primitives, test_sum_float);
+    tcase_add_test(primitives, test_minmax_integers);
+    tcase_add_test(primitives, test_not_numeric);
+    tcase_add_test(primitives, test_dot_mismatch);
+    suite_add_tcase(s, primitives);
+
+    TCase *simd = tcase_create("simd");
+    tcase_add_checked_fixture(simd, setup, teardown);
+    tcase_add_test(simd, test_large_scalar);
+    tcase_add_test(simd, test_large_sse2);
+    tcase_add_test(simd, test_large_avx2);
+    suite_add_tcase(s, simd);
+
+    return s;
+}
+
+int main(int argc, char *argv[]) {
+    Suite *s = create_suite();
+    SRunner *sr = srunner_create(s);
+
+    if(argc > 1) {
+        srunner_run(sr, NULL, argv[1], CK_NORMAL);
+    }
+    else {
+        srunner_run_all(sr, CK_NORMAL);
+    }
+
+    int number_failed = srunner_ntests_failed(sr);
+    srunner_free(sr);
+
+    return (number_failed == 0) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,298 @@
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <check.h>
+#include <lua.h>
+#include <lualib.h>
+#include <lauxlib.h>
+#include "test_array.h"
+#include "simd.h"
+#include "debug.h"
+
+#define TELEMETRY_CAPACITY 64
+#define TELEMETRY_HEAD 50
+#define TELEMETRY_COUNT 40
+#define EVENT_CAPACITY 5
+
+typedef struct Event {
+    int32_t id;
+    float value;
+} Event;
+
+typedef struct Telemetry {
+    float samples[TELEMETRY_CAPACITY];
+    uint32_t head;
+    uint32_t count;
+} Telemetry;
+
+typedef struct EventLog {
+    Event events[EVENT_CAPACITY];
+    int64_t head;
+    int64_t count;
+} EventLog;
+
+typedef struct History {
+    int32_t version;
+    Telemetry telemetry;
+    EventLog log;
+    Telemetry frozen;
+    Telemetry primary;
+    Telemetry backup;
+} History;
+
+static lua_State *state = NULL;
+static History history;
+
+static float *telemetry_sample(size_t logical) {
+    return &history.telemetry.samples[(TELEMETRY_HEAD + logical) % TELEMETRY_CAPACITY];
+}
+
+void setup(void) {
+    state = luaL_newstate();
+    luaL_openlibs(state);
+
+    LUAS_STRUCT(state, Event);
+    LUAS_PRIMITIVE_FIELD(state, Event, id, LUAST_INT32, 0);
+    LUAS_PRIMITIVE_FIELD(state, Event, value, LUAST_FLOAT, 0);
+    lua_pop(state, 1);
+
+    LUAS_STRUCT(state, History);
+    LUAS_PRIMITIVE_RING_FIELD(state, History, telemetry, LUAST_FLOAT, LUAS_RING_LAYOUT(Telemetry, samples, head, count, LUAST_UINT32), 0);
+    LUAS_OBJREF_RING_FIELD(state, History, log, Event, LUAS_RING_LAYOUT(EventLog, events, head, count, LUAST_INT64), 0);
+    LUAS_PRIMITIVE_RING_FIELD(state, History, frozen, LUAST_FLOAT, LUAS_RING_LAYOUT(Telemetry, samples, head, count, LUAST_UINT32), LUAS_FIELD_READONLY);
+    {
+        // One descriptor shared by two fields of the same layout
+        LuastructArrayDesc desc;
+        LuastructRingDesc layout = LUAS_RING_LAYOUT(Telemetry, samples, head, count, LUAST_UINT32);
+        luastruct_new_ring_desc(state, LUAST_FLOAT, NULL, &layout, false, &desc);
+        luastruct_new_struct_array_field(state, "primary", &desc, offsetof(History, primary), false, false);
+        luastruct_new_struct_array_field(state, "backup", &desc, offsetof(History, backup), false, false);
+        luastruct_free_array_desc(&desc);
+    }
+    lua_pop(state, 1);
+
+    memset(&history, 0, sizeof(history));
+    // Slots outside of the ring hold a value no test expects to see
+    for(size_t i = 0; i < TELEMETRY_CAPACITY; i++) {
+        history.telemetry.samples[i] = -1000;
+    }
+    history.telemetry.head = TELEMETRY_HEAD;
+    history.telemetry.count = TELEMETRY_COUNT;
+    for(size_t i = 0; i < TELEMETRY_COUNT; i++) {
+        *telemetry_sample(i) = i + 1;
+    }
+    history.log.head = 3;
+    history.log.count = 4;
+    for(size_t i = 0; i < 4; i++) {
+        Event *event = &history.log.events[(3 + i) % EVENT_CAPACITY];
+        event->id = i + 1;
+        event->value = (i + 1) * 0.5f;
+    }
+    history.frozen = history.telemetry;
+}
+
+void teardown(void) {
+    simd_set_level(LUAS_SIMD_AVX2);
+    lua_gc(state, LUA_GCCOLLECT, 0);
+    lua_close(state);
+    state = NULL;
+}
+
+static int run(const char *statement) {
+    char script[2048];
+    snprintf(script, sizeof(script), "function test(obj) %s end", statement);
+    int res = luaL_dostring(state, script);
+    lua_getglobal(state, "test");
+    LUAS_OBJECT(state, History, &history, false);
+    res = lua_pcall(state, 1, 0, 0);
+    if(res != LUA_OK) {
+        lua_pop(state, 1);
+    }
+    return res;
+}
+
+START_TEST(test_logical_order) {
+    ck_assert_int_eq(run(
+        "local ring = obj.telemetry "
+        "assert(#ring == 40 and ring[1] == 1 and ring[14] == 14 and ring[15] == 15 and ring[40] == 40) "
+        "assert(ring[0] == nil and ring[41] == nil and ring:at(20) == 20) "
+        "local n = 0 "
+        "for i, v in pairs(ring) do n = n + 1 assert(v == i) end "
+        "assert(n == 40) "
+        "ring[15] = -15 "
+        "ring:setrange(14, 140, 150) "
+        "assert(ring[14] == 140 and ring[15] == 150) "
+        "local log = obj.log "
+        "assert(#log == 4 and log[1].id == 1 and log[3].id == 3 and log[4].value == 2) "
+        "log[3].value = 30 "), LUA_OK);
+    ck_assert_float_eq(*telemetry_sample(13), 140.0f);
+    ck_assert_float_eq(history.telemetry.samples[0], 150.0f);
+    ck_assert_float_eq(history.log.events[0].value, 30.0f);
+
+    // C code advances the ring behind the back of the array object
+    ck_assert_int_eq(run("ring = obj.telemetry"), LUA_OK);
+    history.telemetry.head = 0;
+    history.telemetry.count = 2;
+    ck_assert_int_eq(run("assert(#ring == 2 and ring[1] == 150 and ring[2] == 16 and ring[3] == nil)"), LUA_OK);
+}
+END_TEST
+
+static void check_reductions(void) {
+    ck_assert_int_eq(run(
+        "local ring = obj.telemetry "
+        "assert(ring:sum() == 820 and ring:mean() == 20.5) "
+        "local low, high = ring:minmax() "
+        "assert(low == 1 and high == 40 and ring:min() == 1 and ring:max() == 40) "
+        "assert(ring:count(15) == 1 and ring:find(15) == 15 and ring:find(14, 15) == nil) "
+        "ring[2] = 15 "
+        "local found = ring:indexof_all(15) "
+        "assert(#found == 2 and found[1] == 2 and found[2] == 15) "
+        "assert(obj.log:column('value'):sum() == 5) "
+        "assert(obj.log:column('id'):max() == 4) "), LUA_OK);
+}
+
+START_TEST(test_reductions_scalar) {
+    simd_set_level(LUAS_SIMD_SCALAR);
+    check_reductions();
+}
+END_TEST
+
+START_TEST(test_reductions_avx2) {
+    simd_set_level(LUAS_SIMD_AVX2);
+    check_reductions();
+}
+END_TEST
+
+START_TEST(test_bulk) {
+    ck_assert_int_eq(run(
+        "local ring = obj.telemetry "
+        "local values = {} "
+        "for i = 1, 40 do values[i] = i end "
+        "assert(ring:tobytes() == string.pack(string.rep('f', 40), table.unpack(values))) "
+        "assert(ring:tobytes(14, 15) == string.pack('ff', 14, 15)) "
+        "assert(obj.log:tobytes(2, 3) == string.pack('i4fi4f', 2, 1, 3, 1.5)) "
+        "ring:frombytes(string.pack('fff', 7, 8, 9), 13) "
+        "assert(ring[13] == 7 and ring[14] == 8 and ring[15] == 9 and ring[16] == 16) "
+        "ring:fill(3, 10, 20) "
+        "assert(ring:sum() == 820 - 165 + 33 and ring[9] == 9 and ring[21] == 21) "
+        "ring:assign(values) "
+        "assert(ring:sum() == 820) "), LUA_OK);
+    for(size_t i = TELEMETRY_COUNT; i < TELEMETRY_CAPACITY; i++) {
+        ck_assert_float_eq(*telemetry_sample(i), -1000.0f);
+    }
+}
+END_TEST
+
+START_TEST(test_shared_desc) {
+    history.primary.count = 2;
+    history.backup.head = TELEMETRY_CAPACITY - 1;
+    history.backup.count = 3;
+    ck_assert_int_eq(run(
+        "obj.primary[2] = 5 "
+        "obj.backup:fill(2) "
+        "assert(#obj.primary == 2 and obj.primary:sum() == 5 and obj.backup:sum() == 6) "), LUA_OK);
+    ck_assert_float_eq(history.primary.samples[1], 5.0f);
+    ck_assert_float_eq(history.backup.samples[1], 2.0f);
+}
+END_TEST
+
+START_TEST(test_wrapped_methods) {
+    // backup wraps after its 34th element and telemetry after its 14th
+    history.backup.head = 30;
+    history.backup.count = TELEMETRY_COUNT;
+    ck_assert_int_eq(run(
+        "local ring = obj.telemetry "
+        "obj.backup:fill(2) "
+        "assert(ring:dot(obj.frozen) == 22140 and ring:dot(obj.backup) == 1640 and obj.backup:dot(ring) == 1640) "
+        "local stats = ring:aggregate({ count = true, sum = true, min = true, max = true }) "
+        "assert(stats.count == 40 and stats.sum == 820 and stats.min == 1 and stats.max == 40) "
+        "local groups = obj.log:aggregate({ by = 'id', sum = 'value' }) "
+        "assert(groups[1].sum == 0.5 and groups[4].sum == 2) "
+        "local idx = obj.log:index_by('id') "
+        "assert(#idx == 4 and select(2, idx:get(2)) == 2 and select(2, idx:get(3)) == 3 and idx:get(4).value == 2) "
+        "local found = obj.log:where('id >= 2') "
+        "assert(#found == 3 and found[1] == 2 and found[3] == 4 and obj.log:where('id ~= 3', 'count') == 3) "
+        "local ids = {} "
+        "for i, event in obj.log:where({ id = {'>', 1} }, 'iter') do ids[#ids + 1] = event.id end "
+        "assert(#ids == 3 and ids[1] == 2 and ids[3] == 4) "
+        "ring:add(1) "
+        "assert(ring[1] == 2 and ring[14] == 15 and ring[15] == 16 and ring[40] == 41) "
+        "ring:axpy(2, obj.backup) "
+        "assert(ring[1] == 6 and ring[40] == 45) "
+        "ring:add(ring) "
+        "assert(ring[1] == 12 and ring[15] == 40 and ring[40] == 90) "
+        "assert(obj.log:bsearch('id', 3) == 3 and obj.log:lower_bound('id', 2.5) == 3 and obj.log:upper_bound('id', 4) == 5) "
+        "assert(obj.frozen:bsearch(15) == 15 and obj.frozen:bsearch(14.5) == nil and obj.frozen:lower_bound(40) == 40) "
+        "obj.log:column('id'):mul(10) "
+        "assert(obj.log[1].id == 10 and obj.log[3].id == 30 and obj.log[4].id == 40) "), LUA_OK);
+    for(size_t i = TELEMETRY_COUNT; i < TELEMETRY_CAPACITY; i++) {
+        ck_assert_float_eq(*telemetry_sample(i), -1000.0f);
+    }
+}
+END_TEST
+
+START_TEST(test_ring_errors) {
+    ck_assert_int_ne(run("obj.telemetry:sort()"), LUA_OK);
+    ck_assert_int_ne(run("obj.telemetry:view(10, 20)"), LUA_OK);
+    ck_assert_int_eq(run("assert(obj.telemetry:view(1, 14):sum() == 105)"), LUA_OK);
+    ck_assert_int_eq(run("assert(obj.telemetry:view(15, 40):sum() == 715)"), LUA_OK);
+    ck_assert_int_ne(run("obj.frozen[1] = 2"), LUA_OK);
+    ck_assert_int_ne(run("obj.telemetry[41] = 2"), LUA_OK);
+    ck_assert_int_ne(run("obj.telemetry:dot(obj.log:column('value'))"), LUA_OK);
+
+    history.telemetry.head = TELEMETRY_CAPACITY;
+    ck_assert_int_ne(run("return #obj.telemetry"), LUA_OK);
+    history.telemetry.head = 0;
+    history.telemetry.count = TELEMETRY_CAPACITY + 1;
+    ck_assert_int_ne(run("return #obj.telemetry"), LUA_OK);
+    history.telemetry.count = TELEMETRY_CAPACITY;
+    ck_assert_int_eq(run("obj.telemetry:sort() assert(obj.telemetry[1] == -1000)"), LUA_OK);
+}
+END_TEST
+
+Suite *create_suite(void) {
+    Suite *s = suite_create("array_ring");
+
+    TCase *indexing = tcase_create("indexing");
+    tcase_add_checked_fixture(indexing, setup, teardown);
+    tcase_add_test(indexing, test_logical_order);
+    tcase_add_test(indexing, test_shared_desc);
+    suite_add_tcase(s, indexing);
+
+    TCase *reductions = tcase_create("reductions");
+    tcase_add_checked_fixture(reductions, setup, teardown);
+    tcase_add_test(reductions, test_reductions_scalar);
+    tcase_add_test(reductions, test_reductions_avx2);
+    suite_add_tcase(s, reductions);
+
+    TCase *bulk = tcase_create("bulk");
+    tcase_add_checked_fixture(bulk, setup, teardown);
+    tcase_add_test(bulk, test_bulk);
+    tcase_add_test(bulk, test_wrapped_methods);
+    suite_add_tcase(s, bulk);
+
+    TCase *errors = tcase_create("errors");
+    tcase_add_checked_fixture(errors, setup, teardown);
+    tcase_add_test(errors, test_ring_errors);
+    suite_add_tcase(s, errors);
+
+    return s;
+}
+
+int main(int argc, char *argv[]) {
+    Suite *s = create_suite();
+    SRunner *sr = srunner_create(s);
+
+    if(argc > 1) {
+        srunner_run(sr, NULL, argv[1], CK_NORMAL);
+    }
+    else {
+        srunner_run_all(sr, CK_NORMAL);
+    }
+
+    int number_failed = srunner_ntests_failed(sr);
+    srunner_free(sr);
+
+    return (number_failed == 0) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
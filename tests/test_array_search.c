@@ -0,0 +1,326 @@
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <check.h>
+#include <lua.h>
+#include <lualib.h>
+#include <lauxlib.h>
+#include "test_array.h"
+#include "simd.h"
+#include "debug.h"
+
+#define LARGE_ARRAY_SIZE 203
+
+typedef struct LargeStruct {
+    uint8_t bytes[LARGE_ARRAY_SIZE];
+    int16_t shorts[LARGE_ARRAY_SIZE];
+    int32_t ints[LARGE_ARRAY_SIZE];
+    int64_t longs[LARGE_ARRAY_SIZE];
+    float floats[LARGE_ARRAY_SIZE];
+} LargeStruct;
+
+typedef struct SoundEntry {
+    uint32_t id;
+    float volume;
+} SoundEntry;
+
+typedef struct SoundTable {
+    SoundEntry sounds[1000];
+} SoundTable;
+
+static lua_State *state = NULL;
+static TestStruct test_struct;
+static LargeStruct large_struct;
+static SoundTable sound_table;
+
+void setup(void) {
+    state = luaL_newstate();
+    init_test_struct(&test_struct);
+    define_test_struct(state);
+
+    LUAS_STRUCT(state, LargeStruct);
+    LUAS_PRIMITIVE_ARRAY_FIELD(state, LargeStruct, bytes, LUAST_UINT8, 0);
+    LUAS_PRIMITIVE_ARRAY_FIELD(state, LargeStruct, shorts, LUAST_INT16, 0);
+    LUAS_PRIMITIVE_ARRAY_FIELD(state, LargeStruct, ints, LUAST_INT32, 0);
+    LUAS_PRIMITIVE_ARRAY_FIELD(state, LargeStruct, longs, LUAST_INT64, 0);
+    LUAS_PRIMITIVE_ARRAY_FIELD(state, LargeStruct, floats, LUAST_FLOAT, 0);
+    lua_pop(state, 1);
+
+    LUAS_STRUCT(state, SoundEntry);
+    LUAS_PRIMITIVE_FIELD(state, SoundEntry, id, LUAST_UINT32, 0);
+    LUAS_PRIMITIVE_FIELD(state, SoundEntry, volume, LUAST_FLOAT, 0);
+    lua_pop(state, 1);
+    LUAS_STRUCT(state, SoundTable);
+    LUAS_OBJREF_ARRAY_FIELD(state, SoundTable, sounds, SoundEntry, 0);
+    lua_pop(state, 1);
+    for(int i = 0; i < 1000; i++) {
+        sound_table.sounds[i].id = i * 2;
+        sound_table.sounds[i].volume = i * 0.5f;
+    }
+
+    for(int i = 0; i < LARGE_ARRAY_SIZE; i++) {
+        large_struct.bytes[i] = i % 7;
+        large_struct.shorts[i] = i % 7 - 3;
+        large_struct.ints[i] = (i % 7) * 100000;
+        large_struct.longs[i] = (i % 7) * 10000000000LL;
+        large_struct.floats[i] = (i % 7) * 0.5f;
+    }
+
+    LUAS_OBJECT(state, TestStruct, &test_struct, false);
+}
+
+void teardown(void) {
+    simd_set_level(LUAS_SIMD_AVX2);
+    lua_gc(state, LUA_GCCOLLECT, 0);
+    lua_close(state);
+    state = NULL;
+}
+
+static int eval(const char *expression, int n_results) {
+    char script[256];
+    snprintf(script, sizeof(script), "function test(obj) return %s end", expression);
+    int res = luaL_dostring(state, script);
+    lua_getglobal(state, "test");
+    lua_pushvalue(state, -2);
+    res = lua_pcall(state, 1, n_results, 0);
+    if(res != LUA_OK) {
+        lua_pop(state, 1);
+    }
+    return res;
+}
+
+START_TEST(test_find_static_int32) {
+    int32_t values[5] = { 4, 8, 15, 8, 23 };
+    for(int i = 0; i < 5; i++) {
+        test_struct.static_int32[i] = values[i];
+    }
+    ck_assert_int_eq(eval("obj.static_int32:find(8)", 1), LUA_OK);
+    ck_assert_int_eq(lua_tointeger(state, -1), 2);
+    lua_pop(state, 1);
+    ck_assert_int_eq(eval("obj.static_int32:find(42)", 1), LUA_OK);
+    ck_assert_int_eq(lua_isnil(state, -1), 1);
+    lua_pop(state, 1);
+    ck_assert_int_eq(eval("obj.static_int32:count(8)", 1), LUA_OK);
+    ck_assert_int_eq(lua_tointeger(state, -1), 2);
+    lua_pop(state, 1);
+}
+END_TEST
+
+START_TEST(test_find_unrepresentable) {
+    test_struct.static_uint8[0] = 255;
+    ck_assert_int_eq(eval("obj.static_uint8:find(-1)", 1), LUA_OK);
+    ck_assert_int_eq(lua_isnil(state, -1), 1);
+    lua_pop(state, 1);
+    ck_assert_int_eq(eval("obj.static_uint8:count(255.5)", 1), LUA_OK);
+    ck_assert_int_eq(lua_tointeger(state, -1), 0);
+    lua_pop(state, 1);
+    ck_assert_int_eq(eval("obj.static_uint8:find(255.0)", 1), LUA_OK);
+    ck_assert_int_eq(lua_tointeger(state, -1), 1);
+    lua_pop(state, 1);
+}
+END_TEST
+
+START_TEST(test_find_float_and_boolean) {
+    test_struct.dynamic_number[3] = 0.25f;
+    test_struct.static_boolean[2] = true;
+    ck_assert_int_eq(eval("obj.dynamic_number:find(0.25)", 1), LUA_OK);
+    ck_assert_int_eq(lua_tointeger(state, -1), 4);
+    lua_pop(state, 1);
+    ck_assert_int_eq(eval("obj.dynamic_number:find(0.1)", 1), LUA_OK);
+    ck_assert_int_eq(lua_isnil(state, -1), 1);
+    lua_pop(state, 1);
+    ck_assert_int_eq(eval("obj.static_boolean:find(true)", 1), LUA_OK);
+    ck_assert_int_eq(lua_tointeger(state, -1), 3);
+    lua_pop(state, 1);
+    ck_assert_int_eq(eval("obj.static_boolean:count(false)", 1), LUA_OK);
+    ck_assert_int_eq(lua_tointeger(state, -1), 4);
+    lua_pop(state, 1);
+}
+END_TEST
+
+START_TEST(test_indexof_all) {
+    int16_t values[5] = { 1, 2, 1, 3, 1 };
+    for(int i = 0; i < 5; i++) {
+        test_struct.dynamic_int16[i] = values[i];
+    }
+    ck_assert_int_eq(eval("obj.dynamic_int16:indexof_all(1)", 1), LUA_OK);
+    ck_assert_int_eq(lua_rawlen(state, -1), 3);
+    lua_rawgeti(state, -1, 1);
+    lua_rawgeti(state, -2, 2);
+    lua_rawgeti(state, -3, 3);
+    ck_assert_int_eq(lua_tointeger(state, -3), 1);
+    ck_assert_int_eq(lua_tointeger(state, -2), 3);
+    ck_assert_int_eq(lua_tointeger(state, -1), 5);
+    lua_pop(state, 4);
+}
+END_TEST
+
+START_TEST(test_struct_array) {
+    ck_assert_int_ne(eval("obj.static_sub_struct:find(1)", 1), LUA_OK);
+}
+END_TEST
+
+START_TEST(test_bounds) {
+    int32_t values[5] = { 7, 0, 7, 0, 7 };
+    for(int i = 0; i < 5; i++) {
+        test_struct.static_int32[i] = values[i];
+    }
+    ck_assert_int_eq(eval("obj.static_int32:find(7, 2)", 1), LUA_OK);
+    ck_assert_int_eq(lua_tointeger(state, -1), 3);
+    lua_pop(state, 1);
+    ck_assert_int_eq(eval("obj.static_int32:find(7, 4, 4)", 1), LUA_OK);
+    ck_assert_int_eq(lua_isnil(state, -1), 1);
+    lua_pop(state, 1);
+    ck_assert_int_eq(eval("obj.static_int32:count(7, 2, 4)", 1), LUA_OK);
+    ck_assert_int_eq(lua_tointeger(state, -1), 1);
+    lua_pop(state, 1);
+    ck_assert_int_eq(eval("#obj.static_int32:indexof_all(7, 2, 5)", 1), LUA_OK);
+    ck_assert_int_eq(lua_tointeger(state, -1), 2);
+    lua_pop(state, 1);
+    ck_assert_int_ne(eval("obj.static_int32:find(7, 0)", 1), LUA_OK);
+    ck_assert_int_ne(eval("obj.static_int32:count(7, 1, 6)", 1), LUA_OK);
+}
+END_TEST
+
+START_TEST(test_bounds_primitives) {
+    int32_t values[5] = { 1, 3, 3, 5, 9 };
+    for(int i = 0; i < 5; i++) {
+        test_struct.static_int32[i] = values[i];
+    }
+    const char *expressions[] = {
+        "obj.static_int32:lower_bound(3)",
+        "obj.static_int32:upper_bound(3)",
+        "obj.static_int32:lower_bound(nil, 2.5)",
+        "obj.static_int32:lower_bound(0)",
+        "obj.static_int32:upper_bound(9)",
+        "obj.static_int32:bsearch(5)",
+        "obj.static_int32:bsearch(3)",
+    };
+    lua_Integer expected[] = { 2, 4, 2, 1, 6, 4, 2 };
+    for(int i = 0; i < 7; i++) {
+        ck_assert_int_eq(eval(expressions[i], 1), LUA_OK);
+        ck_assert_int_eq(lua_tointeger(state, -1), expected[i]);
+        lua_pop(state, 1);
+    }
+    ck_assert_int_eq(eval("obj.static_int32:bsearch(4)", 1), LUA_OK);
+    ck_assert_int_eq(lua_isnil(state, -1), 1);
+    lua_pop(state, 1);
+}
+END_TEST
+
+START_TEST(test_bounds_struct_field) {
+    LUAS_OBJECT(state, SoundTable, &sound_table, false);
+    ck_assert_int_eq(eval("obj.sounds:bsearch('id', 500)", 1), LUA_OK);
+    ck_assert_int_eq(lua_tointeger(state, -1), 251);
+    lua_pop(state, 1);
+    ck_assert_int_eq(eval("obj.sounds:bsearch('id', 501)", 1), LUA_OK);
+    ck_assert_int_eq(lua_isnil(state, -1), 1);
+    lua_pop(state, 1);
+    ck_assert_int_eq(eval("obj.sounds:lower_bound('id', 501)", 1), LUA_OK);
+    ck_assert_int_eq(lua_tointeger(state, -1), 252);
+    lua_pop(state, 1);
+    ck_assert_int_eq(eval("obj.sounds:upper_bound('volume', 10)", 1), LUA_OK);
+    ck_assert_int_eq(lua_tointeger(state, -1), 22);
+    lua_pop(state, 1);
+    ck_assert_int_eq(eval("obj.sounds:bsearch('id', 5000)", 1), LUA_OK);
+    ck_assert_int_eq(lua_isnil(state, -1), 1);
+    lua_pop(state, 1);
+    ck_assert_int_ne(eval("obj.sounds:bsearch('missing', 1)", 1), LUA_OK);
+    ck_assert_int_ne(eval("obj.sounds:bsearch('id', 'x')", 1), LUA_OK);
+    lua_pop(state, 1);
+}
+END_TEST
+
+static void check_large_search(void) {
+    LUAS_OBJECT(state, LargeStruct, &large_struct, false);
+    const char *fields[] = { "bytes", "shorts", "ints", "longs", "floats" };
+    const char *needles[] = { "5", "2", "500000", "50000000000", "2.5" };
+    for(int f = 0; f < 5; f++) {
+        for(int first = 1; first <= 40; first += 13) {
+            char expression[128];
+            snprintf(expression, sizeof(expression), "obj.%s:find(%s, %d)", fields[f], needles[f], first);
+            ck_assert_int_eq(eval(expression, 1), LUA_OK);
+            int expected = first + (12 - (first - 1) % 7) % 7;
+            ck_assert_int_eq(lua_tointeger(state, -1), expected);
+            lua_pop(state, 1);
+
+            snprintf(expression, sizeof(expression), "obj.%s:count(%s, %d)", fields[f], needles[f], first);
+            ck_assert_int_eq(eval(expression, 1), LUA_OK);
+            int expected_count = 0;
+            for(int i = first - 1; i < LARGE_ARRAY_SIZE; i++) {
+                expected_count += i % 7 == 5;
+            }
+            ck_assert_int_eq(lua_tointeger(state, -1), expected_count);
+            lua_pop(state, 1);
+        }
+    }
+    lua_pop(state, 1);
+}
+
+START_TEST(test_large_scalar) {
+    simd_set_level(LUAS_SIMD_SCALAR);
+    check_large_search();
+}
+END_TEST
+
+START_TEST(test_large_sse2) {
+    simd_set_level(LUAS_SIMD_SSE2);
+    check_large_search();
+}
+END_TEST
+
+START_TEST(test_large_avx2) {
+    simd_set_level(LUAS_SIMD_AVX2);
+    check_large_search();
+}
+END_TEST
+
+Suite *create_suite(void) {
+    Suite *s = suite_create("array_search_methods");
+
+    TCase *primitives = tcase_create("primitives");
+    tcase_add_checked_fixture(primitives, setup, teardown);
+    tcase_add_test(primitives, test_find_static_int32);
+    tcase_add_test(primitives, test_find_unrepresentable);
+    tcase_add_test(primitives, test_find_float_and_boolean);
+    tcase_add_test(primitives, test_indexof_all);
+    tcase_add_test(primitives, test_struct_array);
+    suite_add_tcase(s, primitives);
+
+    TCase *bounds = tcase_create("bounds");
+    tcase_add_checked_fixture(bounds, setup, teardown);
+    tcase_add_test(bounds, test_bounds);
+    suite_add_tcase(s, bounds);
+
+    TCase *sorted = tcase_create("sorted");
+    tcase_add_checked_fixture(sorted, setup, teardown);
+    tcase_add_test(sorted, test_bounds_primitives);
+    tcase_add_test(sorted, test_bounds_struct_field);
+    suite_add_tcase(s, sorted);
+
+    TCase *simd = tcase_create("simd");
+    tcase_add_checked_fixture(simd, setup, teardown);
+    tcase_add_test(simd, test_large_scalar);
+    tcase_add_test(simd, test_large_sse2);
+    tcase_add_test(simd, test_large_avx2);
+    suite_add_tcase(s, simd);
+
+    return s;
+}
+
+int main(int argc, char *argv[]) {
+    Suite *s = create_suite();
+    SRunner *sr = srunner_create(s);
+
+    if(argc > 1) {
+        srunner_run(sr, NULL, argv[1], CK_NORMAL);
+    }
+    else {
+        srunner_run_all(sr, CK_NORMAL);
+    }
+
+    int number_failed = srunner_ntests_failed(sr);
+    srunner_free(sr);
+
+    return (number_failed == 0) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,266 @@
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+#include <check.h>
+#include <lua.h>
+#include <lualib.h>
+#include <lauxlib.h>
+#include "test_array.h"
+#include "debug.h"
+
+#define LARGE_ARRAY_SIZE 5003
+
+typedef struct Unit {
+    int32_t id;
+    float score;
+    uint8_t team;
+} Unit;
+
+typedef struct SortStruct {
+    Unit units[6];
+    Unit *unit_pointers[6];
+    int32_t ints[LARGE_ARRAY_SIZE];
+    int16_t shorts[LARGE_ARRAY_SIZE];
+    float floats[LARGE_ARRAY_SIZE];
+    Unit large_units[LARGE_ARRAY_SIZE];
+} SortStruct;
+
+static lua_State *state = NULL;
+static TestStruct test_struct;
+static SortStruct *sort_struct;
+
+void setup(void) {
+    state = luaL_newstate();
+    init_test_struct(&test_struct);
+    define_test_struct(state);
+
+    LUAS_STRUCT(state, Unit);
+    LUAS_PRIMITIVE_FIELD(state, Unit, id, LUAST_INT32, 0);
+    LUAS_PRIMITIVE_FIELD(state, Unit, score, LUAST_FLOAT, 0);
+    LUAS_PRIMITIVE_FIELD(state, Unit, team, LUAST_UINT8, 0);
+    lua_pop(state, 1);
+
+    LUAS_STRUCT(state, SortStruct);
+    LUAS_OBJREF_ARRAY_FIELD(state, SortStruct, units, Unit, 0);
+    LUAS_OBJREF_ARRAY_FIELD(state, SortStruct, unit_pointers, Unit, LUAS_FIELD_POINTER);
+    LUAS_PRIMITIVE_ARRAY_FIELD(state, SortStruct, ints, LUAST_INT32, 0);
+    LUAS_PRIMITIVE_ARRAY_FIELD(state, SortStruct, shorts, LUAST_INT16, 0);
+    LUAS_PRIMITIVE_ARRAY_FIELD(state, SortStruct, floats, LUAST_FLOAT, 0);
+    LUAS_OBJREF_ARRAY_FIELD(state, SortStruct, large_units, Unit, 0);
+    lua_pop(state, 1);
+
+    sort_struct = calloc(1, sizeof(SortStruct));
+    int32_t ids[6] = { 42, 7, 19, 7, 100, -3 };
+    uint8_t teams[6] = { 2, 1, 2, 3, 1, 2 };
+    for(int i = 0; i < 6; i++) {
+        sort_struct->units[i].id = ids[i];
+        sort_struct->units[i].score = ids[i] * 0.5f;
+        sort_struct->units[i].team = teams[i];
+        sort_struct->unit_pointers[i] = &sort_struct->units[i];
+    }
+    srand(1234);
+    for(int i = 0; i < LARGE_ARRAY_SIZE; i++) {
+        sort_struct->ints[i] = rand() - RAND_MAX / 2;
+        sort_struct->shorts[i] = rand() % 2000 - 1000;
+        sort_struct->floats[i] = (rand() % 1000) * 0.25f - 100.0f;
+        sort_struct->large_units[i].id = i;
+        sort_struct->large_units[i].team = rand() % 4;
+    }
+    sort_struct->ints[17] = INT32_MIN;
+    sort_struct->ints[18] = INT32_MAX;
+
+    LUAS_OBJECT(state, TestStruct, &test_struct, false);
+}
+
+void teardown(void) {
+    lua_gc(state, LUA_GCCOLLECT, 0);
+    lua_close(state);
+    state = NULL;
+    free(sort_struct);
+}
+
+static int eval(const char *statement) {
+    char script[256];
+    snprintf(script, sizeof(script), "function test(obj) %s end", statement);
+    int res = luaL_dostring(state, script);
+    lua_getglobal(state, "test");
+    lua_pushvalue(state, -2);
+    res = lua_pcall(state, 1, 0, 0);
+    if(res != LUA_OK) {
+        lua_pop(state, 1);
+    }
+    return res;
+}
+
+START_TEST(test_sort_integers) {
+    int32_t values[5] = { 5, -1, 3, 3, 0 };
+    int32_t sorted[5] = { -1, 0, 3, 3, 5 };
+    for(int i = 0; i < 5; i++) {
+        test_struct.static_int32[i] = values[i];
+        test_struct.dynamic_int8[i] = values[i];
+        test_struct.static_uint16[i] = values[i] + 1;
+    }
+    ck_assert_int_eq(eval("obj.static_int32:sort()"), LUA_OK);
+    ck_assert_int_eq(eval("obj.dynamic_int8:sort(true)"), LUA_OK);
+    ck_assert_int_eq(eval("obj.static_uint16:sort(nil, true)"), LUA_OK);
+    for(int i = 0; i < 5; i++) {
+        ck_assert_int_eq(test_struct.static_int32[i], sorted[i]);
+        ck_assert_int_eq(test_struct.dynamic_int8[i], sorted[4 - i]);
+        ck_assert_int_eq(test_struct.static_uint16[i], sorted[4 - i] + 1);
+    }
+}
+END_TEST
+
+START_TEST(test_sort_floats_and_booleans) {
+    float values[5] = { 2.5f, NAN, -1.0f, 0.25f, -1.0f };
+    bool flags[5] = { true, false, true, false, false };
+    for(int i = 0; i < 5; i++) {
+        test_struct.static_number[i] = values[i];
+        test_struct.static_boolean[i] = flags[i];
+    }
+    ck_assert_int_eq(eval("obj.static_number:sort()"), LUA_OK);
+    ck_assert_float_eq(test_struct.static_number[0], -1.0f);
+    ck_assert_float_eq(test_struct.static_number[1], -1.0f);
+    ck_assert_float_eq(test_struct.static_number[2], 0.25f);
+    ck_assert_float_eq(test_struct.static_number[3], 2.5f);
+    ck_assert(isnan(test_struct.static_number[4]));
+
+    ck_assert_int_eq(eval("obj.static_number:sort(true)"), LUA_OK);
+    ck_assert_float_eq(test_struct.static_number[0], 2.5f);
+    ck_assert_float_eq(test_struct.static_number[3], -1.0f);
+    ck_assert(isnan(test_struct.static_number[4]));
+
+    ck_assert_int_eq(eval("obj.static_boolean:sort(true)"), LUA_OK);
+    ck_assert(test_struct.static_boolean[0] && test_struct.static_boolean[1]);
+    ck_assert(!test_struct.static_boolean[2] && !test_struct.static_boolean[4]);
+}
+END_TEST
+
+START_TEST(test_sort_struct_by_field) {
+    LUAS_OBJECT(state, SortStruct, sort_struct, false);
+    ck_assert_int_eq(eval("obj.units:sort('id')"), LUA_OK);
+    int32_t ids[6] = { -3, 7, 7, 19, 42, 100 };
+    uint8_t teams[6] = { 2, 1, 3, 2, 2, 1 };
+    for(int i = 0; i < 6; i++) {
+        ck_assert_int_eq(sort_struct->units[i].id, ids[i]);
+        ck_assert_float_eq(sort_struct->units[i].score, ids[i] * 0.5f);
+        ck_assert_int_eq(sort_struct->units[i].team, teams[i]);
+    }
+
+    // Stable: units of the same team keep their order by id
+    ck_assert_int_eq(eval("obj.units:sort('team', true)"), LUA_OK);
+    int32_t ids_by_team[6] = { 7, -3, 19, 42, 7, 100 };
+    for(int i = 0; i < 6; i++) {
+        ck_assert_int_eq(sort_struct->units[i].id, ids_by_team[i]);
+    }
+
+    ck_assert_int_eq(eval("obj.units:sort('score', true)"), LUA_OK);
+    ck_assert_int_eq(sort_struct->units[0].id, 100);
+    ck_assert_int_eq(sort_struct->units[5].id, -3);
+}
+END_TEST
+
+START_TEST(test_sort_struct_errors) {
+    LUAS_OBJECT(state, SortStruct, sort_struct, false);
+    ck_assert_int_ne(eval("obj.units:sort()"), LUA_OK);
+    ck_assert_int_ne(eval("obj.units:sort('missing')"), LUA_OK);
+    ck_assert_int_ne(eval("obj.ints:sort('id')"), LUA_OK);
+}
+END_TEST
+
+START_TEST(test_sort_pointers) {
+    LUAS_OBJECT(state, SortStruct, sort_struct, false);
+    Unit units[6];
+    memcpy(units, sort_struct->units, sizeof(units));
+    ck_assert_int_eq(eval("obj.unit_pointers:sort('id')"), LUA_OK);
+
+    // The pointed-to elements stay in place, only the pointers move
+    ck_assert_mem_eq(units, sort_struct->units, sizeof(units));
+    ck_assert_ptr_eq(sort_struct->unit_pointers[0], &sort_struct->units[5]);
+    ck_assert_ptr_eq(sort_struct->unit_pointers[1], &sort_struct->units[1]);
+    ck_assert_ptr_eq(sort_struct->unit_pointers[2], &sort_struct->units[3]);
+    ck_assert_ptr_eq(sort_struct->unit_pointers[5], &sort_struct->units[4]);
+}
+END_TEST
+
+static int compare_int32(const void *a, const void *b) {
+    int32_t x = *(const int32_t *)a;
+    int32_t y = *(const int32_t *)b;
+    return (x > y) - (x < y);
+}
+
+static int compare_int16(const void *a, const void *b) {
+    return *(const int16_t *)a - *(const int16_t *)b;
+}
+
+START_TEST(test_sort_large) {
+    LUAS_OBJECT(state, SortStruct, sort_struct, false);
+    int32_t *ints = malloc(sizeof(sort_struct->ints));
+    int16_t *shorts = malloc(sizeof(sort_struct->shorts));
+    memcpy(ints, sort_struct->ints, sizeof(sort_struct->ints));
+    memcpy(shorts, sort_struct->shorts, sizeof(sort_struct->shorts));
+    qsort(ints, LARGE_ARRAY_SIZE, sizeof(int32_t), compare_int32);
+    qsort(shorts, LARGE_ARRAY_SIZE, sizeof(int16_t), compare_int16);
+
+    ck_assert_int_eq(eval("obj.ints:sort(true) obj.ints:sort() obj.ints:sort() obj.shorts:sort(true) obj.floats:sort() obj.large_units:sort('team')"), LUA_OK);
+    ck_assert_mem_eq(ints, sort_struct->ints, sizeof(sort_struct->ints));
+    for(int i = 0; i < LARGE_ARRAY_SIZE; i++) {
+        ck_assert_int_eq(sort_struct->shorts[i], shorts[LARGE_ARRAY_SIZE - 1 - i]);
+    }
+    for(int i = 1; i < LARGE_ARRAY_SIZE; i++) {
+        ck_assert(sort_struct->floats[i - 1] <= sort_struct->floats[i]);
+        Unit *previous = &sort_struct->large_units[i - 1];
+        Unit *current = &sort_struct->large_units[i];
+        ck_assert(previous->team < current->team || (previous->team == current->team && previous->id < current->id));
+    }
+    free(ints);
+    free(shorts);
+}
+END_TEST
+
+Suite *create_suite(void) {
+    Suite *s = suite_create("array_sort_method");
+
+    TCase *primitives = tcase_create("primitives");
+    tcase_add_checked_fixture(primitives, setup, teardown);
+    tcase_add_test(primitives, test_sort_integers);
+    tcase_add_test(primitives, test_sort_floats_and_booleans);
+    suite_add_tcase(s, primitives);
+
+    TCase *structs = tcase_create("structs");
+    tcase_add_checked_fixture(structs, setup, teardown);
+    tcase_add_test(structs, test_sort_struct_by_field);
+    tcase_add_test(structs, test_sort_struct_errors);
+    suite_add_tcase(s, structs);
+
+    TCase *pointers = tcase_create("pointers");
+    tcase_add_checked_fixture(pointers, setup, teardown);
+    tcase_add_test(pointers, test_sort_pointers);
+    suite_add_tcase(s, pointers);
+
+    TCase *large = tcase_create("large");
+    tcase_add_checked_fixture(large, setup, teardown);
+    tcase_add_test(large, test_sort_large);
+    suite_add_tcase(s, large);
+
+    return s;
+}
+
+int main(int argc, char *argv[]) {
+    Suite *s = create_suite();
+    SRunner *sr = srunner_create(s);
+
+    if(argc > 1) {
+        srunner_run(sr, NULL, argv[1], CK_NORMAL);
+    }
+    else {
+        srunner_run_all(sr, CK_NORMAL);
+    }
+
+    int number_failed = srunner_ntests_failed(sr);
+    srunner_free(sr);
+
+    return (number_failed == 0) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
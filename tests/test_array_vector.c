@@ -0,0 +1,284 @@
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <check.h>
+#include <lua.h>
+#include <lualib.h>
+#include <lauxlib.h>
+#include "test_array.h"
+#include "debug.h"
+
+typedef struct Item {
+    int32_t id;
+    float weight;
+} Item;
+
+typedef struct FloatVector {
+    float *data;
+    uint32_t count;
+    uint32_t capacity;
+} FloatVector;
+
+typedef struct ItemVector {
+    Item *items;
+    size_t size;
+    size_t capacity;
+} ItemVector;
+
+typedef struct Inventory {
+    int32_t version;
+    FloatVector values;
+    ItemVector items;
+    FloatVector locked;
+    FloatVector first;
+    FloatVector second;
+} Inventory;
+
+typedef struct Allocator {
+    int calls;
+    size_t limit;
+} Allocator;
+
+static lua_State *state = NULL;
+static Inventory *inventory;
+static Allocator allocator;
+
+/**
+ * Always moves the buffer, so that every growth rebases the proxies.
+ */
+static void *test_realloc(void *userdata, void *ptr, size_t osize, size_t nsize) {
+    Allocator *alloc = userdata;
+    alloc->calls++;
+    if(nsize > alloc->limit) {
+        return NULL;
+    }
+    void *data = malloc(nsize);
+    if(data && ptr) {
+        memcpy(data, ptr, osize < nsize ? osize : nsize);
+        free(ptr);
+    }
+    return data;
+}
+
+void setup(void) {
+    state = luaL_newstate();
+    luaL_openlibs(state);
+    allocator.calls = 0;
+    allocator.limit = SIZE_MAX;
+
+    LUAS_STRUCT(state, Item);
+    LUAS_PRIMITIVE_FIELD(state, Item, id, LUAST_INT32, 0);
+    LUAS_PRIMITIVE_FIELD(state, Item, weight, LUAST_FLOAT, 0);
+    lua_pop(state, 1);
+
+    LUAS_STRUCT(state, Inventory);
+    LUAS_PRIMITIVE_VECTOR_FIELD(state, Inventory, values, LUAST_FLOAT, LUAS_VECTOR_LAYOUT(FloatVector, data, count, capacity, LUAST_UINT32, test_realloc, &allocator), 0);
+    LUAS_OBJREF_VECTOR_FIELD(state, Inventory, items, Item, LUAS_VECTOR_LAYOUT(ItemVector, items, size, capacity, LUAST_UINT64, test_realloc, &allocator), 0);
+    LUAS_PRIMITIVE_VECTOR_FIELD(state, Inventory, locked, LUAST_FLOAT, LUAS_VECTOR_LAYOUT(FloatVector, data, count, capacity, LUAST_UINT32, test_realloc, &allocator), LUAS_FIELD_READONLY);
+    {
+        // One descriptor shared by two fields of the same layout
+        LuastructArrayDesc desc;
+        LuastructVectorDesc layout = LUAS_VECTOR_LAYOUT(FloatVector, data, count, capacity, LUAST_UINT32, test_realloc, &allocator);
+        luastruct_new_vector_desc(state, LUAST_FLOAT, NULL, &layout, false, &desc);
+        luastruct_new_struct_array_field(state, "first", &desc, offsetof(Inventory, first), false, false);
+        luastruct_new_struct_array_field(state, "second", &desc, offsetof(Inventory, second), false, false);
+        luastruct_free_array_desc(&desc);
+    }
+    lua_pop(state, 1);
+
+    inventory = calloc(1, sizeof(Inventory));
+    inventory->locked.data = malloc(2 * sizeof(float));
+    inventory->locked.data[0] = 1.5f;
+    inventory->locked.count = 1;
+    inventory->locked.capacity = 2;
+}
+
+void teardown(void) {
+    lua_gc(state, LUA_GCCOLLECT, 0);
+    lua_close(state);
+    state = NULL;
+    free(inventory->values.data);
+    free(inventory->items.items);
+    free(inventory->locked.data);
+    free(inventory->first.data);
+    free(inventory->second.data);
+    free(inventory);
+}
+
+static int run(const char *statement) {
+    char script[2048];
+    snprintf(script, sizeof(script), "function test(obj) %s end", statement);
+    int res = luaL_dostring(state, script);
+    lua_getglobal(state, "test");
+    LUAS_OBJECT(state, Inventory, inventory, false);
+    res = lua_pcall(state, 1, 0, 0);
+    if(res != LUA_OK) {
+        lua_pop(state, 1);
+    }
+    return res;
+}
+
+START_TEST(test_push_pop) {
+    ck_assert_int_eq(run(
+        "local values = obj.values "
+        "assert(#values == 0 and values:capacity() == 0 and values[1] == nil) "
+        "for i = 1, 100 do assert(values:push(i) == i) end "
+        "assert(#values == 100 and values:sum() == 5050 and values[100] == 100) "
+        "assert(values:capacity() == 128) "
+        "assert(values:pop() == 100 and #values == 99) "
+        "assert(#obj.values == 99) "
+        "for i = 1, 99 do values:pop() end "
+        "assert(values:pop() == nil and #values == 0) "
+        "values:push() "
+        "assert(values[1] == 0) "), LUA_OK);
+    ck_assert_int_eq(allocator.calls, 6);
+    ck_assert_uint_eq(inventory->values.count, 1);
+    ck_assert_uint_eq(inventory->values.capacity, 128);
+}
+END_TEST
+
+START_TEST(test_reserve_resize) {
+    ck_assert_int_eq(run(
+        "local values = obj.values "
+        "assert(values:reserve(10) == values and values:capacity() == 10) "
+        "values:reserve(5) "
+        "assert(values:capacity() == 10 and #values == 0) "
+        "values:resize(3) "
+        "assert(#values == 3 and values[3] == 0) "
+        "values:fill(2) "
+        "values:resize(12) "
+        "assert(#values == 12 and values:capacity() == 20 and values:sum() == 6) "
+        "values:resize(1) "
+        "assert(#values == 1 and values[2] == nil and values:capacity() == 20) "), LUA_OK);
+    ck_assert_int_eq(allocator.calls, 2);
+    ck_assert_uint_eq(inventory->values.count, 1);
+    ck_assert_float_eq(inventory->values.data[0], 2.0f);
+}
+END_TEST
+
+START_TEST(test_struct_elements) {
+    ck_assert_int_eq(run(
+        "local items = obj.items "
+        "local first = items:push() "
+        "assert(first.id == 0 and first.weight == 0) "
+        "first.id = 7 "
+        "local weights = items:column('weight') "
+        "for i = 2, 50 do items:push(first).id = i end "
+        "assert(#items == 50 and items[1] == first) "
+        "first.id = 1 "
+        "first.weight = 0.5 "
+        "assert(items[1].id == 1 and weights[1] == 0.5 and items[50].id == 50) "
+        "local last = items[50] "
+        "local copy = items:pop() "
+        "assert(copy.id == 50 and copy ~= last) "
+        "assert(not pcall(function() return last.id end)) "
+        "local again = items:push(copy) "
+        "assert(again.id == 50 and again ~= last) "
+        "local kept = items[10] "
+        "items:resize(5) "
+        "assert(not pcall(function() return kept.id end) and first.id == 1) "
+        "assert(items:index_by('id'):get(3).id == 3) "), LUA_OK);
+    ck_assert_uint_eq(inventory->items.size, 5);
+    ck_assert_int_eq(inventory->items.items[0].id, 1);
+    ck_assert_float_eq(inventory->items.items[0].weight, 0.5f);
+    ck_assert_int_eq(inventory->items.items[4].id, 5);
+}
+END_TEST
+
+START_TEST(test_c_side_changes) {
+    ck_assert_int_eq(run(
+        "vector = obj.values "
+        "vector:push(1) "), LUA_OK);
+    // C code appends to the vector behind the back of the array object
+    float *data = realloc(inventory->values.data, 64 * sizeof(float));
+    for(int i = 1; i < 64; i++) {
+        data[i] = i + 1;
+    }
+    inventory->values.data = data;
+    inventory->values.count = 64;
+    inventory->values.capacity = 64;
+    ck_assert_int_eq(run(
+        "assert(#vector == 64 and vector[64] == 64 and vector:sum() == 2080) "
+        "vector:push(65) "
+        "assert(#vector == 65) "), LUA_OK);
+    ck_assert_uint_eq(inventory->values.count, 65);
+    ck_assert_float_eq(inventory->values.data[64], 65.0f);
+
+    inventory->values.count = 1000;
+    ck_assert_int_ne(run("return #vector"), LUA_OK);
+    inventory->values.count = 0;
+}
+END_TEST
+
+START_TEST(test_shared_desc) {
+    ck_assert_int_eq(run(
+        "obj.first:push(1) "
+        "obj.second:push(2) obj.second:push(3) "
+        "assert(#obj.first == 1 and #obj.second == 2 and obj.second:sum() == 5) "), LUA_OK);
+    ck_assert_uint_eq(inventory->first.count, 1);
+    ck_assert_float_eq(inventory->second.data[1], 3.0f);
+}
+END_TEST
+
+START_TEST(test_vector_errors) {
+    ck_assert_int_ne(run("obj.values:push('x')"), LUA_OK);
+    ck_assert_int_eq(inventory->values.count, 0);
+    ck_assert_int_ne(run("obj.items:push(1)"), LUA_OK);
+    ck_assert_int_ne(run("obj.values:reserve(-1)"), LUA_OK);
+    ck_assert_int_ne(run("obj.values:resize(-1)"), LUA_OK);
+    ck_assert_int_ne(run("obj.locked:push(1)"), LUA_OK);
+    ck_assert_int_ne(run("obj.locked:pop()"), LUA_OK);
+    ck_assert_int_eq(run("assert(obj.locked[1] == 1.5 and obj.locked:capacity() == 2)"), LUA_OK);
+    ck_assert_int_ne(run("obj.values:view(1, 0):push(1)"), LUA_OK);
+
+    ck_assert_int_eq(run("obj.values:push(1)"), LUA_OK);
+    allocator.limit = 16;
+    ck_assert_int_ne(run("obj.values:reserve(5)"), LUA_OK);
+    ck_assert_int_eq(run(
+        "assert(#obj.values == 1 and obj.values[1] == 1 and obj.values:capacity() == 4) "
+        "obj.values:push(2) "), LUA_OK);
+    ck_assert_int_eq(inventory->values.capacity, 4);
+}
+END_TEST
+
+Suite *create_suite(void) {
+    Suite *s = suite_create("array_vector");
+
+    TCase *primitives = tcase_create("primitives");
+    tcase_add_checked_fixture(primitives, setup, teardown);
+    tcase_add_test(primitives, test_push_pop);
+    tcase_add_test(primitives, test_reserve_resize);
+    tcase_add_test(primitives, test_c_side_changes);
+    tcase_add_test(primitives, test_shared_desc);
+    suite_add_tcase(s, primitives);
+
+    TCase *structs = tcase_create("structs");
+    tcase_add_checked_fixture(structs, setup, teardown);
+    tcase_add_test(structs, test_struct_elements);
+    suite_add_tcase(s, structs);
+
+    TCase *errors = tcase_create("errors");
+    tcase_add_checked_fixture(errors, setup, teardown);
+    tcase_add_test(errors, test_vector_errors);
+    suite_add_tcase(s, errors);
+
+    return s;
+}
+
+int main(int argc, char *argv[]) {
+    Suite *s = create_suite();
+    SRunner *sr = srunner_create(s);
+
+    if(argc > 1) {
+        srunner_run(sr, NULL, argv[1], CK_NORMAL);
+    }
+    else {
+        srunner_run_all(sr, CK_NORMAL);
+    }
+
+    int number_failed = srunner_ntests_failed(sr);
+    srunner_free(sr);
+
+    return (number_failed == 0) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
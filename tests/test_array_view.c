@@ -0,0 +1,146 @@
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <check.h>
+#include <lua.h>
+#include <lualib.h>
+#include <lauxlib.h>
+#include "test_array.h"
+#include "debug.h"
+
+static lua_State *state = NULL;
+static TestStruct test_struct;
+
+void setup(void) {
+    state = luaL_newstate();
+    luaL_openlibs(state);
+    init_test_struct(&test_struct);
+    define_test_struct(state);
+    for(int i = 0; i < 5; i++) {
+        test_struct.static_int32[i] = (i + 1) * 10;
+        test_struct.dynamic_int16[i] = 5 - i;
+        test_struct.static_sub_struct[i].a = i;
+    }
+    LUAS_OBJECT(state, TestStruct, &test_struct, false);
+    lua_setglobal(state, "obj");
+}
+
+void teardown(void) {
+    lua_gc(state, LUA_GCCOLLECT, 0);
+    lua_close(state);
+    state = NULL;
+}
+
+static int run(const char *script) {
+    int res = luaL_dostring(state, script);
+    if(res != LUA_OK) {
+        lua_pop(state, 1);
+    }
+    return res;
+}
+
+START_TEST(test_view_index) {
+    ck_assert_int_eq(run(
+        "local v = obj.static_int32:view(2, 4)\n"
+        "assert(#v == 3)\n"
+        "assert(v[1] == 20 and v[3] == 40)\n"
+        "assert(v[0] == nil and v[4] == nil)\n"
+        "v[2] = 99\n"
+        "assert(#obj.static_int32:view(3) == 3)\n"
+        "assert(#obj.static_int32:view() == 5)\n"
+    ), LUA_OK);
+    ck_assert_int_eq(test_struct.static_int32[2], 99);
+    ck_assert_int_ne(run("obj.static_int32:view(2, 4)[4] = 1"), LUA_OK);
+    ck_assert_int_eq(test_struct.static_int32[4], 50);
+}
+END_TEST
+
+START_TEST(test_view_nested) {
+    ck_assert_int_eq(run(
+        "local v = obj.static_int32:view(2, 5):view(2, 3)\n"
+        "assert(#v == 2 and v[1] == 30 and v[2] == 40)\n"
+        "local s = obj.static_sub_struct:view(4)\n"
+        "assert(#s == 2 and s[1].a == 3)\n"
+        "local d = obj.dynamic_int16:view(5, 4)\n"
+        "assert(#d == 0 and d[1] == nil)\n"
+    ), LUA_OK);
+}
+END_TEST
+
+START_TEST(test_view_pairs) {
+    ck_assert_int_eq(run(
+        "local keys, total = 0, 0\n"
+        "for i, v in pairs(obj.dynamic_int16:view(2, 4)) do keys = keys + i total = total + v end\n"
+        "assert(keys == 6 and total == 9)\n"
+    ), LUA_OK);
+}
+END_TEST
+
+START_TEST(test_view_bulk) {
+    ck_assert_int_eq(run(
+        "local v = obj.static_int32:view(2, 4)\n"
+        "assert(v:sum() == 90)\n"
+        "assert(v:find(40) == 3)\n"
+        "assert(v:find(10) == nil)\n"
+        "assert(#v:tobytes() == 12)\n"
+        "obj.dynamic_int16:view(1, 3):sort()\n"
+        "v:fill(7, 3)\n"
+    ), LUA_OK);
+    ck_assert_int_eq(test_struct.static_int32[3], 7);
+    ck_assert_int_eq(test_struct.static_int32[4], 50);
+    ck_assert_int_eq(test_struct.dynamic_int16[0], 3);
+    ck_assert_int_eq(test_struct.dynamic_int16[2], 5);
+    ck_assert_int_eq(test_struct.dynamic_int16[3], 2);
+    ck_assert_int_ne(run("obj.static_int32:view(2, 4):fill(0, 2, 4)"), LUA_OK);
+    ck_assert_int_ne(run("obj.static_int32:view(2, 4):setrange(3, 1, 2)"), LUA_OK);
+    ck_assert_int_eq(test_struct.static_int32[4], 50);
+}
+END_TEST
+
+START_TEST(test_view_bounds) {
+    ck_assert_int_ne(run("obj.static_int32:view(0, 2)"), LUA_OK);
+    ck_assert_int_ne(run("obj.static_int32:view(2, 6)"), LUA_OK);
+    ck_assert_int_ne(run("obj.static_int32:view(7)"), LUA_OK);
+    ck_assert_int_ne(run("obj.static_int32:view(2, 4):view(1, 4)"), LUA_OK);
+}
+END_TEST
+
+Suite *create_suite(void) {
+    Suite *s = suite_create("array_view_method");
+
+    TCase *index = tcase_create("index");
+    tcase_add_checked_fixture(index, setup, teardown);
+    tcase_add_test(index, test_view_index);
+    tcase_add_test(index, test_view_nested);
+    tcase_add_test(index, test_view_pairs);
+    suite_add_tcase(s, index);
+
+    TCase *bulk = tcase_create("bulk");
+    tcase_add_checked_fixture(bulk, setup, teardown);
+    tcase_add_test(bulk, test_view_bulk);
+    suite_add_tcase(s, bulk);
+
+    TCase *bounds = tcase_create("bounds");
+    tcase_add_checked_fixture(bounds, setup, teardown);
+    tcase_add_test(bounds, test_view_bounds);
+    suite_add_tcase(s, bounds);
+
+    return s;
+}
+
+int main(int argc, char *argv[]) {
+    Suite *s = create_suite();
+    SRunner *sr = srunner_create(s);
+
+    if(argc > 1) {
+        srunner_run(sr, NULL, argv[1], CK_NORMAL);
+    }
+    else {
+        srunner_run_all(sr, CK_NORMAL);
+    }
+
+    int number_failed = srunner_ntests_failed(sr);
+    srunner_free(sr);
+
+    return (number_failed == 0) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
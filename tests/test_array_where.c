@@ -0,0 +1,241 @@
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <check.h>
+#include <lua.h>
+#include <lualib.h>
+#include <lauxlib.h>
+#include "test_array.h"
+#include "debug.h"
+
+#define UNIT_COUNT 100
+
+typedef struct Position {
+    float x;
+    float y;
+} Position;
+
+typedef struct Unit {
+    int32_t health;
+    uint8_t team;
+    uint8_t flags;
+    bool alive;
+    Position pos;
+} Unit;
+
+typedef struct WhereStruct {
+    int32_t version;
+    Unit units[UNIT_COUNT];
+    Unit *unit_pointers[UNIT_COUNT];
+} WhereStruct;
+
+static lua_State *state = NULL;
+static TestStruct test_struct;
+static WhereStruct *where_struct;
+
+void setup(void) {
+    state = luaL_newstate();
+    luaL_openlibs(state);
+    init_test_struct(&test_struct);
+    define_test_struct(state);
+
+    LUAS_STRUCT(state, Position);
+    LUAS_PRIMITIVE_FIELD(state, Position, x, LUAST_FLOAT, 0);
+    LUAS_PRIMITIVE_FIELD(state, Position, y, LUAST_FLOAT, 0);
+    lua_pop(state, 1);
+
+    LUAS_STRUCT(state, Unit);
+    LUAS_PRIMITIVE_FIELD(state, Unit, health, LUAST_INT32, 0);
+    LUAS_PRIMITIVE_FIELD(state, Unit, team, LUAST_UINT8, 0);
+    luastruct_new_struct_bit_field(state, "flying", LUAST_UINT8, offsetof(Unit, flags), 2, false, false);
+    LUAS_PRIMITIVE_FIELD(state, Unit, alive, LUAST_BOOL, 0);
+    LUAS_OBJREF_FIELD(state, Unit, pos, Position, 0);
+    lua_pop(state, 1);
+
+    LUAS_STRUCT(state, WhereStruct);
+    LUAS_OBJREF_ARRAY_FIELD(state, WhereStruct, units, Unit, 0);
+    LUAS_OBJREF_ARRAY_FIELD(state, WhereStruct, unit_pointers, Unit, LUAS_FIELD_POINTER);
+    lua_pop(state, 1);
+
+    where_struct = calloc(1, sizeof(WhereStruct));
+    for(int i = 0; i < UNIT_COUNT; i++) {
+        Unit *unit = &where_struct->units[i];
+        unit->health = i % 10 - 2;
+        unit->team = i % 4;
+        unit->flags = (i % 3 == 0) ? 0x04 : 0x01;
+        unit->alive = unit->health > 0;
+        unit->pos.x = i * 0.5f;
+        unit->pos.y = -i;
+        where_struct->unit_pointers[UNIT_COUNT - 1 - i] = unit;
+    }
+
+    LUAS_OBJECT(state, TestStruct, &test_struct, false);
+}
+
+void teardown(void) {
+    lua_gc(state, LUA_GCCOLLECT, 0);
+    lua_close(state);
+    state = NULL;
+    free(where_struct);
+}
+
+static int run(const char *statement, bool use_where_struct) {
+    char script[2048];
+    snprintf(script, sizeof(script), "function test(obj) %s end", statement);
+    int res = luaL_dostring(state, script);
+    lua_getglobal(state, "test");
+    if(use_where_struct) {
+        LUAS_OBJECT(state, WhereStruct, where_struct, false);
+    }
+    else {
+        lua_pushvalue(state, -2);
+    }
+    res = lua_pcall(state, 1, 0, 0);
+    if(res != LUA_OK) {
+        lua_pop(state, 1);
+    }
+    return res;
+}
+
+static int count_units(bool (*predicate)(const Unit *)) {
+    int count = 0;
+    for(int i = 0; i < UNIT_COUNT; i++) {
+        count += predicate(&where_struct->units[i]);
+    }
+    return count;
+}
+
+static bool team2_healthy(const Unit *unit) {
+    return unit->team == 2 && unit->health > 0;
+}
+
+static bool flying_alive(const Unit *unit) {
+    return (unit->flags & 0x04) && unit->alive;
+}
+
+static bool far_right(const Unit *unit) {
+    return unit->pos.x >= 30.25f && unit->health != 7;
+}
+
+START_TEST(test_where_table) {
+    char script[1024];
+    snprintf(script, sizeof(script),
+        "local indices = obj.units:where{ team = 2, health = {'>', 0} } "
+        "assert(#indices == %d) "
+        "for _, i in ipairs(indices) do "
+        "  local unit = obj.units[i] "
+        "  assert(unit.team == 2 and unit.health > 0) "
+        "end "
+        "assert(indices[1] == 7 and indices[2] == 15) "
+        "assert(obj.units:where({ team = 2, health = {'>', 0} }, 'count') == %d) "
+        "assert(obj.units:where({ flying = true, alive = true }, 'count') == %d) "
+        "assert(obj.units:where({ ['pos.x'] = {'>=', 30.25}, health = {'~=', 7} }, 'count') == %d) "
+        "assert(obj.units:where({ health = {'<', -5} }, 'count') == 0) "
+        "assert(obj.units:where({ health = {'<', 0.5} }, 'count') == 30) ",
+        count_units(team2_healthy), count_units(team2_healthy), count_units(flying_alive), count_units(far_right));
+    ck_assert_int_eq(run(script, true), LUA_OK);
+}
+END_TEST
+
+START_TEST(test_where_string) {
+    char script[1024];
+    snprintf(script, sizeof(script),
+        "assert(obj.units:where('team == 2 and health > 0', 'count') == %d) "
+        "assert(obj.units:where('flying = true and alive != false', 'count') == %d) "
+        "assert(obj.units:where('pos.x >= 30.25 and health ~= 7', 'count') == %d) "
+        "assert(obj.units:where('pos.y<-98', 'count') == 1) "
+        "assert(obj.units:where('health <= -2')[1] == 1) ",
+        count_units(team2_healthy), count_units(flying_alive), count_units(far_right));
+    ck_assert_int_eq(run(script, true), LUA_OK);
+}
+END_TEST
+
+START_TEST(test_where_iterator) {
+    ck_assert_int_eq(run(
+        "local n = 0 "
+        "local last = 0 "
+        "for i, unit in obj.units:where({ team = 3, health = {'>=', 5} }, 'iter') do "
+        "  assert(i > last and unit.team == 3 and unit.health >= 5) "
+        "  last = i "
+        "  n = n + 1 "
+        "end "
+        "assert(n == obj.units:where({ team = 3, health = {'>=', 5} }, 'count')) "
+        "n = 0 "
+        "for i, unit in obj.unit_pointers:where('team == 1', 'iter') do "
+        "  assert(unit.team == 1) "
+        "  n = n + 1 "
+        "end "
+        "assert(n == 25) ",
+        true), LUA_OK);
+}
+END_TEST
+
+START_TEST(test_where_primitives) {
+    int32_t values[5] = { 5, -1, 3, 3, 0 };
+    for(int i = 0; i < 5; i++) {
+        test_struct.static_int32[i] = values[i];
+        test_struct.static_number[i] = values[i] * 0.5f;
+    }
+    ck_assert_int_eq(run(
+        "assert(obj.static_int32:where({'>', 0}, 'count') == 3) "
+        "local indices = obj.static_int32:where('== 3') "
+        "assert(#indices == 2 and indices[1] == 3 and indices[2] == 4) "
+        "assert(obj.static_number:where('< 0', 'count') == 1) "
+        "assert(obj.static_number:where({'>=', 1.5}, 'count') == 3) ",
+        false), LUA_OK);
+}
+END_TEST
+
+START_TEST(test_where_errors) {
+    ck_assert_int_ne(run("obj.units:where{ missing = 1 }", true), LUA_OK);
+    ck_assert_int_ne(run("obj.units:where{ pos = 1 }", true), LUA_OK);
+    ck_assert_int_ne(run("obj.units:where{ team = {'<>', 1} }", true), LUA_OK);
+    ck_assert_int_ne(run("obj.units:where{ team = 'red' }", true), LUA_OK);
+    ck_assert_int_ne(run("obj.units:where('team 2')", true), LUA_OK);
+    ck_assert_int_ne(run("obj.units:where('team == 2 or health > 0')", true), LUA_OK);
+    ck_assert_int_ne(run("obj.units:where('team == ')", true), LUA_OK);
+    ck_assert_int_ne(run("obj.units:where({ team = 1 }, 'first')", true), LUA_OK);
+    ck_assert_int_ne(run("obj.units:where{ '>', 1 }", true), LUA_OK);
+}
+END_TEST
+
+Suite *create_suite(void) {
+    Suite *s = suite_create("array_where_method");
+
+    TCase *plans = tcase_create("plans");
+    tcase_add_checked_fixture(plans, setup, teardown);
+    tcase_add_test(plans, test_where_table);
+    tcase_add_test(plans, test_where_string);
+    tcase_add_test(plans, test_where_primitives);
+    suite_add_tcase(s, plans);
+
+    TCase *iterator = tcase_create("iterator");
+    tcase_add_checked_fixture(iterator, setup, teardown);
+    tcase_add_test(iterator, test_where_iterator);
+    suite_add_tcase(s, iterator);
+
+    TCase *errors = tcase_create("errors");
+    tcase_add_checked_fixture(errors, setup, teardown);
+    tcase_add_test(errors, test_where_errors);
+    suite_add_tcase(s, errors);
+
+    return s;
+}
+
+int main(int argc, char *argv[]) {
+    Suite *s = create_suite();
+    SRunner *sr = srunner_create(s);
+
+    if(argc > 1) {
+        srunner_run(sr, NULL, argv[1], CK_NORMAL);
+    }
+    else {
+        srunner_run_all(sr, CK_NORMAL);
+    }
+
+    int number_failed = srunner_ntests_failed(sr);
+    srunner_free(sr);
+
+    return (number_failed == 0) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
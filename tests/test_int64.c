@@ -0,0 +1,503 @@
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <check.h>
+#include <lua.h>
+#include <lualib.h>
+#include <lauxlib.h>
+#include "test_array.h"
+#include "array.h"
+#include "simd.h"
+#include "debug.h"
+
+#define HANDLE_COUNT 1000
+#define EVENT_COUNT 4
+
+typedef struct Event {
+    uint64_t timestamp;
+    int32_t code;
+} Event;
+
+typedef struct Registry {
+    int32_t version;
+    int64_t offset;
+    uint64_t handle;
+    uint64_t checked;
+    uint64_t approximate;
+    int64_t deltas[HANDLE_COUNT];
+    uint64_t handles[HANDLE_COUNT];
+    uint64_t strict[EVENT_COUNT];
+    uint64_t loose[EVENT_COUNT];
+    Event events[EVENT_COUNT];
+} Registry;
+
+static lua_State *state = NULL;
+static Registry registry;
+
+void setup(void) {
+    state = luaL_newstate();
+    luaL_openlibs(state);
+
+    LUAS_STRUCT(state, Event);
+    LUAS_PRIMITIVE_FIELD(state, Event, timestamp, LUAST_UINT64, 0);
+    LUAS_PRIMITIVE_FIELD(state, Event, code, LUAST_INT32, 0);
+    lua_pop(state, 1);
+
+    LUAS_STRUCT(state, Registry);
+    LUAS_PRIMITIVE_FIELD(state, Registry, offset, LUAST_INT64, 0);
+    LUAS_PRIMITIVE_FIELD(state, Registry, handle, LUAST_UINT64, 0);
+    LUAS_PRIMITIVE_FIELD(state, Registry, checked, LUAST_UINT64, 0);
+    LUAS_PRIMITIVE_FIELD(state, Registry, approximate, LUAST_UINT64, 0);
+    LUAS_PRIMITIVE_ARRAY_FIELD(state, Registry, deltas, LUAST_INT64, 0);
+    LUAS_PRIMITIVE_ARRAY_FIELD(state, Registry, handles, LUAST_UINT64, 0);
+    LUAS_PRIMITIVE_ARRAY_FIELD(state, Registry, strict, LUAST_UINT64, 0);
+    LUAS_PRIMITIVE_ARRAY_FIELD(state, Registry, loose, LUAST_UINT64, 0);
+    LUAS_OBJREF_ARRAY_FIELD(state, Registry, events, Event, 0);
+    LUAS_FIELD_OVERFLOW(state, Registry, checked, LUAS_OVERFLOW_ERROR);
+    LUAS_FIELD_OVERFLOW(state, Registry, approximate, LUAS_OVERFLOW_FLOAT);
+    LUAS_FIELD_OVERFLOW(state, Registry, strict, LUAS_OVERFLOW_ERROR);
+    LUAS_FIELD_OVERFLOW(state, Registry, loose, LUAS_OVERFLOW_FLOAT);
+    lua_pop(state, 1);
+
+    lua_pushcfunction(state, luastruct_newarray);
+    lua_setglobal(state, "newarray");
+
+    memset(&registry, 0, sizeof(registry));
+    for(int i = 0; i < HANDLE_COUNT; i++) {
+        registry.deltas[i] = (i % 2 ? -1 : 1) * ((int64_t)i << 33);
+        registry.handles[i] = ((uint64_t)i << 40) + 7;
+    }
+    for(int i = 0; i < EVENT_COUNT; i++) {
+        registry.events[i].timestamp = UINT64_MAX - i;
+        registry.events[i].code = i + 1;
+    }
+}
+
+void teardown(void) {
+    simd_set_level(LUAS_SIMD_AVX2);
+    lua_gc(state, LUA_GCCOLLECT, 0);
+    lua_close(state);
+    state = NULL;
+}
+
+static int run(const char *statement) {
+    char script[2048];
+    snprintf(script, sizeof(script), "function test(obj) %s end", statement);
+    int res = luaL_dostring(state, script);
+    lua_getglobal(state, "test");
+    LUAS_OBJECT(state, Registry, &registry, false);
+    res = lua_pcall(state, 1, 0, 0);
+    if(res != LUA_OK) {
+        lua_pop(state, 1);
+    }
+    return res;
+}
+
+START_TEST(test_fields) {
+    registry.offset = INT64_MIN;
+    registry.handle = (uint64_t)1 << 62;
+    ck_assert_int_eq(run(
+        "assert(obj.offset == math.mininteger and math.type(obj.offset) == 'integer') "
+        "assert(obj.handle == 1 << 62) "
+        "obj.offset = math.maxinteger "
+        "obj.handle = 0x0123456789ABCDEF "), LUA_OK);
+    ck_assert(registry.offset == INT64_MAX);
+    ck_assert(registry.handle == 0x0123456789ABCDEFull);
+    ck_assert_int_ne(run("obj.offset = 1.5"), LUA_OK);
+    ck_assert_int_ne(run("obj.handle = 'abc'"), LUA_OK);
+}
+END_TEST
+
+START_TEST(test_field_policies) {
+    registry.handle = UINT64_MAX;
+    registry.checked = UINT64_MAX;
+    registry.approximate = (uint64_t)1 << 63;
+    ck_assert_int_eq(run(
+        "assert(obj.handle == -1) "
+        "assert(obj.approximate == 2^63 and math.type(obj.approximate) == 'float') "
+        "obj.handle = -2 "
+        "obj.approximate = 2^64 - 2^11 "), LUA_OK);
+    ck_assert(registry.handle == UINT64_MAX - 1);
+    ck_assert(registry.approximate == UINT64_MAX - 2047);
+    ck_assert_int_ne(run("return obj.checked"), LUA_OK);
+    ck_assert_int_ne(run("obj.checked = -1"), LUA_OK);
+    ck_assert_int_ne(run("obj.approximate = -1"), LUA_OK);
+    ck_assert_int_ne(run("obj.approximate = 2^64"), LUA_OK);
+    ck_assert_int_ne(run("obj.approximate = 0.5"), LUA_OK);
+
+    // Values that fit a Lua integer are integers under every policy
+    registry.checked = 42;
+    registry.approximate = 42;
+    ck_assert_int_eq(run(
+        "assert(math.type(obj.checked) == 'integer' and obj.checked == 42) "
+        "assert(math.type(obj.approximate) == 'integer' and obj.approximate == 42) "
+        "obj.checked = math.maxinteger "), LUA_OK);
+    ck_assert(registry.checked == (uint64_t)INT64_MAX);
+}
+END_TEST
+
+START_TEST(test_arrays) {
+    ck_assert_int_eq(run(
+        "assert(obj.deltas[2] == -(1 << 33) and obj.handles[3] == (2 << 40) + 7) "
+        "obj.deltas[1] = math.mininteger "
+        "obj.handles[1] = -1 "
+        "obj.strict[1] = math.maxinteger "
+        "obj.loose[1] = 2^63 "
+        "obj.loose[2] = 5 "
+        "assert(obj.handles[1] == -1 and obj.strict[1] == math.maxinteger) "
+        "assert(obj.loose[1] == 2^63 and math.type(obj.loose[2]) == 'integer') "
+        "assert(obj.events[1].timestamp == -1 and obj.events[4].timestamp == -4) "
+        "obj.events[2].timestamp = 1000 "), LUA_OK);
+    ck_assert(registry.deltas[0] == INT64_MIN);
+    ck_assert(registry.handles[0] == UINT64_MAX);
+    ck_assert(registry.strict[0] == (uint64_t)INT64_MAX);
+    ck_assert(registry.loose[0] == (uint64_t)1 << 63);
+    ck_assert(registry.events[1].timestamp == 1000);
+
+    registry.strict[1] = UINT64_MAX;
+    ck_assert_int_ne(run("return obj.strict[2]"), LUA_OK);
+    ck_assert_int_ne(run("obj.strict[2] = -1"), LUA_OK);
+    ck_assert_int_ne(run("obj.loose[2] = -1"), LUA_OK);
+
+    ck_assert_int_eq(run(
+        "obj.loose:assign({ 1, 2^63, 3, 2^64 - 2^11 }) "
+        "obj.strict:fill(9) "
+        "local values = newarray('uint64', 3) "
+        "values[1] = -1 "
+        "assert(values[1] == -1) "
+        "assert(obj.events:column('timestamp')[3] == -3) "), LUA_OK);
+    ck_assert(registry.loose[1] == (uint64_t)1 << 63);
+    ck_assert(registry.loose[3] == UINT64_MAX - 2047);
+    ck_assert(registry.strict[3] == 9);
+    ck_assert_int_ne(run("obj.strict:assign({ 1, -1 })"), LUA_OK);
+}
+END_TEST
+
+/**
+ * Every level must agree with the scalar loop, including the tails the
+ * vector loops leave and values with the sign bit set.
+ */
+START_TEST(test_kernels) {
+    uint64_t values[67];
+    for(size_t i = 0; i < 67; i++) {
+        values[i] = (i * 0x9E3779B97F4A7C15ull) ^ (i << 61);
+    }
+    for(LuastructSimdLevel level = LUAS_SIMD_SCALAR; level <= LUAS_SIMD_AVX2; level++) {
+        simd_set_level(level);
+        for(size_t count = 1; count <= 67; count++) {
+            uint64_t sum = 0;
+            int64_t min = INT64_MAX;
+            int64_t max = INT64_MIN;
+            uint64_t umin = UINT64_MAX;
+            uint64_t umax = 0;
+            for(size_t i = 0; i < count; i++) {
+                sum += values[i];
+                min = (int64_t)values[i] < min ? (int64_t)values[i] : min;
+                max = (int64_t)values[i] > max ? (int64_t)values[i] : max;
+                umin = values[i] < umin ? values[i] : umin;
+                umax = values[i] > umax ? values[i] : umax;
+            }
+            ck_assert(simd_sum_int64(values, count) == sum);
+            int64_t found_min = (int64_t)values[0];
+            int64_t found_max = found_min;
+            simd_minmax_int64((const int64_t *)values, count, &found_min, &found_max);
+            ck_assert(found_min == min && found_max == max);
+            uint64_t found_umin = values[0];
+            uint64_t found_umax = found_umin;
+            simd_minmax_uint64(values, count, &found_umin, &found_umax);
+            ck_assert(found_umin == umin && found_umax == umax);
+        }
+    }
+}
+END_TEST
+
+static void check_reductions(void) {
+    ck_assert_int_eq(run(
+        "local expected = 0 "
+        "for i = 0, 999 do expected = expected + (i << 40) + 7 end "
+        "assert(obj.handles:sum() == expected) "
+        "assert(obj.handles:min() == 7 and obj.handles:max() == (999 << 40) + 7) "
+        "local low, high = obj.deltas:minmax() "
+        "assert(low == -(999 << 33) and high == 998 << 33) "
+        "assert(obj.deltas:sum() == -500 * (1 << 33)) "
+        "assert(obj.handles:find((500 << 40) + 7) == 501) "), LUA_OK);
+
+    // Unsigned order puts the values above 2^63 last
+    registry.handles[600] = UINT64_MAX;
+    ck_assert_int_eq(run(
+        "assert(obj.handles:max() == -1 and obj.handles:min() == 7) "
+        "local low, high = obj.handles:minmax() "
+        "assert(low == 7 and high == -1) "
+        "assert(obj.loose:max() == 0) "), LUA_OK);
+    registry.loose[2] = UINT64_MAX;
+    ck_assert_int_eq(run("assert(obj.loose:max() == 2^64)"), LUA_OK);
+    registry.strict[2] = UINT64_MAX;
+    ck_assert_int_ne(run("return obj.strict:max()"), LUA_OK);
+}
+
+START_TEST(test_reductions_scalar) {
+    simd_set_level(LUAS_SIMD_SCALAR);
+    check_reductions();
+}
+END_TEST
+
+START_TEST(test_reductions_sse2) {
+    simd_set_level(LUAS_SIMD_SSE2);
+    check_reductions();
+}
+END_TEST
+
+START_TEST(test_reductions_avx2) {
+    simd_set_level(LUAS_SIMD_AVX2);
+    check_reductions();
+}
+END_TEST
+
+START_TEST(test_aggregate) {
+    // Aggregates of uint64 values follow the overflow policy of the array or field
+    registry.handles[600] = UINT64_MAX;
+    registry.loose[2] = UINT64_MAX;
+    ck_assert_int_eq(run(
+        "local stats = obj.handles:aggregate({ min = true, max = true }) "
+        "assert(stats.min == 7 and stats.max == -1) "
+        "stats = obj.loose:aggregate({ sum = true, min = true, max = true }) "
+        "assert(stats.sum == 2^64 and stats.min == 0 and stats.max == 2^64) "
+        "stats = obj.events:aggregate({ min = 'timestamp' }) "
+        "assert(stats.min == -4) "), LUA_OK);
+    registry.strict[2] = UINT64_MAX;
+    ck_assert_int_ne(run("return obj.strict:aggregate({ max = true })"), LUA_OK);
+    ck_assert_int_eq(run("assert(obj.strict:aggregate({ min = true }).min == 0)"), LUA_OK);
+
+    // So do group keys and dot products
+    registry.loose[3] = (uint64_t)1 << 63;
+    ck_assert_int_eq(run(
+        "local groups = obj.loose:aggregate({ by = true, count = true }) "
+        "assert(groups[0].count == 2 and groups[2^63].count == 1 and groups[2^64].count == 1) "
+        "groups = obj.events:aggregate({ by = 'timestamp', count = true }) "
+        "assert(groups[-1].count == 1 and groups[-4].count == 1) "), LUA_OK);
+    ck_assert_int_ne(run("return obj.strict:aggregate({ by = true, count = true })"), LUA_OK);
+    registry.loose[2] = 0;
+    registry.loose[3] = 3037000500u;
+    registry.handles[0] = 3037000500u;
+    ck_assert_int_eq(run(
+        "local product = obj.loose:dot(obj.loose) "
+        "assert(math.type(product) == 'float' and product > 2^63) "
+        "assert(math.type(obj.handles:dot(obj.handles)) == 'integer') "), LUA_OK);
+    registry.strict[2] = 3037000500u;
+    ck_assert_int_ne(run("return obj.strict:dot(obj.strict)"), LUA_OK);
+}
+END_TEST
+
+START_TEST(test_sort) {
+    registry.handles[10] = UINT64_MAX;
+    registry.handles[20] = (uint64_t)1 << 63;
+    ck_assert_int_eq(run("obj.handles:sort() obj.deltas:sort(true) obj.events:sort('timestamp')"), LUA_OK);
+    for(int i = 1; i < HANDLE_COUNT; i++) {
+        ck_assert(registry.handles[i - 1] <= registry.handles[i]);
+        ck_assert(registry.deltas[i - 1] >= registry.deltas[i]);
+    }
+    ck_assert(registry.handles[HANDLE_COUNT - 1] == UINT64_MAX);
+    ck_assert(registry.handles[HANDLE_COUNT - 2] == (uint64_t)1 << 63);
+    for(int i = 1; i < EVENT_COUNT; i++) {
+        ck_assert(registry.events[i - 1].timestamp < registry.events[i].timestamp);
+    }
+    ck_assert_int_eq(registry.events[0].code, EVENT_COUNT);
+}
+END_TEST
+
+START_TEST(test_math) {
+    // Elements above LUA_MAXINTEGER are unsigned, not the negative integers they read as
+    registry.strict[0] = (uint64_t)1 << 63;
+    registry.strict[1] = UINT64_MAX - 1;
+    registry.strict[2] = 5;
+    registry.loose[0] = INT64_MAX;
+    registry.loose[1] = 1;
+    ck_assert_int_eq(run("obj.strict:add(0) obj.strict:mul(1) obj.strict:add(1)"), LUA_OK);
+    ck_assert(registry.strict[0] == ((uint64_t)1 << 63) + 1);
+    ck_assert(registry.strict[1] == UINT64_MAX);
+    ck_assert(registry.strict[2] == 6 && registry.strict[3] == 1);
+
+    ck_assert_int_ne(run("obj.strict:add(1)"), LUA_OK);
+    ck_assert(registry.strict[0] == ((uint64_t)1 << 63) + 1);
+    ck_assert_int_eq(run("obj.strict:mul(2, true)"), LUA_OK);
+    ck_assert(registry.strict[0] == UINT64_MAX && registry.strict[1] == UINT64_MAX);
+    ck_assert(registry.strict[2] == 12 && registry.strict[3] == 2);
+    ck_assert_int_ne(run("obj.strict:add(-13)"), LUA_OK);
+    ck_assert_int_eq(run("obj.strict:add(-12, true)"), LUA_OK);
+    ck_assert(registry.strict[0] == UINT64_MAX - 12 && registry.strict[2] == 0 && registry.strict[3] == 0);
+
+    ck_assert_int_eq(run("obj.strict:clamp(0, 10)"), LUA_OK);
+    ck_assert(registry.strict[0] == 10 && registry.strict[1] == 10 && registry.strict[2] == 0);
+    registry.strict[0] = (uint64_t)1 << 63;
+    ck_assert_int_eq(run("obj.strict:clamp(1, 2^64)"), LUA_OK);
+    ck_assert(registry.strict[0] == (uint64_t)1 << 63 && registry.strict[1] == 10 && registry.strict[2] == 1);
+
+    // Operands read from uint64 arrays are unsigned too
+    ck_assert_int_ne(run("obj.strict:axpy(2, obj.loose)"), LUA_OK);
+    ck_assert_int_eq(run("obj.strict:axpy(2, obj.loose, true)"), LUA_OK);
+    ck_assert(registry.strict[0] == UINT64_MAX && registry.strict[1] == 12);
+    ck_assert_int_eq(run("obj.strict:axpy(-1, obj.loose)"), LUA_OK);
+    ck_assert(registry.strict[0] == (uint64_t)1 << 63 && registry.strict[1] == 11);
+
+    ck_assert_int_eq(run("obj.strict:mul(0.5)"), LUA_OK);
+    ck_assert(registry.strict[0] == (uint64_t)1 << 62 && registry.strict[1] == 6 && registry.strict[2] == 1);
+    ck_assert_int_eq(run("obj.loose:clamp(2.2, 2.4)"), LUA_OK);
+    ck_assert(registry.loose[0] == 2 && registry.loose[1] == 2 && registry.loose[3] == 2);
+    ck_assert_int_ne(run("obj.strict:mul(-0.5)"), LUA_OK);
+    ck_assert_int_eq(run("obj.strict:mul(-0.5, true)"), LUA_OK);
+    ck_assert(registry.strict[0] == 0 && registry.strict[1] == 0);
+}
+END_TEST
+
+START_TEST(test_binary_search) {
+    // Sorted in unsigned order, so the values at and above 2^63 come last
+    registry.handles[HANDLE_COUNT - 3] = (uint64_t)1 << 63;
+    registry.handles[HANDLE_COUNT - 2] = UINT64_MAX - 1;
+    registry.handles[HANDLE_COUNT - 1] = UINT64_MAX;
+    registry.loose[0] = 1;
+    registry.loose[1] = 2;
+    registry.loose[2] = (uint64_t)1 << 63;
+    registry.loose[3] = UINT64_MAX - 2047;
+    ck_assert_int_eq(run(
+        "local handles = obj.handles "
+        "assert(handles:bsearch(7) == 1 and handles:bsearch(-1) == 1000 and handles:bsearch(5) == nil) "
+        "assert(handles:lower_bound(-2) == 999 and handles:lower_bound(math.mininteger) == 998) "
+        "assert(handles:upper_bound(-1) == 1001 and handles:lower_bound(2^63) == 998) "
+        "local loose = obj.loose "
+        "assert(loose:bsearch(2) == 2 and loose:lower_bound(3) == 3 and loose:lower_bound(-1) == 1) "
+        "assert(loose:bsearch(loose[3]) == 3 and loose:bsearch(loose[4]) == 4 and loose:upper_bound(2^64) == 5) "
+        "obj.events:sort('timestamp') "
+        "assert(obj.events:lower_bound('timestamp', 3) == 1 and obj.events:lower_bound('timestamp', -3) == 2) "
+        "assert(obj.events:bsearch('timestamp', -1) == 4) "), LUA_OK);
+}
+END_TEST
+
+START_TEST(test_where) {
+    registry.handles[1] = UINT64_MAX;
+    registry.loose[0] = 1;
+    registry.loose[1] = 2;
+    registry.loose[2] = (uint64_t)1 << 63;
+    registry.loose[3] = UINT64_MAX - 2047;
+    registry.strict[3] = (uint64_t)1 << 63;
+    ck_assert_int_eq(run(
+        "local loose = obj.loose "
+        "assert(loose:where('> 5', 'count') == 2 and loose:where('> 5.0', 'count') == 2) "
+        "assert(loose:where('>= -1', 'count') == 4 and loose:where('== -2048', 'count') == 0) "
+        "local found = obj.handles:where('== -1') "
+        "assert(#found == 1 and found[1] == 2) "
+        "assert(obj.handles:where('> ' .. math.maxinteger, 'count') == 1) "
+        "assert(obj.strict:where('> 0', 'count') == 1 and obj.strict:where('~= -1', 'count') == 4) "
+        "assert(obj.events:where('timestamp > 5', 'count') == 4) "
+        "assert(obj.events:where('timestamp >= -2', 'count') == 2) "), LUA_OK);
+}
+END_TEST
+
+START_TEST(test_find) {
+    // An array finds the values it returns, including floats at and above 2^63
+    registry.handles[1] = UINT64_MAX;
+    registry.handles[2] = (uint64_t)1 << 63;
+    registry.loose[0] = 1;
+    registry.loose[1] = 2;
+    registry.loose[2] = (uint64_t)1 << 63;
+    registry.loose[3] = UINT64_MAX - 2047;
+    registry.strict[3] = UINT64_MAX;
+    ck_assert_int_eq(run(
+        "local loose = obj.loose "
+        "assert(loose:find(loose[4]) == 4 and loose:count(loose[4]) == 1 and loose:find(loose[1]) == 1) "
+        "local found = loose:indexof_all(loose[3]) "
+        "assert(#found == 1 and found[1] == 3) "
+        "assert(loose:find(-2048) == nil and loose:find(2^64) == nil and loose:find(2.5) == nil) "
+        "local handles = obj.handles "
+        "assert(handles:find(handles[2]) == 2 and handles:find(-1) == 2) "
+        "assert(handles:find(handles[3]) == 3 and handles:find(2^63) == 3) "
+        "assert(obj.strict:find(-1) == nil and obj.strict:count(0) == 3) "), LUA_OK);
+}
+END_TEST
+
+static int set_code_overflow(lua_State *state) {
+    LUAS_STRUCT(state, Event);
+    LUAS_FIELD_OVERFLOW(state, Event, code, LUAS_OVERFLOW_ERROR);
+    return 0;
+}
+
+static int set_missing_overflow(lua_State *state) {
+    LUAS_STRUCT(state, Event);
+    luastruct_set_field_overflow(state, "missing", LUAS_OVERFLOW_ERROR);
+    return 0;
+}
+
+static int set_deltas_overflow(lua_State *state) {
+    LUAS_STRUCT(state, Registry);
+    LUAS_FIELD_OVERFLOW(state, Registry, deltas, LUAS_OVERFLOW_FLOAT);
+    return 0;
+}
+
+START_TEST(test_errors) {
+    // Policies only apply to uint64 fields and arrays
+    lua_pushcfunction(state, set_code_overflow);
+    ck_assert_int_ne(lua_pcall(state, 0, 0, 0), LUA_OK);
+    lua_pushcfunction(state, set_missing_overflow);
+    ck_assert_int_ne(lua_pcall(state, 0, 0, 0), LUA_OK);
+    lua_pushcfunction(state, set_deltas_overflow);
+    ck_assert_int_ne(lua_pcall(state, 0, 0, 0), LUA_OK);
+    lua_settop(state, 0);
+
+    ck_assert_int_ne(run("obj.handles[0] = 1"), LUA_OK);
+    ck_assert_int_ne(run("obj.deltas[1] = 'abc'"), LUA_OK);
+    ck_assert_int_ne(run("obj.strict:fill(-1)"), LUA_OK);
+}
+END_TEST
+
+Suite *create_suite(void) {
+    Suite *s = suite_create("int64");
+
+    TCase *fields = tcase_create("fields");
+    tcase_add_checked_fixture(fields, setup, teardown);
+    tcase_add_test(fields, test_fields);
+    tcase_add_test(fields, test_field_policies);
+    suite_add_tcase(s, fields);
+
+    TCase *arrays = tcase_create("arrays");
+    tcase_add_checked_fixture(arrays, setup, teardown);
+    tcase_add_test(arrays, test_arrays);
+    tcase_add_test(arrays, test_sort);
+    tcase_add_test(arrays, test_math);
+    tcase_add_test(arrays, test_binary_search);
+    tcase_add_test(arrays, test_where);
+    tcase_add_test(arrays, test_find);
+    suite_add_tcase(s, arrays);
+
+    TCase *reductions = tcase_create("reductions");
+    tcase_add_checked_fixture(reductions, setup, teardown);
+    tcase_add_test(reductions, test_kernels);
+    tcase_add_test(reductions, test_reductions_scalar);
+    tcase_add_test(reductions, test_reductions_sse2);
+    tcase_add_test(reductions, test_reductions_avx2);
+    tcase_add_test(reductions, test_aggregate);
+    suite_add_tcase(s, reductions);
+
+    TCase *errors = tcase_create("errors");
+    tcase_add_checked_fixture(errors, setup, teardown);
+    tcase_add_test(errors, test_errors);
+    suite_add_tcase(s, errors);
+
+    return s;
+}
+
+int main(int argc, char *argv[]) {
+    Suite *s = create_suite();
+    SRunner *sr = srunner_create(s);
+
+    if(argc > 1) {
+        srunner_run(sr, NULL, argv[1], CK_NORMAL);
+    }
+    else {
+        srunner_run_all(sr, CK_NORMAL);
+    }
+
+    int number_failed = srunner_ntests_failed(sr);
+    srunner_free(sr);
+
+    return (number_failed == 0) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
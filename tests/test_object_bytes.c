@@ -0,0 +1,107 @@
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <check.h>
+#include <lua.h>
+#include <lualib.h>
+#include <lauxlib.h>
+#include "test_object.h"
+#include "debug.h"
+
+static lua_State *state = NULL;
+static TestStruct test_struct;
+
+void setup(void) {
+    state = luaL_newstate();
+    luaL_openlibs(state);
+    init_test_struct(&test_struct);
+    define_test_struct(state);
+    LUAS_OBJECT(state, TestStruct, &test_struct, false);
+}
+
+void teardown(void) {
+    lua_gc(state, LUA_GCCOLLECT, 0);
+    lua_close(state);
+    state = NULL;
+}
+
+START_TEST(test_tobytes) {
+    test_struct.int32 = -123456;
+    test_struct.number = 1.5f;
+    test_struct.sub_struct.a = 42;
+    int res = luaL_dostring(state, "function test(obj) return obj:tobytes(), obj.sub_struct:tobytes() end");
+    lua_getglobal(state, "test");
+    lua_pushvalue(state, -2);
+    ck_assert_int_eq(lua_pcall(state, 1, 2, 0), LUA_OK);
+    size_t length;
+    const char *bytes = lua_tolstring(state, -2, &length);
+    ck_assert_int_eq(length, sizeof(TestStruct));
+    ck_assert_int_eq(memcmp(bytes, &test_struct, length), 0);
+    bytes = lua_tolstring(state, -1, &length);
+    ck_assert_int_eq(length, sizeof(SubStruct));
+    ck_assert_int_eq(memcmp(bytes, &test_struct.sub_struct, length), 0);
+    lua_pop(state, 2);
+}
+END_TEST
+
+START_TEST(test_frombytes) {
+    SubStruct source = { 7, -8, 9, { 1, 2, 3, 4, 5 } };
+    int res = luaL_dostring(state, "function test(obj, bytes) obj.sub_struct:frombytes(bytes) end");
+    lua_getglobal(state, "test");
+    lua_pushvalue(state, -2);
+    lua_pushlstring(state, (const char *)&source, sizeof(source));
+    ck_assert_int_eq(lua_pcall(state, 2, 0, 0), LUA_OK);
+    ck_assert_int_eq(memcmp(&test_struct.sub_struct, &source, sizeof(source)), 0);
+}
+END_TEST
+
+START_TEST(test_frombytes_bad_length) {
+    int res = luaL_dostring(state, "function test(obj) obj.sub_struct:frombytes('abc') end");
+    lua_getglobal(state, "test");
+    lua_pushvalue(state, -2);
+    ck_assert_int_ne(lua_pcall(state, 1, 0, 0), LUA_OK);
+    lua_pop(state, 1);
+    ck_assert_int_eq(test_struct.sub_struct.a, 0);
+}
+END_TEST
+
+START_TEST(test_frombytes_readonly) {
+    int res = luaL_dostring(state, "function test(obj) obj:frombytes(string.rep('\\255', #obj:tobytes())) end");
+    lua_getglobal(state, "test");
+    LUAS_OBJECT(state, TestStruct, &test_struct, true);
+    ck_assert_int_ne(lua_pcall(state, 1, 0, 0), LUA_OK);
+    lua_pop(state, 1);
+    ck_assert_int_eq(test_struct.int32, 0);
+}
+END_TEST
+
+Suite *create_suite(void) {
+    Suite *s = suite_create("object_bytes_methods");
+
+    TCase *bytes = tcase_create("bytes");
+    tcase_add_checked_fixture(bytes, setup, teardown);
+    tcase_add_test(bytes, test_tobytes);
+    tcase_add_test(bytes, test_frombytes);
+    tcase_add_test(bytes, test_frombytes_bad_length);
+    tcase_add_test(bytes, test_frombytes_readonly);
+    suite_add_tcase(s, bytes);
+
+    return s;
+}
+
+int main(int argc, char *argv[]) {
+    Suite *s = create_suite();
+    SRunner *sr = srunner_create(s);
+
+    if(argc > 1) {
+        srunner_run(sr, NULL, argv[1], CK_NORMAL);
+    }
+    else {
+        srunner_run_all(sr, CK_NORMAL);
+    }
+
+    int number_failed = srunner_ntests_failed(sr);
+    srunner_free(sr);
+
+    return (number_failed == 0) ? EXIT_SUCCESS : EXIT_FAILURE;
+}